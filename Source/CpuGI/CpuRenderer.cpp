@@ -0,0 +1,428 @@
+#include "CpuRenderer.h"
+#include "RectGICpu.h"
+#include "SGReflectKernel.h"
+#include "../Render/Profiler.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <cassert>
+#include <cstring>
+
+// Shading points of one row job in SoA layout, one batch per reflector plane.
+struct FReflectBatches
+{
+	struct FBatch
+	{
+		// position, normal and roughness arrays of FSGShadingPoints
+		vector<float> mInputs[7];
+		// image pixel of each shading point
+		vector<int> mPixels;
+	};
+
+	// batches by plane index, grown to the rect count of the scene
+	vector<FBatch> mBatches;
+	// planes with a non-empty batch, in order of first use
+	vector<int> mUsedPlanes;
+
+	// Queue a shading point against a reflector.
+	void Add(int InPlane, int InPixel, const float3& InPos, const float3& InNormal, float InRoughness)
+	{
+		if (InPlane >= (int)mBatches.size())
+		{
+			mBatches.resize(InPlane + 1);
+		}
+
+		FBatch& Batch = mBatches[InPlane];
+		if (Batch.mPixels.empty())
+		{
+			mUsedPlanes.push_back(InPlane);
+		}
+
+		const float Values[7] = { InPos.x, InPos.y, InPos.z, InNormal.x, InNormal.y, InNormal.z, InRoughness };
+		for (int i = 0; i < 7; ++i)
+		{
+			Batch.mInputs[i].push_back(Values[i]);
+		}
+		Batch.mPixels.push_back(InPixel);
+	}
+
+	// Empty all batches, keeping their memory.
+	void Clear()
+	{
+		for (int Plane : mUsedPlanes)
+		{
+			FBatch& Batch = mBatches[Plane];
+			for (vector<float>& Input : Batch.mInputs)
+			{
+				Input.clear();
+			}
+			Batch.mPixels.clear();
+		}
+		mUsedPlanes.clear();
+	}
+};
+
+FCpuScene::FCpuScene()
+{
+	memset(&mPerFrame, 0, sizeof(mPerFrame));
+
+	mCamera.mEye = XMFLOAT3(0.f, -30.f, -20.f);
+	mCamera.mLookAt = XMFLOAT3(0.f, 0.f, 0.f);
+	mCamera.mUp = XMFLOAT3(0.f, 1.f, 0.f);
+	mCamera.mFovY = XM_PI / 4;
+
+	SetLight(XMFLOAT3(0.f, 0.f, -1.f), 1.f, 1.f);
+	SetSamplingRadius(300, 100);
+	SetToggles(true, true, true);
+}
+
+int FCpuScene::AddRect(const XMFLOAT3& InCenter, const XMFLOAT3& InNormal, const XMFLOAT3& InMajorAxis,
+	float InMajorRadius, float InMinorRadius, float InRoughness, const XMFLOAT3& InDiffuseColor)
+{
+	int Index = (int)mRects.size();
+
+	// same packing as CRectStore::PackGpuRects
+	SB_PS_RECT Rect;
+	Rect.plElement0 = XMFLOAT4((float)Index, InRoughness, InMajorRadius, InMinorRadius);
+	Rect.plCenter_DiffX = XMFLOAT4(InCenter.x, InCenter.y, InCenter.z, InDiffuseColor.x);
+	Rect.plNorm_DifY = XMFLOAT4(InNormal.x, InNormal.y, InNormal.z, InDiffuseColor.y);
+	Rect.plAxis_DifZ = XMFLOAT4(InMajorAxis.x, InMajorAxis.y, InMajorAxis.z, InDiffuseColor.z);
+	mRects.push_back(Rect);
+
+	FCpuReceiver Receiver;
+	memset(&Receiver.mConstants, 0, sizeof(Receiver.mConstants));
+	Receiver.mPlaneIndex = Index;
+	Receiver.mConstants.mObjectColor = XMFLOAT4(1.f, 1.f, 1.f, 1.f);
+	Receiver.mConstants.mRoughness4.x = InRoughness;
+	Receiver.mConstants.mDiffuseColor = XMFLOAT4(InDiffuseColor.x, InDiffuseColor.y, InDiffuseColor.z, 1.f);
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; ++i)
+	{
+		Receiver.mConstants.mLinkedReflectors[i * 4] = (uint32_t)INVALID_PLANE_ID;
+	}
+	mReceivers.push_back(Receiver);
+
+	return Index;
+}
+
+void FCpuScene::LinkReflectors(int InReceiver, const vector<int>& InReflectors)
+{
+	assert(InReceiver >= 0 && InReceiver < (int)mReceivers.size());
+	assert(InReflectors.size() <= MAX_RELATED_REFLECTOR_NUM);
+
+	CB_PS_PER_OBJECT& Constants = mReceivers[InReceiver].mConstants;
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; ++i)
+	{
+		int Refl = i < (int)InReflectors.size() ? InReflectors[i] : INVALID_PLANE_ID;
+		assert(Refl != InReceiver);
+		Constants.mLinkedReflectors[i * 4] = (uint32_t)Refl;
+	}
+}
+
+void FCpuScene::SetLight(const XMFLOAT3& InLightDir, float InIntensity, float InDiffuseReflIntensity)
+{
+	mPerFrame.mLightDirAmbient = XMFLOAT4(InLightDir.x, InLightDir.y, InLightDir.z, 0.1f);
+	mPerFrame.mLightIntensity.x = InIntensity;
+	mPerFrame.mLightIntensity.z = InDiffuseReflIntensity;
+}
+
+void FCpuScene::SetSamplingRadius(float InSpecular, float InDiffuse)
+{
+	mPerFrame.mSamplingRadius.x = InSpecular;
+	mPerFrame.mSamplingRadius.y = InDiffuse;
+}
+
+void FCpuScene::SetToggles(bool bDirect, bool bIndirectSpecular, bool bIndirectDiffuse)
+{
+	mPerFrame.mToggleOptionsA[0] = bIndirectSpecular;
+	mPerFrame.mToggleOptionsA[1] = bDirect;
+	mPerFrame.mToggleOptionsA[2] = 0;
+	mPerFrame.mToggleOptionsA[3] = bIndirectDiffuse;
+}
+
+CCpuRenderer::CCpuRenderer()
+	: mRowsPerJob(4)
+	, mUseReflectKernel(true)
+	, mReflectIsa(FSGReflectKernel::GetBestIsa())
+	, mReflectMath(FSGReflectKernel::DefaultMath)
+{
+
+}
+
+void CCpuRenderer::SetReflectKernel(bool bEnable, ESimdIsa::Type InIsa)
+{
+	assert(FSGReflectKernel::IsSupported(InIsa));
+	mUseReflectKernel = bEnable;
+	mReflectIsa = InIsa;
+}
+
+void CCpuRenderer::SetReflectMath(ESimdMath::Type InMath)
+{
+	mReflectMath = InMath;
+}
+
+void CCpuRenderer::MeasureReflectMathError(const FCpuScene& InScene, int InWidth, int InHeight,
+	vector<FCpuMathImageError>& OutResults)
+{
+	CCpuRenderer Renderer;
+	Renderer.SetReflectKernel(false, ESimdIsa::Scalar);
+
+	FHdrImage Reference(InWidth, InHeight);
+	Renderer.Render(InScene, Reference);
+
+	float RefMax = 0.f;
+	for (float Value : Reference.mPixels)
+	{
+		RefMax = Value > RefMax ? Value : RefMax;
+	}
+	RefMax = RefMax > 0 ? RefMax : 1.f;
+
+	OutResults.clear();
+	Renderer.SetReflectKernel(true, FSGReflectKernel::GetBestIsa());
+	for (int Math = 0; Math < ESimdMath::Num; ++Math)
+	{
+		Renderer.SetReflectMath((ESimdMath::Type)Math);
+
+		FHdrImage Image(InWidth, InHeight);
+		FCpuRenderStats Stats = Renderer.Render(InScene, Image);
+
+		double MaxError = 0;
+		double SquaredError = 0;
+		for (size_t i = 0; i < Image.mPixels.size(); ++i)
+		{
+			double Error = std::fabs((double)Image.mPixels[i] - Reference.mPixels[i]);
+			MaxError = Error > MaxError ? Error : MaxError;
+			SquaredError += Error * Error;
+		}
+
+		FCpuMathImageError Result;
+		Result.mMath = (ESimdMath::Type)Math;
+		Result.mMaxError = (float)(MaxError / RefMax);
+		Result.mRmsError = (float)(std::sqrt(SquaredError / Image.mPixels.size()) / RefMax);
+		Result.mSeconds = Stats.mSeconds;
+		Result.bWithinBudget = Result.mMaxError <= FSGReflectKernel::GetErrorBudget(Result.mMath).mImage;
+		OutResults.push_back(Result);
+	}
+}
+
+FCpuRenderStats CCpuRenderer::Render(const FCpuScene& InScene, FHdrImage& OutImage, int InNumThreads)
+{
+	PROFILE_SCOPE("CCpuRenderer::Render");
+	assert(OutImage.mWidth > 0 && OutImage.mHeight > 0);
+
+	// the shader reads the eye position from cbPerObject
+	mReceiverConstants.resize(InScene.mReceivers.size());
+	for (size_t i = 0; i < InScene.mReceivers.size(); ++i)
+	{
+		mReceiverConstants[i] = InScene.mReceivers[i].mConstants;
+		const XMFLOAT3& Eye = InScene.mCamera.mEye;
+		mReceiverConstants[i].mCameraPos = XMFLOAT4(Eye.x, Eye.y, Eye.z, 1.f);
+	}
+
+	int NumThreads = InNumThreads > 0 ? InNumThreads : (int)thread::hardware_concurrency();
+	NumThreads = NumThreads > 0 ? NumThreads : 1;
+
+	auto StartTime = chrono::steady_clock::now();
+
+	// rows are handed out in small jobs to balance empty and covered regions
+	atomic<int> NextRow(0);
+	atomic<size_t> CoveredPixels(0);
+	auto Worker = [&]()
+	{
+		size_t Covered = 0;
+		for (;;)
+		{
+			int Row = NextRow.fetch_add(mRowsPerJob);
+			if (Row >= OutImage.mHeight)
+				break;
+
+			int EndRow = Row + mRowsPerJob < OutImage.mHeight ? Row + mRowsPerJob : OutImage.mHeight;
+			Covered += RenderRows(InScene, OutImage, Row, EndRow);
+		}
+		CoveredPixels += Covered;
+	};
+
+	vector<thread> Workers;
+	for (int i = 1; i < NumThreads; ++i)
+	{
+		Workers.emplace_back(Worker);
+	}
+	Worker();
+	for (auto& Thread : Workers)
+	{
+		Thread.join();
+	}
+
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+
+	FCpuRenderStats Stats;
+	Stats.mSeconds = Elapsed.count();
+	Stats.mPixelsPerSecond = Stats.mSeconds > 0 ? (double)OutImage.mWidth * OutImage.mHeight / Stats.mSeconds : 0;
+	Stats.mNumThreads = NumThreads;
+	Stats.mCoveredPixels = CoveredPixels;
+	return Stats;
+}
+
+size_t CCpuRenderer::RenderRows(const FCpuScene& InScene, FHdrImage& OutImage, int InBeginRow, int InEndRow)
+{
+	PROFILE_SCOPE("CCpuRenderer::RenderRows");
+	const FCpuCamera& Cam = InScene.mCamera;
+	float3 Eye(Cam.mEye.x, Cam.mEye.y, Cam.mEye.z);
+	float3 Forward = normalize(float3(Cam.mLookAt.x, Cam.mLookAt.y, Cam.mLookAt.z) - Eye);
+	float3 Right = normalize(cross(float3(Cam.mUp.x, Cam.mUp.y, Cam.mUp.z), Forward));
+	float3 Up = cross(Forward, Right);
+
+	float TanHalfFov = std::tan(Cam.mFovY * .5f);
+	float Aspect = (float)OutImage.mWidth / (float)OutImage.mHeight;
+
+	// with the kernel, specular reflections are gathered per reflector and shaded after the rows
+	bool bBatchReflections = mUseReflectKernel && InScene.mPerFrame.mToggleOptionsA[0] != 0;
+	CB_PS_PER_FRAME PerFrame = InScene.mPerFrame;
+	if (bBatchReflections)
+	{
+		PerFrame.mToggleOptionsA[0] = 0;
+	}
+	float3 LightDir = normalize(FRectGI::ToFloat3(PerFrame.mLightDirAmbient));
+
+	thread_local FReflectBatches Batches;
+	Batches.Clear();
+
+	FGIConstants Constants;
+	Constants.mPerFrame = &PerFrame;
+	Constants.mRects = InScene.mRects.data();
+
+	size_t Covered = 0;
+	for (int y = InBeginRow; y < InEndRow; ++y)
+	{
+		float NdcY = (1.f - 2.f * (y + .5f) / OutImage.mHeight) * TanHalfFov;
+		for (int x = 0; x < OutImage.mWidth; ++x)
+		{
+			float NdcX = (2.f * (x + .5f) / OutImage.mWidth - 1.f) * TanHalfFov * Aspect;
+			float3 Dir = normalize(Forward + Right * NdcX + Up * NdcY);
+
+			float HitPos[3];
+			int Receiver = TraceReceivers(InScene, &Eye.x, &Dir.x, HitPos);
+			float* Pixel = OutImage.GetPixel(x, y);
+			if (Receiver < 0)
+			{
+				Pixel[0] = Pixel[1] = Pixel[2] = 0.f;
+				continue;
+			}
+
+			int PlaneIndex = InScene.mReceivers[Receiver].mPlaneIndex;
+			Constants.mPerObject = &mReceiverConstants[Receiver];
+			float3 WorldPos(HitPos[0], HitPos[1], HitPos[2]);
+			float3 WorldNormal = normalize(FRectGI::ToFloat3(InScene.mRects[PlaneIndex].plNorm_DifY));
+			float3 Color = FRectGI::PlaneMeshPS(Constants, WorldPos, WorldNormal);
+			Pixel[0] = Color.x;
+			Pixel[1] = Color.y;
+			Pixel[2] = Color.z;
+			++Covered;
+
+			if (bBatchReflections)
+			{
+				FRectGI::SGReflectors Reflectors = FRectGI::findSpecularRelatedPlanes(Constants, WorldPos,
+					WorldNormal, LightDir);
+				for (int i = 0; i < FRectGI::MAX_REFLECTOR_NUM; ++i)
+				{
+					if (Reflectors.indices[i] >= 0)
+					{
+						Batches.Add(Reflectors.indices[i], y * OutImage.mWidth + x, WorldPos, WorldNormal,
+							mReceiverConstants[Receiver].mRoughness4.x);
+					}
+				}
+			}
+		}
+	}
+
+	if (bBatchReflections)
+	{
+		ShadeReflections(InScene, OutImage, Batches);
+	}
+
+	return Covered;
+}
+
+void CCpuRenderer::ShadeReflections(const FCpuScene& InScene, FHdrImage& OutImage, FReflectBatches& InBatches) const
+{
+	const CB_PS_PER_FRAME& F = InScene.mPerFrame;
+	const SB_PS_RECT* P = InScene.mRects.data();
+	const XMFLOAT3& Eye = InScene.mCamera.mEye;
+
+	// inputs of sgGlossyReflection
+	float3 LightDir = normalize(FRectGI::ToFloat3(F.mLightDirAmbient));
+	float3 DefaultSpecularColor = float3(1.f, 1.f, 1.f);
+
+	vector<float> Colors;
+	for (int PlaneId : InBatches.mUsedPlanes)
+	{
+		FReflectBatches::FBatch& Batch = InBatches.mBatches[PlaneId];
+		int Count = (int)Batch.mPixels.size();
+
+		FSGReflectUniforms Uniforms;
+		Uniforms.Setup(F.mSamplingRadius.x,
+			FRectGI::ToFloat3(P[PlaneId].plCenter_DiffX), FRectGI::ToFloat3(P[PlaneId].plNorm_DifY),
+			FRectGI::ToFloat3(P[PlaneId].plAxis_DifZ), DefaultSpecularColor,
+			P[PlaneId].plElement0.z, P[PlaneId].plElement0.w, P[PlaneId].plElement0.y,
+			LightDir, F.mLightIntensity.x, float3(Eye.x, Eye.y, Eye.z));
+
+		FSGShadingPoints Points = { Batch.mInputs[0].data(), Batch.mInputs[1].data(), Batch.mInputs[2].data(),
+			Batch.mInputs[3].data(), Batch.mInputs[4].data(), Batch.mInputs[5].data(), Batch.mInputs[6].data(), Count };
+
+		Colors.assign(3 * Count, 0.f);
+		PROFILE_SCOPE("FSGReflectKernel::Evaluate");
+		FSGReflectKernel::Evaluate(mReflectIsa, mReflectMath, Points, Uniforms, &Colors[0], &Colors[Count], &Colors[2 * Count]);
+
+		for (int i = 0; i < Count; ++i)
+		{
+			float* Pixel = &OutImage.mPixels[3 * (size_t)Batch.mPixels[i]];
+			Pixel[0] += Colors[i];
+			Pixel[1] += Colors[Count + i];
+			Pixel[2] += Colors[2 * Count + i];
+		}
+	}
+}
+
+int CCpuRenderer::TraceReceivers(const FCpuScene& InScene, const float* InOrigin, const float* InDir,
+	float* OutHitPos) const
+{
+	const SB_PS_RECT* P = InScene.mRects.data();
+	float3 Origin(InOrigin[0], InOrigin[1], InOrigin[2]);
+	float3 Dir(InDir[0], InDir[1], InDir[2]);
+
+	int Hit = -1;
+	float HitT = 1e30f;
+	for (size_t i = 0; i < InScene.mReceivers.size(); ++i)
+	{
+		int PlaneIndex = InScene.mReceivers[i].mPlaneIndex;
+		float3 Center = FRectGI::ToFloat3(P[PlaneIndex].plCenter_DiffX);
+		float3 Normal = normalize(FRectGI::ToFloat3(P[PlaneIndex].plNorm_DifY));
+
+		float DoN = dot(Dir, Normal);
+		if (std::fabs(DoN) < 1e-6f)
+			continue;
+
+		float t = dot(Center - Origin, Normal) / DoN;
+		if (t <= 0 || t >= HitT)
+			continue;
+
+		// rectangles are drawn without culling, test extents along both axes
+		float3 MajorAxis = normalize(FRectGI::ToFloat3(P[PlaneIndex].plAxis_DifZ));
+		float3 MinorAxis = normalize(cross(Normal, MajorAxis));
+		float3 Local = Origin + Dir * t - Center;
+		if (std::fabs(dot(Local, MajorAxis)) > P[PlaneIndex].plElement0.z ||
+			std::fabs(dot(Local, MinorAxis)) > P[PlaneIndex].plElement0.w)
+			continue;
+
+		Hit = (int)i;
+		HitT = t;
+	}
+
+	if (Hit >= 0)
+	{
+		float3 HitPos = Origin + Dir * HitT;
+		OutHitPos[0] = HitPos.x;
+		OutHitPos[1] = HitPos.y;
+		OutHitPos[2] = HitPos.z;
+	}
+	return Hit;
+}
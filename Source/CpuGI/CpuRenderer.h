@@ -0,0 +1,135 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include "../Render/ShaderBuffers.h"
+#include "HdrImage.h"
+#include "SimdIsa.h"
+
+using namespace DirectX;
+using namespace std;
+
+// Rectangle receiver drawn by the cpu renderer, same as a rect render instance using PlaneMeshPS.
+struct FCpuReceiver
+{
+	// index of the receiver geometry in mRects
+	int mPlaneIndex;
+	// constants of PlaneMeshPS for this receiver
+	CB_PS_PER_OBJECT mConstants;
+};
+
+// Pinhole camera of the cpu renderer, left handed like the DXUT camera.
+struct FCpuCamera
+{
+	// eye position
+	XMFLOAT3 mEye;
+	// look at position
+	XMFLOAT3 mLookAt;
+	// up direction
+	XMFLOAT3 mUp;
+	// vertical field of view in radians
+	float mFovY;
+};
+
+// Scene description consumed by the cpu renderer.
+// Uses the same constant layouts as the D3D11 path, so a scene can either be captured
+// from the running engine or built directly on machines without D3D.
+class FCpuScene
+{
+public:
+	FCpuScene();
+
+	// Add a rectangle which is both a receiver and a reflector, returns its plane index.
+	int AddRect(const XMFLOAT3& InCenter, const XMFLOAT3& InNormal, const XMFLOAT3& InMajorAxis,
+		float InMajorRadius, float InMinorRadius, float InRoughness, const XMFLOAT3& InDiffuseColor);
+	// Link possible reflectors to a receiver.
+	void LinkReflectors(int InReceiver, const vector<int>& InReflectors);
+
+	// Set the distant light.
+	void SetLight(const XMFLOAT3& InLightDir, float InIntensity, float InDiffuseReflIntensity);
+	// Set sampling radius for specular and diffuse indirect lighting.
+	void SetSamplingRadius(float InSpecular, float InDiffuse);
+	// Toggle lighting components.
+	void SetToggles(bool bDirect, bool bIndirectSpecular, bool bIndirectDiffuse);
+
+public:
+	// constants: psPerFrame
+	CB_PS_PER_FRAME mPerFrame;
+	// structured buffer: psRects
+	vector<SB_PS_RECT> mRects;
+	// all receivers
+	vector<FCpuReceiver> mReceivers;
+	// view
+	FCpuCamera mCamera;
+};
+
+// Timing of a cpu render.
+struct FCpuRenderStats
+{
+	// wall time in seconds
+	double mSeconds;
+	// shaded pixels per second
+	double mPixelsPerSecond;
+	// worker threads used
+	int mNumThreads;
+	// pixels covered by a receiver
+	size_t mCoveredPixels;
+};
+
+// Image error of an exp/log policy of the reflection kernel against the per pixel libm path.
+struct FCpuMathImageError
+{
+	// exp/log policy
+	ESimdMath::Type mMath;
+	// max channel error divided by the max channel value of the reference
+	float mMaxError;
+	// root mean square channel error divided by the max channel value of the reference
+	float mRmsError;
+	// render time with this policy
+	double mSeconds;
+	// mMaxError is within the image budget of FSGReflectKernel::GetErrorBudget
+	bool bWithinBudget;
+};
+
+// Shading points gathered per reflector.
+struct FReflectBatches;
+
+// Headless reference renderer evaluating PlaneMeshPS on the cpu.
+class CCpuRenderer
+{
+public:
+	CCpuRenderer();
+
+	// Render the scene into the image, using InNumThreads workers (0: all cores).
+	FCpuRenderStats Render(const FCpuScene& InScene, FHdrImage& OutImage, int InNumThreads = 0);
+
+	// Evaluate specular reflections with the packet kernel instead of per pixel FRectGI calls.
+	void SetReflectKernel(bool bEnable, ESimdIsa::Type InIsa);
+	// Select the exp/log policy of the reflection kernel.
+	void SetReflectMath(ESimdMath::Type InMath);
+
+	// Render the scene with every exp/log policy and compare the images against the per pixel libm path.
+	static void MeasureReflectMathError(const FCpuScene& InScene, int InWidth, int InHeight,
+		vector<FCpuMathImageError>& OutResults);
+
+private:
+	// Render rows [InBeginRow, InEndRow).
+	size_t RenderRows(const FCpuScene& InScene, FHdrImage& OutImage, int InBeginRow, int InEndRow);
+
+	// Add specular reflections of the gathered shading points to the image.
+	void ShadeReflections(const FCpuScene& InScene, FHdrImage& OutImage, FReflectBatches& InBatches) const;
+
+	// Intersect a view ray against all receivers, returns the receiver index or -1.
+	int TraceReceivers(const FCpuScene& InScene, const float* InOrigin, const float* InDir, float* OutHitPos) const;
+
+private:
+	// per receiver constants with the camera position patched in
+	vector<CB_PS_PER_OBJECT> mReceiverConstants;
+	// rows handed out per job
+	int mRowsPerJob;
+	// use FSGReflectKernel for specular reflections
+	bool mUseReflectKernel;
+	// instruction set of the reflection kernel
+	ESimdIsa::Type mReflectIsa;
+	// exp/log policy of the reflection kernel
+	ESimdMath::Type mReflectMath;
+};
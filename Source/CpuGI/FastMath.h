@@ -0,0 +1,190 @@
+#pragma once
+#include "SimdMath.h"
+#include "SGLightingLut.h"
+
+// exp/log policies for the packet kernels, every policy works on all lane types of SimdMath.h
+// (FSimdScalar being the scalar variant). Use as M::template Exp<S>(x).
+//
+// Argument ranges seen by the SG math:
+//	exp: sgProductIntegral factor in [-10, 0] (smaller is masked to 0),
+//	     gIntegrateDiskLighting -k * sinThetaA2 in (-inf, 0.673]
+//	log: asgCalcBandwidth 1 + dr * dr in [1, inf)
+// Besides Exp and Log every policy provides the two composite terms of the SG math, so a policy
+// can also replace them as a whole (FMathLut).
+namespace
+{
+	// Composite terms built from Exp and Log of policy M.
+	template<class M>
+	struct TMathTerms
+	{
+		// 1 - exp(-t) of gIntegrateDiskLighting.
+		template<class S>
+		static typename S::Float OneMinusExp(typename S::Float t)
+		{
+			return S::Set1(1.f) - M::template Exp<S>(-t);
+		}
+
+		// asgCalcBandwidth(dr) from dr * dr.
+		template<class S>
+		static typename S::Float AsgBandwidth(typename S::Float dr2)
+		{
+			typedef typename S::Float Float;
+			const Float One = S::Set1(1.f);
+			Float bw = -((One + dr2) * (S::Set1(-5.991f) + M::template Log<S>(One + dr2))) / (S::Set1(2.f) * dr2);
+			return S::Max(S::Set1(4.60517f), bw);
+		}
+	};
+
+	// Reference: std::exp / std::log lane by lane.
+	struct FMathLibm : public TMathTerms<FMathLibm>
+	{
+		template<class S>
+		static typename S::Float Exp(typename S::Float x)
+		{
+			float Lanes[S::Width];
+			S::Store(Lanes, x);
+			for (int i = 0; i < S::Width; ++i)
+			{
+				Lanes[i] = std::exp(Lanes[i]);
+			}
+			return S::Load(Lanes);
+		}
+
+		template<class S>
+		static typename S::Float Log(typename S::Float x)
+		{
+			float Lanes[S::Width];
+			S::Store(Lanes, x);
+			for (int i = 0; i < S::Width; ++i)
+			{
+				Lanes[i] = std::log(Lanes[i]);
+			}
+			return S::Load(Lanes);
+		}
+	};
+
+	// Cephes polynomials, ~1 ulp over the whole float range.
+	struct FMathPrecise : public TMathTerms<FMathPrecise>
+	{
+		// exp(x), degree 7, x clamped to the finite result range.
+		template<class S>
+		static typename S::Float Exp(typename S::Float x)
+		{
+			typedef typename S::Float Float;
+			x = S::Min(S::Max(x, S::Set1(-87.3365f)), S::Set1(88.3762f));
+
+			// x = n * ln2 + r, |r| <= ln2 / 2, ln2 split in two parts
+			Float n = S::Round(x * S::Set1(1.44269504088896341f));
+			Float r = x - n * S::Set1(0.693359375f) - n * S::Set1(-2.12194440e-4f);
+
+			Float p = S::Set1(1.9875691500E-4f);
+			p = p * r + S::Set1(1.3981999507E-3f);
+			p = p * r + S::Set1(8.3334519073E-3f);
+			p = p * r + S::Set1(4.1665795894E-2f);
+			p = p * r + S::Set1(1.6666665459E-1f);
+			p = p * r + S::Set1(5.0000001201E-1f);
+			p = p * (r * r) + r + S::Set1(1.f);
+
+			return p * S::Pow2i(n);
+		}
+
+		// log(x) for positive normal x, degree 10.
+		template<class S>
+		static typename S::Float Log(typename S::Float x)
+		{
+			typedef typename S::Float Float;
+			Float e;
+			Float m = S::Frexp(x, e);
+
+			// fold mantissa into [sqrt(0.5), sqrt(2))
+			typename S::Mask Small = S::Less(m, S::Set1(0.707106781186547524f));
+			e = S::Select(Small, e - S::Set1(1.f), e);
+			m = S::Select(Small, m + m, m) - S::Set1(1.f);
+
+			Float z = m * m;
+			Float p = S::Set1(7.0376836292E-2f);
+			p = p * m + S::Set1(-1.1514610310E-1f);
+			p = p * m + S::Set1(1.1676998740E-1f);
+			p = p * m + S::Set1(-1.2420140846E-1f);
+			p = p * m + S::Set1(1.4249322787E-1f);
+			p = p * m + S::Set1(-1.6668057665E-1f);
+			p = p * m + S::Set1(2.0000714765E-1f);
+			p = p * m + S::Set1(-2.4999993993E-1f);
+			p = p * m + S::Set1(3.3333331174E-1f);
+			p = p * m * z;
+
+			p = p + e * S::Set1(-2.12194440e-4f);
+			p = p - z * S::Set1(.5f);
+			return m + p + e * S::Set1(0.693359375f);
+		}
+	};
+
+	// Low degree least squares fits, ~1.5e-5 relative error for exp and absolute error for log.
+	struct FMathFast : public TMathTerms<FMathFast>
+	{
+		// exp(x), degree 4. The single constant ln2 reduction loses precision for |x| >> 10,
+		// which only happens where the result underflows to ~0 relative to the other terms.
+		template<class S>
+		static typename S::Float Exp(typename S::Float x)
+		{
+			typedef typename S::Float Float;
+			x = S::Min(S::Max(x, S::Set1(-87.3365f)), S::Set1(88.3762f));
+
+			Float n = S::Round(x * S::Set1(1.44269504088896341f));
+			Float r = x - n * S::Set1(0.693147180559945309f);
+
+			Float p = S::Set1(4.1833826e-2f);
+			p = p * r + S::Set1(1.6741917e-1f);
+			p = p * r + S::Set1(4.9999749e-1f);
+			p = p * (r * r) + r + S::Set1(1.f);
+
+			return p * S::Pow2i(n);
+		}
+
+		// log(x) for positive normal x, degree 6.
+		template<class S>
+		static typename S::Float Log(typename S::Float x)
+		{
+			typedef typename S::Float Float;
+			Float e;
+			Float m = S::Frexp(x, e);
+
+			typename S::Mask Small = S::Less(m, S::Set1(0.707106781186547524f));
+			e = S::Select(Small, e - S::Set1(1.f), e);
+			m = S::Select(Small, m + m, m) - S::Set1(1.f);
+
+			Float z = m * m;
+			Float p = S::Set1(-1.5188585e-1f);
+			p = p * m + S::Set1(2.1523051e-1f);
+			p = p * m + S::Set1(-2.5138352e-1f);
+			p = p * m + S::Set1(3.3311831e-1f);
+			p = p * m * z;
+
+			return m - z * S::Set1(.5f) + p + e * S::Set1(0.693147180559945309f);
+		}
+	};
+
+	// FMathFast with the float16 tables of FSGLightingLut for the composite terms.
+	struct FMathLut : public FMathFast
+	{
+		template<class S>
+		static typename S::Float OneMinusExp(typename S::Float t)
+		{
+			typedef typename S::Float Float;
+			Float x = t + S::Set1(FSGLightingLut::DiskOffset);
+			Float InvScale = S::Set1(1.f) / (x + S::Set1(FSGLightingLut::DiskScale));
+			const float* Row = FSGLightingLut::GetTexels() + FSGLightingLut::DiskLightingRow * FSGLightingLut::Width;
+			Float Scaled = S::LerpTable(Row, FSGLightingLut::Width, x * InvScale * S::Set1(FSGLightingLut::Width - 1.f));
+			return t * Scaled * InvScale;
+		}
+
+		template<class S>
+		static typename S::Float AsgBandwidth(typename S::Float dr2)
+		{
+			const float* Row = FSGLightingLut::GetTexels() + FSGLightingLut::BandwidthRow * FSGLightingLut::Width;
+			typename S::Float Numerator = S::LerpTable(Row, FSGLightingLut::Width,
+				dr2 * S::Set1((FSGLightingLut::Width - 1) / FSGLightingLut::BandwidthMaxX));
+			return S::Max(S::Set1(4.60517f), Numerator / dr2);
+		}
+	};
+}
\ No newline at end of file
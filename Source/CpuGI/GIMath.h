@@ -0,0 +1,52 @@
+#pragma once
+#include <cmath>
+#include <algorithm>
+
+// Minimal HLSL-like vector math so that the shading code in Shaders/RectGI.hlsl
+// can be ported to c++ almost line by line. Only depends on the standard library.
+namespace GIMath
+{
+	static const float PI = 3.1415926535897932384626433832795f;
+
+	struct float2
+	{
+		float x, y;
+
+		float2() : x(0), y(0) {}
+		float2(float InX, float InY) : x(InX), y(InY) {}
+	};
+
+	struct float3
+	{
+		float x, y, z;
+
+		float3() : x(0), y(0), z(0) {}
+		explicit float3(float InV) : x(InV), y(InV), z(InV) {}
+		float3(float InX, float InY, float InZ) : x(InX), y(InY), z(InZ) {}
+
+		float3& operator+=(const float3& b) { x += b.x; y += b.y; z += b.z; return *this; }
+		float3& operator-=(const float3& b) { x -= b.x; y -= b.y; z -= b.z; return *this; }
+		float3& operator*=(float s) { x *= s; y *= s; z *= s; return *this; }
+	};
+
+	inline float3 operator+(const float3& a, const float3& b) { return float3(a.x + b.x, a.y + b.y, a.z + b.z); }
+	inline float3 operator-(const float3& a, const float3& b) { return float3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	inline float3 operator-(const float3& a) { return float3(-a.x, -a.y, -a.z); }
+	inline float3 operator*(const float3& a, const float3& b) { return float3(a.x * b.x, a.y * b.y, a.z * b.z); }
+	inline float3 operator*(const float3& a, float s) { return float3(a.x * s, a.y * s, a.z * s); }
+	inline float3 operator*(float s, const float3& a) { return float3(a.x * s, a.y * s, a.z * s); }
+	inline float3 operator/(const float3& a, float s) { return float3(a.x / s, a.y / s, a.z / s); }
+
+	inline float dot(const float3& a, const float3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	inline float3 cross(const float3& a, const float3& b)
+	{
+		return float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+	inline float length(const float3& a) { return std::sqrt(dot(a, a)); }
+	inline float3 normalize(const float3& a) { return a * (1.f / length(a)); }
+
+	inline float saturate(float v) { return std::min(std::max(v, 0.f), 1.f); }
+	inline float rcp(float v) { return 1.f / v; }
+	inline float max(float a, float b) { return std::max(a, b); }
+	inline float min(float a, float b) { return std::min(a, b); }
+}
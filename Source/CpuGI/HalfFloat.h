@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// IEEE 754 binary16 conversion, bit exact with DXGI_FORMAT_R16_FLOAT and DirectX::PackedVector::HALF.
+namespace HalfFloat
+{
+	// Convert with round to nearest even, overflow becomes infinity.
+	inline uint16_t FromFloat(float InValue)
+	{
+		uint32_t Bits;
+		memcpy(&Bits, &InValue, sizeof(Bits));
+
+		uint32_t Sign = (Bits >> 16) & 0x8000;
+		uint32_t Abs = Bits & 0x7fffffff;
+
+		// nan and infinity
+		if (Abs >= 0x7f800000)
+			return (uint16_t)(Sign | 0x7c00 | (Abs > 0x7f800000 ? 0x200 : 0));
+
+		// overflow, 65520 rounds to infinity
+		if (Abs >= 0x477ff000)
+			return (uint16_t)(Sign | 0x7c00);
+
+		// normal half
+		if (Abs >= 0x38800000)
+		{
+			uint32_t Rounded = Abs + 0xfff + ((Abs >> 13) & 1);
+			return (uint16_t)(Sign | ((Rounded - 0x38000000) >> 13));
+		}
+
+		// subnormal half or zero
+		if (Abs < 0x33000000)
+			return (uint16_t)Sign;
+
+		uint32_t Exp = Abs >> 23;
+		uint32_t Mantissa = (Abs & 0x7fffff) | 0x800000;
+		uint32_t Shift = 126 - Exp;
+		uint32_t Half = Mantissa >> Shift;
+		uint32_t Rest = Mantissa & ((1u << Shift) - 1);
+		uint32_t Midpoint = 1u << (Shift - 1);
+		if (Rest > Midpoint || (Rest == Midpoint && (Half & 1)))
+			++Half;
+		return (uint16_t)(Sign | Half);
+	}
+
+	// Convert exactly.
+	inline float ToFloat(uint16_t InValue)
+	{
+		uint32_t Sign = (uint32_t)(InValue & 0x8000) << 16;
+		uint32_t Exp = (InValue >> 10) & 0x1f;
+		uint32_t Mantissa = InValue & 0x3ff;
+
+		uint32_t Bits;
+		if (Exp == 0x1f)
+		{
+			Bits = Sign | 0x7f800000 | (Mantissa << 13);
+		}
+		else if (Exp != 0)
+		{
+			Bits = Sign | ((Exp + 112) << 23) | (Mantissa << 13);
+		}
+		else if (Mantissa != 0)
+		{
+			// renormalize the subnormal
+			Exp = 113;
+			while ((Mantissa & 0x400) == 0)
+			{
+				Mantissa <<= 1;
+				--Exp;
+			}
+			Bits = Sign | (Exp << 23) | ((Mantissa & 0x3ff) << 13);
+		}
+		else
+		{
+			Bits = Sign;
+		}
+
+		float Ret;
+		memcpy(&Ret, &Bits, sizeof(Ret));
+		return Ret;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "HdrImage.h"
+#include "../Render/FileUtil.h"
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+FHdrImage::FHdrImage()
+	: mWidth(0)
+	, mHeight(0)
+{
+
+}
+
+FHdrImage::FHdrImage(int InWidth, int InHeight)
+	: mWidth(0)
+	, mHeight(0)
+{
+	Resize(InWidth, InHeight);
+}
+
+void FHdrImage::Resize(int InWidth, int InHeight)
+{
+	mWidth = InWidth;
+	mHeight = InHeight;
+	mPixels.assign((size_t)InWidth * InHeight * 3, 0.f);
+}
+
+bool FHdrImage::SavePFM(const string& InFileName) const
+{
+	FILE* fp = OpenFile(InFileName.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+
+	// negative scale marks little endian data
+	fprintf(fp, "PF\n%d %d\n-1.0\n", mWidth, mHeight);
+	// pfm stores rows from bottom to top
+	for (int y = mHeight - 1; y >= 0; --y)
+	{
+		fwrite(GetPixel(0, y), sizeof(float), (size_t)mWidth * 3, fp);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+// Append raw bytes to an exr stream.
+static void ExrWrite(vector<uint8_t>& Out, const void* InData, size_t InSize)
+{
+	const uint8_t* Bytes = (const uint8_t*)InData;
+	Out.insert(Out.end(), Bytes, Bytes + InSize);
+}
+
+// Append a null terminated string to an exr stream.
+static void ExrWriteString(vector<uint8_t>& Out, const char* InStr)
+{
+	ExrWrite(Out, InStr, strlen(InStr) + 1);
+}
+
+// Append an attribute header, followed by the attribute value.
+static void ExrWriteAttribute(vector<uint8_t>& Out, const char* InName, const char* InType,
+	const void* InValue, int32_t InSize)
+{
+	ExrWriteString(Out, InName);
+	ExrWriteString(Out, InType);
+	ExrWrite(Out, &InSize, sizeof(InSize));
+	ExrWrite(Out, InValue, InSize);
+}
+
+bool FHdrImage::SaveEXR(const string& InFileName) const
+{
+	vector<uint8_t> Header;
+
+	// magic number and version 2, single part scanline file
+	const int32_t Magic = 20000630;
+	const int32_t Version = 2;
+	ExrWrite(Header, &Magic, sizeof(Magic));
+	ExrWrite(Header, &Version, sizeof(Version));
+
+	// channels are stored in alphabetical order
+	const char* ChannelNames[3] = { "B", "G", "R" };
+	const int ChannelOffsets[3] = { 2, 1, 0 };
+	vector<uint8_t> ChList;
+	for (int c = 0; c < 3; ++c)
+	{
+		// pixel type 2: FLOAT, pLinear, 3 reserved bytes, x/y sampling
+		const int32_t PixelType = 2;
+		const uint8_t Linear[4] = { 0, 0, 0, 0 };
+		const int32_t Sampling[2] = { 1, 1 };
+		ExrWriteString(ChList, ChannelNames[c]);
+		ExrWrite(ChList, &PixelType, sizeof(PixelType));
+		ExrWrite(ChList, Linear, sizeof(Linear));
+		ExrWrite(ChList, Sampling, sizeof(Sampling));
+	}
+	ChList.push_back(0);
+	ExrWriteAttribute(Header, "channels", "chlist", ChList.data(), (int32_t)ChList.size());
+
+	const uint8_t NoCompression = 0;
+	ExrWriteAttribute(Header, "compression", "compression", &NoCompression, 1);
+
+	const int32_t Window[4] = { 0, 0, mWidth - 1, mHeight - 1 };
+	ExrWriteAttribute(Header, "dataWindow", "box2i", Window, sizeof(Window));
+	ExrWriteAttribute(Header, "displayWindow", "box2i", Window, sizeof(Window));
+
+	const uint8_t IncreasingY = 0;
+	ExrWriteAttribute(Header, "lineOrder", "lineOrder", &IncreasingY, 1);
+
+	const float PixelAspect = 1.f;
+	ExrWriteAttribute(Header, "pixelAspectRatio", "float", &PixelAspect, sizeof(PixelAspect));
+
+	const float WindowCenter[2] = { 0.f, 0.f };
+	ExrWriteAttribute(Header, "screenWindowCenter", "v2f", WindowCenter, sizeof(WindowCenter));
+
+	const float WindowWidth = 1.f;
+	ExrWriteAttribute(Header, "screenWindowWidth", "float", &WindowWidth, sizeof(WindowWidth));
+	Header.push_back(0);
+
+	// one uncompressed scanline per chunk
+	const int32_t LineBytes = mWidth * 3 * (int32_t)sizeof(float);
+	const uint64_t ChunkSize = sizeof(int32_t) * 2 + LineBytes;
+	uint64_t Offset = Header.size() + sizeof(uint64_t) * mHeight;
+	for (int y = 0; y < mHeight; ++y)
+	{
+		ExrWrite(Header, &Offset, sizeof(Offset));
+		Offset += ChunkSize;
+	}
+
+	FILE* fp = OpenFile(InFileName.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+	fwrite(Header.data(), 1, Header.size(), fp);
+
+	vector<float> Line((size_t)mWidth * 3);
+	for (int32_t y = 0; y < mHeight; ++y)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			for (int x = 0; x < mWidth; ++x)
+			{
+				Line[(size_t)c * mWidth + x] = GetPixel(x, y)[ChannelOffsets[c]];
+			}
+		}
+		fwrite(&y, sizeof(y), 1, fp);
+		fwrite(&LineBytes, sizeof(LineBytes), 1, fp);
+		fwrite(Line.data(), sizeof(float), Line.size(), fp);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+bool FHdrImage::Save(const string& InFileName) const
+{
+	size_t Dot = InFileName.find_last_of('.');
+	string Ext = Dot == string::npos ? "" : InFileName.substr(Dot);
+	if (Ext == ".exr" || Ext == ".EXR")
+	{
+		return SaveEXR(InFileName);
+	}
+
+	return SavePFM(InFileName);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Linear HDR image with 3 float channels.
+class FHdrImage
+{
+public:
+	FHdrImage();
+	FHdrImage(int InWidth, int InHeight);
+
+	// Resize and clear to black.
+	void Resize(int InWidth, int InHeight);
+
+	// Get pixel at (x, y), y = 0 is the top row.
+	float* GetPixel(int x, int y) { return &mPixels[((size_t)y * mWidth + x) * 3]; }
+	const float* GetPixel(int x, int y) const { return &mPixels[((size_t)y * mWidth + x) * 3]; }
+
+	// Write portable float map (little endian).
+	bool SavePFM(const string& InFileName) const;
+	// Write uncompressed OpenEXR with 32 bit float channels.
+	bool SaveEXR(const string& InFileName) const;
+	// Write by file extension (.pfm or .exr).
+	bool Save(const string& InFileName) const;
+
+public:
+	// image width
+	int mWidth;
+	// image height
+	int mHeight;
+	// rgb pixels in scanline order
+	vector<float> mPixels;
+};
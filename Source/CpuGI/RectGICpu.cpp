@@ -0,0 +1,481 @@
+#include "RectGICpu.h"
+
+// parameters follow the shaders, some of them are unused there too
+#ifdef _MSC_VER
+#pragma warning( disable : 4100 )
+#else
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#endif
+
+const float FRectGI::sgMinLambda = 4.60517f;
+
+float FRectGI::sgProductIntegral(const SG& sg1, const SG& sg2)
+{
+	float3 p1 = sg1.axis;
+	float3 p2 = sg2.axis;
+
+	float l1 = sg1.lambda;
+	float l2 = sg2.lambda;
+
+	float c1 = (l1 * l2) / (l1 + l2);
+	float c2 = dot(p1, p2);
+	float l3 = l1 + l2 - c1 * (1 - c2);
+
+	float factor = c1 * (c2 - 1);
+	float ret;
+	if (factor < -10)
+	{
+		ret = 0;
+	}
+	else
+	{
+		ret = std::exp(factor) * (sg1.mu * sg2.mu * 2 * PI) / l3;
+	}
+
+	return ret;
+}
+
+float FRectGI::sgIntegral(float lambda, float mu)
+{
+	float ret;
+	if (lambda >= sgMinLambda)
+	{
+		ret = mu * 2 * PI / lambda;
+	}
+	else
+	{
+		ret = mu * 2 * PI * (1 - std::exp(-2 * lambda)) / lambda;
+	}
+
+	return ret;
+}
+
+float FRectGI::asgCalcBandwidth(float dr)
+{
+	float dr2 = dr * dr;
+	float bw = max(sgMinLambda, -(((1 + dr2) * (-5.991f + std::log(1 + dr2))) / (2 * dr2)));
+	return bw;
+}
+
+float FRectGI::sgCalcAmplitude(float lambda, float totalEnergy)
+{
+	float sgEnergy = sgIntegral(lambda, 1);
+	float mu = totalEnergy / sgEnergy;
+	return mu;
+}
+
+float3 FRectGI::gReflectVector(const float3& viewOrLight, const float3& halfDir)
+{
+	float3 o = normalize(viewOrLight);
+	float3 h = normalize(halfDir);
+	float3 i = normalize(2 * dot(o, h) * h - o);
+
+	return i;
+}
+
+FRectGI::SG FRectGI::sgNDF(float roughness, const float3& lightDir, const float3& viewDir, const float3& normalDir)
+{
+	float3 halfDir = normalize((lightDir + viewDir) * .5f);
+	float3 reflectDir = gReflectVector(viewDir, normalDir);
+
+	// Jacobian determinant for differential area
+	float jacobian = max(4 * dot(halfDir, viewDir), 0.001f);
+
+	// contruct warpped SG
+	float m2 = roughness * roughness;
+	SG sg;
+	sg.axis = reflectDir;
+	sg.lambda = (2 / (m2 * jacobian));
+	sg.mu = 1 / (PI * m2);
+
+	return sg;
+}
+
+float FRectGI::gIntegrateDiskLighting(const float3& shadingPt, const float3& diskPt, const float3& diskNormal,
+	float diskRadius, const float3& lightDir, float lightIntensity, float roughness)
+{
+	float m = roughness;
+	float m2 = m * m;
+	float3 n = diskNormal;
+	float3 l = lightDir;
+	float nol = max(dot(n, l), 0);
+	float dr = diskRadius / length(diskPt - shadingPt);
+
+	float k = (0.288f * nol) / m2 - 0.673f;
+	float lighting = 0;
+	if (k != 0)
+	{
+		float drCos = dr * nol;
+		float drCos2 = drCos * drCos;
+		float approxSinThetaA2 = drCos2 / (1 + drCos2);
+		float midTerm = (1 - std::exp(-k * approxSinThetaA2)) / (2 * k);
+
+		float gDGGX0 = 1 / (m2 * PI);
+		float lyr = PI * m2 * gDGGX0 * nol;
+		lighting = lightIntensity * midTerm * lyr * PI / k;
+	}
+
+	return lighting;
+}
+
+FRectGI::SG FRectGI::sgReflectLight(const float3& shadingPt, const float3& lightDir, float lightIntensity,
+	float roughness, const float3& diskCenter, const float3& diskNormal, float diskRadius)
+{
+	float shadingDist = length(shadingPt - diskCenter);
+	float3 refViewDir = normalize(shadingPt - diskCenter);
+	float minorSize = dot(diskNormal, refViewDir) * diskRadius / shadingDist;
+
+	SG sgLight;
+	sgLight.axis = -refViewDir;
+	sgLight.lambda = 2 * asgCalcBandwidth(minorSize);
+	float sgEnergy = gIntegrateDiskLighting(shadingPt, diskCenter, diskNormal, diskRadius,
+		lightDir, lightIntensity, roughness);
+	sgLight.mu = sgCalcAmplitude(sgLight.lambda, sgEnergy);
+
+	return sgLight;
+}
+
+float3 FRectGI::gCalcPeakPoint(const float3& normalDir, const float3& planePt, const float3& lightDir,
+	const float3& viewPt)
+{
+	float3 halfDir = normalDir;
+	float3 viewDir = gReflectVector(lightDir, halfDir);
+	float viewProjDist = dot(normalize(viewPt - planePt), normalDir) * length(viewPt - planePt);
+	float viewPeakDist = viewProjDist / dot(lightDir, halfDir);
+	float3 peakPt = viewPt - viewDir * viewPeakDist;
+
+	return peakPt;
+}
+
+float FRectGI::gCircIntsRectArea(const float3& circCenter, float circRadius, const float3& rectCenter,
+	const float3& rMajorAxis, const float3& rMinorAxis, float rectMajorRadius, float rectMinorRadius)
+{
+	float rLeft = -rectMajorRadius;
+	float rRight = rectMajorRadius;
+	float rTop = rectMinorRadius;
+	float rBottom = -rectMinorRadius;
+
+	float cDistX = dot(circCenter - rectCenter, rMajorAxis);
+	float cDistY = dot(circCenter - rectCenter, rMinorAxis);
+	float cLeft = cDistX - circRadius;
+	float cRight = cDistX + circRadius;
+	float cTop = cDistY + circRadius;
+	float cBottom = cDistY - circRadius;
+
+	float xOverlap = max(0, min(rRight, cRight) - max(rLeft, cLeft));
+	float yOverlap = max(0, min(rTop, cTop) - max(rBottom, cBottom));
+
+	float area = xOverlap * yOverlap;
+	return area;
+}
+
+float3 FRectGI::sgReflectShading(
+	// shading point
+	const float3& shadingPt, const float3& inShadingNormal, float shadingRoughness, float samplingRadius,
+	// reflection plane
+	const float3& planeCenter, const float3& inPlaneNormal, const float3& inPlaneMajorAxis,
+	const float3& planeSpecularColor, float planeMajorRadius, float planeMinorRadius, float planeRoughness,
+	// light
+	const float3& inLightDir, float lightIntensity, const float3& viewPoint)
+{
+	if (planeMajorRadius < 0.1f || planeMinorRadius < 0.1f)
+		return float3(0);
+
+	float3 shadingNormal = normalize(inShadingNormal);
+	float3 planeNormal = normalize(inPlaneNormal);
+	// need validating axes in cpu
+	float3 planeMajorAxis = normalize(inPlaneMajorAxis);
+	float3 planeMinorAxis = normalize(cross(planeMajorAxis, planeNormal));
+	float3 lightDir = normalize(inLightDir);
+	float3 viewDir = normalize(viewPoint - shadingPt);
+
+	// condition check in gCalcPeakPoint
+	float3 reflHalfDir = planeNormal;
+	if (dot(lightDir, reflHalfDir) < 0.001f)
+		return float3(0);
+
+	// find specular peak
+	float3 reflPeakPt = gCalcPeakPoint(planeNormal, planeCenter, lightDir, shadingPt);
+
+	float reflDist = length(shadingPt - reflPeakPt);
+	if (reflDist < 0.001f)
+		return float3(0);
+
+	// approximating reflection light
+	SG reflSgLight = sgReflectLight(shadingPt, lightDir, lightIntensity,
+		planeRoughness, reflPeakPt, planeNormal, samplingRadius);
+
+	SG shadingNDF = sgNDF(shadingRoughness, reflSgLight.axis, viewDir, shadingNormal);
+	float reflShading = sgProductIntegral(reflSgLight, shadingNDF);
+
+	// intersection area
+	float intsArea = gCircIntsRectArea(reflPeakPt, samplingRadius, planeCenter,
+		planeMajorAxis, planeMinorAxis, planeMajorRadius, planeMinorRadius);
+	float intsPercent = min(1, intsArea / (4 * samplingRadius * samplingRadius));
+
+	float reflPower = reflShading * intsPercent;
+	return planeSpecularColor * reflPower;
+}
+
+float3 FRectGI::sgGlossyReflection(const FGIConstants& C, const float3& shadingPt, const float3& inShadingNormal,
+	float shadingRoughness, const float3& inLightDir, float lightIntensity, const float3& viewPoint,
+	const SGReflectors& reflectors)
+{
+	const SB_PS_RECT* P = C.mRects;
+	float samplingRadius = C.mPerFrame->mSamplingRadius.x;
+	float3 defaultSpecularColor = float3(1.f, 1.f, 1.f);
+
+	float3 reflColor;
+	for (int i = 0; i < MAX_REFLECTOR_NUM; i++)
+	{
+		int plId = reflectors.indices[i];
+		if (plId >= 0)
+		{
+			reflColor += sgReflectShading(
+				// shading point
+				shadingPt, inShadingNormal, shadingRoughness, samplingRadius,
+				// reflection plane
+				ToFloat3(P[plId].plCenter_DiffX), ToFloat3(P[plId].plNorm_DifY), ToFloat3(P[plId].plAxis_DifZ),
+				defaultSpecularColor, P[plId].plElement0.z, P[plId].plElement0.w, P[plId].plElement0.y,
+				// light
+				inLightDir, lightIntensity, viewPoint
+			);
+		}
+	}
+
+	return reflColor;
+}
+
+float3 FRectGI::gCalcProjPoint(const float3& planeNormal, const float3& planePt, const float3& shadingPt)
+{
+	float3 dir0 = planePt - shadingPt;
+	// scalar promoted to float3 as in the shader
+	float3 projDir = float3(dot(dir0, -planeNormal));
+	float projDist = length(projDir);
+	float3 projPt = shadingPt - planeNormal * projDist;
+
+	return projPt;
+}
+
+float FRectGI::gIntegrateDiskDiffuse(float dr)
+{
+	float dr2 = dr * dr;
+	float approxD = 0.666667f * PI * dr2 / (1 + dr2);
+	return approxD;
+}
+
+float3 FRectGI::gReflectDiffuse(
+	// shading point
+	const float3& shadingPt, float samplingRadius,
+	// reflection plane
+	const float3& planeCenter, const float3& inPlaneNormal, const float3& inPlaneMajorAxis,
+	float planeMajorRadius, float planeMinorRadius, const float3& planeDiffuseColor,
+	// light
+	const float3& inLightDir, float lightIntensity)
+{
+	float3 planeNormal = normalize(inPlaneNormal);
+	float3 lightDir = normalize(inLightDir);
+
+	float3 projPt = gCalcProjPoint(planeNormal, planeCenter, shadingPt);
+
+	// integrating area
+	float shadingDist = length(projPt - shadingPt);
+	float dr = samplingRadius / shadingDist;
+	float integratedDiffuse = gIntegrateDiskDiffuse(dr);
+
+	float planeNoL = max(dot(planeNormal, lightDir), 0);
+
+	// the shader computes the intersection area here but does not use it yet
+	float lighting = integratedDiffuse * planeNoL * lightIntensity;
+
+	return lighting * planeDiffuseColor;
+}
+
+float3 FRectGI::gDiffuseReflection(const FGIConstants& C, const float3& shadingPt, const float3& inLightDir,
+	float lightIntensity, const SGReflectors& reflectors)
+{
+	const SB_PS_RECT* P = C.mRects;
+	float samplingRadius = C.mPerFrame->mSamplingRadius.y;
+
+	float3 reflColor;
+	for (int i = 0; i < MAX_REFLECTOR_NUM; i++)
+	{
+		int pid = reflectors.indices[i];
+		if (pid >= 0)
+		{
+			reflColor += gReflectDiffuse(
+				// shading point
+				shadingPt, samplingRadius,
+				// reflection plane
+				ToFloat3(P[pid].plCenter_DiffX), ToFloat3(P[pid].plNorm_DifY), ToFloat3(P[pid].plAxis_DifZ),
+				P[pid].plElement0.z, P[pid].plElement0.w,
+				float3(P[pid].plCenter_DiffX.w, P[pid].plNorm_DifY.w, P[pid].plAxis_DifZ.w),
+				// light
+				inLightDir, lightIntensity
+			);
+		}
+	}
+
+	return reflColor;
+}
+
+FRectGI::SGReflectors FRectGI::findDiffuseRelatedPlanes(const FGIConstants& C, const float3& shadingPt,
+	const float3& inShadingNormal)
+{
+	const SB_PS_RECT* P = C.mRects;
+	SGReflectors reflectors = { { -1, -1, -1 } };
+
+	int reflectorNum = 0;
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; i++)
+	{
+		int plId = (int)C.mPerObject->mLinkedReflectors[i * 4];
+		if (plId < 0)
+			break;
+
+		float3 plCenter = ToFloat3(P[plId].plCenter_DiffX);
+		float3 plNormal = ToFloat3(P[plId].plNorm_DifY);
+
+		float3 projPt = gCalcProjPoint(plNormal, plCenter, shadingPt);
+		float3 viewDir = shadingPt - projPt;
+
+		if (dot(viewDir, plNormal) < 0)
+			continue;
+
+		if (reflectorNum == MAX_REFLECTOR_NUM)
+			break;
+
+		reflectors.indices[reflectorNum] = plId;
+		reflectorNum++;
+	}
+
+	return reflectors;
+}
+
+FRectGI::SGReflectors FRectGI::findSpecularRelatedPlanes(const FGIConstants& C, const float3& shadingPt,
+	const float3& inShadingNormal, const float3& lightDir)
+{
+	const SB_PS_RECT* P = C.mRects;
+	SGReflectors reflectors = { { -1, -1, -1 } };
+
+	int reflectorNum = 0;
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; i++)
+	{
+		int plId = (int)C.mPerObject->mLinkedReflectors[i * 4];
+		if (plId < 0)
+			break;
+
+		float roughness = P[plId].plElement0.y;
+		if (roughness > .3f)
+			continue;
+
+		float3 plCenter = ToFloat3(P[plId].plCenter_DiffX);
+		float3 plNormal = ToFloat3(P[plId].plNorm_DifY);
+
+		float3 projPt = gCalcProjPoint(plNormal, plCenter, shadingPt);
+		float3 viewDir = shadingPt - projPt;
+
+		if (dot(viewDir, plNormal) < 0 || dot(lightDir, plNormal) < 0)
+			continue;
+
+		if (reflectorNum == MAX_REFLECTOR_NUM)
+			break;
+
+		reflectors.indices[reflectorNum] = plId;
+		reflectorNum++;
+	}
+
+	return reflectors;
+}
+
+float3 FRectGI::GILighting(const FGIConstants& C, const float3& shadingPt, const float3& inShadingNormal,
+	float shadingRoughness, const float3& inLightDir, const float3& viewPoint)
+{
+	const CB_PS_PER_FRAME& F = *C.mPerFrame;
+	bool bShowSpecularGI = F.mToggleOptionsA[0] != 0;
+	bool bShowDiffuseGI = F.mToggleOptionsA[3] != 0;
+	float3 shadingNormal = normalize(inShadingNormal);
+	float3 lightDir = normalize(inLightDir);
+
+	float3 OutColor;
+	if (bShowSpecularGI)
+	{
+		float GIIntensity = F.mLightIntensity.x;
+		SGReflectors reflectors = findSpecularRelatedPlanes(C, shadingPt, shadingNormal, lightDir);
+		OutColor += sgGlossyReflection(C, shadingPt, shadingNormal, shadingRoughness,
+			inLightDir, GIIntensity, viewPoint, reflectors);
+	}
+
+	if (bShowDiffuseGI)
+	{
+		float GIIntensity = F.mLightIntensity.x * F.mLightIntensity.z;
+		SGReflectors reflectors = findDiffuseRelatedPlanes(C, shadingPt, shadingNormal);
+		OutColor += gDiffuseReflection(C, shadingPt, inLightDir, GIIntensity, reflectors);
+	}
+
+	return OutColor;
+}
+
+float FRectGI::D_GGX(float a2, float NoH)
+{
+	float NoH2 = NoH * NoH;
+	float d = NoH2 * (a2 - 1) + 1;
+	return a2 / (PI * d * d);
+}
+
+float FRectGI::Vis_SmithJointApprox(float a2, float NoV, float NoL)
+{
+	float a = std::sqrt(a2);
+	float Vis_SmithV = NoL * (NoV * (1 - a) + a);
+	float Vis_SmithL = NoV * (NoL * (1 - a) + a);
+	return 0.5f * rcp(Vis_SmithV + Vis_SmithL);
+}
+
+float3 FRectGI::F_Schlick(const float3& SpecularColor, float VoH)
+{
+	float a1 = 1 - VoH;
+	float a2 = a1 * a1;
+	float a4 = a2 * a2;
+	float Fc = a4 * a1;
+	return float3(saturate(50.0f * SpecularColor.y) * Fc) + (1 - Fc) * SpecularColor;
+}
+
+float3 FRectGI::PlaneMeshPS(const FGIConstants& C, const float3& InWorldPos, const float3& InWorldNormal)
+{
+	const CB_PS_PER_FRAME& F = *C.mPerFrame;
+	const CB_PS_PER_OBJECT& O = *C.mPerObject;
+
+	float3 WorldNormal = normalize(InWorldNormal);
+	float3 WorldPos = InWorldPos;
+	float3 CameraPos = ToFloat3(O.mCameraPos);
+
+	bool bShowBRDF = F.mToggleOptionsA[1] != 0;
+
+	float Roughness = O.mRoughness4.x;
+	float a2 = Roughness * Roughness;
+
+	float3 CameraVector = normalize(CameraPos - WorldPos);
+	float3 DirectionalLightDirection = normalize(ToFloat3(F.mLightDirAmbient));
+	float NoV = max(0, dot(WorldNormal, CameraVector));
+	float NoL = max(0, dot(WorldNormal, DirectionalLightDirection));
+	float3 H = normalize(CameraVector + DirectionalLightDirection);
+	float NoH = max(0, dot(WorldNormal, H));
+	float VoH = max(0, dot(CameraVector, H));
+
+	float Vis = Vis_SmithJointApprox(a2, NoV, NoL);
+	float D = D_GGX(a2, NoH);
+	float3 MySpecularColor = float3(1, 1, 1);
+	float3 Fr = F_Schlick(MySpecularColor, VoH);
+
+	// direct lighting
+	float3 OutColor;
+	if (bShowBRDF)
+	{
+		OutColor += ToFloat3(O.mDiffuseColor) * Fr * (D * Vis * NoL);
+	}
+
+	// indirect lighting
+	OutColor *= F.mLightIntensity.x;
+	OutColor += GILighting(C, WorldPos, WorldNormal, Roughness, DirectionalLightDirection, CameraPos);
+
+	return OutColor;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+#include "GIMath.h"
+#include "../Render/ShaderBuffers.h"
+
+using namespace GIMath;
+
+// Shader constants visible to one invocation of PlaneMeshPS.
+struct FGIConstants
+{
+	// cbuffer psPerFrame
+	const CB_PS_PER_FRAME* mPerFrame;
+	// StructuredBuffer psRects
+	const SB_PS_RECT* mRects;
+	// cbuffer cbPerObject, pixel shader part
+	const CB_PS_PER_OBJECT* mPerObject;
+};
+
+// C++ port of Shaders/RectGI.hlsl and the BRDF of Shaders/PlaneMeshPS.hlsl.
+// Function names and bodies follow the shaders, keep both in sync.
+class FRectGI
+{
+public:
+	// preserving the energy in hemisphere
+	static const float sgMinLambda;
+	// max reflectors evaluated per shading point
+	static const int MAX_REFLECTOR_NUM = 3;
+
+	// Spherical Gaussian
+	struct SG
+	{
+		// lobe axis
+		float3 axis;
+		// bandwidth
+		float lambda;
+		// amplitude
+		float mu;
+	};
+
+	struct SGReflectors
+	{
+		// reflector indices
+		int indices[MAX_REFLECTOR_NUM];
+	};
+
+public:
+	// product integral of 2 SGs
+	static float sgProductIntegral(const SG& sg1, const SG& sg2);
+	// integral of SG
+	static float sgIntegral(float lambda, float mu);
+	// calculate bandwidth for ASG with given extent
+	static float asgCalcBandwidth(float dr);
+	// calculate amplitude for SG with given extent
+	static float sgCalcAmplitude(float lambda, float totalEnergy);
+	// reflect vector 'viewOrLight' by vector 'halfDir'
+	static float3 gReflectVector(const float3& viewOrLight, const float3& halfDir);
+	// approximating NDF as SG
+	static SG sgNDF(float roughness, const float3& lightDir, const float3& viewDir, const float3& normalDir);
+	// integrating reflected radiance(from a disk to a sphere)
+	static float gIntegrateDiskLighting(const float3& shadingPt, const float3& diskPt, const float3& diskNormal,
+		float diskRadius, const float3& lightDir, float lightIntensity, float roughness);
+	// approximating SG light
+	static SG sgReflectLight(const float3& shadingPt, const float3& lightDir, float lightIntensity, float roughness,
+		const float3& diskCenter, const float3& diskNormal, float diskRadius);
+	// find specular peak
+	static float3 gCalcPeakPoint(const float3& normalDir, const float3& planePt, const float3& lightDir,
+		const float3& viewPt);
+	// instersection area of a disk and a rectangle
+	static float gCircIntsRectArea(const float3& circCenter, float circRadius, const float3& rectCenter,
+		const float3& rMajorAxis, const float3& rMinorAxis, float rectMajorRadius, float rectMinorRadius);
+	// calculate incident illumation from a specular reflection
+	static float3 sgReflectShading(
+		// shading point
+		const float3& shadingPt, const float3& inShadingNormal, float shadingRoughness, float samplingRadius,
+		// reflection plane
+		const float3& planeCenter, const float3& inPlaneNormal, const float3& inPlaneMajorAxis,
+		const float3& planeSpecularColor, float planeMajorRadius, float planeMinorRadius, float planeRoughness,
+		// light
+		const float3& inLightDir, float lightIntensity, const float3& viewPoint);
+	// calculate glossy reflections
+	static float3 sgGlossyReflection(const FGIConstants& C, const float3& shadingPt, const float3& inShadingNormal,
+		float shadingRoughness, const float3& inLightDir, float lightIntensity, const float3& viewPoint,
+		const SGReflectors& reflectors);
+
+	// calculate projection point from a shading point to a rectangle
+	static float3 gCalcProjPoint(const float3& planeNormal, const float3& planePt, const float3& shadingPt);
+	// integrating total reflected diffuse from a disk
+	static float gIntegrateDiskDiffuse(float dr);
+	// calculate diffuse reflection
+	static float3 gReflectDiffuse(
+		// shading point
+		const float3& shadingPt, float samplingRadius,
+		// reflection plane
+		const float3& planeCenter, const float3& inPlaneNormal, const float3& inPlaneMajorAxis,
+		float planeMajorRadius, float planeMinorRadius, const float3& planeDiffuseColor,
+		// light
+		const float3& inLightDir, float lightIntensity);
+	// calculate diffuse reflection
+	static float3 gDiffuseReflection(const FGIConstants& C, const float3& shadingPt, const float3& inLightDir,
+		float lightIntensity, const SGReflectors& reflectors);
+
+	// find reflectors for diffuse reflection
+	static SGReflectors findDiffuseRelatedPlanes(const FGIConstants& C, const float3& shadingPt,
+		const float3& inShadingNormal);
+	// find reflectors for specular reflection
+	static SGReflectors findSpecularRelatedPlanes(const FGIConstants& C, const float3& shadingPt,
+		const float3& inShadingNormal, const float3& lightDir);
+	// calculate total indirect lighting
+	static float3 GILighting(const FGIConstants& C, const float3& shadingPt, const float3& inShadingNormal,
+		float shadingRoughness, const float3& inLightDir, const float3& viewPoint);
+
+	// GGX normal distribution (PlaneMeshPS.hlsl)
+	static float D_GGX(float a2, float NoH);
+	// Smith joint visibility (PlaneMeshPS.hlsl)
+	static float Vis_SmithJointApprox(float a2, float NoV, float NoL);
+	// Schlick fresnel (PlaneMeshPS.hlsl)
+	static float3 F_Schlick(const float3& SpecularColor, float VoH);
+	// Entry of PlaneMeshPS.hlsl: direct lighting plus indirect lighting of a rectangle receiver.
+	static float3 PlaneMeshPS(const FGIConstants& C, const float3& InWorldPos, const float3& InWorldNormal);
+
+	// Read xyz of a constant register.
+	static float3 ToFloat3(const XMFLOAT4& InValue) { return float3(InValue.x, InValue.y, InValue.z); }
+};
\ No newline at end of file
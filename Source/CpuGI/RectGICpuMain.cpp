@@ -0,0 +1,229 @@
+// Headless cpu renderer of the demo scene for machines without Windows or a GPU, built by CMakeLists.txt.
+//
+// RectGICpu [-out:File] [-width:N] [-height:N] [-threads:N] [-time:Seconds] [-scalar] [-selftest] [-bakelut:File]
+//	[-microbench] [-mesh:File]
+//	-out      image to write, .exr or .pfm (RectGI_cpu.exr)
+//	-width    image size (1024 x 768)
+//	-height
+//	-threads  worker threads, 0 uses all cores (0)
+//	-time     seconds into the demo, places the moving light (0)
+//	-scalar   shade specular reflections per pixel instead of with the packet kernel
+//	-selftest check the exp/log policies against libm instead of rendering, fails when one exceeds its budget
+//	-microbench run the benchmarks of the engine modules instead of rendering, see CMicroBenchmarks
+//	-mesh     .sdkmesh file of the mesh load benchmark (mesh/ball.sdkmesh)
+//	-bakelut  write the tables of FSGLightingLut as a header instead of rendering, e.g. CpuGI/SGLightingLutData.h
+#include "CpuRenderer.h"
+#include "SGReflectKernel.h"
+#include "SGLightingLut.h"
+#include "../DemoScene.h"
+#include "../Render/DemoFrameStages.h"
+#include "../Render/MicroBenchmarks.h"
+#include "../Render/RectProxy.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	// Options of a render.
+	struct FCpuRenderSettings
+	{
+		FCpuRenderSettings()
+			: mOutFile("RectGI_cpu.exr")
+			, mWidth(1024)
+			, mHeight(768)
+			, mNumThreads(0)
+			, mTime(0)
+			, bScalar(false)
+			, bSelfTest(false)
+			, bMicroBenchmark(false)
+		{
+
+		}
+
+		// Parse options in the -name:value form of the demo, false on unknown options.
+		bool ParseCommandLine(int argc, char** argv)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char* Arg = argv[i];
+				if (strncmp(Arg, "-out:", 5) == 0)
+				{
+					mOutFile = Arg + 5;
+				}
+				else if (strncmp(Arg, "-width:", 7) == 0)
+				{
+					mWidth = max(1, atoi(Arg + 7));
+				}
+				else if (strncmp(Arg, "-height:", 8) == 0)
+				{
+					mHeight = max(1, atoi(Arg + 8));
+				}
+				else if (strncmp(Arg, "-threads:", 9) == 0)
+				{
+					mNumThreads = max(0, atoi(Arg + 9));
+				}
+				else if (strncmp(Arg, "-time:", 6) == 0)
+				{
+					mTime = atof(Arg + 6);
+				}
+				else if (strcmp(Arg, "-scalar") == 0)
+				{
+					bScalar = true;
+				}
+				else if (strcmp(Arg, "-selftest") == 0)
+				{
+					bSelfTest = true;
+				}
+				else if (strcmp(Arg, "-microbench") == 0)
+				{
+					bMicroBenchmark = true;
+				}
+				else if (strncmp(Arg, "-mesh:", 6) == 0)
+				{
+					mMicroBench.mMeshFile = Arg + 6;
+				}
+				else if (strncmp(Arg, "-bakelut:", 9) == 0)
+				{
+					mLutFile = Arg + 9;
+				}
+				else
+				{
+					fprintf(stderr, "RectGICpu: unknown option %s\n", Arg);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		string mOutFile;
+		int mWidth;
+		int mHeight;
+		int mNumThreads;
+		double mTime;
+		bool bScalar;
+		bool bSelfTest;
+		bool bMicroBenchmark;
+		FMicroBenchSettings mMicroBench;
+		string mLutFile;
+	};
+
+	// Build the scene of DemoScene.h as CMiniEngine::CaptureCpuScene sees it at InTime seconds.
+	void BuildDemoScene(double InTime, FCpuScene& OutScene)
+	{
+		// reflectors are linked from geometry like CRectCollections::UpdateAllProxies does
+		CRectStore Rects;
+		for (int i = 0; i < GNumDemoRects; ++i)
+		{
+			CRect Rect = CDemoFrameStages::GetDemoRectProxy(i);
+			Rects.Add(Rect);
+			OutScene.AddRect(Rect.mCenter, Rect.mNormal, Rect.mMajorAxis, Rect.mMajorRadius, Rect.mMinorRadius,
+				Rect.mRoughness, Rect.mDiffuseColor);
+		}
+
+		CRectBvh Bvh;
+		Bvh.Build(Rects);
+		CReflectorLinker Linker;
+		Linker.Build(Rects, Bvh);
+		for (int i = 0; i < Rects.Num(); ++i)
+		{
+			const int32_t* Links = Linker.GetLinks(i);
+			OutScene.LinkReflectors(i, vector<int>(Links, Links + Linker.NumLinks(i)));
+		}
+
+		XMFLOAT3 LightDir;
+		XMFLOAT3 LightPos = GetDemoLightPosition(InTime);
+		XMStoreFloat3(&LightDir, XMVector3Normalize(XMLoadFloat3(&LightPos)));
+		OutScene.SetLight(LightDir, GDemoLightIntensity, GDemoDiffuseReflIntensity);
+		OutScene.mPerFrame.mLightIntensity.y = GDemoSpecularReflIntensity;
+
+		// the model viewer camera keeps its default radius
+		XMStoreFloat3(&OutScene.mCamera.mEye,
+			XMVectorScale(XMVector3Normalize(XMLoadFloat3(&GDemoEye)), GDemoSceneRadius * 3.0f));
+		XMStoreFloat4(&OutScene.mPerFrame.mEyePos, XMLoadFloat3(&OutScene.mCamera.mEye));
+	}
+
+	// Check every exp/log policy against libm, alone and in images of the demo scene, true if all are within
+	// their budgets.
+	bool RunSelfTest(const FCpuScene& InScene)
+	{
+		bool bPassed = true;
+
+		// the checked in tables must be reproducible by -bakelut
+		vector<uint16_t> Texels;
+		FSGLightingLut::Bake(Texels);
+		bool bBakedDataValid = memcmp(Texels.data(), FSGLightingLut::GetHalfTexels(), Texels.size() * sizeof(uint16_t)) == 0;
+		printf("RectGI lut SGLightingLutData.h matches a fresh bake: %s\n", bBakedDataValid ? "ok" : "FAILED");
+		bPassed = bPassed && bBakedDataValid;
+
+		vector<FSGMathErrorResult> MathErrors;
+		FSGReflectKernel::MeasureMathError(MathErrors);
+		for (const FSGMathErrorResult& Result : MathErrors)
+		{
+			const FSGMathErrorBudget& Budget = FSGReflectKernel::GetErrorBudget(Result.mMath);
+			printf("RectGI math %-8s exp %.3g (budget %.3g), log %.3g (budget %.3g): %s\n",
+				FSGReflectKernel::GetMathName(Result.mMath), Result.mExpMaxError, Budget.mExp, Result.mLogMaxError,
+				Budget.mLog, Result.bWithinBudget ? "ok" : "FAILED");
+			bPassed = bPassed && Result.bWithinBudget;
+		}
+
+		vector<FCpuMathImageError> ImageErrors;
+		CCpuRenderer::MeasureReflectMathError(InScene, 640, 480, ImageErrors);
+		for (const FCpuMathImageError& Result : ImageErrors)
+		{
+			printf("RectGI image %-8s max %.3g (budget %.3g), rms %.3g, %.3f ms: %s\n",
+				FSGReflectKernel::GetMathName(Result.mMath), Result.mMaxError,
+				FSGReflectKernel::GetErrorBudget(Result.mMath).mImage, Result.mRmsError, Result.mSeconds * 1000,
+				Result.bWithinBudget ? "ok" : "FAILED");
+			bPassed = bPassed && Result.bWithinBudget;
+		}
+
+		return bPassed;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	FCpuRenderSettings Settings;
+	if (!Settings.ParseCommandLine(argc, argv))
+		return 2;
+
+	if (!Settings.mLutFile.empty())
+	{
+		bool bWritten = FSGLightingLut::WriteBakedHeader(Settings.mLutFile.c_str());
+		printf("RectGI lut %s %s\n", bWritten ? "written to" : "cannot write", Settings.mLutFile.c_str());
+		return bWritten ? 0 : 1;
+	}
+
+	if (Settings.bMicroBenchmark)
+	{
+		return CMicroBenchmarks::Run(Settings.mMicroBench, stdout) ? 0 : 1;
+	}
+
+	FCpuScene Scene;
+	BuildDemoScene(Settings.mTime, Scene);
+	if (Settings.bSelfTest)
+	{
+		return RunSelfTest(Scene) ? 0 : 1;
+	}
+
+	CCpuRenderer Renderer;
+	if (Settings.bScalar)
+	{
+		Renderer.SetReflectKernel(false, ESimdIsa::Scalar);
+	}
+
+	FHdrImage Image(Settings.mWidth, Settings.mHeight);
+	FCpuRenderStats Stats = Renderer.Render(Scene, Image, Settings.mNumThreads);
+	if (!Image.Save(Settings.mOutFile))
+	{
+		fprintf(stderr, "RectGICpu: cannot write %s\n", Settings.mOutFile.c_str());
+		return 1;
+	}
+
+	printf("RectGI cpu render: %dx%d, %.3f ms, %.2f MPixels/s, %d threads, %zu covered pixels -> %s\n",
+		Settings.mWidth, Settings.mHeight, Stats.mSeconds * 1000, Stats.mPixelsPerSecond * 1e-6, Stats.mNumThreads,
+		Stats.mCoveredPixels, Settings.mOutFile.c_str());
+	return 0;
+}
@@ -0,0 +1,149 @@
+#include "SGLightingLut.h"
+#include "HalfFloat.h"
+#include "RectGICpu.h"
+#include "../Render/FileUtil.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#include "SGLightingLutData.h"
+
+const float FSGLightingLut::DiskScale = 2.f;
+const float FSGLightingLut::DiskOffset = 0.673f;
+const float FSGLightingLut::BandwidthMaxX = 2.f;
+
+namespace
+{
+	// (1 - exp(-t)) / t
+	double Phi(double t)
+	{
+		return std::fabs(t) > 1e-7 ? -std::expm1(-t) / t : 1 - t * .5;
+	}
+
+	// dr2 * asgCalcBandwidth(dr) without the clamp
+	double BandwidthNumerator(double dr2)
+	{
+		return -((1 + dr2) * (-5.991 + std::log(1 + dr2))) * .5;
+	}
+}
+
+const uint16_t* FSGLightingLut::GetHalfTexels()
+{
+	return GSGLightingLutHalf;
+}
+
+const float* FSGLightingLut::GetTexels()
+{
+	return GSGLightingLutFloat;
+}
+
+float FSGLightingLut::Sample(float u, float v)
+{
+	// texel centers at (i + 0.5) / size
+	float y = v * Height - .5f;
+	y = y < 0 ? 0 : (y > Height - 1 ? (float)(Height - 1) : y);
+	int Row = (int)y;
+	Row = Row < Height - 1 ? Row : Height - 2;
+	float Frac = y - Row;
+
+	float x = u * Width - .5f;
+	return SampleRow(Row, x) * (1 - Frac) + SampleRow(Row + 1, x) * Frac;
+}
+
+float FSGLightingLut::SampleRow(int InRow, float InX)
+{
+	assert(InRow >= 0 && InRow < Height);
+	const float* Texels = GSGLightingLutFloat + InRow * Width;
+
+	float x = InX < 0 ? 0 : (InX > Width - 1 ? (float)(Width - 1) : InX);
+	int i = (int)x;
+	i = i < Width - 1 ? i : Width - 2;
+	float Frac = x - i;
+	return Texels[i] + (Texels[i + 1] - Texels[i]) * Frac;
+}
+
+float FSGLightingLut::OneMinusExp(float t)
+{
+	float x = t + DiskOffset;
+	float Scaled = SampleRow(DiskLightingRow, x / (x + DiskScale) * (Width - 1));
+	return t * Scaled / (x + DiskScale);
+}
+
+float FSGLightingLut::IntegrateDiskLighting(float InDiskRadius, float InDiskDist, float InNoL,
+	float InLightIntensity, float InRoughness)
+{
+	// same terms as gIntegrateDiskLighting, with lyr = nol
+	float m2 = InRoughness * InRoughness;
+	float nol = InNoL > 0 ? InNoL : 0;
+	float dr = InDiskRadius / InDiskDist;
+
+	float k = (0.288f * nol) / m2 - 0.673f;
+	if (k == 0)
+		return 0;
+
+	float drCos = dr * nol;
+	float drCos2 = drCos * drCos;
+	float approxSinThetaA2 = drCos2 / (1 + drCos2);
+	float midTerm = OneMinusExp(k * approxSinThetaA2) / (2 * k);
+	return InLightIntensity * midTerm * nol * PI / k;
+}
+
+float FSGLightingLut::CalcBandwidth(float dr)
+{
+	float dr2 = dr * dr;
+	float Numerator = SampleRow(BandwidthRow, dr2 * ((Width - 1) / BandwidthMaxX));
+	float bw = Numerator / dr2;
+	return bw > FRectGI::sgMinLambda ? bw : FRectGI::sgMinLambda;
+}
+
+void FSGLightingLut::Bake(vector<uint16_t>& OutTexels)
+{
+	OutTexels.resize(Width * Height);
+	for (int i = 0; i < Width; ++i)
+	{
+		double u = (double)i / (Width - 1);
+
+		// the last texel is the limit x -> inf of phi(t) * (x + DiskScale)
+		double x = i < Width - 1 ? DiskScale * u / (1 - u) : 0;
+		double Disk = i < Width - 1 ? Phi(x - DiskOffset) * (x + DiskScale) : 1;
+		OutTexels[DiskLightingRow * Width + i] = HalfFloat::FromFloat((float)Disk);
+
+		double Bandwidth = BandwidthNumerator(u * BandwidthMaxX);
+		OutTexels[BandwidthRow * Width + i] = HalfFloat::FromFloat((float)Bandwidth);
+	}
+}
+
+bool FSGLightingLut::WriteBakedHeader(const char* InFileName)
+{
+	vector<uint16_t> Texels;
+	Bake(Texels);
+
+	FILE* fp = OpenFile(InFileName, "wb");
+	if (!fp)
+		return false;
+
+	fprintf(fp, "#pragma once\n#include <cstdint>\n\n");
+	fprintf(fp, "// Generated by FSGLightingLut::WriteBakedHeader (RectGICpu -bakelut), do not edit.\n");
+	fprintf(fp, "// %d x %d texels, see SGLightingLut.h for the layout.\n", Width, Height);
+
+	fprintf(fp, "static const uint16_t GSGLightingLutHalf[%d] =\n{", Width * Height);
+	for (size_t i = 0; i < Texels.size(); ++i)
+	{
+		fprintf(fp, "%s0x%04x,", i % 8 == 0 ? "\n\t" : " ", Texels[i]);
+	}
+	fprintf(fp, "\n};\n\n");
+
+	fprintf(fp, "static const float GSGLightingLutFloat[%d] =\n{", Width * Height);
+	for (size_t i = 0; i < Texels.size(); ++i)
+	{
+		// keep a decimal point so the literal takes the f suffix
+		char Literal[32];
+		snprintf(Literal, sizeof(Literal), "%.9g", HalfFloat::ToFloat(Texels[i]));
+		bool bHasPoint = strchr(Literal, '.') || strchr(Literal, 'e');
+		fprintf(fp, "%s%s%sf,", i % 4 == 0 ? "\n\t" : " ", Literal, bHasPoint ? "" : ".0");
+	}
+	fprintf(fp, "\n};");
+
+	fclose(fp);
+	return true;
+}
\ No newline at end of file
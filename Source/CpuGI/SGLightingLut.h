@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Float16 lookup table for the exp/log terms of gIntegrateDiskLighting and asgCalcBandwidth.
+//
+// gIntegrateDiskLighting(roughness, nol, dr) only needs a transcendental for 1 - exp(-k * s), with
+// k = 0.288 * nol / m2 - 0.673 and s = sinThetaA2. Since 1 - exp(-t) = t * phi(t), the three inputs
+// collapse into the single argument t = k * s >= -0.673 and the remaining terms stay in alu, which
+// also keeps the pole at k = 0 exact. asgCalcBandwidth(dr) = max(sgMinLambda, G(dr * dr) / (dr * dr))
+// with smooth G.
+//
+// Both rows share one Width x Height R16_FLOAT texture:
+//	row 0: phi(t) * (x + DiskScale), u = x / (x + DiskScale), x = t + 0.673
+//	row 1: G(x), u = x / BandwidthMaxX, x = dr * dr, clamped (bandwidth is sgMinLambda beyond)
+// Texels sit at u = i / (Width - 1) and are sampled bilinearly with clamp addressing, so the gpu
+// reads the same values with uv = ((u * (Width - 1) + 0.5) / Width, (row + 0.5) / Height).
+//
+// The tables are baked offline into SGLightingLutData.h by WriteBakedHeader, nothing is computed at startup.
+// Regenerate it with "RectGICpu -bakelut:CpuGI/SGLightingLutData.h" or the BakeLightingLut target of CMakeLists.txt.
+class FSGLightingLut
+{
+public:
+	// texels per row
+	static const int Width = 64;
+	// rows
+	static const int Height = 2;
+	// row of the disk lighting term
+	static const int DiskLightingRow = 0;
+	// row of the bandwidth term
+	static const int BandwidthRow = 1;
+	// scale of the disk lighting axis
+	static const float DiskScale;
+	// -min(k) of gIntegrateDiskLighting
+	static const float DiskOffset;
+	// end of the bandwidth axis
+	static const float BandwidthMaxX;
+
+	// Baked texels as float16, Width * Height in row order.
+	static const uint16_t* GetHalfTexels();
+	// Baked texels decoded to float.
+	static const float* GetTexels();
+	// Bytes per texture row.
+	static int GetRowPitch() { return Width * sizeof(uint16_t); }
+
+	// Bilinear sample with clamp addressing, same as a linear sampler on the texture.
+	static float Sample(float u, float v);
+	// Linear lookup of a row at table coordinate InX in [0, Width - 1].
+	static float SampleRow(int InRow, float InX);
+
+	// 1 - exp(-t) for t >= -0.673.
+	static float OneMinusExp(float t);
+	// Lookup version of FRectGI::gIntegrateDiskLighting with the same arguments.
+	static float IntegrateDiskLighting(float InDiskRadius, float InDiskDist, float InNoL, float InLightIntensity,
+		float InRoughness);
+	// Lookup version of FRectGI::asgCalcBandwidth.
+	static float CalcBandwidth(float dr);
+
+	// Evaluate the tables in double precision and convert them to float16.
+	static void Bake(vector<uint16_t>& OutTexels);
+	// Write a fresh bake as SGLightingLutData.h.
+	static bool WriteBakedHeader(const char* InFileName);
+};
\ No newline at end of file
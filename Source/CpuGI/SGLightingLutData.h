@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+
+// Generated by FSGLightingLut::WriteBakedHeader (RectGICpu -bakelut), do not edit.
+// 64 x 2 texels, see SGLightingLut.h for the layout.
+static const uint16_t GSGLightingLutHalf[128] =
+{
+	0x41b5, 0x41b2, 0x41af, 0x41ac, 0x41a8, 0x41a4, 0x419f, 0x419a,
+	0x4195, 0x418f, 0x4188, 0x4181, 0x417a, 0x4172, 0x416a, 0x4161,
+	0x4157, 0x414d, 0x4142, 0x4137, 0x412b, 0x411e, 0x4111, 0x4103,
+	0x40f4, 0x40e4, 0x40d4, 0x40c3, 0x40b1, 0x409f, 0x408c, 0x4078,
+	0x4064, 0x404e, 0x4039, 0x4022, 0x400b, 0x3fe8, 0x3fb8, 0x3f88,
+	0x3f57, 0x3f26, 0x3ef4, 0x3ec3, 0x3e93, 0x3e63, 0x3e34, 0x3e06,
+	0x3dd9, 0x3dae, 0x3d85, 0x3d5d, 0x3d37, 0x3d14, 0x3cf2, 0x3cd1,
+	0x3cb3, 0x3c95, 0x3c7a, 0x3c5f, 0x3c46, 0x3c2d, 0x3c16, 0x3c00,
+	0x41fe, 0x4226, 0x424e, 0x4276, 0x429e, 0x42c5, 0x42ed, 0x4314,
+	0x433b, 0x4361, 0x4388, 0x43ae, 0x43d4, 0x43fa, 0x4410, 0x4422,
+	0x4435, 0x4448, 0x445a, 0x446d, 0x447f, 0x4491, 0x44a3, 0x44b5,
+	0x44c7, 0x44d9, 0x44eb, 0x44fd, 0x450f, 0x4520, 0x4532, 0x4544,
+	0x4555, 0x4566, 0x4578, 0x4589, 0x459a, 0x45ab, 0x45bc, 0x45cd,
+	0x45de, 0x45ef, 0x4600, 0x4611, 0x4622, 0x4633, 0x4643, 0x4654,
+	0x4664, 0x4675, 0x4685, 0x4696, 0x46a6, 0x46b6, 0x46c7, 0x46d7,
+	0x46e7, 0x46f7, 0x4707, 0x4717, 0x4727, 0x4737, 0x4747, 0x4757,
+};
+
+static const float GSGLightingLutFloat[128] =
+{
+	2.85351562f, 2.84765625f, 2.84179688f, 2.8359375f,
+	2.828125f, 2.8203125f, 2.81054688f, 2.80078125f,
+	2.79101562f, 2.77929688f, 2.765625f, 2.75195312f,
+	2.73828125f, 2.72265625f, 2.70703125f, 2.68945312f,
+	2.66992188f, 2.65039062f, 2.62890625f, 2.60742188f,
+	2.58398438f, 2.55859375f, 2.53320312f, 2.50585938f,
+	2.4765625f, 2.4453125f, 2.4140625f, 2.38085938f,
+	2.34570312f, 2.31054688f, 2.2734375f, 2.234375f,
+	2.1953125f, 2.15234375f, 2.11132812f, 2.06640625f,
+	2.02148438f, 1.9765625f, 1.9296875f, 1.8828125f,
+	1.83496094f, 1.78710938f, 1.73828125f, 1.69042969f,
+	1.64355469f, 1.59667969f, 1.55078125f, 1.50585938f,
+	1.46191406f, 1.41992188f, 1.37988281f, 1.34082031f,
+	1.30371094f, 1.26953125f, 1.23632812f, 1.20410156f,
+	1.17480469f, 1.14550781f, 1.11914062f, 1.09277344f,
+	1.06835938f, 1.04394531f, 1.02148438f, 1.0f,
+	2.99609375f, 3.07421875f, 3.15234375f, 3.23046875f,
+	3.30859375f, 3.38476562f, 3.46289062f, 3.5390625f,
+	3.61523438f, 3.68945312f, 3.765625f, 3.83984375f,
+	3.9140625f, 3.98828125f, 4.0625f, 4.1328125f,
+	4.20703125f, 4.28125f, 4.3515625f, 4.42578125f,
+	4.49609375f, 4.56640625f, 4.63671875f, 4.70703125f,
+	4.77734375f, 4.84765625f, 4.91796875f, 4.98828125f,
+	5.05859375f, 5.125f, 5.1953125f, 5.265625f,
+	5.33203125f, 5.3984375f, 5.46875f, 5.53515625f,
+	5.6015625f, 5.66796875f, 5.734375f, 5.80078125f,
+	5.8671875f, 5.93359375f, 6.0f, 6.06640625f,
+	6.1328125f, 6.19921875f, 6.26171875f, 6.328125f,
+	6.390625f, 6.45703125f, 6.51953125f, 6.5859375f,
+	6.6484375f, 6.7109375f, 6.77734375f, 6.83984375f,
+	6.90234375f, 6.96484375f, 7.02734375f, 7.08984375f,
+	7.15234375f, 7.21484375f, 7.27734375f, 7.33984375f,
+};
\ No newline at end of file
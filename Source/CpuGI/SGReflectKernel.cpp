@@ -0,0 +1,221 @@
+#include "SGReflectKernel.h"
+#include "FastMath.h"
+#include "RectGICpu.h"
+#include <algorithm>
+#include <cassert>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "SGReflectKernel.inl"
+
+// kernels of the instruction set specific translation units
+FSGReflectKernel::KernelFunc GetSGReflectKernelAVX2(ESimdMath::Type InMath);
+FSGReflectKernel::KernelFunc GetSGReflectKernelAVX512(ESimdMath::Type InMath);
+
+namespace
+{
+	// Cpu features relevant to the kernels.
+	struct FCpuFeatures
+	{
+		bool bAVX2;
+		bool bAVX512;
+
+		FCpuFeatures() : bAVX2(false), bAVX512(false)
+		{
+#if defined(_MSC_VER)
+			int Info[4];
+			__cpuid(Info, 0);
+			if (Info[0] < 7)
+				return;
+
+			__cpuid(Info, 1);
+			bool bOSXSave = (Info[2] & (1 << 27)) != 0;
+			bool bAVX = (Info[2] & (1 << 28)) != 0;
+			bool bFMA = (Info[2] & (1 << 12)) != 0;
+			if (!bOSXSave || !bAVX)
+				return;
+
+			// the os must save ymm, and zmm plus opmask state for avx-512
+			unsigned long long XCR0 = _xgetbv(0);
+			bool bYmmState = (XCR0 & 0x6) == 0x6;
+			bool bZmmState = (XCR0 & 0xe6) == 0xe6;
+
+			__cpuidex(Info, 7, 0);
+			bAVX2 = bYmmState && bFMA && (Info[1] & (1 << 5)) != 0;
+			bAVX512 = bZmmState && (Info[1] & (1 << 16)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			__builtin_cpu_init();
+			bAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			bAVX512 = __builtin_cpu_supports("avx512f");
+#endif
+		}
+	};
+
+	const FCpuFeatures& GetCpuFeatures()
+	{
+		static FCpuFeatures Features;
+		return Features;
+	}
+}
+
+void FSGReflectUniforms::Setup(float InSamplingRadius,
+	const float3& InPlaneCenter, const float3& InPlaneNormal, const float3& InPlaneMajorAxis,
+	const float3& InPlaneSpecularColor, float InPlaneMajorRadius, float InPlaneMinorRadius, float InPlaneRoughness,
+	const float3& InLightDir, float InLightIntensity, const float3& InViewPoint)
+{
+	// early outs of sgReflectShading that do not depend on the shading point
+	float3 LightDir = normalize(InLightDir);
+	mPlaneNormal = normalize(InPlaneNormal);
+	mIsBlack = InPlaneMajorRadius < 0.1f || InPlaneMinorRadius < 0.1f || dot(LightDir, mPlaneNormal) < 0.001f;
+
+	mPlaneCenter = InPlaneCenter;
+	mPlaneMajorAxis = normalize(InPlaneMajorAxis);
+	mPlaneMinorAxis = normalize(cross(mPlaneMajorAxis, mPlaneNormal));
+	mSpecularColor = InPlaneSpecularColor;
+	mMajorRadius = InPlaneMajorRadius;
+	mMinorRadius = InPlaneMinorRadius;
+	mViewPoint = InViewPoint;
+	mSamplingRadius = InSamplingRadius;
+
+	mMirrorDir = FRectGI::gReflectVector(LightDir, mPlaneNormal);
+	mInvLoN = 1.f / dot(LightDir, mPlaneNormal);
+
+	// gIntegrateDiskLighting with lyr folded into nol
+	float m2 = InPlaneRoughness * InPlaneRoughness;
+	mNoL = max(dot(mPlaneNormal, LightDir), 0);
+	mDiskK = (0.288f * mNoL) / m2 - 0.673f;
+	mDiskScale = mDiskK != 0 ? InLightIntensity * mNoL * PI / (2 * mDiskK * mDiskK) : 0.f;
+}
+
+bool FSGReflectKernel::IsSupported(ESimdIsa::Type InIsa)
+{
+	switch (InIsa)
+	{
+	case ESimdIsa::Scalar:
+		return true;
+	case ESimdIsa::AVX2:
+		return GetCpuFeatures().bAVX2 && GetKernel(InIsa, DefaultMath) != nullptr;
+	case ESimdIsa::AVX512:
+		return GetCpuFeatures().bAVX512 && GetKernel(InIsa, DefaultMath) != nullptr;
+	default:
+		return false;
+	}
+}
+
+ESimdIsa::Type FSGReflectKernel::GetBestIsa()
+{
+	static ESimdIsa::Type BestIsa =
+		IsSupported(ESimdIsa::AVX512) ? ESimdIsa::AVX512 :
+		IsSupported(ESimdIsa::AVX2) ? ESimdIsa::AVX2 : ESimdIsa::Scalar;
+	return BestIsa;
+}
+
+int FSGReflectKernel::GetLaneWidth(ESimdIsa::Type InIsa)
+{
+	static const int Widths[ESimdIsa::Num] = { 1, 8, 16 };
+	return Widths[InIsa];
+}
+
+const char* FSGReflectKernel::GetIsaName(ESimdIsa::Type InIsa)
+{
+	static const char* Names[ESimdIsa::Num] = { "Scalar", "AVX2", "AVX512" };
+	return Names[InIsa];
+}
+
+const char* FSGReflectKernel::GetMathName(ESimdMath::Type InMath)
+{
+	static const char* Names[ESimdMath::Num] = { "Libm", "Precise", "Fast", "Lut" };
+	return Names[InMath];
+}
+
+void FSGReflectKernel::Evaluate(const FSGShadingPoints& InPoints, const FSGReflectUniforms& InUniforms,
+	float* OutR, float* OutG, float* OutB)
+{
+	Evaluate(GetBestIsa(), DefaultMath, InPoints, InUniforms, OutR, OutG, OutB);
+}
+
+void FSGReflectKernel::Evaluate(ESimdIsa::Type InIsa, ESimdMath::Type InMath, const FSGShadingPoints& InPoints,
+	const FSGReflectUniforms& InUniforms, float* OutR, float* OutG, float* OutB)
+{
+	assert(IsSupported(InIsa));
+	GetKernel(InIsa, InMath)(InPoints, InUniforms, OutR, OutG, OutB);
+}
+
+FSGReflectKernel::KernelFunc FSGReflectKernel::GetKernel(ESimdIsa::Type InIsa, ESimdMath::Type InMath)
+{
+	switch (InIsa)
+	{
+	case ESimdIsa::Scalar:
+		return GetSGReflectKernel<FSimdScalar>(InMath);
+	case ESimdIsa::AVX2:
+		return GetSGReflectKernelAVX2(InMath);
+	case ESimdIsa::AVX512:
+		return GetSGReflectKernelAVX512(InMath);
+	default:
+		return nullptr;
+	}
+}
+
+void FSGReflectKernel::MeasureMathError(vector<FSGMathErrorResult>& OutResults)
+{
+	const int NumSamples = 1 << 20;
+
+	OutResults.clear();
+	for (int Math = 0; Math < ESimdMath::Num; ++Math)
+	{
+		FSGMathErrorResult Result;
+		Result.mMath = (ESimdMath::Type)Math;
+		Result.mExpMaxError = 0.f;
+		Result.mLogMaxError = 0.f;
+
+		for (int i = 0; i <= NumSamples; ++i)
+		{
+			float t = (float)i / NumSamples;
+
+			// exp range of sgProductIntegral and gIntegrateDiskLighting
+			float x = -10.f + t * 10.673f;
+			float Exp = 0.f;
+			switch (Math)
+			{
+			case ESimdMath::Libm: Exp = FMathLibm::Exp<FSimdScalar>(x); break;
+			case ESimdMath::Precise: Exp = FMathPrecise::Exp<FSimdScalar>(x); break;
+			case ESimdMath::Fast: Exp = FMathFast::Exp<FSimdScalar>(x); break;
+			case ESimdMath::Lut: Exp = FMathLut::Exp<FSimdScalar>(x); break;
+			}
+			double ExpRef = std::exp((double)x);
+			Result.mExpMaxError = max(Result.mExpMaxError, (float)std::fabs((Exp - ExpRef) / ExpRef));
+
+			// log range of asgCalcBandwidth, sampled logarithmically
+			float y = std::pow(1e4f, t);
+			float Log = 0.f;
+			switch (Math)
+			{
+			case ESimdMath::Libm: Log = FMathLibm::Log<FSimdScalar>(y); break;
+			case ESimdMath::Precise: Log = FMathPrecise::Log<FSimdScalar>(y); break;
+			case ESimdMath::Fast: Log = FMathFast::Log<FSimdScalar>(y); break;
+			case ESimdMath::Lut: Log = FMathLut::Log<FSimdScalar>(y); break;
+			}
+			Result.mLogMaxError = max(Result.mLogMaxError, (float)std::fabs(Log - std::log((double)y)));
+		}
+
+		const FSGMathErrorBudget& Budget = GetErrorBudget(Result.mMath);
+		Result.bWithinBudget = Result.mExpMaxError <= Budget.mExp && Result.mLogMaxError <= Budget.mLog;
+		OutResults.push_back(Result);
+	}
+}
+
+const FSGMathErrorBudget& FSGReflectKernel::GetErrorBudget(ESimdMath::Type InMath)
+{
+	// exp and log: 2 ulp for libm and the cephes polynomials, FastMath.h quotes ~1.5e-5 for the fits.
+	// image: the 1e-5 kernel tolerance, 1e-4 for the float16 tables of the Lut policy.
+	static const FSGMathErrorBudget Budgets[ESimdMath::Num] =
+	{
+		{ 2.4e-7f, 1e-6f, 1e-5f },
+		{ 2.4e-7f, 1e-6f, 1e-5f },
+		{ 2e-5f, 2e-5f, 1e-5f },
+		{ 2e-5f, 2e-5f, 1e-4f },
+	};
+	assert(InMath >= 0 && InMath < ESimdMath::Num);
+	return Budgets[InMath];
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+#include <vector>
+#include "GIMath.h"
+#include "SimdIsa.h"
+
+using namespace GIMath;
+using namespace std;
+
+// Shading points in structure-of-arrays layout, every array holds mCount floats.
+struct FSGShadingPoints
+{
+	// world position
+	const float* mPosX;
+	const float* mPosY;
+	const float* mPosZ;
+	// world normal, not necessarily normalized
+	const float* mNormalX;
+	const float* mNormalY;
+	const float* mNormalZ;
+	// material roughness
+	const float* mRoughness;
+	// number of shading points
+	int mCount;
+};
+
+// Inputs of sgReflectShading that are shared by all shading points of one reflector rectangle,
+// with every term that does not depend on the shading point precomputed.
+struct FSGReflectUniforms
+{
+	// Setup from the arguments of sgReflectShading.
+	void Setup(float InSamplingRadius,
+		const float3& InPlaneCenter, const float3& InPlaneNormal, const float3& InPlaneMajorAxis,
+		const float3& InPlaneSpecularColor, float InPlaneMajorRadius, float InPlaneMinorRadius, float InPlaneRoughness,
+		const float3& InLightDir, float InLightIntensity, const float3& InViewPoint);
+
+	// the rectangle can not reflect the light at all
+	bool mIsBlack;
+
+	float3 mPlaneCenter;
+	float3 mPlaneNormal;
+	float3 mPlaneMajorAxis;
+	float3 mPlaneMinorAxis;
+	float3 mSpecularColor;
+	float mMajorRadius;
+	float mMinorRadius;
+	float3 mViewPoint;
+	float mSamplingRadius;
+
+	// light direction mirrored by the plane, see gCalcPeakPoint
+	float3 mMirrorDir;
+	// 1 / dot(lightDir, planeNormal)
+	float mInvLoN;
+	// max(dot(planeNormal, lightDir), 0)
+	float mNoL;
+	// k of gIntegrateDiskLighting
+	float mDiskK;
+	// lightIntensity * lyr * PI / (2 * k * k) of gIntegrateDiskLighting
+	float mDiskScale;
+};
+
+// Error of one exp/log policy against libm over the argument ranges of the SG math.
+// The tables of the Lut policy are measured by CModuleBenchmarks::RunSGLightingLut.
+struct FSGMathErrorResult
+{
+	// exp/log policy
+	ESimdMath::Type mMath;
+	// max relative error of exp on [-10, 0.673]
+	float mExpMaxError;
+	// max absolute error of log on [1, 1e4]
+	float mLogMaxError;
+	// both errors are within FSGMathErrorBudget
+	bool bWithinBudget;
+};
+
+// Errors an exp/log policy is allowed, checked by RectGICpu -selftest.
+struct FSGMathErrorBudget
+{
+	// max relative error of exp, see FSGMathErrorResult
+	float mExp;
+	// max absolute error of log
+	float mLog;
+	// max image error of CCpuRenderer::MeasureReflectMathError relative to the peak value
+	float mImage;
+};
+
+// Batch evaluation of sgReflectShading for packets of shading points against one rectangle.
+// Accuracy: the packet paths fold the normalize/length pair of gCalcPeakPoint. With the precise
+// exp/log the tolerance against FRectGI::sgReflectShading is 1e-5 of the peak reflected value,
+// the benchmark scene measures ~1e-6 for every instruction set.
+class FSGReflectKernel
+{
+public:
+	// Packet function of one instruction set, adds results to the outputs.
+	typedef void (*KernelFunc)(const FSGShadingPoints& InPoints, const FSGReflectUniforms& InUniforms,
+		float* OutR, float* OutG, float* OutB);
+
+	// Whether the build and the running cpu support the instruction set.
+	static bool IsSupported(ESimdIsa::Type InIsa);
+	// Widest supported instruction set, picked once at runtime.
+	static ESimdIsa::Type GetBestIsa();
+	// Shading points per packet.
+	static int GetLaneWidth(ESimdIsa::Type InIsa);
+	// Printable name of the instruction set.
+	static const char* GetIsaName(ESimdIsa::Type InIsa);
+	// Printable name of the exp/log policy.
+	static const char* GetMathName(ESimdMath::Type InMath);
+
+	// Evaluate sgReflectShading for all points, adding the reflected color into the outputs.
+	static void Evaluate(const FSGShadingPoints& InPoints, const FSGReflectUniforms& InUniforms,
+		float* OutR, float* OutG, float* OutB);
+	// Same as above with an explicit instruction set and exp/log policy.
+	static void Evaluate(ESimdIsa::Type InIsa, ESimdMath::Type InMath, const FSGShadingPoints& InPoints,
+		const FSGReflectUniforms& InUniforms, float* OutR, float* OutG, float* OutB);
+
+	// Measure exp/log error of every policy with the scalar lanes.
+	static void MeasureMathError(vector<FSGMathErrorResult>& OutResults);
+	// Error budget of an exp/log policy.
+	static const FSGMathErrorBudget& GetErrorBudget(ESimdMath::Type InMath);
+
+public:
+	// exp/log policy used when none is given, see CCpuRenderer::MeasureReflectMathError for its image error
+	static const ESimdMath::Type DefaultMath = ESimdMath::Fast;
+
+private:
+	// Kernel of an instruction set and exp/log policy, nullptr if it was not compiled in.
+	static KernelFunc GetKernel(ESimdIsa::Type InIsa, ESimdMath::Type InMath);
+};
\ No newline at end of file
@@ -0,0 +1,178 @@
+// Packet kernel of sgReflectShading, included by one translation unit per instruction set.
+// Requires FastMath.h and SGReflectKernel.h.
+
+namespace
+{
+	// Evaluate S::Width shading points starting at InOffset, with lane type S and exp/log policy M.
+	template<class S, class M>
+	void SGReflectShadingPacket(const FSGShadingPoints& InPoints, const FSGReflectUniforms& U, int InOffset,
+		float* OutR, float* OutG, float* OutB)
+	{
+		typedef typename S::Float Float;
+		const Float Zero = S::Set1(0.f);
+		const Float One = S::Set1(1.f);
+
+		// shading point
+		Float Px = S::Load(InPoints.mPosX + InOffset);
+		Float Py = S::Load(InPoints.mPosY + InOffset);
+		Float Pz = S::Load(InPoints.mPosZ + InOffset);
+		Float Nx = S::Load(InPoints.mNormalX + InOffset);
+		Float Ny = S::Load(InPoints.mNormalY + InOffset);
+		Float Nz = S::Load(InPoints.mNormalZ + InOffset);
+		Float Rough = S::Load(InPoints.mRoughness + InOffset);
+
+		Float InvLen = One / S::Sqrt(Nx * Nx + Ny * Ny + Nz * Nz);
+		Nx = Nx * InvLen; Ny = Ny * InvLen; Nz = Nz * InvLen;
+
+		// viewDir = normalize(viewPoint - shadingPt)
+		Float Vx = S::Set1(U.mViewPoint.x) - Px;
+		Float Vy = S::Set1(U.mViewPoint.y) - Py;
+		Float Vz = S::Set1(U.mViewPoint.z) - Pz;
+		InvLen = One / S::Sqrt(Vx * Vx + Vy * Vy + Vz * Vz);
+		Vx = Vx * InvLen; Vy = Vy * InvLen; Vz = Vz * InvLen;
+
+		// gCalcPeakPoint
+		Float Dx = Px - S::Set1(U.mPlaneCenter.x);
+		Float Dy = Py - S::Set1(U.mPlaneCenter.y);
+		Float Dz = Pz - S::Set1(U.mPlaneCenter.z);
+		Float ViewProjDist = Dx * S::Set1(U.mPlaneNormal.x) + Dy * S::Set1(U.mPlaneNormal.y) + Dz * S::Set1(U.mPlaneNormal.z);
+		Float ViewPeakDist = ViewProjDist * S::Set1(U.mInvLoN);
+		Float PeakX = Px - S::Set1(U.mMirrorDir.x) * ViewPeakDist;
+		Float PeakY = Py - S::Set1(U.mMirrorDir.y) * ViewPeakDist;
+		Float PeakZ = Pz - S::Set1(U.mMirrorDir.z) * ViewPeakDist;
+
+		// sgReflectLight
+		Float Tx = Px - PeakX;
+		Float Ty = Py - PeakY;
+		Float Tz = Pz - PeakZ;
+		Float ShadingDist = S::Sqrt(Tx * Tx + Ty * Ty + Tz * Tz);
+		typename S::Mask Black = S::Less(ShadingDist, S::Set1(0.001f));
+		Float InvDist = One / ShadingDist;
+		Float RefX = Tx * InvDist;
+		Float RefY = Ty * InvDist;
+		Float RefZ = Tz * InvDist;
+		Float Dr = S::Set1(U.mSamplingRadius) * InvDist;
+		Float MinorSize = (RefX * S::Set1(U.mPlaneNormal.x) + RefY * S::Set1(U.mPlaneNormal.y) +
+			RefZ * S::Set1(U.mPlaneNormal.z)) * Dr;
+
+		// asgCalcBandwidth
+		Float MinorSize2 = MinorSize * MinorSize;
+		Float LightLambda = S::Set1(2.f) * M::template AsgBandwidth<S>(MinorSize2);
+
+		// gIntegrateDiskLighting, then sgCalcAmplitude with lambda >= sgMinLambda
+		Float DrCos = Dr * S::Set1(U.mNoL);
+		Float DrCos2 = DrCos * DrCos;
+		Float SinThetaA2 = DrCos2 / (One + DrCos2);
+		Float Energy = M::template OneMinusExp<S>(S::Set1(U.mDiskK) * SinThetaA2) * S::Set1(U.mDiskScale);
+		Float LightMu = Energy * LightLambda * S::Set1(1.f / (2 * PI));
+
+		// sgNDF with lightDir = -refViewDir
+		Float Hx = Vx - RefX;
+		Float Hy = Vy - RefY;
+		Float Hz = Vz - RefZ;
+		InvLen = One / S::Sqrt(Hx * Hx + Hy * Hy + Hz * Hz);
+		Float HoV = (Hx * Vx + Hy * Vy + Hz * Vz) * InvLen;
+		Float VoN2 = S::Set1(2.f) * (Vx * Nx + Vy * Ny + Vz * Nz);
+		Float Rx = VoN2 * Nx - Vx;
+		Float Ry = VoN2 * Ny - Vy;
+		Float Rz = VoN2 * Nz - Vz;
+		InvLen = One / S::Sqrt(Rx * Rx + Ry * Ry + Rz * Rz);
+		Float Jacobian = S::Max(S::Set1(4.f) * HoV, S::Set1(0.001f));
+		Float M2 = Rough * Rough;
+		Float NdfLambda = S::Set1(2.f) / (M2 * Jacobian);
+		Float NdfMu = One / (S::Set1(PI) * M2);
+
+		// sgProductIntegral
+		Float C1 = (LightLambda * NdfLambda) / (LightLambda + NdfLambda);
+		Float C2 = -(RefX * Rx + RefY * Ry + RefZ * Rz) * InvLen;
+		Float L3 = LightLambda + NdfLambda - C1 * (One - C2);
+		Float Factor = C1 * (C2 - One);
+		Float Shading = M::template Exp<S>(Factor) * (LightMu * NdfMu * S::Set1(2 * PI)) / L3;
+		Shading = S::Select(S::Less(Factor, S::Set1(-10.f)), Zero, Shading);
+
+		// gCircIntsRectArea around the peak point
+		Float R = S::Set1(U.mSamplingRadius);
+		Float Cx = PeakX - S::Set1(U.mPlaneCenter.x);
+		Float Cy = PeakY - S::Set1(U.mPlaneCenter.y);
+		Float Cz = PeakZ - S::Set1(U.mPlaneCenter.z);
+		Float DistX = Cx * S::Set1(U.mPlaneMajorAxis.x) + Cy * S::Set1(U.mPlaneMajorAxis.y) + Cz * S::Set1(U.mPlaneMajorAxis.z);
+		Float DistY = Cx * S::Set1(U.mPlaneMinorAxis.x) + Cy * S::Set1(U.mPlaneMinorAxis.y) + Cz * S::Set1(U.mPlaneMinorAxis.z);
+		Float MajorR = S::Set1(U.mMajorRadius);
+		Float MinorR = S::Set1(U.mMinorRadius);
+		Float XOverlap = S::Max(Zero, S::Min(MajorR, DistX + R) - S::Max(-MajorR, DistX - R));
+		Float YOverlap = S::Max(Zero, S::Min(MinorR, DistY + R) - S::Max(-MinorR, DistY - R));
+		Float IntsPercent = S::Min(One, XOverlap * YOverlap * S::Set1(1.f / (4 * U.mSamplingRadius * U.mSamplingRadius)));
+
+		Float Power = S::Select(Black, Zero, Shading * IntsPercent);
+		S::Store(OutR + InOffset, S::Load(OutR + InOffset) + Power * S::Set1(U.mSpecularColor.x));
+		S::Store(OutG + InOffset, S::Load(OutG + InOffset) + Power * S::Set1(U.mSpecularColor.y));
+		S::Store(OutB + InOffset, S::Load(OutB + InOffset) + Power * S::Set1(U.mSpecularColor.z));
+	}
+
+	// Run the packet kernel over all points, the tail is padded through a local packet.
+	template<class S, class M>
+	void SGReflectShadingBatch(const FSGShadingPoints& InPoints, const FSGReflectUniforms& InUniforms,
+		float* OutR, float* OutG, float* OutB)
+	{
+		if (InUniforms.mIsBlack)
+			return;
+
+		const int Width = S::Width;
+		int Full = InPoints.mCount - InPoints.mCount % Width;
+		for (int i = 0; i < Full; i += Width)
+		{
+			SGReflectShadingPacket<S, M>(InPoints, InUniforms, i, OutR, OutG, OutB);
+		}
+
+		int Tail = InPoints.mCount - Full;
+		if (Tail == 0)
+			return;
+
+		// replicate the last point into the unused lanes to keep them finite
+		float Tmp[10][Width];
+		const float* Src[7] = { InPoints.mPosX, InPoints.mPosY, InPoints.mPosZ,
+			InPoints.mNormalX, InPoints.mNormalY, InPoints.mNormalZ, InPoints.mRoughness };
+		float* Dst[3] = { OutR, OutG, OutB };
+		for (int Lane = 0; Lane < Width; ++Lane)
+		{
+			int Index = Full + (Lane < Tail ? Lane : Tail - 1);
+			for (int a = 0; a < 7; ++a)
+			{
+				Tmp[a][Lane] = Src[a][Index];
+			}
+			for (int a = 0; a < 3; ++a)
+			{
+				Tmp[7 + a][Lane] = 0.f;
+			}
+		}
+
+		FSGShadingPoints TailPoints = { Tmp[0], Tmp[1], Tmp[2], Tmp[3], Tmp[4], Tmp[5], Tmp[6], Width };
+		SGReflectShadingPacket<S, M>(TailPoints, InUniforms, 0, Tmp[7], Tmp[8], Tmp[9]);
+		for (int Lane = 0; Lane < Tail; ++Lane)
+		{
+			for (int a = 0; a < 3; ++a)
+			{
+				Dst[a][Full + Lane] += Tmp[7 + a][Lane];
+			}
+		}
+	}
+
+	// Kernels of lane type S for every exp/log policy.
+	template<class S>
+	FSGReflectKernel::KernelFunc GetSGReflectKernel(ESimdMath::Type InMath)
+	{
+		switch (InMath)
+		{
+		case ESimdMath::Libm:
+			return &SGReflectShadingBatch<S, FMathLibm>;
+		case ESimdMath::Precise:
+			return &SGReflectShadingBatch<S, FMathPrecise>;
+		case ESimdMath::Fast:
+			return &SGReflectShadingBatch<S, FMathFast>;
+		case ESimdMath::Lut:
+			return &SGReflectShadingBatch<S, FMathLut>;
+		default:
+			return nullptr;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+// Compiled with /arch:AVX512, only reached after the runtime cpu check in SGReflectKernel.cpp.
+#include "SGReflectKernel.h"
+#include "FastMath.h"
+
+#if defined(__AVX512F__)
+#include "SGReflectKernel.inl"
+
+FSGReflectKernel::KernelFunc GetSGReflectKernelAVX512(ESimdMath::Type InMath)
+{
+	return GetSGReflectKernel<FSimdAVX512>(InMath);
+}
+#else
+FSGReflectKernel::KernelFunc GetSGReflectKernelAVX512(ESimdMath::Type InMath)
+{
+	(void)InMath;
+	return nullptr;
+}
+#endif
\ No newline at end of file
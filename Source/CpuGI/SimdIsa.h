@@ -0,0 +1,35 @@
+#pragma once
+
+// Instruction sets of the packet kernels.
+namespace ESimdIsa
+{
+	enum Type
+	{
+		// one float per step
+		Scalar = 0,
+		// 8 float lanes
+		AVX2,
+		// 16 float lanes
+		AVX512,
+
+		Num
+	};
+};
+
+// exp/log implementations of the packet kernels, see FastMath.h.
+namespace ESimdMath
+{
+	enum Type
+	{
+		// std::exp / std::log per lane
+		Libm = 0,
+		// cephes polynomials, ~1 ulp
+		Precise,
+		// low degree polynomials, ~1.5e-5 relative error
+		Fast,
+		// Fast plus the float16 tables of FSGLightingLut, ~5e-4 relative error
+		Lut,
+
+		Num
+	};
+};
\ No newline at end of file
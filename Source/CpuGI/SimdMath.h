@@ -0,0 +1,193 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Lane abstractions for the packet kernels.
+// Every ISA specific translation unit is compiled with its own instruction set flags, so all
+// symbols here have internal linkage. Otherwise the linker could merge an AVX-512 compiled
+// inline function into the AVX2 or scalar path.
+namespace
+{
+	// One float per packet.
+	struct FSimdScalar
+	{
+		typedef float Float;
+		typedef bool Mask;
+		static const int Width = 1;
+
+		static Float Load(const float* p) { return *p; }
+		static void Store(float* p, Float v) { *p = v; }
+		static Float Set1(float v) { return v; }
+
+		static Float Sqrt(Float v) { return std::sqrt(v); }
+		static Float Min(Float a, Float b) { return a < b ? a : b; }
+		static Float Max(Float a, Float b) { return a > b ? a : b; }
+		static Float Abs(Float v) { return std::fabs(v); }
+		static Float Round(Float v) { return std::nearbyint(v); }
+
+		static Mask Less(Float a, Float b) { return a < b; }
+		static Mask Or(Mask a, Mask b) { return a || b; }
+		// m ? a : b
+		static Float Select(Mask m, Float a, Float b) { return m ? a : b; }
+		static bool All(Mask m) { return m; }
+
+		// 2^n for integral n in the normal exponent range.
+		static Float Pow2i(Float n)
+		{
+			int32_t Bits = ((int32_t)n + 127) << 23;
+			float Ret;
+			memcpy(&Ret, &Bits, sizeof(Ret));
+			return Ret;
+		}
+		// Split positive normal x into mantissa in [0.5, 1) and exponent.
+		static Float Frexp(Float x, Float& OutExp)
+		{
+			int32_t Bits;
+			memcpy(&Bits, &x, sizeof(Bits));
+			OutExp = (float)(((Bits >> 23) & 0xff) - 126);
+			Bits = (Bits & 0x807fffff) | 0x3f000000;
+			float Ret;
+			memcpy(&Ret, &Bits, sizeof(Ret));
+			return Ret;
+		}
+		// Linear interpolation of a table at coordinate x, clamped to [0, Size - 1].
+		static Float LerpTable(const float* Table, int Size, Float x)
+		{
+			x = Min(Max(x, 0.f), (float)(Size - 1));
+			int i = (int)x;
+			i = i < Size - 2 ? i : Size - 2;
+			Float Frac = x - (float)i;
+			return Table[i] + (Table[i + 1] - Table[i]) * Frac;
+		}
+	};
+
+#if defined(__AVX2__)
+	// 8 floats of a ymm register.
+	struct FFloat8
+	{
+		__m256 v;
+
+		FFloat8() {}
+		FFloat8(__m256 InV) : v(InV) {}
+	};
+
+	inline FFloat8 operator+(FFloat8 a, FFloat8 b) { return _mm256_add_ps(a.v, b.v); }
+	inline FFloat8 operator-(FFloat8 a, FFloat8 b) { return _mm256_sub_ps(a.v, b.v); }
+	inline FFloat8 operator*(FFloat8 a, FFloat8 b) { return _mm256_mul_ps(a.v, b.v); }
+	inline FFloat8 operator/(FFloat8 a, FFloat8 b) { return _mm256_div_ps(a.v, b.v); }
+	inline FFloat8 operator-(FFloat8 a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)); }
+
+	struct FSimdAVX2
+	{
+		typedef FFloat8 Float;
+		typedef FFloat8 Mask;
+		static const int Width = 8;
+
+		static Float Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Float v) { _mm256_storeu_ps(p, v.v); }
+		static Float Set1(float v) { return _mm256_set1_ps(v); }
+
+		static Float Sqrt(Float v) { return _mm256_sqrt_ps(v.v); }
+		static Float Min(Float a, Float b) { return _mm256_min_ps(a.v, b.v); }
+		static Float Max(Float a, Float b) { return _mm256_max_ps(a.v, b.v); }
+		static Float Abs(Float v) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), v.v); }
+		static Float Round(Float v) { return _mm256_round_ps(v.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+		static Mask Less(Float a, Float b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+		static Mask Or(Mask a, Mask b) { return _mm256_or_ps(a.v, b.v); }
+		static Float Select(Mask m, Float a, Float b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+		static bool All(Mask m) { return _mm256_movemask_ps(m.v) == 0xff; }
+
+		static Float Pow2i(Float n)
+		{
+			__m256i Bits = _mm256_add_epi32(_mm256_cvtps_epi32(n.v), _mm256_set1_epi32(127));
+			return _mm256_castsi256_ps(_mm256_slli_epi32(Bits, 23));
+		}
+		static Float Frexp(Float x, Float& OutExp)
+		{
+			__m256i Bits = _mm256_castps_si256(x.v);
+			__m256i Exp = _mm256_and_si256(_mm256_srli_epi32(Bits, 23), _mm256_set1_epi32(0xff));
+			OutExp = _mm256_cvtepi32_ps(_mm256_sub_epi32(Exp, _mm256_set1_epi32(126)));
+			Bits = _mm256_or_si256(_mm256_and_si256(Bits, _mm256_set1_epi32((int)0x807fffff)),
+				_mm256_set1_epi32(0x3f000000));
+			return _mm256_castsi256_ps(Bits);
+		}
+		static Float LerpTable(const float* Table, int Size, Float x)
+		{
+			x = Min(Max(x, Set1(0.f)), Set1((float)(Size - 1)));
+			__m256i i = _mm256_min_epi32(_mm256_cvttps_epi32(x.v), _mm256_set1_epi32(Size - 2));
+			Float Frac = x - Float(_mm256_cvtepi32_ps(i));
+			Float a = _mm256_i32gather_ps(Table, i, 4);
+			Float b = _mm256_i32gather_ps(Table + 1, i, 4);
+			return a + (b - a) * Frac;
+		}
+	};
+#endif
+
+#if defined(__AVX512F__)
+	// 16 floats of a zmm register.
+	struct FFloat16
+	{
+		__m512 v;
+
+		FFloat16() {}
+		FFloat16(__m512 InV) : v(InV) {}
+	};
+
+	inline FFloat16 operator+(FFloat16 a, FFloat16 b) { return _mm512_add_ps(a.v, b.v); }
+	inline FFloat16 operator-(FFloat16 a, FFloat16 b) { return _mm512_sub_ps(a.v, b.v); }
+	inline FFloat16 operator*(FFloat16 a, FFloat16 b) { return _mm512_mul_ps(a.v, b.v); }
+	inline FFloat16 operator/(FFloat16 a, FFloat16 b) { return _mm512_div_ps(a.v, b.v); }
+	inline FFloat16 operator-(FFloat16 a) { return _mm512_sub_ps(_mm512_setzero_ps(), a.v); }
+
+	struct FSimdAVX512
+	{
+		typedef FFloat16 Float;
+		typedef __mmask16 Mask;
+		static const int Width = 16;
+
+		static Float Load(const float* p) { return _mm512_loadu_ps(p); }
+		static void Store(float* p, Float v) { _mm512_storeu_ps(p, v.v); }
+		static Float Set1(float v) { return _mm512_set1_ps(v); }
+
+		static Float Sqrt(Float v) { return _mm512_sqrt_ps(v.v); }
+		static Float Min(Float a, Float b) { return _mm512_min_ps(a.v, b.v); }
+		static Float Max(Float a, Float b) { return _mm512_max_ps(a.v, b.v); }
+		static Float Abs(Float v) { return _mm512_abs_ps(v.v); }
+		static Float Round(Float v) { return _mm512_roundscale_ps(v.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+
+		static Mask Less(Float a, Float b) { return _mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ); }
+		static Mask Or(Mask a, Mask b) { return (Mask)(a | b); }
+		static Float Select(Mask m, Float a, Float b) { return _mm512_mask_blend_ps(m, b.v, a.v); }
+		static bool All(Mask m) { return m == 0xffff; }
+
+		static Float Pow2i(Float n)
+		{
+			__m512i Bits = _mm512_add_epi32(_mm512_cvtps_epi32(n.v), _mm512_set1_epi32(127));
+			return _mm512_castsi512_ps(_mm512_slli_epi32(Bits, 23));
+		}
+		static Float Frexp(Float x, Float& OutExp)
+		{
+			__m512i Bits = _mm512_castps_si512(x.v);
+			__m512i Exp = _mm512_and_si512(_mm512_srli_epi32(Bits, 23), _mm512_set1_epi32(0xff));
+			OutExp = _mm512_cvtepi32_ps(_mm512_sub_epi32(Exp, _mm512_set1_epi32(126)));
+			Bits = _mm512_or_si512(_mm512_and_si512(Bits, _mm512_set1_epi32((int)0x807fffff)),
+				_mm512_set1_epi32(0x3f000000));
+			return _mm512_castsi512_ps(Bits);
+		}
+		static Float LerpTable(const float* Table, int Size, Float x)
+		{
+			x = Min(Max(x, Set1(0.f)), Set1((float)(Size - 1)));
+			__m512i i = _mm512_min_epi32(_mm512_cvttps_epi32(x.v), _mm512_set1_epi32(Size - 2));
+			Float Frac = x - Float(_mm512_cvtepi32_ps(i));
+			Float a = _mm512_i32gather_ps(i, Table, 4);
+			Float b = _mm512_i32gather_ps(i, Table + 1, 4);
+			return a + (b - a) * Frac;
+		}
+	};
+#endif
+}
\ No newline at end of file
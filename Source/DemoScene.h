@@ -0,0 +1,50 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cmath>
+
+using namespace DirectX;
+
+// Description of the demo scene, shared by RectGI.cpp and the headless cpu renderer so both draw the same scene.
+
+// Rectangle receiver, the arguments of CRenderInstance::CreateRectInstance.
+struct FDemoRect
+{
+	// render instance name
+	const char* mName;
+	// center
+	XMFLOAT3 mPosition;
+	// pitch, yaw and roll in units of PI
+	XMFLOAT3 mRotation;
+	// half extent
+	float mScale;
+	// material roughness
+	float mRoughness;
+	// diffuse color
+	XMFLOAT3 mDiffuseColor;
+};
+
+// all rectangles, their application ids are their indices
+static const FDemoRect GDemoRects[] =
+{
+	{ "floor", XMFLOAT3(0.f, 0.f, 280.f), XMFLOAT3(1.f, .0f, .0f), 300, 0.1f, XMFLOAT3(0.7f, 0.2f, 0.2f) },
+	{ "wallBack", XMFLOAT3(0.f, 300.f, -20.f), XMFLOAT3(.5f, 1.f, .0f), 300, 0.1f, XMFLOAT3(0.2f, 0.7f, 0.2f) },
+	{ "wallR", XMFLOAT3(300.f, 0.f, -20.f), XMFLOAT3(1.f, 2.5f, .0f), 300, 0.1f, XMFLOAT3(0.2f, 0.2f, 0.7f) },
+	{ "wallL", XMFLOAT3(-300.f, 0.f, -20.f), XMFLOAT3(-1.f, -2.5f, .0f), 300, 0.1f, XMFLOAT3(0.2f, 0.2f, 0.7f) },
+};
+static const int GNumDemoRects = sizeof(GDemoRects) / sizeof(GDemoRects[0]);
+
+// light intensities of CMiniEngine
+static const float GDemoLightIntensity = 18;
+static const float GDemoSpecularReflIntensity = 1;
+static const float GDemoDiffuseReflIntensity = .008f;
+
+// the model viewer camera looks at the origin from the direction of GDemoEye, 3 scene radii away
+static const XMFLOAT3 GDemoEye(0.0f, -30.0f, -20.0f);
+static const float GDemoSceneRadius = 378.15607f;
+
+// Position of the moving light at a time in seconds, also its direction.
+inline XMFLOAT3 GetDemoLightPosition(double InTime)
+{
+	static const float GLightSpeed = 2;
+	return XMFLOAT3(std::cos((float)InTime * GLightSpeed) * 500, std::sin((float)InTime * GLightSpeed) * 500, -300);
+}
@@ -0,0 +1,39 @@
+#include "AllocationCounter.h"
+#include <atomic>
+
+using namespace std;
+
+namespace
+{
+	// constant initialized, allocations of static constructors in other files are counted too
+	atomic<uint64_t> GNumAllocations(0);
+	atomic<uint64_t> GNumBytes(0);
+	atomic<bool> GHooked(false);
+}
+
+bool CAllocationCounter::IsHooked()
+{
+	return GHooked.load(memory_order_relaxed);
+}
+
+uint64_t CAllocationCounter::GetNumAllocations()
+{
+	return GNumAllocations.load(memory_order_relaxed);
+}
+
+uint64_t CAllocationCounter::GetNumBytes()
+{
+	return GNumBytes.load(memory_order_relaxed);
+}
+
+void CAllocationCounter::Count(size_t InSize)
+{
+	GNumAllocations.fetch_add(1, memory_order_relaxed);
+	GNumBytes.fetch_add(InSize, memory_order_relaxed);
+}
+
+bool CAllocationCounter::SetHooked()
+{
+	GHooked.store(true, memory_order_relaxed);
+	return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Counts heap allocations made through the global operator new. The operators are replaced by AllocationHook.cpp,
+// which only the benchmark builds link, so the demo and the tests allocate without the two atomic adds.
+class CAllocationCounter
+{
+public:
+	// Whether AllocationHook.cpp is linked, the counters stay zero otherwise.
+	static bool IsHooked();
+	// Allocations since the process started.
+	static uint64_t GetNumAllocations();
+	// Bytes requested by those allocations.
+	static uint64_t GetNumBytes();
+
+	// Count one allocation of InSize bytes, called by the replaced operators.
+	static void Count(size_t InSize);
+	// Called once by AllocationHook.cpp when it is linked.
+	static bool SetHooked();
+};
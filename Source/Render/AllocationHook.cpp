@@ -0,0 +1,115 @@
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+using namespace std;
+
+// Replaces the global operator new and delete to count allocations in CAllocationCounter. Only linked into the
+// benchmark builds: RectGIFrameBench in CMake and the Profile configuration of RectGI.vcxproj.
+
+namespace
+{
+	const bool GHooked = CAllocationCounter::SetHooked();
+
+	// Loop over the new_handler like the default operator new, nullptr if there is none.
+	void* Allocate(size_t InSize)
+	{
+		CAllocationCounter::Count(InSize);
+		size_t Size = InSize > 0 ? InSize : 1;
+		for (;;)
+		{
+			void* p = malloc(Size);
+			if (p != nullptr)
+				return p;
+			new_handler Handler = get_new_handler();
+			if (Handler == nullptr)
+				return nullptr;
+			Handler();
+		}
+	}
+
+#ifdef __cpp_aligned_new
+	void* AllocateAligned(size_t InSize, size_t InAlignment)
+	{
+		CAllocationCounter::Count(InSize);
+		// aligned_alloc needs a multiple of the alignment
+		size_t Size = (max(InSize, (size_t)1) + InAlignment - 1) & ~(InAlignment - 1);
+		for (;;)
+		{
+#ifdef _MSC_VER
+			void* p = _aligned_malloc(Size, InAlignment);
+#else
+			void* p = aligned_alloc(InAlignment, Size);
+#endif
+			if (p != nullptr)
+				return p;
+			new_handler Handler = get_new_handler();
+			if (Handler == nullptr)
+				return nullptr;
+			Handler();
+		}
+	}
+
+	void FreeAligned(void* p)
+	{
+#ifdef _MSC_VER
+		_aligned_free(p);
+#else
+		free(p);
+#endif
+	}
+#endif
+}
+
+// The array, nothrow and sized forms call these by default, and the aligned ones call the aligned forms.
+void* operator new(size_t InSize)
+{
+	void* p = Allocate(InSize);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new(size_t InSize, const nothrow_t&) noexcept
+{
+	return Allocate(InSize);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t InSize, align_val_t InAlignment)
+{
+	void* p = AllocateAligned(InSize, (size_t)InAlignment);
+	if (p == nullptr)
+		throw bad_alloc();
+	return p;
+}
+
+void* operator new(size_t InSize, align_val_t InAlignment, const nothrow_t&) noexcept
+{
+	return AllocateAligned(InSize, (size_t)InAlignment);
+}
+
+void operator delete(void* p, align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept
+{
+	FreeAligned(p);
+}
+#endif
@@ -0,0 +1,354 @@
+#include "DXUT.h"
+#include "D3D11RenderBackend.h"
+
+CD3D11RenderBackend::CD3D11RenderBackend()
+	: mContext(nullptr)
+	, mContext1(nullptr)
+	, bFeaturesQueried(false)
+	, bConstantBufferOffsetting(false)
+	, bMapNoOverwriteConstants(false)
+	, mFrameConstantsRing(nullptr)
+	, mRingSize(0)
+	, mRingHead(0)
+	, mRingBase(0)
+{
+	for (int Stage = 0; Stage < EShaderStage::Num; ++Stage)
+	{
+		for (int Slot = 0; Slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++Slot)
+		{
+			mScratchConstants[Stage][Slot] = nullptr;
+			mScratchSizes[Stage][Slot] = 0;
+		}
+	}
+}
+
+void CD3D11RenderBackend::OnDestroy()
+{
+	SAFE_RELEASE(mFrameConstantsRing);
+	mRingSize = 0;
+	mRingHead = 0;
+	for (int Stage = 0; Stage < EShaderStage::Num; ++Stage)
+	{
+		for (int Slot = 0; Slot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++Slot)
+		{
+			SAFE_RELEASE(mScratchConstants[Stage][Slot]);
+			mScratchSizes[Stage][Slot] = 0;
+		}
+	}
+	SAFE_RELEASE(mContext1);
+	bFeaturesQueried = false;
+}
+
+bool CD3D11RenderBackend::CreateBuffer(EBufferBinding::Type InBinding, uint32_t InStride, uint32_t InCapacity,
+	FRenderBuffer& OutBuffer)
+{
+	assert(mContext != nullptr && OutBuffer.mBuffer == nullptr && InStride > 0 && InCapacity > 0);
+	ID3D11Device* pd3dDevice = nullptr;
+	mContext->GetDevice(&pd3dDevice);
+
+	D3D11_BUFFER_DESC Desc;
+	ZeroMemory(&Desc, sizeof(D3D11_BUFFER_DESC));
+	Desc.Usage = D3D11_USAGE_DYNAMIC;
+	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	Desc.ByteWidth = InCapacity * InStride;
+	switch (InBinding)
+	{
+	case EBufferBinding::Vertex:
+		Desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		break;
+	case EBufferBinding::Index:
+		Desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		break;
+	case EBufferBinding::Structured:
+		Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		Desc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		Desc.StructureByteStride = InStride;
+		break;
+	}
+
+	ID3D11Buffer* pBuffer = nullptr;
+	ID3D11ShaderResourceView* pView = nullptr;
+	HRESULT hr = pd3dDevice->CreateBuffer(&Desc, nullptr, &pBuffer);
+	if (SUCCEEDED(hr) && InBinding == EBufferBinding::Structured)
+	{
+		D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc;
+		ZeroMemory(&SRVDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
+		SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
+		SRVDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		SRVDesc.Buffer.FirstElement = 0;
+		SRVDesc.Buffer.NumElements = InCapacity;
+		hr = pd3dDevice->CreateShaderResourceView(pBuffer, &SRVDesc, &pView);
+	}
+	SAFE_RELEASE(pd3dDevice);
+	if (FAILED(hr))
+	{
+		SAFE_RELEASE(pBuffer);
+		return false;
+	}
+
+	OutBuffer.mBuffer = pBuffer;
+	OutBuffer.mView = pView;
+	OutBuffer.mCapacity = InCapacity;
+	return true;
+}
+
+void CD3D11RenderBackend::ReleaseBuffer(FRenderBuffer& InOutBuffer)
+{
+	ID3D11ShaderResourceView* pView = static_cast<ID3D11ShaderResourceView*>(InOutBuffer.mView);
+	ID3D11Buffer* pBuffer = static_cast<ID3D11Buffer*>(InOutBuffer.mBuffer);
+	SAFE_RELEASE(pView);
+	SAFE_RELEASE(pBuffer);
+	InOutBuffer = FRenderBuffer();
+}
+
+void CD3D11RenderBackend::QueryFeatures()
+{
+	bFeaturesQueried = true;
+
+	ID3D11Device* pd3dDevice = nullptr;
+	mContext->GetDevice(&pd3dDevice);
+	D3D11_FEATURE_DATA_D3D11_OPTIONS Options = {};
+	HRESULT hr = pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &Options, sizeof(Options));
+	SAFE_RELEASE(pd3dDevice);
+
+	if (SUCCEEDED(hr) && Options.ConstantBufferOffsetting
+		&& SUCCEEDED(mContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&mContext1))))
+	{
+		bConstantBufferOffsetting = true;
+		bMapNoOverwriteConstants = Options.MapNoOverwriteOnDynamicConstantBuffer != FALSE;
+	}
+}
+
+void CD3D11RenderBackend::UploadFrameConstants(const CRenderCommandList& InCommands)
+{
+	const vector<uint8_t>& FrameConstants = InCommands.GetFrameConstants();
+	UINT Size = (UINT)FrameConstants.size();
+	if (Size == 0)
+		return;
+
+	if (mRingSize < Size)
+	{
+		// grow to hold a few frames
+		SAFE_RELEASE(mFrameConstantsRing);
+		mRingSize = max((UINT)MinRingSize, Size * 4);
+		mRingHead = 0;
+
+		ID3D11Device* pd3dDevice = nullptr;
+		mContext->GetDevice(&pd3dDevice);
+		D3D11_BUFFER_DESC Desc;
+		Desc.ByteWidth = mRingSize;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+		HRESULT hr = pd3dDevice->CreateBuffer(&Desc, nullptr, &mFrameConstantsRing);
+		assert(SUCCEEDED(hr));
+		SAFE_RELEASE(pd3dDevice);
+	}
+
+	// append behind the frames the GPU may still read, start over with a fresh buffer when full
+	D3D11_MAP MapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (!bMapNoOverwriteConstants || mRingHead + Size > mRingSize)
+	{
+		MapType = D3D11_MAP_WRITE_DISCARD;
+		mRingHead = 0;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	HRESULT hr = mContext->Map(mFrameConstantsRing, 0, MapType, 0, &MappedResource);
+	assert(SUCCEEDED(hr));
+	memcpy(static_cast<uint8_t*>(MappedResource.pData) + mRingHead, FrameConstants.data(), Size);
+	mContext->Unmap(mFrameConstantsRing, 0);
+
+	mRingBase = mRingHead;
+	mRingHead += Size;
+}
+
+void CD3D11RenderBackend::SetFrameConstants(const CRenderCommandList& InCommands, const FRenderCommand& InCommand)
+{
+	UINT Offset = InCommand.mArgs[0];
+	UINT Size = InCommand.mArgs[1];
+	assert(InCommand.mSlot < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
+
+	if (bConstantBufferOffsetting)
+	{
+		// offsets and sizes are in constants of 16 bytes, both multiples of 16 constants
+		UINT FirstConstant = (mRingBase + Offset) / 16;
+		UINT NumConstants = ((Size + CRenderCommandList::ConstantsAlignment - 1) & ~(CRenderCommandList::ConstantsAlignment - 1)) / 16;
+		if (InCommand.mStage == EShaderStage::Vertex)
+			mContext1->VSSetConstantBuffers1(InCommand.mSlot, 1, &mFrameConstantsRing, &FirstConstant, &NumConstants);
+		else
+			mContext1->PSSetConstantBuffers1(InCommand.mSlot, 1, &mFrameConstantsRing, &FirstConstant, &NumConstants);
+		return;
+	}
+
+	// no offsets, copy the range into the buffer of its slot
+	ID3D11Buffer*& pScratch = mScratchConstants[InCommand.mStage][InCommand.mSlot];
+	UINT& ScratchSize = mScratchSizes[InCommand.mStage][InCommand.mSlot];
+	UINT AlignedSize = (Size + 15) & ~15u;
+	if (ScratchSize < AlignedSize)
+	{
+		SAFE_RELEASE(pScratch);
+		ScratchSize = AlignedSize;
+
+		ID3D11Device* pd3dDevice = nullptr;
+		mContext->GetDevice(&pd3dDevice);
+		D3D11_BUFFER_DESC Desc;
+		Desc.ByteWidth = ScratchSize;
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.MiscFlags = 0;
+		Desc.StructureByteStride = 0;
+		HRESULT hr = pd3dDevice->CreateBuffer(&Desc, nullptr, &pScratch);
+		assert(SUCCEEDED(hr));
+		SAFE_RELEASE(pd3dDevice);
+	}
+
+	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	HRESULT hr = mContext->Map(pScratch, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource);
+	assert(SUCCEEDED(hr));
+	memcpy(MappedResource.pData, &InCommands.GetFrameConstants()[Offset], Size);
+	mContext->Unmap(pScratch, 0);
+
+	if (InCommand.mStage == EShaderStage::Vertex)
+		mContext->VSSetConstantBuffers(InCommand.mSlot, 1, &pScratch);
+	else
+		mContext->PSSetConstantBuffers(InCommand.mSlot, 1, &pScratch);
+}
+
+void CD3D11RenderBackend::Execute(const CRenderCommandList& InCommands)
+{
+	assert(mContext != nullptr);
+	ID3D11DeviceContext* pd3dContext = mContext;
+
+	if (!bFeaturesQueried)
+	{
+		QueryFeatures();
+	}
+	if (bConstantBufferOffsetting)
+	{
+		UploadFrameConstants(InCommands);
+	}
+
+	// pipelines are compared by part, consecutive pipelines often share their shaders
+	const FPipelineState* pBoundPipeline = nullptr;
+
+	for (const FRenderCommand& Command : InCommands.GetCommands())
+	{
+		switch (Command.mType)
+		{
+		case ERenderCommand::SetRenderTargets:
+		{
+			ID3D11RenderTargetView* aRTViews[1] = { static_cast<ID3D11RenderTargetView*>(Command.mObject) };
+			pd3dContext->OMSetRenderTargets(aRTViews[0] != nullptr ? 1 : 0, aRTViews,
+				static_cast<ID3D11DepthStencilView*>(Command.mObject2));
+			break;
+		}
+		case ERenderCommand::ClearRenderTarget:
+			pd3dContext->ClearRenderTargetView(static_cast<ID3D11RenderTargetView*>(Command.mObject), Command.mFloats);
+			break;
+		case ERenderCommand::ClearDepth:
+			pd3dContext->ClearDepthStencilView(static_cast<ID3D11DepthStencilView*>(Command.mObject),
+				D3D11_CLEAR_DEPTH, Command.mFloats[0], 0);
+			break;
+		case ERenderCommand::SetViewport:
+		{
+			D3D11_VIEWPORT vp;
+			vp.Width = Command.mFloats[0];
+			vp.Height = Command.mFloats[1];
+			vp.MinDepth = 0.0f;
+			vp.MaxDepth = 1.0f;
+			vp.TopLeftX = 0;
+			vp.TopLeftY = 0;
+			pd3dContext->RSSetViewports(1, &vp);
+			break;
+		}
+		case ERenderCommand::SetPipeline:
+		{
+			const FPipelineState& Pipeline = InCommands.GetPipeline(Command);
+			const FPipelineState* pBound = pBoundPipeline;
+			if (pBound == nullptr || pBound->mVertexShader != Pipeline.mVertexShader)
+				pd3dContext->VSSetShader(static_cast<ID3D11VertexShader*>(Pipeline.mVertexShader), nullptr, 0);
+			if (pBound == nullptr || pBound->mPixelShader != Pipeline.mPixelShader)
+				pd3dContext->PSSetShader(static_cast<ID3D11PixelShader*>(Pipeline.mPixelShader), nullptr, 0);
+			if (pBound == nullptr || pBound->mInputLayout != Pipeline.mInputLayout)
+				pd3dContext->IASetInputLayout(static_cast<ID3D11InputLayout*>(Pipeline.mInputLayout));
+			if (pBound == nullptr || pBound->mRasterizerState != Pipeline.mRasterizerState)
+				pd3dContext->RSSetState(static_cast<ID3D11RasterizerState*>(Pipeline.mRasterizerState));
+			if (pBound == nullptr || pBound->mTopology != Pipeline.mTopology)
+				pd3dContext->IASetPrimitiveTopology(Pipeline.mTopology == EPrimitiveTopology::TriangleStrip
+					? D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP : D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+			pBoundPipeline = &Pipeline;
+			break;
+		}
+		case ERenderCommand::SetVertexBuffer:
+		{
+			ID3D11Buffer* pVB[1] = { static_cast<ID3D11Buffer*>(Command.mObject) };
+			UINT Strides[1] = { Command.mArgs[0] };
+			UINT Offsets[1] = { Command.mArgs[1] };
+			pd3dContext->IASetVertexBuffers(Command.mSlot, 1, pVB, Strides, Offsets);
+			break;
+		}
+		case ERenderCommand::SetIndexBuffer:
+			pd3dContext->IASetIndexBuffer(static_cast<ID3D11Buffer*>(Command.mObject),
+				Command.mArgs[0] == EIndexFormat::UInt32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT, 0);
+			break;
+		case ERenderCommand::UpdateBuffer:
+		{
+			// ranges written without discard are not read by the GPU, so the driver need not wait or rename
+			ID3D11Buffer* pBuffer = static_cast<ID3D11Buffer*>(Command.mObject);
+			D3D11_MAP MapType = Command.mArgs[3] != 0 ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+			D3D11_MAPPED_SUBRESOURCE MappedResource;
+			HRESULT hr = pd3dContext->Map(pBuffer, 0, MapType, 0, &MappedResource);
+			assert(SUCCEEDED(hr));
+			memcpy(static_cast<uint8_t*>(MappedResource.pData) + Command.mArgs[2], InCommands.GetUploadData(Command),
+				Command.mArgs[1]);
+			pd3dContext->Unmap(pBuffer, 0);
+			break;
+		}
+		case ERenderCommand::SetConstantBuffer:
+		{
+			ID3D11Buffer* pBuffer = static_cast<ID3D11Buffer*>(Command.mObject);
+			if (Command.mStage == EShaderStage::Vertex)
+				pd3dContext->VSSetConstantBuffers(Command.mSlot, 1, &pBuffer);
+			else
+				pd3dContext->PSSetConstantBuffers(Command.mSlot, 1, &pBuffer);
+			break;
+		}
+		case ERenderCommand::SetFrameConstants:
+			SetFrameConstants(InCommands, Command);
+			break;
+		case ERenderCommand::SetShaderResource:
+		{
+			ID3D11ShaderResourceView* pView = static_cast<ID3D11ShaderResourceView*>(Command.mObject);
+			if (Command.mStage == EShaderStage::Vertex)
+				pd3dContext->VSSetShaderResources(Command.mSlot, 1, &pView);
+			else
+				pd3dContext->PSSetShaderResources(Command.mSlot, 1, &pView);
+			break;
+		}
+		case ERenderCommand::SetSampler:
+		{
+			ID3D11SamplerState* pSampler = static_cast<ID3D11SamplerState*>(Command.mObject);
+			if (Command.mStage == EShaderStage::Vertex)
+				pd3dContext->VSSetSamplers(Command.mSlot, 1, &pSampler);
+			else
+				pd3dContext->PSSetSamplers(Command.mSlot, 1, &pSampler);
+			break;
+		}
+		case ERenderCommand::Draw:
+			pd3dContext->Draw(Command.mArgs[0], Command.mArgs[1]);
+			break;
+		case ERenderCommand::DrawIndexed:
+			pd3dContext->DrawIndexed(Command.mArgs[0], Command.mArgs[1], (INT)Command.mArgs[2]);
+			break;
+		case ERenderCommand::DrawIndexedInstanced:
+			pd3dContext->DrawIndexedInstanced(Command.mArgs[0], Command.mArgs[1], Command.mArgs[2], 0, Command.mArgs[3]);
+			break;
+		default:
+			assert(0);
+		}
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <d3d11_1.h>
+#include "RenderCommands.h"
+
+using namespace std;
+
+// Replays command lists on a D3D11 device context. Objects in the commands are the matching D3D11
+// interfaces: views, buffers, shaders, input layouts, rasterizer and sampler states.
+// The frame constants of a list are written with one map into a ring constant buffer and bound by offset,
+// on runtimes without constant buffer offsets every range is copied into a scratch buffer of its slot instead.
+class CD3D11RenderBackend : public IRenderBackend
+{
+public:
+	CD3D11RenderBackend();
+
+	// initial size of the frame constants ring
+	static const UINT MinRingSize = 64 * 1024;
+
+	// Set the context commands are executed on.
+	void SetContext(ID3D11DeviceContext* pd3dContext) { mContext = pd3dContext; }
+
+	// Replay all commands of the list on the context.
+	virtual void Execute(const CRenderCommandList& InCommands) override;
+	// Create a dynamic ID3D11Buffer on the device of the context, with an ID3D11ShaderResourceView if structured.
+	virtual bool CreateBuffer(EBufferBinding::Type InBinding, uint32_t InStride, uint32_t InCapacity,
+		FRenderBuffer& OutBuffer) override;
+	virtual void ReleaseBuffer(FRenderBuffer& InOutBuffer) override;
+
+	// Release the frame constants buffers, they are created again by the next Execute.
+	void OnDestroy();
+
+private:
+	// Query what the device supports for binding constant buffer ranges.
+	void QueryFeatures();
+	// Write the frame constants of the list into the ring and remember where they start.
+	void UploadFrameConstants(const CRenderCommandList& InCommands);
+	// Bind a range of the frame constants.
+	void SetFrameConstants(const CRenderCommandList& InCommands, const FRenderCommand& InCommand);
+
+private:
+	// context of the current frame, not owned
+	ID3D11DeviceContext* mContext;
+	// the same context with constant buffer offsets, null when the runtime has none
+	ID3D11DeviceContext1* mContext1;
+	// features of the device
+	bool bFeaturesQueried;
+	bool bConstantBufferOffsetting;
+	bool bMapNoOverwriteConstants;
+
+	// ring buffer holding the frame constants of recent frames
+	ID3D11Buffer* mFrameConstantsRing;
+	UINT mRingSize;
+	// where the next frame constants are written
+	UINT mRingHead;
+	// where the frame constants of the current list start
+	UINT mRingBase;
+
+	// per stage and slot buffers receiving copies of ranges, without constant buffer offsets
+	ID3D11Buffer* mScratchConstants[EShaderStage::Num][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	UINT mScratchSizes[EShaderStage::Num][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+};
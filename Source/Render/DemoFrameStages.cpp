@@ -0,0 +1,156 @@
+#include "DemoFrameStages.h"
+#include "../DemoScene.h"
+#include "Profiler.h"
+#include "TransformHierarchy.h"
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// quad of the rect mesh, normal z and major axis x
+	const float GQuadVertices[] =
+	{
+		-1.f, -1.f, 0.f,
+		1.f, -1.f, 0.f,
+		1.f, 1.f, 0.f,
+		-1.f, 1.f, 0.f,
+	};
+	const uint16_t GQuadIndices[] = { 0, 1, 2, 0, 2, 3 };
+	const uint32_t GQuadStride = 3 * sizeof(float);
+	const uint32_t GNumQuadIndices = sizeof(GQuadIndices) / sizeof(GQuadIndices[0]);
+}
+
+CDemoFrameStages::CDemoFrameStages()
+{
+	CreateRects();
+}
+
+CRect CDemoFrameStages::GetDemoRectProxy(int InIndex)
+{
+	const FDemoRect& Demo = GDemoRects[InIndex];
+	XMFLOAT4X4 World;
+	XMStoreFloat4x4(&World, CTransformHierarchy::ComposeLocal(Demo.mPosition, Demo.mRotation, Demo.mScale));
+
+	CRect Rect;
+	Rect.mID = InIndex;
+	Rect.mRoughness = Demo.mRoughness;
+	Rect.mDiffuseColor = Demo.mDiffuseColor;
+	Rect.mCenter = XMFLOAT3(World._41, World._42, World._43);
+	float WorldScale = std::sqrt(World._11 * World._11 + World._12 * World._12 + World._13 * World._13);
+	Rect.mMajorRadius = WorldScale;
+	Rect.mMinorRadius = WorldScale;
+	// the default normal and major axis of the rect mesh are z and x
+	XMStoreFloat3(&Rect.mNormal, XMVector3Normalize(XMVectorSet(World._31, World._32, World._33, 0)));
+	XMStoreFloat3(&Rect.mMajorAxis, XMVector3Normalize(XMVectorSet(World._11, World._12, World._13, 0)));
+	return Rect;
+}
+
+void CDemoFrameStages::Simulate(double InTime, float InTimeStep)
+{
+	PROFILE_SCOPE("CDemoFrameStages::Simulate");
+	(void)InTimeStep;
+	FFrameSnapshot& Snapshot = mSnapshots.GetSimulated();
+	Snapshot.Reset();
+	FillPerFrameConstants(InTime, Snapshot);
+
+	// only the light moves, the rects keep their proxies and links like in UpdateFrame of RectGI.cpp
+	mSceneStats = FFrameSceneStats();
+	mRects.PackGpuRects(Snapshot.mRects);
+	for (int i = 0; i < mRects.Num(); ++i)
+	{
+		CRect Rect;
+		mRects.GetAt(i, Rect);
+		Snapshot.mRectPacker.Add(mWorlds[i], Rect.mRoughness, Rect.mDiffuseColor, mLinker.GetLinks(i), mLinker.NumLinks(i));
+	}
+}
+
+void CDemoFrameStages::Publish()
+{
+	mSnapshots.Publish();
+}
+
+void CDemoFrameStages::Record(IRenderBackend& InBackend, CRenderCommandList& OutCommands)
+{
+	PROFILE_SCOPE("CDemoFrameStages::Record");
+	const FFrameSnapshot* Snapshot = mSnapshots.GetRendered();
+	assert(Snapshot != nullptr);
+
+	if (mQuadVertices.mBuffer == nullptr)
+	{
+		bool bCreated = InBackend.CreateBuffer(EBufferBinding::Vertex, GQuadStride, 4, mQuadVertices)
+			&& InBackend.CreateBuffer(EBufferBinding::Index, sizeof(uint16_t), GNumQuadIndices, mQuadIndices);
+		assert(bCreated);
+		(void)bCreated;
+		OutCommands.UpdateBuffer(mQuadVertices.mBuffer, GQuadVertices, sizeof(GQuadVertices));
+		OutCommands.UpdateBuffer(mQuadIndices.mBuffer, GQuadIndices, sizeof(GQuadIndices));
+	}
+
+	// like CMiniEngine::RenderScene without the mesh draws
+	mRectRenderer.UploadRects(InBackend, Snapshot->mRects, OutCommands);
+	uint32_t Offset;
+	void* pVSPerFrame = OutCommands.AllocateFrameConstants(sizeof(CB_VS_PER_FRAME), Offset);
+	memcpy(pVSPerFrame, &Snapshot->mVSPerFrame, sizeof(CB_VS_PER_FRAME));
+	OutCommands.SetFrameConstants(EShaderStage::Vertex, 1, Offset, sizeof(CB_VS_PER_FRAME));
+	void* pPSPerFrame = OutCommands.AllocateFrameConstants(sizeof(CB_PS_PER_FRAME), Offset);
+	memcpy(pPSPerFrame, &Snapshot->mPSPerFrame, sizeof(CB_PS_PER_FRAME));
+	OutCommands.SetFrameConstants(EShaderStage::Pixel, 1, Offset, sizeof(CB_PS_PER_FRAME));
+
+	// the programs are null, the null backend never runs them
+	FRectQuadDraw Quad;
+	Quad.mPipeline.mTopology = EPrimitiveTopology::TriangleList;
+	Quad.mVertexBuffer = mQuadVertices.mBuffer;
+	Quad.mVertexStride = GQuadStride;
+	Quad.mIndexBuffer = mQuadIndices.mBuffer;
+	Quad.mNumIndices = GNumQuadIndices;
+	mRectRenderer.RecordInstancedRects(InBackend, Snapshot->mRectPacker, Quad, OutCommands);
+}
+
+int CDemoFrameStages::GetNumRenderInstances() const
+{
+	// the rects and the light
+	return GNumDemoRects + 1;
+}
+
+void CDemoFrameStages::Release(IRenderBackend& InBackend)
+{
+	mRectRenderer.Release(InBackend);
+	InBackend.ReleaseBuffer(mQuadVertices);
+	InBackend.ReleaseBuffer(mQuadIndices);
+}
+
+void CDemoFrameStages::CreateRects()
+{
+	for (int i = 0; i < GNumDemoRects; ++i)
+	{
+		mRects.Add(GetDemoRectProxy(i));
+		const FDemoRect& Demo = GDemoRects[i];
+		XMFLOAT4X4 World;
+		XMStoreFloat4x4(&World, CTransformHierarchy::ComposeLocal(Demo.mPosition, Demo.mRotation, Demo.mScale));
+		mWorlds.push_back(World);
+	}
+	mBvh.Build(mRects);
+	mLinker.Build(mRects, mBvh);
+}
+
+void CDemoFrameStages::FillPerFrameConstants(double InTime, FFrameSnapshot& OutSnapshot) const
+{
+	// the model viewer camera of SetupEnvironment at its default radius, with the projection of the headless run
+	XMVECTOR Eye = XMVectorScale(XMVector3Normalize(XMLoadFloat3(&GDemoEye)), GDemoSceneRadius * 3.0f);
+	XMMATRIX View = XMMatrixLookAtLH(Eye, XMVectorZero(), XMVectorSet(0.f, 1.f, 0.f, 0.f));
+	XMMATRIX Proj = XMMatrixPerspectiveFovLH(XM_PI / 4, 1024.f / 768.f, 2.0f, 4000.0f);
+	XMStoreFloat4x4(&OutSnapshot.mVSPerFrame.mView, XMMatrixTranspose(View));
+	XMStoreFloat4x4(&OutSnapshot.mVSPerFrame.mProj, XMMatrixTranspose(Proj));
+
+	CB_PS_PER_FRAME& Constants = OutSnapshot.mPSPerFrame;
+	XMFLOAT3 LightPos = GetDemoLightPosition(InTime);
+	XMFLOAT3 LightDir;
+	XMStoreFloat3(&LightDir, XMVector3Normalize(XMLoadFloat3(&LightPos)));
+	Constants.mLightDirAmbient = XMFLOAT4(LightDir.x, LightDir.y, LightDir.z, 0.1f);
+	Constants.mLightIntensity = XMFLOAT4(GDemoLightIntensity, GDemoSpecularReflIntensity, GDemoDiffuseReflIntensity, 0.f);
+	Constants.mToggleOptionsA[0] = 1;
+	Constants.mToggleOptionsA[1] = 1;
+	Constants.mToggleOptionsA[2] = 0;
+	Constants.mToggleOptionsA[3] = 1;
+	XMStoreFloat4(&Constants.mEyePos, Eye);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "FrameLoop.h"
+#include "FrameSnapshot.h"
+#include "RectProxy.h"
+#include "RectRenderer.h"
+
+// The scene of DemoScene.h as frame stages without a device: the rects are simulated and snapshotted like the
+// render instances of CMiniEngine and drawn instanced through CRectRenderer, creating the buffers on the
+// backend given to Record. The light mesh is not drawn, it has no geometry outside of the D3D11 build.
+class CDemoFrameStages : public IFrameStages
+{
+public:
+	CDemoFrameStages();
+
+	// Rect proxy of a demo rectangle, like CRenderInstance::GetRectProxy of its render instance.
+	static CRect GetDemoRectProxy(int InIndex);
+
+	virtual void Simulate(double InTime, float InTimeStep) override;
+	virtual void Publish() override;
+	virtual void Record(IRenderBackend& InBackend, CRenderCommandList& OutCommands) override;
+
+	virtual int GetNumRenderInstances() const override;
+	virtual int GetNumRects() const override { return mRects.Num(); }
+	virtual FFrameSceneStats GetSceneStats() const override { return mSceneStats; }
+
+	// Release the buffers created by Record.
+	void Release(IRenderBackend& InBackend);
+
+private:
+	// Add the rects and link their reflectors, like the first CRectCollections::UpdateAllProxies.
+	void CreateRects();
+	// Fill the per-frame constants of the snapshot for the light at InTime.
+	void FillPerFrameConstants(double InTime, FFrameSnapshot& OutSnapshot) const;
+
+private:
+	CFrameSnapshots mSnapshots;
+	CRectStore mRects;
+	CRectBvh mBvh;
+	CReflectorLinker mLinker;
+	// world matrix of each rect, by dense index
+	vector<XMFLOAT4X4> mWorlds;
+	FFrameSceneStats mSceneStats;
+
+	CRectRenderer mRectRenderer;
+	// quad drawn once per rect, uploaded by the first Record
+	FRenderBuffer mQuadVertices;
+	FRenderBuffer mQuadIndices;
+};
@@ -4,6 +4,9 @@
 #include "MiniEngine.h"
 #include "RenderData.h"
 #include "MeshData.h"
+#include "RectProxy.h"
+#include "Profiler.h"
+#include "ShaderCache.h"
 #include <cstdint>
 #include <algorithm>
 #include <complex>
@@ -11,11 +14,25 @@
 
 #pragma warning( disable : 4100 )
 
+namespace
+{
+	// Mesh of the light instance, null if the light is not a loaded mesh.
+	CDxMesh* GetLightMesh()
+	{
+		CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
+		CRenderInstance* LightInst = MiniEngine.GetRenderInstance(MiniEngine.mLightInstance);
+		if (LightInst == nullptr || LightInst->mMeshData->GetMeshType() != EMeshData::DxMesh)
+			return nullptr;
+		return static_cast<CDxMesh*>(LightInst->mMeshData);
+	}
+}
+
 CDemoUI::CDemoUI()
 	: mShowIndirectSpecular(true)
 	, mShowIndirectDiffuse(true)
 	, mShowDirectLighting(true)
 	, mShowHDR(true)
+	, mInstancedRects(true)
 	, mTxtHelper(nullptr)
 	, mShowText(true)
 {
@@ -52,6 +69,31 @@ void CDemoUI::OnKeyboard(UINT nChar, bool bKeyDown, bool bAltDown, void* pUserCo
 			mShowIndirectSpecular = !mShowIndirectSpecular;
 		}
 		break;
+		case 'I':
+		{
+			// toggle instanced drawing of rects
+			mInstancedRects = !mInstancedRects;
+		}
+		break;
+		case 'T':
+		{
+			// toggle the lookup tables of RectGI.hlsl, to compare against exp/log
+			CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
+			MiniEngine.SetLightingLut(DXUTGetD3D11Device(), !MiniEngine.bLightingLut);
+		}
+		break;
+		case 'P':
+		{
+			// save the cpu profile of the last frames
+			CMiniEngine::GetInstance().SaveProfile("RectGI_trace.json");
+		}
+		break;
+		case 'C':
+		{
+			// render current view with the cpu reference renderer
+			CMiniEngine::GetInstance().RenderCpuReference("RectGI_cpu.exr");
+		}
+		break;
 		//case 'L':
 		//{
 		//	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
@@ -112,6 +154,8 @@ void CDemoUI::RenderGUI(float fElapsedTime)
 	if (!mShowText)
 		return;
 
+	// gpu captures see the perf event, the cpu profiler the zone
+	PROFILE_SCOPE("CDemoUI::RenderGUI");
 	DXUT_BeginPerfEvent(DXUT_PERFEVENTCOLOR, L"HUD / Stats");
 	// Display text
 	RenderText();
@@ -133,14 +177,86 @@ void CDemoUI::RenderText()
 		swprintf_s(sz, 255,
 			L"Direct Lighting(F1): %s\n"
 			L"Indirect Diffuse(F2): %s\n"
-			L"Indirect Specular(F3): %s\n",
+			L"Indirect Specular(F3): %s\n"
+			L"Lighting Lut(T): %s\n"
+			L"Cpu Reference Render(C)\n"
+			L"Save Cpu Profile(P)\n",
 			mShowDirectLighting ? L"On" : L"Off",
 			mShowIndirectDiffuse ? L"On" : L"Off",
-			mShowIndirectSpecular ? L"On" : L"Off"
+			mShowIndirectSpecular ? L"On" : L"Off",
+			CMiniEngine::GetInstance().bLightingLut ? L"On" : L"Off"
 			);
 		mTxtHelper->DrawTextLine(sz);
 	}
 
+	// incremental proxy maintenance
+	{
+		const FRectProxyStats& ProxyStats = CRectCollections::GetInstance().GetStats();
+		const FReflectorLinkStats& LinkStats = CRectCollections::GetInstance().mLinker.GetStats();
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Rect proxies refreshed: %d, moved: %d, receivers relinked: %d\n",
+			ProxyStats.mRefreshedProxies, ProxyStats.mMovedProxies, LinkStats.mRelinkedReceivers);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	// submitted work of the last frame
+	{
+		const FRenderStats& RenderStats = CMiniEngine::GetInstance().mFrameStats.GetStats();
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Draws: %u, state changes: %u, redundant binds: %u, skipped binds: %u, uploads: %u, uploaded: %.1f KB\n",
+			RenderStats.mDraws, RenderStats.mStateChanges, RenderStats.mRedundantBinds, RenderStats.mSkippedBinds,
+			RenderStats.mUploads, RenderStats.mBytesUploaded / 1024.0);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	// overlap of simulating the next frame with rendering the last one
+	{
+		const FFramePipelineStats& PipelineStats = CMiniEngine::GetInstance().mPipelineStats;
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Simulate: %.2f ms, render: %.2f ms, overlapped: %.2f ms, both: %.2f ms\n",
+			PipelineStats.mSimulateMs, PipelineStats.mRenderMs, PipelineStats.mOverlapMs, PipelineStats.mFrameMs);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	// load time work on the light mesh
+	CDxMesh* LightMesh = GetLightMesh();
+	if (LightMesh != nullptr && LightMesh->GetOptimizeReport().mNumOptimizedSubsets > 0)
+	{
+		const FMeshOptimizeReport& Report = LightMesh->GetOptimizeReport();
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Light mesh ACMR: %.3f -> %.3f, ATVR: %.3f -> %.3f, %d subsets optimized in %.3f ms\n",
+			Report.mBefore.mACMR, Report.mAfter.mACMR, Report.mBefore.mATVR, Report.mAfter.mATVR,
+			Report.mNumOptimizedSubsets, Report.mMilliseconds);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	if (LightMesh != nullptr && LightMesh->GetFileVertexStride() > 0)
+	{
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Light mesh vertices quantized from %u to %u bytes\n", LightMesh->GetFileVertexStride(),
+			LightMesh->GetVertexFormat().mStride);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	// meshlets culled by the last frame, of all meshes drawn with meshlet culling
+	{
+		const FMeshletCullStats& MeshletStats = CMiniEngine::GetInstance().mMeshletStats;
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Meshlets: %u, frustum culled: %u, backface culled: %u, triangles: %llu of %llu\n",
+			MeshletStats.mNumMeshlets, MeshletStats.mNumFrustumCulled, MeshletStats.mNumBackfaceCulled,
+			MeshletStats.mNumVisibleTriangles, MeshletStats.mNumTriangles);
+		mTxtHelper->DrawTextLine(sz);
+	}
+
+	// programs since startup, toggling the lighting lut compiles or loads more
+	{
+		const CShaderCache& ShaderCache = CShaderCache::GetInstance();
+		WCHAR sz[255];
+		swprintf_s(sz, 255, L"Shaders compiled: %d, loaded from cache: %d, requests shared: %d\n",
+			ShaderCache.GetNumCompiles(), ShaderCache.GetBytecodeStats().mDiskHits, ShaderCache.GetNumSharedRequests());
+		mTxtHelper->DrawTextLine(sz);
+	}
+
 	// end rendering text
 	mTxtHelper->End();
 }
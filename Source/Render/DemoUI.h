@@ -55,4 +55,6 @@ public:
 	bool mShowIndirectSpecular;
 	// Whether or not using HDR.
 	bool mShowHDR;
+	// Whether or not drawing all rects with one instanced draw.
+	bool mInstancedRects;
 };
\ No newline at end of file
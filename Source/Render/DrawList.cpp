@@ -0,0 +1,100 @@
+#include "DrawList.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+CDrawList::CDrawList()
+{
+}
+
+void CDrawList::Reset()
+{
+	mItems.clear();
+}
+
+void CDrawList::Add(uint64_t InSortKey, uint32_t InPayload)
+{
+	FDrawItem Item;
+	Item.mSortKey = InSortKey;
+	Item.mPayload = InPayload;
+	mItems.push_back(Item);
+}
+
+void CDrawList::Sort()
+{
+	const size_t Num = mItems.size();
+	if (Num < 2)
+		return;
+
+	// histograms of all 8 digits in one pass over the keys
+	const int NumDigits = 8;
+	uint32_t Counts[NumDigits][256];
+	memset(Counts, 0, sizeof(Counts));
+	for (const FDrawItem& Item : mItems)
+	{
+		for (int Digit = 0; Digit < NumDigits; ++Digit)
+		{
+			++Counts[Digit][(Item.mSortKey >> (Digit * 8)) & 0xff];
+		}
+	}
+
+	mSortBuffer.resize(Num);
+	FDrawItem* Src = mItems.data();
+	FDrawItem* Dst = mSortBuffer.data();
+	for (int Digit = 0; Digit < NumDigits; ++Digit)
+	{
+		// a digit shared by all keys does not change the order, e.g. unused high bits of small ids
+		uint32_t* DigitCounts = Counts[Digit];
+		if (DigitCounts[(Src[0].mSortKey >> (Digit * 8)) & 0xff] == Num)
+			continue;
+
+		uint32_t Offsets[256];
+		uint32_t Sum = 0;
+		for (int Bucket = 0; Bucket < 256; ++Bucket)
+		{
+			Offsets[Bucket] = Sum;
+			Sum += DigitCounts[Bucket];
+		}
+		for (size_t i = 0; i < Num; ++i)
+		{
+			Dst[Offsets[(Src[i].mSortKey >> (Digit * 8)) & 0xff]++] = Src[i];
+		}
+		swap(Src, Dst);
+	}
+
+	// an odd number of passes leaves the result in the scratch buffer
+	if (Src != mItems.data())
+	{
+		mItems.swap(mSortBuffer);
+	}
+}
+
+uint32_t CDrawList::GetPipelineId(const FPipelineState& InPipeline)
+{
+	// pipelines are few, a linear search beats hashing five members
+	for (size_t i = 0; i < mPipelines.size(); ++i)
+	{
+		if (mPipelines[i] == InPipeline)
+			return (uint32_t)i;
+	}
+	mPipelines.push_back(InPipeline);
+	return (uint32_t)mPipelines.size() - 1;
+}
+
+uint32_t CDrawList::GetObjectId(const void* InObject)
+{
+	auto Result = mObjectIds.insert(make_pair(InObject, (uint32_t)mObjectIds.size()));
+	return Result.first->second;
+}
+
+uint64_t CDrawList::MakeSortKey(uint32_t InPipeline, uint32_t InMesh, uint32_t InMaterial, float InDepth)
+{
+	const uint64_t MaxDepth = (1ull << DepthBits) - 1;
+	float Depth = InDepth < 0.f ? 0.f : (InDepth > 1.f ? 1.f : InDepth);
+
+	uint64_t Key = InPipeline & ((1u << PipelineBits) - 1);
+	Key = (Key << MeshBits) | (InMesh & ((1u << MeshBits) - 1));
+	Key = (Key << MaterialBits) | (InMaterial & ((1u << MaterialBits) - 1));
+	Key = (Key << DepthBits) | (uint64_t)(Depth * MaxDepth);
+	return Key;
+}
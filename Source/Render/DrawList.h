@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "RenderCommands.h"
+
+using namespace std;
+
+// A draw of the frame, found again by its payload after sorting.
+struct FDrawItem
+{
+	uint64_t mSortKey;
+	// e.g. the dense index of a render instance
+	uint32_t mPayload;
+};
+
+// Draws of a frame with 64 bit sort keys, sorted so draws sharing a pipeline, then a mesh, then a material
+// are submitted next to each other and front to back within a batch.
+class CDrawList
+{
+public:
+	// bits of the key fields, from the most significant
+	static const int PipelineBits = 16;
+	static const int MeshBits = 16;
+	static const int MaterialBits = 12;
+	static const int DepthBits = 20;
+
+	CDrawList();
+
+	// Remove all draws, keeping the memory and the state ids.
+	void Reset();
+	// Add a draw.
+	void Add(uint64_t InSortKey, uint32_t InPayload);
+	// Sort the draws by key with a least significant digit radix sort, draws with equal keys keep their order.
+	void Sort();
+
+	// Draws, sorted after Sort.
+	const vector<FDrawItem>& GetItems() const { return mItems; }
+
+	// Small id of a pipeline, equal pipelines get the same id.
+	uint32_t GetPipelineId(const FPipelineState& InPipeline);
+	// Small id of any state object, e.g. a vertex buffer for the mesh or a texture for the material.
+	uint32_t GetObjectId(const void* InObject);
+
+	// Key of a draw from its ids and its view depth normalized to [0, 1]. Ids wider than their field wrap,
+	// which only makes the order less coherent.
+	static uint64_t MakeSortKey(uint32_t InPipeline, uint32_t InMesh, uint32_t InMaterial, float InDepth);
+
+private:
+	// draws of the frame
+	vector<FDrawItem> mItems;
+	// scratch of the radix sort
+	vector<FDrawItem> mSortBuffer;
+
+	// pipelines by id
+	vector<FPipelineState> mPipelines;
+	// state object ids
+	unordered_map<const void*, uint32_t> mObjectIds;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdio>
+
+// Open a file like fopen, with fopen_s under MSVC where fopen raises C4996. Returns nullptr on failure.
+inline FILE* OpenFile(const char* InFileName, const char* InMode)
+{
+#ifdef _MSC_VER
+	FILE* fp = nullptr;
+	return fopen_s(&fp, InFileName, InMode) == 0 ? fp : nullptr;
+#else
+	return fopen(InFileName, InMode);
+#endif
+}
+
+#ifdef _WIN32
+// Same as above for wide file names, with _wfopen_s.
+inline FILE* OpenFile(const wchar_t* InFileName, const wchar_t* InMode)
+{
+	FILE* fp = nullptr;
+	return _wfopen_s(&fp, InFileName, InMode) == 0 ? fp : nullptr;
+}
+#endif
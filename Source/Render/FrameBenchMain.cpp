@@ -0,0 +1,120 @@
+// Headless frame loop of the demo scene on the null backend, built by CMakeLists.txt with AllocationHook.cpp.
+//
+// RectGIFrameBench [-frames:N] [-warmup:N] [-step:Seconds] [-threads:N] [-out:File]
+//	-frames   frames measured after the warm up (600)
+//	-warmup   frames run before measuring (60)
+//	-step     seconds between frames (1/60)
+//	-threads  workers of the job system, 0 uses all cores (0)
+//	-out      JSON report of CFrameLoop (RectGI_framebench.json)
+//
+// Fails when a frame does not draw every rect in one instanced draw, when buffers created through the backend
+// leak, or when the report cannot be written.
+#include "DemoFrameStages.h"
+#include "JobSystem.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace
+{
+	// Options of a run.
+	struct FFrameBenchSettings
+	{
+		FFrameBenchSettings()
+			: mOutFile("RectGI_framebench.json")
+			, mNumThreads(0)
+		{
+
+		}
+
+		// Parse options in the -name:value form of the demo, false on unknown options.
+		bool ParseCommandLine(int argc, char** argv)
+		{
+			for (int i = 1; i < argc; ++i)
+			{
+				const char* Arg = argv[i];
+				if (strncmp(Arg, "-frames:", 8) == 0)
+				{
+					mLoop.mNumFrames = max(1, atoi(Arg + 8));
+				}
+				else if (strncmp(Arg, "-warmup:", 8) == 0)
+				{
+					mLoop.mWarmupFrames = max(0, atoi(Arg + 8));
+				}
+				else if (strncmp(Arg, "-step:", 6) == 0)
+				{
+					mLoop.mTimeStep = (float)atof(Arg + 6);
+				}
+				else if (strncmp(Arg, "-threads:", 9) == 0)
+				{
+					mNumThreads = max(0, atoi(Arg + 9));
+				}
+				else if (strncmp(Arg, "-out:", 5) == 0)
+				{
+					mOutFile = Arg + 5;
+				}
+				else
+				{
+					fprintf(stderr, "RectGIFrameBench: unknown option %s\n", Arg);
+					return false;
+				}
+			}
+			return true;
+		}
+
+		FFrameLoopSettings mLoop;
+		string mOutFile;
+		int mNumThreads;
+	};
+}
+
+int main(int argc, char** argv)
+{
+	FFrameBenchSettings Settings;
+	if (!Settings.ParseCommandLine(argc, argv))
+		return 2;
+
+	CJobSystem::GetInstance().Start(Settings.mNumThreads > 0 ? Settings.mNumThreads - 1 : -1);
+	CNullRenderBackend Backend;
+	FFrameLoopReport Report;
+	{
+		CDemoFrameStages Stages;
+		CFrameLoop::Run(Stages, Settings.mLoop, Backend, Report);
+		Stages.Release(Backend);
+	}
+	CJobSystem::GetInstance().Stop();
+
+	bool bWritten = false;
+	FILE* fp = OpenFile(Settings.mOutFile.c_str(), "wb");
+	if (fp != nullptr)
+	{
+		bWritten = CFrameLoop::WriteReport(Report, fp);
+		fclose(fp);
+	}
+
+	// all rects in one instanced draw of two triangles each, every frame
+	int Frames = Settings.mLoop.mNumFrames;
+	const FRenderStats& Totals = Report.mRenderTotals;
+	bool bDrawn = Totals.mDraws == (uint32_t)Frames && Totals.mTriangles == (uint64_t)Frames * 2 * Report.mNumRects;
+	bool bReleased = Backend.GetNumBuffers() == 0;
+	double FrameMs = 0;
+	for (double Ms : Report.mFrameMs)
+	{
+		FrameMs += Ms;
+	}
+	double Allocations = 0;
+	for (double Count : Report.mFrameAllocations)
+	{
+		Allocations += Count;
+	}
+	printf("RectGI frame loop: %d frames, %d rects, %.4f ms, %.1f commands, %.1f allocations per frame\n", Frames,
+		Report.mNumRects, FrameMs / Frames, (double)Totals.mCommands / Frames, Allocations / Frames);
+	printf("RectGI frame loop draws %u, triangles %llu: %s\n", Totals.mDraws, (unsigned long long)Totals.mTriangles,
+		bDrawn ? "ok" : "FAILED");
+	printf("RectGI frame loop buffers released: %s\n", bReleased ? "ok" : "FAILED");
+	printf("RectGI frame loop report %s %s\n", bWritten ? "written to" : "cannot write", Settings.mOutFile.c_str());
+	return bDrawn && bReleased && bWritten ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include "FrameLoop.h"
+#include "AllocationCounter.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+	// Write mean, percentiles and max of per-frame values as a JSON object member.
+	void WriteDistribution(FILE* fp, const char* InName, vector<double> InValues, bool bInLast)
+	{
+		sort(InValues.begin(), InValues.end());
+		double Sum = 0;
+		for (double Value : InValues)
+		{
+			Sum += Value;
+		}
+		fprintf(fp, "    \"%s\": { \"mean\": %.6f, \"p50\": %.6f, \"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f }%s\n",
+			InName, Sum / InValues.size(), CProfiler::Percentile(InValues, .5), CProfiler::Percentile(InValues, .9),
+			CProfiler::Percentile(InValues, .99), InValues.back(), bInLast ? "" : ",");
+	}
+
+	// Milliseconds since InStart.
+	double MillisecondsSince(chrono::steady_clock::time_point InStart)
+	{
+		chrono::duration<double, milli> Elapsed = chrono::steady_clock::now() - InStart;
+		return Elapsed.count();
+	}
+}
+
+FFrameLoopSettings::FFrameLoopSettings()
+	: mNumFrames(600)
+	, mWarmupFrames(60)
+	, mTimeStep(1.f / 60)
+{
+
+}
+
+FFrameSceneStats::FFrameSceneStats()
+	: mRefreshedProxies(0)
+	, mMovedProxies(0)
+	, mRelinkedReceivers(0)
+{
+
+}
+
+FFrameLoopReport::FFrameLoopReport()
+	: mNumRenderInstances(0)
+	, mNumRects(0)
+	, mNumThreads(0)
+	, mAllocatedBytes(0)
+	, mRefreshedProxies(0)
+	, mMovedProxies(0)
+	, mRelinkedReceivers(0)
+{
+
+}
+
+void CFrameLoop::Run(IFrameStages& InStages, const FFrameLoopSettings& InSettings, CNullRenderBackend& InBackend,
+	FFrameLoopReport& OutReport)
+{
+	OutReport = FFrameLoopReport();
+	OutReport.mSettings = InSettings;
+	CProfiler& Profiler = CProfiler::GetInstance();
+	bool bCountAllocations = CAllocationCounter::IsHooked();
+	CRenderCommandList Commands;
+	// the loop itself does not allocate while measuring
+	OutReport.mSimulateMs.reserve(InSettings.mNumFrames);
+	OutReport.mRecordMs.reserve(InSettings.mNumFrames);
+	OutReport.mSubmitMs.reserve(InSettings.mNumFrames);
+	OutReport.mFrameMs.reserve(InSettings.mNumFrames);
+	OutReport.mFrameAllocations.reserve(bCountAllocations ? InSettings.mNumFrames : 0);
+
+	int NumFrames = InSettings.mWarmupFrames + InSettings.mNumFrames;
+	for (int Frame = 0; Frame < NumFrames; ++Frame)
+	{
+		bool bMeasured = Frame >= InSettings.mWarmupFrames;
+		if (Frame == InSettings.mWarmupFrames)
+		{
+			Profiler.Clear();
+		}
+		uint64_t AllocationsBefore = CAllocationCounter::GetNumAllocations();
+		uint64_t BytesBefore = CAllocationCounter::GetNumBytes();
+
+		// the same times on every run
+		auto FrameStart = chrono::steady_clock::now();
+		InStages.Simulate(Frame * (double)InSettings.mTimeStep, InSettings.mTimeStep);
+		InStages.Publish();
+		double Simulate = MillisecondsSince(FrameStart);
+
+		auto RecordStart = chrono::steady_clock::now();
+		Commands.Reset();
+		InStages.Record(InBackend, Commands);
+		double Record = MillisecondsSince(RecordStart);
+
+		auto SubmitStart = chrono::steady_clock::now();
+		InBackend.ResetStats();
+		InBackend.Execute(Commands);
+		InStages.EndFrame();
+		double Submit = MillisecondsSince(SubmitStart);
+		double Total = MillisecondsSince(FrameStart);
+
+		if (!bMeasured)
+			continue;
+
+		OutReport.mSimulateMs.push_back(Simulate);
+		OutReport.mRecordMs.push_back(Record);
+		OutReport.mSubmitMs.push_back(Submit);
+		OutReport.mFrameMs.push_back(Total);
+		if (bCountAllocations)
+		{
+			OutReport.mFrameAllocations.push_back((double)(CAllocationCounter::GetNumAllocations() - AllocationsBefore));
+			OutReport.mAllocatedBytes += CAllocationCounter::GetNumBytes() - BytesBefore;
+		}
+
+		const FRenderStats& Stats = InBackend.GetStats();
+		FRenderStats& Totals = OutReport.mRenderTotals;
+		Totals.mCommands += Stats.mCommands;
+		Totals.mDraws += Stats.mDraws;
+		Totals.mTriangles += Stats.mTriangles;
+		Totals.mStateChanges += Stats.mStateChanges;
+		Totals.mRedundantBinds += Stats.mRedundantBinds;
+		Totals.mSkippedBinds += Stats.mSkippedBinds;
+		Totals.mUploads += Stats.mUploads;
+		Totals.mBytesUploaded += Stats.mBytesUploaded;
+		FFrameSceneStats SceneStats = InStages.GetSceneStats();
+		OutReport.mRefreshedProxies += SceneStats.mRefreshedProxies;
+		OutReport.mMovedProxies += SceneStats.mMovedProxies;
+		OutReport.mRelinkedReceivers += SceneStats.mRelinkedReceivers;
+	}
+
+	OutReport.mNumRenderInstances = InStages.GetNumRenderInstances();
+	OutReport.mNumRects = InStages.GetNumRects();
+	OutReport.mNumThreads = CJobSystem::GetInstance().GetNumThreads();
+	Profiler.GetZoneStats(OutReport.mZones);
+}
+
+bool CFrameLoop::WriteReport(const FFrameLoopReport& InReport, FILE* fp)
+{
+	const FFrameLoopSettings& Settings = InReport.mSettings;
+	int Frames = Settings.mNumFrames;
+	fprintf(fp, "{\n  \"frames\": %d,\n  \"warmupFrames\": %d,\n  \"timeStep\": %.6f,\n", Frames,
+		Settings.mWarmupFrames, Settings.mTimeStep);
+	fprintf(fp, "  \"renderInstances\": %d,\n  \"rects\": %d,\n  \"threads\": %d,\n", InReport.mNumRenderInstances,
+		InReport.mNumRects, InReport.mNumThreads);
+
+	// milliseconds per frame
+	fprintf(fp, "  \"stagesMs\": {\n");
+	WriteDistribution(fp, "simulate", InReport.mSimulateMs, false);
+	WriteDistribution(fp, "record", InReport.mRecordMs, false);
+	WriteDistribution(fp, "submit", InReport.mSubmitMs, false);
+	WriteDistribution(fp, "frame", InReport.mFrameMs, true);
+	fprintf(fp, "  },\n");
+
+	// microseconds per call
+	const vector<FProfileZoneStats>& Zones = InReport.mZones;
+	fprintf(fp, "  \"zonesUs\": [\n");
+	for (size_t i = 0; i < Zones.size(); ++i)
+	{
+		const FProfileZoneStats& Zone = Zones[i];
+		fprintf(fp, "    { \"name\": \"%s\", \"calls\": %d, \"totalMs\": %.6f, \"mean\": %.6f, \"p50\": %.6f, "
+			"\"p90\": %.6f, \"p99\": %.6f, \"max\": %.6f }%s\n", Zone.mName.c_str(), Zone.mCount, Zone.mTotalMs,
+			Zone.mMeanUs, Zone.mP50Us, Zone.mP90Us, Zone.mP99Us, Zone.mMaxUs, i + 1 < Zones.size() ? "," : "");
+	}
+	fprintf(fp, "  ],\n");
+
+	// only counted when AllocationHook.cpp is linked
+	if (!InReport.mFrameAllocations.empty())
+	{
+		fprintf(fp, "  \"allocations\": {\n");
+		WriteDistribution(fp, "perFrame", InReport.mFrameAllocations, false);
+		fprintf(fp, "    \"bytesPerFrame\": %.1f\n  },\n", (double)InReport.mAllocatedBytes / Frames);
+	}
+	else
+	{
+		fprintf(fp, "  \"allocations\": null,\n");
+	}
+
+	// per frame averages
+	const FRenderStats& Totals = InReport.mRenderTotals;
+	fprintf(fp, "  \"counters\": {\n");
+	fprintf(fp, "    \"commands\": %.2f,\n    \"draws\": %.2f,\n    \"triangles\": %.2f,\n",
+		(double)Totals.mCommands / Frames, (double)Totals.mDraws / Frames, (double)Totals.mTriangles / Frames);
+	fprintf(fp, "    \"stateChanges\": %.2f,\n    \"redundantBinds\": %.2f,\n    \"skippedBinds\": %.2f,\n",
+		(double)Totals.mStateChanges / Frames, (double)Totals.mRedundantBinds / Frames,
+		(double)Totals.mSkippedBinds / Frames);
+	fprintf(fp, "    \"uploads\": %.2f,\n    \"bytesUploaded\": %.1f,\n", (double)Totals.mUploads / Frames,
+		(double)Totals.mBytesUploaded / Frames);
+	fprintf(fp, "    \"refreshedProxies\": %.2f,\n    \"movedProxies\": %.2f,\n    \"relinkedReceivers\": %.2f\n  }\n}\n",
+		(double)InReport.mRefreshedProxies / Frames, (double)InReport.mMovedProxies / Frames,
+		(double)InReport.mRelinkedReceivers / Frames);
+
+	return ferror(fp) == 0;
+}
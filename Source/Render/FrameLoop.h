@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "Profiler.h"
+#include "RenderCommands.h"
+
+using namespace std;
+
+// Settings of a CFrameLoop run.
+struct FFrameLoopSettings
+{
+	FFrameLoopSettings();
+
+	// frames measured after the warm up
+	int mNumFrames;
+	// frames run before measuring, filling caches and growing buffers
+	int mWarmupFrames;
+	// seconds between frames given to the simulation
+	float mTimeStep;
+};
+
+// Proxy and link work of one simulated frame.
+struct FFrameSceneStats
+{
+	FFrameSceneStats();
+
+	// rect proxies recomputed from their render instance
+	int mRefreshedProxies;
+	// refreshed proxies whose geometry changed
+	int mMovedProxies;
+	// receivers whose reflectors were linked again
+	int mRelinkedReceivers;
+};
+
+// Stages of the frames of a scene, run one after another by CFrameLoop.
+class IFrameStages
+{
+public:
+	virtual ~IFrameStages() {}
+
+	// Advance the scene to InTime and build the simulated snapshot.
+	virtual void Simulate(double InTime, float InTimeStep) = 0;
+	// Hand the simulated snapshot to the render stage.
+	virtual void Publish() = 0;
+	// Record the published snapshot. Buffers are created through InBackend unless the stages have their own.
+	virtual void Record(IRenderBackend& InBackend, CRenderCommandList& OutCommands) = 0;
+	// Called after the recorded commands were executed.
+	virtual void EndFrame() {}
+
+	// Size of the scene, for the report.
+	virtual int GetNumRenderInstances() const = 0;
+	virtual int GetNumRects() const = 0;
+	// Work of the last Simulate.
+	virtual FFrameSceneStats GetSceneStats() const = 0;
+};
+
+// Measurements of a CFrameLoop run.
+struct FFrameLoopReport
+{
+	FFrameLoopReport();
+
+	FFrameLoopSettings mSettings;
+	int mNumRenderInstances;
+	int mNumRects;
+	int mNumThreads;
+
+	// milliseconds of each measured frame
+	vector<double> mSimulateMs;
+	vector<double> mRecordMs;
+	vector<double> mSubmitMs;
+	vector<double> mFrameMs;
+	// heap allocations of each measured frame, empty when CAllocationCounter is not hooked
+	vector<double> mFrameAllocations;
+	uint64_t mAllocatedBytes;
+
+	// sums over the measured frames
+	FRenderStats mRenderTotals;
+	int64_t mRefreshedProxies;
+	int64_t mMovedProxies;
+	int64_t mRelinkedReceivers;
+
+	// profiler zones of the measured frames
+	vector<FProfileZoneStats> mZones;
+};
+
+// Runs the frames of a scene for a fixed number of frames, so performance runs are repeatable. Each frame
+// advances the simulation by the same time step, publishes its snapshot and records it into a
+// CNullRenderBackend instead of a device context. Stages run one after another to be measured alone.
+class CFrameLoop
+{
+public:
+	// Run the warm up and measured frames of InStages, executing their commands on InBackend.
+	static void Run(IFrameStages& InStages, const FFrameLoopSettings& InSettings, CNullRenderBackend& InBackend,
+		FFrameLoopReport& OutReport);
+
+	// Write the percentiles of every stage and profiler zone, heap allocations per frame and the render, proxy
+	// and link counters as JSON. False on a write error.
+	static bool WriteReport(const FFrameLoopReport& InReport, FILE* fp);
+};
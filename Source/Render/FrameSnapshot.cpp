@@ -0,0 +1,31 @@
+#include "FrameSnapshot.h"
+#include <cstring>
+
+FFrameSnapshot::FFrameSnapshot()
+	: mFrame(0)
+{
+	memset(&mVSPerFrame, 0, sizeof(mVSPerFrame));
+	memset(&mPSPerFrame, 0, sizeof(mPSPerFrame));
+}
+
+void FFrameSnapshot::Reset()
+{
+	mRects.clear();
+	mDraws.clear();
+	mObjectConstants.clear();
+	mRectPacker.Reset();
+}
+
+CFrameSnapshots::CFrameSnapshots()
+	: mSimulatedIndex(0)
+	, bPublished(false)
+{
+}
+
+void CFrameSnapshots::Publish()
+{
+	uint64_t Frame = mSnapshots[mSimulatedIndex].mFrame;
+	mSimulatedIndex = 1 - mSimulatedIndex;
+	mSnapshots[mSimulatedIndex].mFrame = Frame + 1;
+	bPublished = true;
+}
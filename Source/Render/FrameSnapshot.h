@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "RenderCommands.h"
+#include "ShaderBuffers.h"
+#include "RectInstancing.h"
+
+using namespace std;
+
+class IMeshData;
+
+// One draw of a frame snapshot, all the render stage needs of its render instance.
+struct FSnapshotDraw
+{
+	FPipelineState mPipeline;
+	// geometry and texture, render instances and their meshes live until the engine is destroyed
+	IMeshData* mMeshData;
+};
+
+// Time spent by the stages of the last frame.
+struct FFramePipelineStats
+{
+	// milliseconds of simulating the next frame and building its snapshot
+	double mSimulateMs;
+	// milliseconds of recording and submitting the previous snapshot
+	double mRenderMs;
+	// milliseconds of both, overlapped
+	double mFrameMs;
+	// milliseconds both stages ran at the same time
+	double mOverlapMs;
+};
+
+// Immutable state of one simulated frame. The simulation stage fills it and the render stage reads it one
+// frame later, while the simulation fills the other snapshot of CFrameSnapshots.
+struct FFrameSnapshot
+{
+	FFrameSnapshot();
+
+	// Remove all draws and rects, keeping the memory.
+	void Reset();
+
+	// simulated frames before this one
+	uint64_t mFrame;
+	// cbuffer vsPerFrame, camera matrices
+	CB_VS_PER_FRAME mVSPerFrame;
+	// cbuffer psPerFrame, light, toggles and eye position
+	CB_PS_PER_FRAME mPSPerFrame;
+	// all rect proxies in the layout of psRects
+	vector<SB_PS_RECT> mRects;
+	// draws sorted by state
+	vector<FSnapshotDraw> mDraws;
+	// cbuffer cbPerObject of each draw in mDraws
+	vector<CB_PER_OBJECT> mObjectConstants;
+	// rect receivers drawn instanced
+	CRectInstancePacker mRectPacker;
+};
+
+// Two frame snapshots, the simulation stage writes one while the render stage reads the other. Both stages
+// are finished when the snapshots are swapped by Publish.
+class CFrameSnapshots
+{
+public:
+	CFrameSnapshots();
+
+	// Snapshot written by the simulation stage.
+	FFrameSnapshot& GetSimulated() { return mSnapshots[mSimulatedIndex]; }
+	// Snapshot read by the render stage, null before the first Publish.
+	const FFrameSnapshot* GetRendered() const { return bPublished ? &mSnapshots[1 - mSimulatedIndex] : nullptr; }
+
+	// Hand the simulated snapshot to the render stage and simulate into the other one.
+	void Publish();
+
+private:
+	FFrameSnapshot mSnapshots[2];
+	// index of the snapshot written by the simulation
+	int mSimulatedIndex;
+	// a snapshot was simulated completely
+	bool bPublished;
+};
@@ -0,0 +1,191 @@
+#include "DXUT.h"
+#include "HeadlessBenchmark.h"
+#include "RenderData.h"
+#include "RectProxy.h"
+#include "RenderStates.h"
+#include "ShaderCache.h"
+#include "StreamingGeometry.h"
+#include "JobSystem.h"
+#include "MicroBenchmarks.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+namespace
+{
+	// Stages of the scene set up by the DXUT callbacks, recorded with the meshes and buffers of the device.
+	class CMiniEngineStages : public IFrameStages
+	{
+	public:
+		CMiniEngineStages(CMiniEngine& InEngine, ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dContext)
+			: mEngine(InEngine)
+			, mDevice(pd3dDevice)
+			, mContext(pd3dContext)
+		{
+
+		}
+
+		virtual void Simulate(double InTime, float InTimeStep) override
+		{
+			mEngine.Simulate(InTime, InTimeStep);
+		}
+
+		virtual void Publish() override
+		{
+			mEngine.mSnapshots.Publish();
+		}
+
+		// the buffers are created through the D3D11 backend of the engine, only the commands go to InBackend
+		virtual void Record(IRenderBackend& InBackend, CRenderCommandList& OutCommands) override
+		{
+			(void)InBackend;
+			CStreamingGeometry::GetInstance().BeginFrame(mContext);
+			mEngine.RenderScene(mDevice, OutCommands);
+		}
+
+		virtual void EndFrame() override
+		{
+			CStreamingGeometry::GetInstance().EndFrame(mContext);
+		}
+
+		virtual int GetNumRenderInstances() const override
+		{
+			return mEngine.mRenderInstances.Num();
+		}
+
+		virtual int GetNumRects() const override
+		{
+			return CRectCollections::GetInstance().mRects.Num();
+		}
+
+		virtual FFrameSceneStats GetSceneStats() const override
+		{
+			const CRectCollections& RectColls = CRectCollections::GetInstance();
+			FFrameSceneStats Stats;
+			Stats.mRefreshedProxies = RectColls.GetStats().mRefreshedProxies;
+			Stats.mMovedProxies = RectColls.GetStats().mMovedProxies;
+			Stats.mRelinkedReceivers = RectColls.mLinker.GetStats().mRelinkedReceivers;
+			return Stats;
+		}
+
+	private:
+		CMiniEngine& mEngine;
+		ID3D11Device* mDevice;
+		ID3D11DeviceContext* mContext;
+	};
+}
+
+FHeadlessSettings::FHeadlessSettings()
+	: mWidth(1024)
+	, mHeight(768)
+	, mOutFile(L"RectGI_benchmark.json")
+	, bMicroBenchmark(false)
+{
+
+}
+
+bool FHeadlessSettings::ParseCommandLine(LPCWSTR InCommandLine)
+{
+	bool bBenchmark = false;
+	bool bOutFile = false;
+	wistringstream Stream(InCommandLine != nullptr ? InCommandLine : L"");
+	wstring Arg;
+	while (Stream >> Arg)
+	{
+		// options in the -name:value form of DXUT
+		if (Arg == L"-benchmark")
+		{
+			bBenchmark = true;
+		}
+		else if (Arg == L"-microbench")
+		{
+			bMicroBenchmark = true;
+		}
+		else if (Arg.compare(0, 8, L"-frames:") == 0)
+		{
+			mLoop.mNumFrames = max(1, _wtoi(Arg.c_str() + 8));
+		}
+		else if (Arg.compare(0, 8, L"-warmup:") == 0)
+		{
+			mLoop.mWarmupFrames = max(0, _wtoi(Arg.c_str() + 8));
+		}
+		else if (Arg.compare(0, 6, L"-step:") == 0)
+		{
+			mLoop.mTimeStep = (float)_wtof(Arg.c_str() + 6);
+		}
+		else if (Arg.compare(0, 5, L"-out:") == 0)
+		{
+			mOutFile = Arg.substr(5);
+			bOutFile = true;
+		}
+	}
+	if (bMicroBenchmark && !bOutFile)
+	{
+		mOutFile = L"RectGI_microbench.txt";
+	}
+	return bBenchmark || bMicroBenchmark;
+}
+
+int CHeadlessBenchmark::Run(CreateRenderInstancesCallback InCreateRenderInstances, SetupEnvironmentCallback InSetupEnvironment,
+	FrameUpdateCallback InFrameUpdate, const FHeadlessSettings& InSettings)
+{
+	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
+	MiniEngine.OnCreateRenderInstances = InCreateRenderInstances;
+	MiniEngine.OnSetupEnvironment = InSetupEnvironment;
+	MiniEngine.OnFrameUpdate = InFrameUpdate;
+
+	// the software rasterizer exists on every machine, nothing is ever submitted to it
+	const D3D_FEATURE_LEVEL FeatureLevels[] = { D3D_FEATURE_LEVEL_11_1, D3D_FEATURE_LEVEL_11_0 };
+	ID3D11Device* pd3dDevice = nullptr;
+	ID3D11DeviceContext* pd3dContext = nullptr;
+	HRESULT hr = D3D11CreateDevice(nullptr, D3D_DRIVER_TYPE_WARP, nullptr, 0, FeatureLevels, ARRAYSIZE(FeatureLevels),
+		D3D11_SDK_VERSION, &pd3dDevice, nullptr, &pd3dContext);
+	if (FAILED(hr))
+		return 1;
+
+	// the device part of OnD3D11CreateDevice and OnD3D11ResizedSwapChain, without UI and post processing
+	CJobSystem::GetInstance().Start(-1);
+	CShaderCache::GetInstance().SetCacheDirectory(L"ShaderCache");
+	MiniEngine.OnSetupEnvironment();
+	MiniEngine.OnCreateRenderInstances(pd3dDevice);
+	CRenderStates::GetInstance().InitRenderStates(pd3dDevice);
+	MiniEngine.CreateLightingLut(pd3dDevice);
+	MiniEngine.CreateRectInstancing(pd3dDevice);
+	// the rect buffers are created through the backend, the commands are executed on the null backend
+	MiniEngine.mBackend.SetContext(pd3dContext);
+	MiniEngine.mCamera.SetProjParams(XM_PI / 4, InSettings.mWidth / (FLOAT)InSettings.mHeight, 2.0f, 4000.0f);
+
+	CMiniEngineStages Stages(MiniEngine, pd3dDevice, pd3dContext);
+	CNullRenderBackend Backend;
+	FFrameLoopReport Report;
+	CFrameLoop::Run(Stages, InSettings.mLoop, Backend, Report);
+
+	FILE* fp = OpenFile(InSettings.mOutFile.c_str(), L"wb");
+	bool bWritten = fp != nullptr;
+	if (fp != nullptr)
+	{
+		bWritten = CFrameLoop::WriteReport(Report, fp);
+		fclose(fp);
+	}
+
+	MiniEngine.DestroyEngine();
+	CJobSystem::GetInstance().Stop();
+	SAFE_RELEASE(pd3dContext);
+	SAFE_RELEASE(pd3dDevice);
+	return bWritten ? 0 : 1;
+}
+
+int CHeadlessBenchmark::RunMicroBenchmarks(const FHeadlessSettings& InSettings)
+{
+	FILE* fp = OpenFile(InSettings.mOutFile.c_str(), L"wb");
+	if (fp == nullptr)
+		return 1;
+
+	// the defaults find mesh/ball.sdkmesh like the media search path of the demo
+	FMicroBenchSettings Settings;
+	bool bPassed = CMicroBenchmarks::Run(Settings, fp);
+	bool bWritten = ferror(fp) == 0;
+	fclose(fp);
+	return bPassed && bWritten ? 0 : 1;
+}
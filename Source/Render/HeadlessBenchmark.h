@@ -0,0 +1,43 @@
+#pragma once
+#include <d3d11.h>
+#include <string>
+#include <vector>
+#include "MiniEngine.h"
+#include "FrameLoop.h"
+
+using namespace std;
+
+// Settings of a headless benchmark run.
+struct FHeadlessSettings
+{
+	FHeadlessSettings();
+
+	// Parse "-benchmark [-frames:N] [-warmup:N] [-step:Seconds] [-out:File]" or "-microbench [-out:File]", false
+	// without either.
+	bool ParseCommandLine(LPCWSTR InCommandLine);
+
+	// frames and time step
+	FFrameLoopSettings mLoop;
+	// size of the view, only the aspect ratio of the projection depends on it
+	int mWidth;
+	int mHeight;
+	// JSON report, or the text log of the micro benchmarks
+	wstring mOutFile;
+	// run CMicroBenchmarks instead of frames
+	bool bMicroBenchmark;
+};
+
+// Runs the scene of the DXUT callbacks without a window in CFrameLoop, recording into a CNullRenderBackend. The
+// report holds percentiles of every stage and profiler zone, heap allocations per frame and the render, proxy
+// and link counters. Allocations are null unless AllocationHook.cpp is linked, as in the Profile build.
+class CHeadlessBenchmark
+{
+public:
+	// Create a WARP device, set up the scene with the callbacks like OnD3D11CreateDevice, run and write the
+	// report. Returns the process exit code.
+	static int Run(CreateRenderInstancesCallback InCreateRenderInstances, SetupEnvironmentCallback InSetupEnvironment,
+		FrameUpdateCallback InFrameUpdate, const FHeadlessSettings& InSettings);
+
+	// Run CMicroBenchmarks and write their log. Returns the process exit code, 1 when a check failed.
+	static int RunMicroBenchmarks(const FHeadlessSettings& InSettings);
+};
@@ -0,0 +1,343 @@
+#include "JobSystem.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	// index of the thread in CJobSystem, -1 for threads which cannot create jobs
+	thread_local int GJobThreadIndex = -1;
+
+	// root of ParallelFor, only waited on
+	void NoWork(void* InData, int InBegin, int InEnd)
+	{
+		(void)InData;
+		(void)InBegin;
+		(void)InEnd;
+	}
+}
+
+CJobDeque::CJobDeque()
+	: mTop(0)
+	, mBottom(0)
+{
+	for (int i = 0; i < Capacity; ++i)
+	{
+		mJobs[i].store(nullptr, memory_order_relaxed);
+	}
+}
+
+bool CJobDeque::Push(FJob* InJob)
+{
+	int64_t Bottom = mBottom.load(memory_order_relaxed);
+	int64_t Top = mTop.load(memory_order_acquire);
+	if (Bottom - Top >= Capacity)
+		return false;
+
+	mJobs[Bottom & (Capacity - 1)].store(InJob, memory_order_relaxed);
+	// the job is visible before the new bottom
+	atomic_thread_fence(memory_order_release);
+	mBottom.store(Bottom + 1, memory_order_relaxed);
+	return true;
+}
+
+FJob* CJobDeque::Pop()
+{
+	int64_t Bottom = mBottom.load(memory_order_relaxed) - 1;
+	mBottom.store(Bottom, memory_order_relaxed);
+	// thieves see the reserved bottom before the owner reads the top
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t Top = mTop.load(memory_order_relaxed);
+
+	if (Top > Bottom)
+	{
+		// empty
+		mBottom.store(Bottom + 1, memory_order_relaxed);
+		return nullptr;
+	}
+
+	FJob* Job = mJobs[Bottom & (Capacity - 1)].load(memory_order_relaxed);
+	if (Top == Bottom)
+	{
+		// the last job, race the thieves for it
+		if (!mTop.compare_exchange_strong(Top, Top + 1, memory_order_seq_cst, memory_order_relaxed))
+		{
+			Job = nullptr;
+		}
+		mBottom.store(Bottom + 1, memory_order_relaxed);
+	}
+	return Job;
+}
+
+FJob* CJobDeque::Steal()
+{
+	int64_t Top = mTop.load(memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	int64_t Bottom = mBottom.load(memory_order_acquire);
+	if (Top >= Bottom)
+		return nullptr;
+
+	FJob* Job = mJobs[Top & (Capacity - 1)].load(memory_order_relaxed);
+	if (!mTop.compare_exchange_strong(Top, Top + 1, memory_order_seq_cst, memory_order_relaxed))
+		return nullptr;
+	return Job;
+}
+
+CJobSystem::CJobSystem()
+	: mNumQueued(0)
+	, mNumSleeping(0)
+	, bStopping(false)
+{
+}
+
+CJobSystem::~CJobSystem()
+{
+	Stop();
+	for (size_t i = 0; i < mDeques.size(); ++i)
+	{
+		delete mDeques[i];
+		delete[] mJobPools[i];
+	}
+}
+
+CJobSystem& CJobSystem::GetInstance()
+{
+	static CJobSystem GInstance;
+	return GInstance;
+}
+
+void CJobSystem::Start(int InNumWorkers)
+{
+	Stop();
+	int NumWorkers = InNumWorkers >= 0 ? InNumWorkers : max((int)thread::hardware_concurrency() - 1, 0);
+
+	// deques and pools of stopped threads are drained and reused
+	while ((int)mDeques.size() < NumWorkers + 1)
+	{
+		mDeques.push_back(new CJobDeque);
+		mJobPools.push_back(new FJob[JobPoolSize]);
+		mNextJobs.push_back(0);
+		for (int i = 0; i < JobPoolSize; ++i)
+		{
+			mJobPools.back()[i].mUnfinished.store(0, memory_order_relaxed);
+		}
+	}
+
+	GJobThreadIndex = 0;
+	bStopping = false;
+	for (int i = 1; i <= NumWorkers; ++i)
+	{
+		mWorkers.push_back(thread(&CJobSystem::WorkerMain, this, i));
+	}
+}
+
+void CJobSystem::Stop()
+{
+	GJobThreadIndex = -1;
+	if (mWorkers.empty())
+		return;
+
+	{
+		lock_guard<mutex> Lock(mSleepMutex);
+		bStopping = true;
+	}
+	mWakeUp.notify_all();
+	for (thread& Worker : mWorkers)
+	{
+		Worker.join();
+	}
+	mWorkers.clear();
+}
+
+bool CJobSystem::IsStarted() const
+{
+	return GetThreadIndex() == 0;
+}
+
+int CJobSystem::GetThreadIndex() const
+{
+	return GJobThreadIndex < (int)mDeques.size() ? GJobThreadIndex : -1;
+}
+
+FJob* CJobSystem::CreateJob(FJobFunction InFunction, void* InData, int InBegin, int InEnd, FJob* InParent)
+{
+	int ThreadIndex = GetThreadIndex();
+	assert(ThreadIndex >= 0 && InFunction != nullptr);
+
+	FJob* Job = &mJobPools[ThreadIndex][mNextJobs[ThreadIndex]++ & (JobPoolSize - 1)];
+	// more than JobPoolSize jobs of one thread are alive
+	assert(Job->mUnfinished.load(memory_order_relaxed) == 0);
+
+	Job->mFunction = InFunction;
+	Job->mData = InData;
+	Job->mBegin = InBegin;
+	Job->mEnd = InEnd;
+	Job->mParent = InParent;
+	Job->mUnfinished.store(1, memory_order_relaxed);
+	Job->mPendingDependencies.store(1, memory_order_relaxed);
+	Job->mNumContinuations = 0;
+	if (InParent != nullptr)
+	{
+		InParent->mUnfinished.fetch_add(1, memory_order_relaxed);
+	}
+	return Job;
+}
+
+void CJobSystem::AddDependency(FJob* InJob, FJob* InPrerequisite)
+{
+	// the prerequisite has not been run, so nothing reads its continuations yet
+	assert(InPrerequisite->mPendingDependencies.load(memory_order_relaxed) > 0);
+	assert(InPrerequisite->mNumContinuations < FJob::MaxContinuations);
+	InPrerequisite->mContinuations[InPrerequisite->mNumContinuations++] = InJob;
+	InJob->mPendingDependencies.fetch_add(1, memory_order_relaxed);
+}
+
+void CJobSystem::Run(FJob* InJob)
+{
+	if (InJob->mPendingDependencies.fetch_sub(1, memory_order_acq_rel) == 1)
+	{
+		Submit(InJob);
+	}
+}
+
+void CJobSystem::Submit(FJob* InJob)
+{
+	int ThreadIndex = GetThreadIndex();
+	assert(ThreadIndex >= 0);
+
+	mNumQueued.fetch_add(1);
+	if (!mDeques[ThreadIndex]->Push(InJob))
+	{
+		mNumQueued.fetch_sub(1);
+		Execute(InJob);
+		return;
+	}
+
+	// a sleeping worker checks mNumQueued under the mutex, so taking it here cannot miss the wake up
+	if (mNumSleeping.load() > 0)
+	{
+		lock_guard<mutex> Lock(mSleepMutex);
+		mWakeUp.notify_one();
+	}
+}
+
+FJob* CJobSystem::FindJob(int InThreadIndex)
+{
+	FJob* Job = mDeques[InThreadIndex]->Pop();
+	if (Job == nullptr)
+	{
+		// steal starting after the own deque, so thieves spread over the victims
+		int NumDeques = (int)mDeques.size();
+		for (int i = 1; i < NumDeques && Job == nullptr; ++i)
+		{
+			Job = mDeques[(InThreadIndex + i) % NumDeques]->Steal();
+		}
+	}
+	if (Job != nullptr)
+	{
+		mNumQueued.fetch_sub(1);
+	}
+	return Job;
+}
+
+void CJobSystem::Execute(FJob* InJob)
+{
+	InJob->mFunction(InJob->mData, InJob->mBegin, InJob->mEnd);
+	Finish(InJob);
+}
+
+void CJobSystem::Finish(FJob* InJob)
+{
+	// read before the count drops, a waiter may reuse the job right after
+	FJob* Parent = InJob->mParent;
+	FJob* Continuations[FJob::MaxContinuations];
+	int NumContinuations = InJob->mNumContinuations;
+	memcpy(Continuations, InJob->mContinuations, NumContinuations * sizeof(FJob*));
+
+	if (InJob->mUnfinished.fetch_sub(1, memory_order_acq_rel) != 1)
+		return;
+
+	for (int i = 0; i < NumContinuations; ++i)
+	{
+		Run(Continuations[i]);
+	}
+	if (Parent != nullptr)
+	{
+		Finish(Parent);
+	}
+}
+
+void CJobSystem::Wait(FJob* InJob)
+{
+	int ThreadIndex = GetThreadIndex();
+	assert(ThreadIndex >= 0);
+	while (InJob->mUnfinished.load(memory_order_acquire) > 0)
+	{
+		FJob* Job = FindJob(ThreadIndex);
+		if (Job != nullptr)
+		{
+			Execute(Job);
+		}
+		else
+		{
+			this_thread::yield();
+		}
+	}
+}
+
+void CJobSystem::ParallelFor(int InCount, int InGrain, FJobFunction InFunction, void* InData)
+{
+	if (InCount <= 0)
+		return;
+
+	int Grain = max(InGrain, 1);
+	if (GetThreadIndex() < 0 || GetNumThreads() == 1 || InCount <= Grain)
+	{
+		InFunction(InData, 0, InCount);
+		return;
+	}
+
+	// a few ranges per thread, so threads finishing early steal from the others
+	int NumRanges = min((InCount + Grain - 1) / Grain, GetNumThreads() * 4);
+	FJob* Root = CreateJob(NoWork, nullptr);
+	for (int Range = 0; Range < NumRanges; ++Range)
+	{
+		int Begin = (int)((int64_t)InCount * Range / NumRanges);
+		int End = (int)((int64_t)InCount * (Range + 1) / NumRanges);
+		Run(CreateJob(InFunction, InData, Begin, End, Root));
+	}
+	Run(Root);
+	Wait(Root);
+}
+
+void CJobSystem::WorkerMain(int InThreadIndex)
+{
+	GJobThreadIndex = InThreadIndex;
+
+	// spin a little before sleeping, frames queue jobs in bursts
+	const int SpinsBeforeSleep = 64;
+	int Spins = 0;
+	while (true)
+	{
+		FJob* Job = FindJob(InThreadIndex);
+		if (Job != nullptr)
+		{
+			Execute(Job);
+			Spins = 0;
+			continue;
+		}
+		if (bStopping.load())
+			break;
+		if (++Spins < SpinsBeforeSleep)
+		{
+			this_thread::yield();
+			continue;
+		}
+
+		unique_lock<mutex> Lock(mSleepMutex);
+		mNumSleeping.fetch_add(1);
+		mWakeUp.wait(Lock, [this]() { return mNumQueued.load() > 0 || bStopping.load(); });
+		mNumSleeping.fetch_sub(1);
+		Spins = 0;
+	}
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Function of a job, called with the data and range given to CJobSystem::CreateJob.
+typedef void (*FJobFunction)(void* InData, int InBegin, int InEnd);
+
+// A unit of work of CJobSystem, allocated from the pool of the creating thread and reused once finished.
+struct FJob
+{
+	// jobs started when one finishes
+	static const int MaxContinuations = 4;
+
+	FJobFunction mFunction;
+	void* mData;
+	int mBegin;
+	int mEnd;
+	// parent waiting for this job too, null for none
+	FJob* mParent;
+	// this job and its unfinished children
+	atomic<int32_t> mUnfinished;
+	// unfinished prerequisites, plus one until Run
+	atomic<int32_t> mPendingDependencies;
+	// jobs depending on this one
+	FJob* mContinuations[MaxContinuations];
+	int mNumContinuations;
+};
+
+// Work-stealing deque of Chase and Lev with a fixed capacity. The owning thread pushes and pops at the bottom,
+// any other thread steals from the top.
+class CJobDeque
+{
+public:
+	// jobs held at most, a power of two
+	static const int Capacity = 4096;
+
+	CJobDeque();
+
+	// Push a job at the bottom, owner only. False when full.
+	bool Push(FJob* InJob);
+	// Pop the newest job, owner only. Null when empty.
+	FJob* Pop();
+	// Take the oldest job from any thread. Null when empty or lost to another thief.
+	FJob* Steal();
+
+private:
+	atomic<int64_t> mTop;
+	atomic<int64_t> mBottom;
+	atomic<FJob*> mJobs[Capacity];
+};
+
+// Job scheduler with one deque per thread. Threads run their own jobs newest first and steal the oldest jobs
+// of others when they run out, waiting threads help instead of blocking. Jobs can have children, which a wait
+// on the parent includes, and prerequisites, which delay them until finished.
+//
+// Only the thread which called Start and the workers create jobs; other threads, or all threads without
+// workers, run ParallelFor inline.
+class CJobSystem
+{
+private:
+	CJobSystem();
+
+public:
+	~CJobSystem();
+
+	static CJobSystem& GetInstance();
+
+	// jobs per thread which can be alive at the same time
+	static const int JobPoolSize = 4096;
+
+	// Start InNumWorkers threads besides the calling one, negative for one per remaining hardware thread.
+	void Start(int InNumWorkers);
+	// Finish all jobs and join the workers, the calling thread runs ParallelFor inline afterwards.
+	void Stop();
+	// Whether the calling thread started the jobs system.
+	bool IsStarted() const;
+	// Threads running jobs, the caller of Start included.
+	int GetNumThreads() const { return (int)mWorkers.size() + 1; }
+
+	// Create a job calling InFunction(InData, InBegin, InEnd). A parent is not finished before its children.
+	FJob* CreateJob(FJobFunction InFunction, void* InData, int InBegin = 0, int InEnd = 0, FJob* InParent = nullptr);
+	// Run InJob after InPrerequisite, both created and neither run yet.
+	void AddDependency(FJob* InJob, FJob* InPrerequisite);
+	// Queue a job, it starts when its prerequisites are finished.
+	void Run(FJob* InJob);
+	// Run other jobs until InJob and its children are finished.
+	void Wait(FJob* InJob);
+
+	// Call InBody(Begin, End) for ranges of at least InGrain elements covering [0, InCount), in parallel, and
+	// return when all are done.
+	template <typename TBody>
+	void ParallelFor(int InCount, int InGrain, const TBody& InBody)
+	{
+		ParallelFor(InCount, InGrain, [](void* InData, int InBegin, int InEnd)
+		{
+			(*static_cast<const TBody*>(InData))(InBegin, InEnd);
+		}, const_cast<TBody*>(&InBody));
+	}
+	// Same as above with a job function.
+	void ParallelFor(int InCount, int InGrain, FJobFunction InFunction, void* InData);
+
+private:
+	// Index of the calling thread, -1 if it cannot create jobs.
+	int GetThreadIndex() const;
+	// A job of the own deque or stolen from another, null if there is none.
+	FJob* FindJob(int InThreadIndex);
+	// Run a job and finish it.
+	void Execute(FJob* InJob);
+	// Count a finished job or child, starting continuations and finishing the parent when it is the last.
+	void Finish(FJob* InJob);
+	// Push a job whose prerequisites are finished, running it inline if the deque is full.
+	void Submit(FJob* InJob);
+	// Loop of a worker thread.
+	void WorkerMain(int InThreadIndex);
+
+private:
+	// per thread, index 0 is the thread which called Start
+	vector<CJobDeque*> mDeques;
+	vector<FJob*> mJobPools;
+	vector<uint32_t> mNextJobs;
+	vector<thread> mWorkers;
+
+	// jobs in deques, workers sleep while there are none
+	atomic<int32_t> mNumQueued;
+	atomic<int32_t> mNumSleeping;
+	atomic<bool> bStopping;
+	mutex mSleepMutex;
+	condition_variable mWakeUp;
+};
@@ -0,0 +1,199 @@
+#include "ModuleBenchmarks.h"
+#include "../CpuGI/RectGICpu.h"
+#include "../CpuGI/SGLightingLut.h"
+#include "../CpuGI/SGReflectKernel.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// gIntegrateDiskLighting in double precision, the float version cancels badly for small k * s.
+	// k keeps the float rounding of the shader, the pole at k = 0 amplifies any difference in it.
+	double DiskLighting(float dr, float nol, float roughness)
+	{
+		float m2 = roughness * roughness;
+		double k = (0.288f * nol) / m2 - 0.673f;
+		double drCos2 = (double)dr * nol * dr * nol;
+		double s = drCos2 / (1 + drCos2);
+		return k != 0 ? -std::expm1(-k * s) / (2 * k) * nol * PI / k : 0;
+	}
+}
+
+FSGLutBenchResult CModuleBenchmarks::RunSGLightingLut(int InNumSamples)
+{
+	assert(InNumSamples > 0);
+
+	FSGLutBenchResult Result;
+
+	vector<uint16_t> Texels;
+	FSGLightingLut::Bake(Texels);
+	Result.bBakedDataValid = memcmp(Texels.data(), FSGLightingLut::GetHalfTexels(), Texels.size() * sizeof(uint16_t)) == 0;
+
+	// reflector roughness up to the specular cut of findSpecularRelatedPlanes, any angle and distance
+	mt19937 Rng(5678);
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	vector<float> Roughness(InNumSamples), NoL(InNumSamples), Dr(InNumSamples);
+	for (int i = 0; i < InNumSamples; ++i)
+	{
+		Roughness[i] = .02f + Unit(Rng) * .28f;
+		NoL[i] = Unit(Rng);
+		Dr[i] = std::pow(10.f, Unit(Rng) * 4.f - 3.f);
+	}
+
+	// gIntegrateDiskLighting takes points, place the disk at distance 1 along the normal
+	float3 ShadingPt(0.f, 0.f, 0.f);
+	float3 DiskNormal(0.f, 0.f, 1.f);
+	float3 DiskPt(0.f, 0.f, 1.f);
+
+	vector<float> Analytic(2 * InNumSamples);
+	auto StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumSamples; ++i)
+	{
+		float3 LightDir(std::sqrt(1 - NoL[i] * NoL[i]), 0.f, NoL[i]);
+		Analytic[2 * i] = FRectGI::gIntegrateDiskLighting(ShadingPt, DiskPt, DiskNormal, Dr[i], LightDir, 1.f,
+			Roughness[i]);
+		Analytic[2 * i + 1] = FRectGI::asgCalcBandwidth(Dr[i]);
+	}
+	chrono::duration<double> AnalyticElapsed = chrono::steady_clock::now() - StartTime;
+
+	vector<float> Lut(2 * InNumSamples);
+	StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumSamples; ++i)
+	{
+		Lut[2 * i] = FSGLightingLut::IntegrateDiskLighting(Dr[i], 1.f, NoL[i], 1.f, Roughness[i]);
+		Lut[2 * i + 1] = FSGLightingLut::CalcBandwidth(Dr[i]);
+	}
+	chrono::duration<double> LutElapsed = chrono::steady_clock::now() - StartTime;
+
+	Result.mDiskLightingMaxError = 0.f;
+	Result.mDiskLightingAnalyticError = 0.f;
+	Result.mBandwidthMaxError = 0.f;
+	for (int i = 0; i < InNumSamples; ++i)
+	{
+		double Exact = DiskLighting(Dr[i], NoL[i], Roughness[i]);
+		if (Exact != 0)
+		{
+			Result.mDiskLightingMaxError = max(Result.mDiskLightingMaxError, (float)std::fabs(Lut[2 * i] / Exact - 1));
+			Result.mDiskLightingAnalyticError = max(Result.mDiskLightingAnalyticError,
+				(float)std::fabs(Analytic[2 * i] / Exact - 1));
+		}
+		float Error = std::fabs(Lut[2 * i + 1] / Analytic[2 * i + 1] - 1);
+		Result.mBandwidthMaxError = max(Result.mBandwidthMaxError, Error);
+	}
+
+	Result.mAnalyticNs = AnalyticElapsed.count() * 1e9 / InNumSamples;
+	Result.mLutNs = LutElapsed.count() * 1e9 / InNumSamples;
+	return Result;
+}
+
+vector<FSGKernelBenchResult> CModuleBenchmarks::RunSGReflectKernel(int InNumPoints, int InIterations)
+{
+	assert(InNumPoints > 0 && InIterations > 0);
+
+	// a glossy floor reflector lit from above, shading points scattered over a wall in front of it
+	float SamplingRadius = 300.f;
+	float3 PlaneCenter(0.f, 0.f, 0.f);
+	float3 PlaneNormal(0.f, 1.f, 0.f);
+	float3 PlaneMajorAxis(1.f, 0.f, 0.f);
+	float3 SpecularColor(1.f, 1.f, 1.f);
+	float PlaneMajorRadius = 400.f;
+	float PlaneMinorRadius = 300.f;
+	float PlaneRoughness = 0.2f;
+	float3 LightDir = normalize(float3(0.3f, 1.f, -0.4f));
+	float LightIntensity = 1.f;
+	float3 ViewPoint(0.f, 200.f, -800.f);
+
+	FSGReflectUniforms Uniforms;
+	Uniforms.Setup(SamplingRadius, PlaneCenter, PlaneNormal, PlaneMajorAxis, SpecularColor,
+		PlaneMajorRadius, PlaneMinorRadius, PlaneRoughness, LightDir, LightIntensity, ViewPoint);
+
+	mt19937 Rng(1234);
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	vector<float> Inputs(7 * InNumPoints);
+	float* Pos[3] = { &Inputs[0], &Inputs[InNumPoints], &Inputs[2 * InNumPoints] };
+	float* Normal[3] = { &Inputs[3 * InNumPoints], &Inputs[4 * InNumPoints], &Inputs[5 * InNumPoints] };
+	float* Roughness = &Inputs[6 * InNumPoints];
+	for (int i = 0; i < InNumPoints; ++i)
+	{
+		Pos[0][i] = (Unit(Rng) * 2.f - 1.f) * 500.f;
+		Pos[1][i] = 5.f + Unit(Rng) * 400.f;
+		Pos[2][i] = 300.f + Unit(Rng) * 20.f;
+		Normal[0][i] = (Unit(Rng) * 2.f - 1.f) * .3f;
+		Normal[1][i] = (Unit(Rng) * 2.f - 1.f) * .3f;
+		Normal[2][i] = -1.f;
+		Roughness[i] = .1f + Unit(Rng) * .8f;
+	}
+	FSGShadingPoints Points = { Pos[0], Pos[1], Pos[2], Normal[0], Normal[1], Normal[2], Roughness, InNumPoints };
+
+	// reference: the scalar port of the shader
+	vector<float> Reference(3 * InNumPoints);
+	auto StartTime = chrono::steady_clock::now();
+	for (int Iter = 0; Iter < InIterations; ++Iter)
+	{
+		for (int i = 0; i < InNumPoints; ++i)
+		{
+			float3 Color = FRectGI::sgReflectShading(
+				float3(Pos[0][i], Pos[1][i], Pos[2][i]), float3(Normal[0][i], Normal[1][i], Normal[2][i]),
+				Roughness[i], SamplingRadius,
+				PlaneCenter, PlaneNormal, PlaneMajorAxis, SpecularColor, PlaneMajorRadius, PlaneMinorRadius,
+				PlaneRoughness, LightDir, LightIntensity, ViewPoint);
+			Reference[3 * i + 0] = Color.x;
+			Reference[3 * i + 1] = Color.y;
+			Reference[3 * i + 2] = Color.z;
+		}
+	}
+	chrono::duration<double> RefElapsed = chrono::steady_clock::now() - StartTime;
+	double RefPointsPerSecond = (double)InNumPoints * InIterations / RefElapsed.count();
+
+	float RefMax = 0.f;
+	for (float Value : Reference)
+	{
+		RefMax = max(RefMax, Value);
+	}
+	RefMax = RefMax > 0 ? RefMax : 1.f;
+
+	vector<FSGKernelBenchResult> Results;
+	vector<float> Output(3 * InNumPoints);
+	for (int Isa = 0; Isa < ESimdIsa::Num; ++Isa)
+	{
+		if (!FSGReflectKernel::IsSupported((ESimdIsa::Type)Isa))
+			continue;
+
+		for (int Math = 0; Math < ESimdMath::Num; ++Math)
+		{
+			float* OutR = &Output[0];
+			float* OutG = &Output[InNumPoints];
+			float* OutB = &Output[2 * InNumPoints];
+
+			StartTime = chrono::steady_clock::now();
+			for (int Iter = 0; Iter < InIterations; ++Iter)
+			{
+				std::fill(Output.begin(), Output.end(), 0.f);
+				FSGReflectKernel::Evaluate((ESimdIsa::Type)Isa, (ESimdMath::Type)Math, Points, Uniforms, OutR, OutG, OutB);
+			}
+			chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+
+			float MaxError = 0.f;
+			for (int i = 0; i < InNumPoints; ++i)
+			{
+				MaxError = max(MaxError, std::fabs(OutR[i] - Reference[3 * i + 0]));
+				MaxError = max(MaxError, std::fabs(OutG[i] - Reference[3 * i + 1]));
+				MaxError = max(MaxError, std::fabs(OutB[i] - Reference[3 * i + 2]));
+			}
+
+			FSGKernelBenchResult Result;
+			Result.mIsa = (ESimdIsa::Type)Isa;
+			Result.mMath = (ESimdMath::Type)Math;
+			Result.mPointsPerSecond = (double)InNumPoints * InIterations / Elapsed.count();
+			Result.mSpeedup = Result.mPointsPerSecond / RefPointsPerSecond;
+			Result.mMaxError = MaxError / RefMax;
+			Results.push_back(Result);
+		}
+	}
+	return Results;
+}
@@ -0,0 +1,393 @@
+#include "ModuleBenchmarks.h"
+#include "FileUtil.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "SdkMeshFile.h"
+#include "VertexQuantization.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// Sum of the vertex and index bytes of a file, reading them like an upload would.
+	uint64_t SumBufferBytes(const CSdkMeshFile& InFile)
+	{
+		uint64_t Sum = 0;
+		for (uint32_t i = 0; i < InFile.GetNumVertexBuffers(); ++i)
+		{
+			FSdkMeshVertexView View = InFile.GetVertices(i);
+			uint64_t Size = View.mNumVertices * View.mStride;
+			for (uint64_t j = 0; j < Size; ++j)
+			{
+				Sum += View.mData[j];
+			}
+		}
+		for (uint32_t i = 0; i < InFile.GetNumIndexBuffers(); ++i)
+		{
+			FSdkMeshIndexView View = InFile.GetIndices(i);
+			for (uint64_t j = 0; j < View.mNumIndices; ++j)
+			{
+				Sum += View[j];
+			}
+		}
+		return Sum;
+	}
+
+	// Nanoseconds per item since InStart.
+	double NanosecondsPer(chrono::steady_clock::time_point InStart, size_t InCount)
+	{
+		chrono::duration<double, nano> Elapsed = chrono::steady_clock::now() - InStart;
+		return Elapsed.count() / InCount;
+	}
+
+	// Milliseconds since InStart.
+	double MillisecondsSince(chrono::steady_clock::time_point InStart)
+	{
+		return chrono::duration<double, milli>(chrono::steady_clock::now() - InStart).count();
+	}
+
+	float Dot(const float A[3], const float B[3])
+	{
+		return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+	}
+}
+
+FSdkMeshLoadBenchResult CModuleBenchmarks::RunSdkMeshLoad(const string& InFileName, int InIterations)
+{
+	assert(InIterations > 0);
+	FSdkMeshLoadBenchResult Result;
+	memset(&Result, 0, sizeof(Result));
+
+	// like CDXUTSDKMesh::CreateFromFile, which reads the file into the heap and patches it in place
+	uint64_t ReadCopySum = 0;
+	for (int i = 0; i < InIterations; ++i)
+	{
+		auto StartTime = chrono::steady_clock::now();
+		FILE* fp = OpenFile(InFileName.c_str(), "rb");
+		if (fp == nullptr)
+			return Result;
+		fseek(fp, 0, SEEK_END);
+		long Size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		// new of uint64_t keeps the tables aligned like new BYTE[] does on every heap in practice
+		uint64_t* pData = new uint64_t[(Size + 7) / 8];
+		size_t Read = fread(pData, 1, (size_t)Size, fp);
+		fclose(fp);
+		CSdkMeshFile File;
+		bool bOpened = Read == (size_t)Size && File.OpenMemory(pData, (size_t)Size) == ESdkMeshError::None;
+		chrono::duration<double, micro> Load = chrono::steady_clock::now() - StartTime;
+
+		StartTime = chrono::steady_clock::now();
+		ReadCopySum = bOpened ? SumBufferBytes(File) : 0;
+		chrono::duration<double, micro> Touch = chrono::steady_clock::now() - StartTime;
+
+		File.Close();
+		delete[] pData;
+		Result.mReadCopyUs += Load.count();
+		Result.mReadCopyTouchUs += Touch.count();
+		Result.mFileBytes = (uint64_t)Size;
+	}
+
+	uint64_t MapSum = 0;
+	for (int i = 0; i < InIterations; ++i)
+	{
+		auto StartTime = chrono::steady_clock::now();
+		CSdkMeshFile File;
+		bool bOpened = File.Open(InFileName) == ESdkMeshError::None;
+		chrono::duration<double, micro> Load = chrono::steady_clock::now() - StartTime;
+
+		StartTime = chrono::steady_clock::now();
+		MapSum = bOpened ? SumBufferBytes(File) : 0;
+		chrono::duration<double, micro> Touch = chrono::steady_clock::now() - StartTime;
+
+		Result.mMapUs += Load.count();
+		Result.mMapTouchUs += Touch.count();
+	}
+
+	Result.mReadCopyUs /= InIterations;
+	Result.mReadCopyTouchUs /= InIterations;
+	Result.mMapUs /= InIterations;
+	Result.mMapTouchUs /= InIterations;
+	Result.bMatches = ReadCopySum != 0 && ReadCopySum == MapSum;
+	return Result;
+}
+
+FMeshOptimizeBenchResult CModuleBenchmarks::RunMeshOptimizer(int InGridSize)
+{
+	assert(InGridSize > 1);
+	FMeshOptimizeBenchResult Result;
+	const int CacheSize = CMeshOptimizer::DefaultCacheSize;
+
+	// a sphere of InGridSize rings and segments, like a tessellated scanned model with its triangles in random order
+	uint32_t Side = (uint32_t)InGridSize + 1;
+	uint32_t NumVertices = Side * Side;
+	vector<float> Positions(NumVertices * 3);
+	for (uint32_t y = 0; y < Side; ++y)
+	{
+		float Theta = 3.14159265f * y / InGridSize;
+		for (uint32_t x = 0; x < Side; ++x)
+		{
+			float Phi = 2 * 3.14159265f * x / InGridSize;
+			float* P = &Positions[(y * Side + x) * 3];
+			P[0] = sinf(Theta) * cosf(Phi);
+			P[1] = cosf(Theta);
+			P[2] = sinf(Theta) * sinf(Phi);
+		}
+	}
+	vector<uint32_t> Triangles;
+	for (uint32_t y = 0; y < (uint32_t)InGridSize; ++y)
+	{
+		for (uint32_t x = 0; x < (uint32_t)InGridSize; ++x)
+		{
+			uint32_t V0 = y * Side + x;
+			Triangles.insert(Triangles.end(), { V0, V0 + Side, V0 + 1, V0 + 1, V0 + Side, V0 + Side + 1 });
+		}
+	}
+	Result.mNumTriangles = (int)(Triangles.size() / 3);
+	vector<uint32_t> Order(Result.mNumTriangles);
+	for (int i = 0; i < Result.mNumTriangles; ++i)
+	{
+		Order[i] = (uint32_t)i;
+	}
+	mt19937 Rng(2468);
+	shuffle(Order.begin(), Order.end(), Rng);
+	vector<uint32_t> Indices;
+	Indices.reserve(Triangles.size());
+	for (uint32_t Triangle : Order)
+	{
+		Indices.insert(Indices.end(), Triangles.begin() + Triangle * 3, Triangles.begin() + Triangle * 3 + 3);
+	}
+	Result.mShuffled = CMeshOptimizer::AnalyzeVertexCache(Indices.data(), Indices.size(), NumVertices, CacheSize);
+
+	vector<uint32_t> Clusters;
+	auto StartTime = chrono::steady_clock::now();
+	CMeshOptimizer::OptimizeVertexCache(Indices, NumVertices, CacheSize, &Clusters);
+	chrono::duration<double, milli> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mVertexCacheMs = Elapsed.count();
+	Result.mVertexCache = CMeshOptimizer::AnalyzeVertexCache(Indices.data(), Indices.size(), NumVertices, CacheSize);
+
+	StartTime = chrono::steady_clock::now();
+	CMeshOptimizer::OptimizeOverdraw(Indices, Clusters, Positions.data(), sizeof(float) * 3, NumVertices,
+		CMeshOptimizer::DefaultOverdrawThreshold, CacheSize);
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mOverdrawMs = Elapsed.count();
+	Result.mOverdraw = CMeshOptimizer::AnalyzeVertexCache(Indices.data(), Indices.size(), NumVertices, CacheSize);
+
+	StartTime = chrono::steady_clock::now();
+	CMeshOptimizer::OptimizeVertexFetch(Indices, Positions.data(), NumVertices, sizeof(float) * 3);
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mVertexFetchMs = Elapsed.count();
+	return Result;
+}
+
+FVertexQuantizeBenchResult CModuleBenchmarks::RunVertexQuantizer(int InNumVertices)
+{
+	assert(InNumVertices > 0);
+	FVertexQuantizeBenchResult Result;
+	Result.mNumVertices = InNumVertices;
+	Result.mFloatStride = FVertexFormat(EVertexTexcoord::Float2).mStride;
+
+	// a sphere away from the origin, like a model placed in its own space
+	const float Radius = 50.f;
+	mt19937 Rng(9753);
+	normal_distribution<float> Gaussian;
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	vector<FDecodedVertex> Vertices(InNumVertices);
+	for (FDecodedVertex& Vertex : Vertices)
+	{
+		float Direction[3] = { Gaussian(Rng), Gaussian(Rng), Gaussian(Rng) };
+		float InvLength = 1.f / max(sqrtf(Direction[0] * Direction[0] + Direction[1] * Direction[1]
+			+ Direction[2] * Direction[2]), 1e-6f);
+		for (int k = 0; k < 3; ++k)
+		{
+			Vertex.mNormal[k] = Direction[k] * InvLength;
+			Vertex.mPosition[k] = Vertex.mNormal[k] * Radius + 100.f;
+		}
+		Vertex.mTexcoord[0] = Unit(Rng);
+		Vertex.mTexcoord[1] = Unit(Rng);
+	}
+
+	auto StartTime = chrono::steady_clock::now();
+	Result.mFormat = CVertexQuantizer::ChooseFormat(Vertices.data(), Vertices.size(), true, FVertexQuantizeSettings());
+	vector<uint8_t> Encoded(Vertices.size() * Result.mFormat.mStride);
+	CVertexQuantizer::Encode(Result.mFormat, Vertices.data(), Vertices.size(), Encoded.data());
+	Result.mEncodeNs = NanosecondsPer(StartTime, Vertices.size());
+
+	vector<FDecodedVertex> Scalar(Vertices.size());
+	StartTime = chrono::steady_clock::now();
+	CVertexQuantizer::DecodeScalar(Result.mFormat, Encoded.data(), Vertices.size(), Scalar.data());
+	Result.mDecodeScalarNs = NanosecondsPer(StartTime, Vertices.size());
+
+	vector<FDecodedVertex> Simd(Vertices.size());
+	StartTime = chrono::steady_clock::now();
+	CVertexQuantizer::Decode(Result.mFormat, Encoded.data(), Vertices.size(), Simd.data());
+	Result.mDecodeSimdNs = NanosecondsPer(StartTime, Vertices.size());
+
+	Result.mMaxPositionError = 0;
+	Result.mMaxNormalErrorDegrees = 0;
+	Result.mMaxTexcoordError = 0;
+	float MinCosine = 1;
+	for (size_t i = 0; i < Vertices.size(); ++i)
+	{
+		const FDecodedVertex& Original = Vertices[i];
+		const FDecodedVertex& Decoded = Simd[i];
+		float Cosine = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			Result.mMaxPositionError = max(Result.mMaxPositionError,
+				fabsf(Decoded.mPosition[k] - Original.mPosition[k]) / (2 * Radius));
+			Cosine += Decoded.mNormal[k] * Original.mNormal[k];
+		}
+		MinCosine = min(MinCosine, Cosine);
+		for (int k = 0; k < 2; ++k)
+		{
+			Result.mMaxTexcoordError = max(Result.mMaxTexcoordError, fabsf(Decoded.mTexcoord[k] - Original.mTexcoord[k]));
+		}
+	}
+	Result.mMaxNormalErrorDegrees = acosf(min(1.f, MinCosine)) * 180 / 3.14159265f;
+	return Result;
+}
+
+FMeshletBenchResult CModuleBenchmarks::RunMeshlets(int InGridSize, int InNumViews)
+{
+	assert(InGridSize > 1 && InNumViews > 0);
+	FMeshletBenchResult Result;
+
+	// a unit sphere of InGridSize rings and segments
+	uint32_t Side = (uint32_t)InGridSize + 1;
+	uint32_t NumVertices = Side * Side;
+	vector<float> Positions(NumVertices * 3);
+	for (uint32_t y = 0; y < Side; ++y)
+	{
+		float Theta = 3.14159265f * y / InGridSize;
+		for (uint32_t x = 0; x < Side; ++x)
+		{
+			float Phi = 2 * 3.14159265f * x / InGridSize;
+			float* P = &Positions[(y * Side + x) * 3];
+			P[0] = sinf(Theta) * cosf(Phi);
+			P[1] = cosf(Theta);
+			P[2] = sinf(Theta) * sinf(Phi);
+		}
+	}
+	// clockwise seen from outside
+	vector<uint32_t> Indices;
+	for (uint32_t y = 0; y < (uint32_t)InGridSize; ++y)
+	{
+		for (uint32_t x = 0; x < (uint32_t)InGridSize; ++x)
+		{
+			uint32_t V0 = y * Side + x;
+			Indices.insert(Indices.end(), { V0, V0 + 1, V0 + Side, V0 + 1, V0 + Side + 1, V0 + Side });
+		}
+	}
+	Result.mNumTriangles = (int)(Indices.size() / 3);
+
+	// triangles in the order of the loading path
+	mt19937 Rng(1357);
+	vector<uint32_t> Order(Result.mNumTriangles);
+	for (int i = 0; i < Result.mNumTriangles; ++i)
+	{
+		Order[i] = (uint32_t)i;
+	}
+	shuffle(Order.begin(), Order.end(), Rng);
+	vector<uint32_t> Shuffled;
+	Shuffled.reserve(Indices.size());
+	for (uint32_t Triangle : Order)
+	{
+		Shuffled.insert(Shuffled.end(), Indices.begin() + Triangle * 3, Indices.begin() + Triangle * 3 + 3);
+	}
+	Indices.swap(Shuffled);
+	vector<uint32_t> Clusters;
+	CMeshOptimizer::OptimizeVertexCache(Indices, NumVertices, CMeshOptimizer::DefaultCacheSize, &Clusters);
+	CMeshOptimizer::OptimizeOverdraw(Indices, Clusters, Positions.data(), sizeof(float) * 3, NumVertices,
+		CMeshOptimizer::DefaultOverdrawThreshold, CMeshOptimizer::DefaultCacheSize);
+
+	FMeshletData Meshlets;
+	auto StartTime = chrono::steady_clock::now();
+	CMeshletBuilder::Build(Indices.data(), Indices.size(), Positions.data(), sizeof(float) * 3, NumVertices, Meshlets);
+	Result.mBuildMs = MillisecondsSince(StartTime);
+	Result.mNumMeshlets = (int)Meshlets.mMeshlets.size();
+	Result.mAverageVertices = (double)Meshlets.mVertices.size() / Result.mNumMeshlets;
+	Result.mAverageTriangles = (double)Meshlets.GetNumTriangles() / Result.mNumMeshlets;
+
+	// cameras circling the sphere at distances from 1.5 to 4, a 60 degree perspective looking at its center
+	vector<FMeshletCullView> Views(InNumViews);
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	for (FMeshletCullView& View : Views)
+	{
+		float Yaw = Unit(Rng) * 2 * 3.14159265f;
+		float Pitch = (Unit(Rng) - .5f) * 3.f;
+		float Distance = 1.5f + Unit(Rng) * 2.5f;
+		float Eye[3] = { cosf(Pitch) * cosf(Yaw) * Distance, sinf(Pitch) * Distance, cosf(Pitch) * sinf(Yaw) * Distance };
+
+		// left handed look at, as XMMatrixLookAtLH, times XMMatrixPerspectiveFovLH
+		float Z[3] = { -Eye[0] / Distance, -Eye[1] / Distance, -Eye[2] / Distance };
+		float Up[3] = { 0, 1, 0 };
+		float X[3] = { Up[1] * Z[2] - Up[2] * Z[1], Up[2] * Z[0] - Up[0] * Z[2], Up[0] * Z[1] - Up[1] * Z[0] };
+		float XLength = sqrtf(Dot(X, X));
+		for (float& C : X)
+		{
+			C /= XLength;
+		}
+		float Y[3] = { Z[1] * X[2] - Z[2] * X[1], Z[2] * X[0] - Z[0] * X[2], Z[0] * X[1] - Z[1] * X[0] };
+		float ViewMatrix[4][4] =
+		{
+			{ X[0], Y[0], Z[0], 0 },
+			{ X[1], Y[1], Z[1], 0 },
+			{ X[2], Y[2], Z[2], 0 },
+			{ -Dot(X, Eye), -Dot(Y, Eye), -Dot(Z, Eye), 1 },
+		};
+		float Near = .01f;
+		float Far = 100.f;
+		float YScale = 1 / tanf(3.14159265f / 6);
+		float ProjMatrix[4][4] =
+		{
+			{ YScale, 0, 0, 0 },
+			{ 0, YScale, 0, 0 },
+			{ 0, 0, Far / (Far - Near), 1 },
+			{ 0, 0, -Near * Far / (Far - Near), 0 },
+		};
+		float ViewProj[16];
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				ViewProj[r * 4 + c] = ViewMatrix[r][0] * ProjMatrix[0][c] + ViewMatrix[r][1] * ProjMatrix[1][c]
+					+ ViewMatrix[r][2] * ProjMatrix[2][c] + ViewMatrix[r][3] * ProjMatrix[3][c];
+			}
+		}
+		CMeshletCuller::SetupView(ViewProj, Eye, View);
+	}
+
+	vector<uint32_t> Visible;
+	Visible.reserve(Indices.size());
+	StartTime = chrono::steady_clock::now();
+	for (const FMeshletCullView& View : Views)
+	{
+		FMeshletCullStats Stats;
+		CMeshletCuller::Cull(Meshlets, View, Visible, &Stats);
+		Result.mStats.Accumulate(Stats);
+	}
+	Result.mCullUs = MillisecondsSince(StartTime) * 1000 / InNumViews;
+
+	// the alternative of streaming all indices every frame
+	StartTime = chrono::steady_clock::now();
+	uint64_t Checksum = 0;
+	for (int i = 0; i < InNumViews; ++i)
+	{
+		Visible.assign(Indices.begin(), Indices.end());
+		Checksum += Visible[i % Visible.size()];
+	}
+	Result.mCopyUs = MillisecondsSince(StartTime) * 1000 / InNumViews;
+	assert(Checksum < NumVertices * (uint64_t)InNumViews);
+
+	uint64_t NumCulled = Result.mStats.mNumTriangles - Result.mStats.mNumVisibleTriangles;
+	Result.mNsPerCulledTriangle = NumCulled > 0 ? Result.mCullUs * 1000 * InNumViews / NumCulled : 0;
+	return Result;
+}
@@ -3,23 +3,54 @@
 #include "RenderData.h"
 #include "MiniEngine.h"
 #include "RectProxy.h"
+#include "StreamingGeometry.h"
 
 #pragma warning( disable : 4100 )
 
 IMeshData::IMeshData()
 	: mVB(nullptr)
 	, mIB(nullptr)
+	, mBaseVertex(0)
+	, mStartIndex(0)
+	, mNumVertexElements(0)
 	, mTexture(nullptr)
+{
+	SetVertexFormat(FVertexFormat());
+}
+
+void IMeshData::DynamicUpdateVB(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
 
 }
 
-void IMeshData::DynamicUpdateVB(ID3D11Device* pd3dDevice)
+void IMeshData::SetVertexFormat(const FVertexFormat& InFormat)
 {
+	// DXGI formats indexed by EVertexPosition, EVertexNormal and EVertexTexcoord
+	const static DXGI_FORMAT PositionFormats[] =
+		{ DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R16G16B16A16_SNORM, DXGI_FORMAT_R16G16B16A16_UNORM };
+	const static DXGI_FORMAT NormalFormats[] = { DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R16G16_SNORM, DXGI_FORMAT_R8G8_SNORM };
+	const static DXGI_FORMAT TexcoordFormats[] = { DXGI_FORMAT_UNKNOWN, DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R16G16_FLOAT };
+
+	mVertexFormat = InFormat;
+	const D3D11_INPUT_ELEMENT_DESC layout[] =
+	{
+		{ "POSITION",  0, PositionFormats[InFormat.mPosition], 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL",    0, NormalFormats[InFormat.mNormal], 0, InFormat.mNormalOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD",  0, TexcoordFormats[InFormat.mTexcoord], 0, InFormat.mTexcoordOffset, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+	};
+	static_assert(sizeof(layout) == sizeof(mVertexDesc), "one element per attribute");
+	memcpy(mVertexDesc, layout, sizeof(layout));
+	mNumVertexElements = InFormat.mTexcoord == EVertexTexcoord::None ? 2 : 3;
+}
 
+const D3D_SHADER_MACRO* IMeshData::GetShaderDefines() const
+{
+	// octahedral normals are float2 inputs, see ShaderBuffers.fxc
+	const static D3D_SHADER_MACRO OctNormalDefines[] = { { "VERTEX_OCT_NORMAL", "1" }, { nullptr, nullptr } };
+	return mVertexFormat.mNormal == EVertexNormal::Float3 ? nullptr : OctNormalDefines;
 }
 
-CDxMesh* IMeshData::CreateDxMesh(LPCWSTR szFileName,ID3D11Device* pd3dDevice)
+CDxMesh* IMeshData::CreateDxMesh(LPCWSTR szFileName,ID3D11Device* pd3dDevice, bool bInOptimize, bool bInQuantize)
 {
 	CDxMesh* TheMesh = new CDxMesh;
 	assert(TheMesh->mSdkMesh == nullptr);
@@ -34,6 +65,11 @@ CDxMesh* IMeshData::CreateDxMesh(LPCWSTR szFileName,ID3D11Device* pd3dDevice)
 
 	// binding mesh
 	TheMesh->mSdkMesh = pMesh;
+	// replace the buffers as authored, falling back to them if the file cannot be read
+	if (bInOptimize || bInQuantize)
+	{
+		TheMesh->CreateFileBuffers(szFileName, pd3dDevice, bInOptimize, bInQuantize);
+	}
 	// create device buffers
 	TheMesh->CreateBuffers(pd3dDevice);
 
@@ -85,9 +121,9 @@ void IMeshData::DestroyMesh(IMeshData** ppMeshData)
 	*ppMeshData = nullptr;
 }
 
-ID3D11Buffer* IMeshData::GetVertexBuffer(ID3D11Device* pd3dDevice)
+ID3D11Buffer* IMeshData::GetVertexBuffer(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
-	DynamicUpdateVB(pd3dDevice);
+	DynamicUpdateVB(pd3dDevice, OutCommands);
 	return mVB;
 }
 
@@ -124,56 +160,90 @@ const vector<WORD>& CRectMesh::GetRectIndices()
 	return GPlaneIndices;
 }
 
+// quad buffers shared by all rectangle meshes
+static ID3D11Buffer* GRectVB = nullptr;
+static ID3D11Buffer* GRectIB = nullptr;
+// rectangle meshes holding the shared buffers
+static int GNumRectMeshes = 0;
+// storage of the shared vertex buffer
+static FVertexFormat GRectFormat;
+
 void CRectMesh::CreateBuffers(ID3D11Device* pd3dDevice)
 {
-	// Create vertex buffer
-	D3D11_BUFFER_DESC bd = {};
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(Vertex_P3N3) * 8;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA InitData = {};
-	InitData.pSysMem = &GPlaneVertices[0];
-	assert(mVB == nullptr);
-	HRESULT hr = pd3dDevice->CreateBuffer(&bd, &InitData, &mVB);
-	assert(SUCCEEDED(hr));
-	assert(mVB != nullptr);
+	if (GNumRectMeshes == 0)
+	{
+		// Quantize vertices
+		vector<FDecodedVertex> Vertices(GPlaneVertices.size());
+		for (size_t i = 0; i < Vertices.size(); ++i)
+		{
+			memcpy(Vertices[i].mPosition, &GPlaneVertices[i].mPos, sizeof(Vertices[i].mPosition));
+			memcpy(Vertices[i].mNormal, &GPlaneVertices[i].mNormal, sizeof(Vertices[i].mNormal));
+			Vertices[i].mTexcoord[0] = Vertices[i].mTexcoord[1] = 0;
+		}
+		GRectFormat = CVertexQuantizer::ChooseFormat(&Vertices[0], Vertices.size(), false, FVertexQuantizeSettings());
+		vector<uint8_t> Encoded(Vertices.size() * GRectFormat.mStride);
+		CVertexQuantizer::Encode(GRectFormat, &Vertices[0], Vertices.size(), &Encoded[0]);
+
+		// Create vertex buffer
+		D3D11_BUFFER_DESC bd = {};
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.ByteWidth = (UINT)Encoded.size();
+		bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bd.CPUAccessFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA InitData = {};
+		InitData.pSysMem = &Encoded[0];
+		assert(GRectVB == nullptr);
+		HRESULT hr = pd3dDevice->CreateBuffer(&bd, &InitData, &GRectVB);
+		assert(SUCCEEDED(hr));
+		assert(GRectVB != nullptr);
+
+		// Create index buffer
+		bd.Usage = D3D11_USAGE_DEFAULT;
+		bd.ByteWidth = (UINT)(sizeof(WORD) * GPlaneIndices.size());
+		bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		bd.CPUAccessFlags = 0;
+		InitData.pSysMem = &GPlaneIndices[0];
+		assert(GRectIB == nullptr);
+		hr = pd3dDevice->CreateBuffer(&bd, &InitData, &GRectIB);
+		assert(SUCCEEDED(hr));
+		assert(GRectIB != nullptr);
+	}
+	++GNumRectMeshes;
 
-	// Create index buffer
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * 6; 
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = 0;
-	InitData.pSysMem = &GPlaneIndices[0];
-	assert(mIB == nullptr);
-	hr = pd3dDevice->CreateBuffer(&bd, &InitData, &mIB);
-	assert(SUCCEEDED(hr));
-	assert(mIB != nullptr);
+	assert(mVB == nullptr && mIB == nullptr);
+	mVB = GRectVB;
+	mIB = GRectIB;
+	SetVertexFormat(GRectFormat);
 }
 
 void CRectMesh::DestroyData()
 {
-	// release buffers
-	SAFE_RELEASE(mVB);
-	SAFE_RELEASE(mIB);
+	if (mVB == nullptr)
+		return;
+
+	// the last rectangle mesh releases the shared buffers
+	mVB = nullptr;
+	mIB = nullptr;
+	assert(GNumRectMeshes > 0);
+	if (--GNumRectMeshes == 0)
+	{
+		SAFE_RELEASE(GRectVB);
+		SAFE_RELEASE(GRectIB);
+	}
 }
 
 const D3D11_INPUT_ELEMENT_DESC* CRectMesh::GetVertexDesc(UINT& OutNumElement)
 {
-	// vertex declaration
-	const static D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	OutNumElement = ARRAYSIZE(layout);
-	return layout;
+	// vertex declaration of the shared quad
+	assert(mVB != nullptr);
+	OutNumElement = mNumVertexElements;
+	return mVertexDesc;
 }
 
 UINT CRectMesh::GetVertexStride()
 {
-	return sizeof(Vertex_P3N3);
+	return mVertexFormat.mStride;
 }
 
 UINT CRectMesh::GetVertexNum()
@@ -199,6 +269,7 @@ ID3D11ShaderResourceView* CRectMesh::GetTexture()
 }
 
 CCPUMesh::CCPUMesh()
+	: mStreamedFrame(0)
 {
 
 }
@@ -211,48 +282,32 @@ void CCPUMesh::SetBufferData(const vector<Vertex_P3>& InVertices, const vector<W
 
 void CCPUMesh::CreateBuffers(ID3D11Device* pd3dDevice)
 {
-	assert(mVertices.size() >= 3);
-	assert(mIndices.size() >= 3);
-
-	// destroy buffers
-	SAFE_RELEASE(mVB);
-	SAFE_RELEASE(mIB);
-	
-	// Create vertex buffer
-	D3D11_BUFFER_DESC bd = {};
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(Vertex_P3N3) * 8;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = 0;
-
-	D3D11_SUBRESOURCE_DATA InitData = {};
-	InitData.pSysMem = &mVertices[0];
-	assert(mVB == nullptr);
-	HRESULT hr = pd3dDevice->CreateBuffer(&bd, &InitData, &mVB);
-	assert(SUCCEEDED(hr));
-	assert(mVB != nullptr);
-
-	// Create index buffer
-	bd.Usage = D3D11_USAGE_DEFAULT;
-	bd.ByteWidth = sizeof(WORD) * 6;
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = 0;
-	InitData.pSysMem = &mIndices[0];
-	assert(mIB == nullptr);
-	hr = pd3dDevice->CreateBuffer(&bd, &InitData, &mIB);
-	assert(SUCCEEDED(hr));
-	assert(mIB != nullptr);
 }
 
-void CCPUMesh::DynamicUpdateVB(ID3D11Device* pd3dDevice)
+void CCPUMesh::DynamicUpdateVB(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
-	CreateBuffers(pd3dDevice);
+	assert(mVertices.size() >= 3);
+	assert(mIndices.size() >= 3);
+
+	// data of earlier frames may have been overwritten, so it is appended again in every frame it is drawn
+	CStreamingGeometry& Streaming = CStreamingGeometry::GetInstance();
+	if (mStreamedFrame != Streaming.GetFrame())
+	{
+		mBaseVertex = Streaming.AppendVertices(pd3dDevice, OutCommands, &mVertices[0], sizeof(Vertex_P3),
+			(UINT)mVertices.size());
+		mStartIndex = Streaming.AppendIndices(pd3dDevice, OutCommands, &mIndices[0], (UINT)mIndices.size());
+		mVB = Streaming.GetVertexBuffer();
+		mIB = Streaming.GetIndexBuffer();
+		mStreamedFrame = Streaming.GetFrame();
+	}
 }
 
 void CCPUMesh::DestroyData()
 {
-	SAFE_RELEASE(mVB);
-	SAFE_RELEASE(mIB);
+	// owned by CStreamingGeometry
+	mVB = nullptr;
+	mIB = nullptr;
+	mStreamedFrame = 0;
 }
 
 const D3D11_INPUT_ELEMENT_DESC* CCPUMesh::GetVertexDesc(UINT& OutNumElement)
@@ -301,6 +356,7 @@ void CCPUMesh::UpdateTestRectMesh(const string& RectMeshName, const string& Plan
 	assert(MeshInst->mMeshData->GetMeshType() == EMeshData::RectMesh);
 	assert(RectInst->mMeshData->GetMeshType() == EMeshData::CPUMesh);
 
+	MiniEngine.mTransforms.Update();
 	XMMATRIX mWorld = MeshInst->GetWorldMatrix();
 	XMMATRIX mWVP = MeshInst->GetWVPMatrix();
 
@@ -343,8 +399,9 @@ void CCPUMesh::UpdateTestRectMesh(const string& RectMeshName, const string& Plan
 
 CDxMesh::CDxMesh()
 	: mSdkMesh(nullptr)
+	, mFileVertexStride(0)
 {
-
+	SetVertexFormat(FVertexFormat(EVertexTexcoord::Float2));
 }
 
 CDxMesh::~CDxMesh()
@@ -354,17 +411,83 @@ CDxMesh::~CDxMesh()
 
 void CDxMesh::CreateBuffers(ID3D11Device* pd3dDevice)
 {
+	const SDKMESH_MESH* pMesh = mSdkMesh->GetMesh(0);
+	bool bFileBuffers = mFileBuffers.IsCreated();
+
 	// vertex buffer
 	assert(mVB == nullptr);
-	mVB = mSdkMesh->GetVB11(0, 0);
+	mVB = bFileBuffers ? mFileBuffers.GetVertexBuffer(pMesh->VertexBuffers[0]) : mSdkMesh->GetVB11(0, 0);
 	assert(mVB != nullptr);
 
 	// index buffer
 	assert(mIB == nullptr);
-	mIB = mSdkMesh->GetIB11(0);
+	mIB = bFileBuffers ? mFileBuffers.GetIndexBuffer(pMesh->IndexBuffer) : mSdkMesh->GetIB11(0);
 	assert(mIB != nullptr);
 }
 
+bool CDxMesh::CreateFileBuffers(LPCWSTR szFileName, ID3D11Device* pd3dDevice, bool bInOptimize, bool bInQuantize)
+{
+	// the same search as CDXUTSDKMesh::Create
+	WCHAR FilePathW[MAX_PATH];
+	char FilePath[MAX_PATH];
+	if (FAILED(DXUTFindDXSDKMediaFileCch(FilePathW, MAX_PATH, szFileName))
+		|| WideCharToMultiByte(CP_ACP, 0, FilePathW, -1, FilePath, MAX_PATH, nullptr, nullptr) == 0)
+		return false;
+
+	vector<uint8_t> Data;
+	{
+		CSdkMeshFile File;
+		if (File.Open(FilePath) != ESdkMeshError::None)
+			return false;
+		const FSdkMeshHeader& Header = File.GetHeader();
+		const uint8_t* pData = reinterpret_cast<const uint8_t*>(&Header);
+		Data.assign(pData, pData + Header.mHeaderSize + Header.mNonBufferDataSize + Header.mBufferDataSize);
+	}
+
+	// reorder before quantizing, the compact vertices keep the order of first use
+	FMeshOptimizeReport Report;
+	bool bOptimized = bInOptimize && CMeshOptimizer::OptimizeSdkMesh(Data, Report) && Report.mNumOptimizedSubsets > 0;
+
+	CSdkMeshFile File;
+	if (File.OpenMemory(Data.data(), Data.size()) != ESdkMeshError::None || !mFileBuffers.Create(pd3dDevice, File))
+		return false;
+
+	if (bOptimized)
+	{
+		// shown on the HUD
+		mOptimizeReport = Report;
+	}
+	// the clusters follow the optimized triangle order, so they are compact, culling them is shown on the HUD
+	CMeshletBuilder::BuildSdkMesh(File, 0, mMeshlets);
+	if (bInQuantize)
+	{
+		QuantizeVertexBuffer(pd3dDevice, File);
+	}
+	return true;
+}
+
+bool CDxMesh::QuantizeVertexBuffer(ID3D11Device* pd3dDevice, const CSdkMeshFile& InFile)
+{
+	// the vertex shader reads positions, normals and texture coordinates of a single stream
+	const FSdkMeshMesh& Mesh = InFile.GetMesh(0);
+	vector<FDecodedVertex> Vertices;
+	bool bHasTexcoord = false;
+	if (Mesh.mNumVertexBuffers != 1
+		|| !CVertexQuantizer::ReadSdkMeshVertices(InFile.GetVertices(Mesh.mVertexBuffers[0]), Vertices, bHasTexcoord)
+		|| !bHasTexcoord || Vertices.empty())
+		return false;
+
+	FVertexFormat Format = CVertexQuantizer::ChooseFormat(Vertices.data(), Vertices.size(), true, FVertexQuantizeSettings());
+	vector<uint8_t> Encoded(Vertices.size() * Format.mStride);
+	CVertexQuantizer::Encode(Format, Vertices.data(), Vertices.size(), Encoded.data());
+	if (!mFileBuffers.ReplaceVertexBuffer(pd3dDevice, Mesh.mVertexBuffers[0], Encoded.data(), Vertices.size(), Format.mStride))
+		return false;
+	SetVertexFormat(Format);
+	// shown on the HUD
+	mFileVertexStride = InFile.GetVertices(Mesh.mVertexBuffers[0]).mStride;
+	return true;
+}
+
 void CDxMesh::DestroyData()
 {
 	if (mSdkMesh != nullptr)
@@ -373,6 +496,11 @@ void CDxMesh::DestroyData()
 		delete mSdkMesh;
 		mSdkMesh = nullptr;
 	}
+	mFileBuffers.Release();
+	mOptimizeReport = FMeshOptimizeReport();
+	mFileVertexStride = 0;
+	mMeshlets.Clear();
+	SetVertexFormat(FVertexFormat(EVertexTexcoord::Float2));
 
 	mVB = nullptr;
 	mIB = nullptr;
@@ -380,20 +508,14 @@ void CDxMesh::DestroyData()
 
 const D3D11_INPUT_ELEMENT_DESC* CDxMesh::GetVertexDesc(UINT& OutNumElement)
 {
-	// vertex declaration
-	const static D3D11_INPUT_ELEMENT_DESC layout[] =
-	{
-		{ "POSITION",  0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,  D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL",    0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD",  0, DXGI_FORMAT_R32G32_FLOAT,    0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
-	};
-	OutNumElement = ARRAYSIZE(layout);
-	return layout;
+	// vertex declaration, the float layout of the file unless it was quantized
+	OutNumElement = mNumVertexElements;
+	return mVertexDesc;
 }
 
 UINT CDxMesh::GetVertexStride()
 {
-	return mSdkMesh->GetVertexStride(0, 0);
+	return mVertexFormat.IsQuantized() ? mVertexFormat.mStride : mSdkMesh->GetVertexStride(0, 0);
 }
 
 UINT CDxMesh::GetVertexNum()
@@ -2,6 +2,11 @@
 #include "SDKmesh.h"
 #include <d3d11.h>
 #include <string>
+#include "RenderCommands.h"
+#include "SdkMeshBuffers.h"
+#include "MeshOptimizer.h"
+#include "VertexQuantization.h"
+#include "Meshlets.h"
 
 using namespace DirectX;
 using namespace std;
@@ -54,17 +59,25 @@ public:
 	// Destroy rendering buffers.
 	virtual void DestroyData() = 0;
 
-	// Get vertex buffer of current mesh.
-	ID3D11Buffer* GetVertexBuffer(ID3D11Device* pd3dDevice);
+	// Get vertex buffer of current mesh, recording its update for this frame if it has one.
+	ID3D11Buffer* GetVertexBuffer(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
 	// Get vertex description of current mesh.
 	virtual const D3D11_INPUT_ELEMENT_DESC* GetVertexDesc(UINT& OutNumElement) = 0;
 	// Get vertex stride of current mesh.
 	virtual UINT GetVertexStride() = 0;
 	// Get vertex number of current mesh.
 	virtual UINT GetVertexNum() = 0;
+	// Get the storage of the vertex attributes, which the per-object constants pass on to the vertex shader.
+	const FVertexFormat& GetVertexFormat() const { return mVertexFormat; }
+	// Get the defines vertex shaders of current mesh are compiled with, null if there are none.
+	const D3D_SHADER_MACRO* GetShaderDefines() const;
+	// Get the vertex added to the indices, non-zero when the vertices share a buffer with other meshes.
+	INT GetBaseVertex() const { return mBaseVertex; }
 
 	// Get index buffer of current mesh.
 	ID3D11Buffer* GetIndexBuffer();
+	// Get the first index of current mesh in its index buffer.
+	UINT GetStartIndex() const { return mStartIndex; }
 	// Get index format of current mesh.
 	virtual DXGI_FORMAT GetIndexFormat()
 	{
@@ -72,17 +85,24 @@ public:
 	}
 	// Get index number of current mesh.
 	virtual UINT GetIndexNum() = 0;
+	// Get the meshlets of current mesh, whose indices replace the index buffer when meshlets are culled, null if
+	// it has none.
+	virtual const FMeshletData* GetMeshlets() const { return nullptr; }
 
 	// Get textures of current mesh if there is any.
 	virtual ID3D11ShaderResourceView* GetTexture() = 0;
 
 protected:
 	// Updating vertex buffer for current mesh.
-	virtual void DynamicUpdateVB(ID3D11Device* pd3dDevice);
+	virtual void DynamicUpdateVB(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
+	// Set the vertex format and the matching vertex description.
+	void SetVertexFormat(const FVertexFormat& InFormat);
 
 public:
-	// Create a DXUT built-in mesh.
-	static CDxMesh* CreateDxMesh(LPCWSTR szFileName, ID3D11Device* pd3dDevice);
+	// Create a DXUT built-in mesh, with its triangles and vertices reordered by CMeshOptimizer when bInOptimize is set
+	// and its vertices compacted by CVertexQuantizer when bInQuantize is set.
+	static CDxMesh* CreateDxMesh(LPCWSTR szFileName, ID3D11Device* pd3dDevice, bool bInOptimize = true,
+		bool bInQuantize = true);
 	// Create a rectangle mesh.
 	static CRectMesh* CreateRectMesh(ID3D11Device* pd3dDevice);
 	// Create a cpu mesh.
@@ -96,12 +116,20 @@ protected:
 	ID3D11Buffer* mVB;
 	// index buffer
 	ID3D11Buffer* mIB;
+	// where the mesh starts in its buffers
+	INT mBaseVertex;
+	UINT mStartIndex;
+	// vertex format and its description, position, normal and texture coordinates
+	FVertexFormat mVertexFormat;
+	D3D11_INPUT_ELEMENT_DESC mVertexDesc[3];
+	UINT mNumVertexElements;
 
 	// texture
 	ID3D11ShaderResourceView* mTexture;
 };
 
-// Rectangle mesh.
+// Rectangle mesh, all of them share one quad vertex and index buffer. The quad is stored quantized, its positions
+// are exact snorm values.
 class CRectMesh : public IMeshData
 {
 	friend class IMeshData;
@@ -138,7 +166,7 @@ public:
 	virtual ID3D11ShaderResourceView* GetTexture() override;
 };
 
-// Mesh with vertices being handled on CPU
+// Mesh with vertices being handled on CPU, streamed into CStreamingGeometry in every frame it is drawn.
 class CCPUMesh : public IMeshData
 {
 	friend class IMeshData;
@@ -152,9 +180,9 @@ public:
 	// Update buffer data.
 	void SetBufferData(const vector<Vertex_P3>& InVertices, const vector<WORD>& InIndices);
 
-	// Create rendering buffers for current mesh.
+	// Nothing to create, the buffers are shared by all CPU meshes.
 	virtual void CreateBuffers(ID3D11Device* pd3dDevice) override;
-	// Destroy rendering buffers.
+	// Forget the shared buffers.
 	virtual void DestroyData() override;
 
 	// Get vertex description of current mesh.
@@ -176,14 +204,16 @@ public:
 	static void UpdateTestRectMesh(const string& RectMeshName, const string& PlaneMeshName);
 
 protected:
-	// Updating vertex buffer for current mesh.
-	virtual void DynamicUpdateVB(ID3D11Device* pd3dDevice) override;
+	// Append the vertices and indices to the streaming buffers, once per frame.
+	virtual void DynamicUpdateVB(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands) override;
 
 private:
 	// transformed vertex buffer data
 	vector<Vertex_P3> mVertices;
 	// index buffer data
 	vector<WORD> mIndices;
+	// frame of CStreamingGeometry the data was appended in, 0 if never
+	UINT64 mStreamedFrame;
 };
 
 // DXUT built-in mesh.
@@ -218,7 +248,29 @@ public:
 	// Get textures of current mesh if there is any.
 	virtual ID3D11ShaderResourceView* GetTexture() override;
 
+	// Meshlets of the first mesh, built from the buffers read by CreateFileBuffers.
+	virtual const FMeshletData* GetMeshlets() const override { return mMeshlets.mMeshlets.empty() ? nullptr : &mMeshlets; }
+
+	// Cache statistics of the optimization on load, empty if the mesh was not optimized.
+	const FMeshOptimizeReport& GetOptimizeReport() const { return mOptimizeReport; }
+	// Vertex stride in the file, 0 if the vertices were not quantized.
+	uint32_t GetFileVertexStride() const { return mFileVertexStride; }
+
+private:
+	// Optimize and quantize a copy of the file and create buffers and meshlets from it instead of using the buffers
+	// of DXUT.
+	bool CreateFileBuffers(LPCWSTR szFileName, ID3D11Device* pd3dDevice, bool bInOptimize, bool bInQuantize);
+	// Replace the vertex buffer of the first mesh by its quantized vertices.
+	bool QuantizeVertexBuffer(ID3D11Device* pd3dDevice, const CSdkMeshFile& InFile);
+
 private:
-	// DXUT mesh
+	// DXUT mesh, which still provides the materials
 	CDXUTSDKMesh* mSdkMesh;
+	// optimized and quantized buffers replacing those of mSdkMesh
+	CSdkMeshBuffers mFileBuffers;
+	FMeshOptimizeReport mOptimizeReport;
+	// stride of the vertices in the file before quantizing
+	uint32_t mFileVertexStride;
+	// clusters of the indices of mFileBuffers
+	FMeshletData mMeshlets;
 };
\ No newline at end of file
@@ -0,0 +1,555 @@
+#include "MeshOptimizer.h"
+#include "SdkMeshFile.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// PT_TRIANGLE_LIST of SDKMESH_PRIMITIVE_TYPE
+	const uint32_t PrimitiveTriangleList = 0;
+	// D3DDECLUSAGE_POSITION and D3DDECLTYPE_FLOAT3 of vertex declarations
+	const uint8_t DeclUsagePosition = 0;
+	const uint8_t DeclTypeFloat3 = 2;
+	// marks vertices not reached yet
+	const uint32_t InvalidVertex = 0xffffffff;
+
+	// FIFO cache of vertex timestamps, a vertex is cached while less than CacheSize vertices were added after it.
+	struct FFifoCache
+	{
+		FFifoCache(uint32_t InNumVertices, int InCacheSize)
+			: mTimestamps(InNumVertices, 0)
+			, mCacheSize((uint32_t)InCacheSize)
+			, mTime((uint32_t)InCacheSize + 1)
+		{
+
+		}
+
+		// Whether a vertex is cached.
+		bool IsCached(uint32_t InVertex) const
+		{
+			return mTime - mTimestamps[InVertex] <= mCacheSize;
+		}
+
+		// Use a vertex, true if it has to be transformed.
+		bool Access(uint32_t InVertex)
+		{
+			if (IsCached(InVertex))
+				return false;
+			mTimestamps[InVertex] = mTime++;
+			return true;
+		}
+
+		// Age of a cached vertex, 1 for the last one added.
+		uint32_t GetAge(uint32_t InVertex) const
+		{
+			return mTime - mTimestamps[InVertex];
+		}
+
+		// Evict all vertices.
+		void Flush()
+		{
+			mTime += mCacheSize + 1;
+		}
+
+		vector<uint32_t> mTimestamps;
+		uint32_t mCacheSize;
+		uint32_t mTime;
+	};
+
+	void LoadPosition(const uint8_t* InPositions, size_t InStride, uint32_t InVertex, float OutPosition[3])
+	{
+		memcpy(OutPosition, InPositions + InVertex * InStride, sizeof(float) * 3);
+	}
+
+	// Indices of a range of an index buffer widened to 32 bit.
+	void ReadIndices(const uint8_t* InIndices, bool bIn32Bit, uint64_t InStart, uint64_t InCount, vector<uint32_t>& OutIndices)
+	{
+		OutIndices.resize((size_t)InCount);
+		for (uint64_t i = 0; i < InCount; ++i)
+		{
+			if (bIn32Bit)
+			{
+				memcpy(&OutIndices[(size_t)i], InIndices + (InStart + i) * 4, 4);
+			}
+			else
+			{
+				uint16_t Index;
+				memcpy(&Index, InIndices + (InStart + i) * 2, 2);
+				OutIndices[(size_t)i] = Index;
+			}
+		}
+	}
+
+	void WriteIndices(uint8_t* OutIndices, bool bIn32Bit, uint64_t InStart, const vector<uint32_t>& InIndices)
+	{
+		for (size_t i = 0; i < InIndices.size(); ++i)
+		{
+			if (bIn32Bit)
+			{
+				memcpy(OutIndices + (InStart + i) * 4, &InIndices[i], 4);
+			}
+			else
+			{
+				uint16_t Index = (uint16_t)InIndices[i];
+				memcpy(OutIndices + (InStart + i) * 2, &Index, 2);
+			}
+		}
+	}
+
+	// Milliseconds since InStart.
+	double MillisecondsSince(chrono::steady_clock::time_point InStart)
+	{
+		chrono::duration<double, milli> Elapsed = chrono::steady_clock::now() - InStart;
+		return Elapsed.count();
+	}
+}
+
+const float CMeshOptimizer::DefaultOverdrawThreshold = 1.05f;
+
+FVertexCacheStats::FVertexCacheStats()
+	: mNumTransformed(0)
+	, mNumTriangles(0)
+	, mNumVertices(0)
+	, mACMR(0)
+	, mATVR(0)
+{
+
+}
+
+void FVertexCacheStats::Accumulate(const FVertexCacheStats& InStats)
+{
+	mNumTransformed += InStats.mNumTransformed;
+	mNumTriangles += InStats.mNumTriangles;
+	mNumVertices += InStats.mNumVertices;
+	mACMR = mNumTriangles > 0 ? (double)mNumTransformed / mNumTriangles : 0;
+	mATVR = mNumVertices > 0 ? (double)mNumTransformed / mNumVertices : 0;
+}
+
+FMeshOptimizeReport::FMeshOptimizeReport()
+	: mNumOptimizedSubsets(0)
+	, mNumSkippedSubsets(0)
+	, mNumReorderedVertexBuffers(0)
+	, mMilliseconds(0)
+{
+
+}
+
+void CMeshOptimizer::OptimizeVertexCache(vector<uint32_t>& InOutIndices, uint32_t InNumVertices, int InCacheSize,
+	vector<uint32_t>* OutClusters)
+{
+	assert(InOutIndices.size() % 3 == 0 && InCacheSize > 0);
+	uint32_t NumTriangles = (uint32_t)(InOutIndices.size() / 3);
+	if (OutClusters != nullptr)
+	{
+		OutClusters->clear();
+	}
+	if (NumTriangles == 0)
+		return;
+
+	// triangles of every vertex, and how many of them are not emitted yet
+	vector<uint32_t> Live(InNumVertices, 0);
+	for (uint32_t Index : InOutIndices)
+	{
+		assert(Index < InNumVertices);
+		++Live[Index];
+	}
+	vector<uint32_t> Offsets(InNumVertices + 1, 0);
+	for (uint32_t v = 0; v < InNumVertices; ++v)
+	{
+		Offsets[v + 1] = Offsets[v] + Live[v];
+	}
+	vector<uint32_t> Adjacency(InOutIndices.size());
+	vector<uint32_t> Fill(Offsets.begin(), Offsets.end() - 1);
+	for (uint32_t i = 0; i < InOutIndices.size(); ++i)
+	{
+		Adjacency[Fill[InOutIndices[i]]++] = i / 3;
+	}
+
+	FFifoCache Cache(InNumVertices, InCacheSize);
+	vector<bool> Emitted(NumTriangles, false);
+	vector<uint32_t> DeadEnds;
+	vector<uint32_t> Candidates;
+	vector<uint32_t> Output;
+	Output.reserve(InOutIndices.size());
+	// vertices are scanned in order once the dead end stack is exhausted
+	uint32_t Cursor = 0;
+
+	// Next vertex with live triangles after a dead end, InvalidVertex when all triangles are emitted.
+	auto SkipDeadEnd = [&]()
+	{
+		while (!DeadEnds.empty())
+		{
+			uint32_t Vertex = DeadEnds.back();
+			DeadEnds.pop_back();
+			if (Live[Vertex] > 0)
+				return Vertex;
+		}
+		for (; Cursor < InNumVertices; ++Cursor)
+		{
+			if (Live[Cursor] > 0)
+				return Cursor;
+		}
+		return InvalidVertex;
+	};
+
+	if (OutClusters != nullptr)
+	{
+		OutClusters->push_back(0);
+	}
+	uint32_t Fanning = InOutIndices[0];
+	while (Fanning != InvalidVertex)
+	{
+		// emit the whole fan around the vertex
+		Candidates.clear();
+		for (uint32_t k = Offsets[Fanning]; k < Offsets[Fanning + 1]; ++k)
+		{
+			uint32_t Triangle = Adjacency[k];
+			if (Emitted[Triangle])
+				continue;
+			for (int c = 0; c < 3; ++c)
+			{
+				uint32_t Vertex = InOutIndices[Triangle * 3 + c];
+				Output.push_back(Vertex);
+				DeadEnds.push_back(Vertex);
+				Candidates.push_back(Vertex);
+				--Live[Vertex];
+				Cache.Access(Vertex);
+			}
+			Emitted[Triangle] = true;
+		}
+
+		// the oldest candidate which stays in the cache while its remaining triangles are emitted
+		uint32_t Next = InvalidVertex;
+		int BestPriority = -1;
+		for (uint32_t Vertex : Candidates)
+		{
+			if (Live[Vertex] == 0)
+				continue;
+			int Priority = 0;
+			if (Cache.GetAge(Vertex) + 2 * Live[Vertex] <= (uint32_t)InCacheSize)
+			{
+				Priority = (int)Cache.GetAge(Vertex);
+			}
+			if (Priority > BestPriority)
+			{
+				BestPriority = Priority;
+				Next = Vertex;
+			}
+		}
+		if (Next == InvalidVertex)
+		{
+			Next = SkipDeadEnd();
+			// continuing elsewhere starts over with a mostly cold cache
+			if (Next != InvalidVertex && OutClusters != nullptr && OutClusters->back() != Output.size() / 3)
+			{
+				OutClusters->push_back((uint32_t)(Output.size() / 3));
+			}
+		}
+		Fanning = Next;
+	}
+
+	assert(Output.size() == InOutIndices.size());
+	InOutIndices.swap(Output);
+}
+
+void CMeshOptimizer::OptimizeOverdraw(vector<uint32_t>& InOutIndices, const vector<uint32_t>& InClusters, const void* InPositions,
+	size_t InPositionStride, uint32_t InNumVertices, float InThreshold, int InCacheSize)
+{
+	uint32_t NumTriangles = (uint32_t)(InOutIndices.size() / 3);
+	if (NumTriangles == 0 || InClusters.empty())
+		return;
+	assert(InClusters[0] == 0);
+
+	// split the clusters where the triangles so far reached nearly the cache efficiency of the whole cluster
+	FFifoCache Cache(InNumVertices, InCacheSize);
+	vector<uint32_t> Clusters;
+	for (size_t c = 0; c < InClusters.size(); ++c)
+	{
+		uint32_t Start = InClusters[c];
+		uint32_t End = c + 1 < InClusters.size() ? InClusters[c + 1] : NumTriangles;
+
+		Cache.Flush();
+		uint32_t ClusterMisses = 0;
+		for (uint32_t i = Start * 3; i < End * 3; ++i)
+		{
+			ClusterMisses += Cache.Access(InOutIndices[i]) ? 1 : 0;
+		}
+		float ClusterThreshold = InThreshold * ClusterMisses / (End - Start);
+
+		Cache.Flush();
+		Clusters.push_back(Start);
+		uint32_t Misses = 0;
+		uint32_t Triangles = 0;
+		for (uint32_t t = Start; t < End; ++t)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Misses += Cache.Access(InOutIndices[t * 3 + k]) ? 1 : 0;
+			}
+			++Triangles;
+			if (t + 1 < End && Misses <= ClusterThreshold * Triangles)
+			{
+				Clusters.push_back(t + 1);
+				Cache.Flush();
+				Misses = 0;
+				Triangles = 0;
+			}
+		}
+	}
+
+	// area weighted centers and normals of the clusters and of the mesh
+	const uint8_t* pPositions = static_cast<const uint8_t*>(InPositions);
+	size_t NumClusters = Clusters.size();
+	vector<float> Centers(NumClusters * 3, 0.f);
+	vector<float> Normals(NumClusters * 3, 0.f);
+	float MeshCenter[3] = { 0, 0, 0 };
+	float MeshArea = 0;
+	for (size_t c = 0; c < NumClusters; ++c)
+	{
+		uint32_t End = c + 1 < NumClusters ? Clusters[c + 1] : NumTriangles;
+		float ClusterArea = 0;
+		for (uint32_t t = Clusters[c]; t < End; ++t)
+		{
+			float P0[3], P1[3], P2[3];
+			LoadPosition(pPositions, InPositionStride, InOutIndices[t * 3 + 0], P0);
+			LoadPosition(pPositions, InPositionStride, InOutIndices[t * 3 + 1], P1);
+			LoadPosition(pPositions, InPositionStride, InOutIndices[t * 3 + 2], P2);
+			float E1[3] = { P1[0] - P0[0], P1[1] - P0[1], P1[2] - P0[2] };
+			float E2[3] = { P2[0] - P0[0], P2[1] - P0[1], P2[2] - P0[2] };
+			float N[3] = { E1[1] * E2[2] - E1[2] * E2[1], E1[2] * E2[0] - E1[0] * E2[2], E1[0] * E2[1] - E1[1] * E2[0] };
+			float Area = sqrtf(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+			for (int k = 0; k < 3; ++k)
+			{
+				float Center = (P0[k] + P1[k] + P2[k]) / 3;
+				Centers[c * 3 + k] += Center * Area;
+				Normals[c * 3 + k] += N[k];
+				MeshCenter[k] += Center * Area;
+			}
+			ClusterArea += Area;
+		}
+		for (int k = 0; k < 3; ++k)
+		{
+			Centers[c * 3 + k] = ClusterArea > 0 ? Centers[c * 3 + k] / ClusterArea : 0.f;
+		}
+		MeshArea += ClusterArea;
+	}
+	for (int k = 0; k < 3; ++k)
+	{
+		MeshCenter[k] = MeshArea > 0 ? MeshCenter[k] / MeshArea : 0.f;
+	}
+
+	// clusters facing away from the center occlude those facing towards it
+	vector<float> Keys(NumClusters);
+	vector<uint32_t> Order(NumClusters);
+	for (size_t c = 0; c < NumClusters; ++c)
+	{
+		const float* N = &Normals[c * 3];
+		float Length = sqrtf(N[0] * N[0] + N[1] * N[1] + N[2] * N[2]);
+		float Dot = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			Dot += (Centers[c * 3 + k] - MeshCenter[k]) * N[k];
+		}
+		Keys[c] = Length > 0 ? Dot / Length : 0.f;
+		Order[c] = (uint32_t)c;
+	}
+	stable_sort(Order.begin(), Order.end(), [&Keys](uint32_t A, uint32_t B) { return Keys[A] > Keys[B]; });
+
+	vector<uint32_t> Output;
+	Output.reserve(InOutIndices.size());
+	for (uint32_t c : Order)
+	{
+		uint32_t End = c + 1 < NumClusters ? Clusters[c + 1] : NumTriangles;
+		Output.insert(Output.end(), InOutIndices.begin() + Clusters[c] * 3, InOutIndices.begin() + End * 3);
+	}
+	InOutIndices.swap(Output);
+}
+
+uint32_t CMeshOptimizer::OptimizeVertexFetch(vector<uint32_t>& InOutIndices, void* InOutVertices, uint32_t InNumVertices,
+	uint32_t InStride)
+{
+	vector<uint32_t> Remap(InNumVertices, InvalidVertex);
+	uint32_t NumUsed = 0;
+	for (uint32_t& Index : InOutIndices)
+	{
+		assert(Index < InNumVertices);
+		if (Remap[Index] == InvalidVertex)
+		{
+			Remap[Index] = NumUsed++;
+		}
+		Index = Remap[Index];
+	}
+	uint32_t NumMapped = NumUsed;
+	for (uint32_t& Target : Remap)
+	{
+		if (Target == InvalidVertex)
+		{
+			Target = NumMapped++;
+		}
+	}
+
+	uint8_t* pVertices = static_cast<uint8_t*>(InOutVertices);
+	vector<uint8_t> Source(pVertices, pVertices + (size_t)InNumVertices * InStride);
+	for (uint32_t v = 0; v < InNumVertices; ++v)
+	{
+		memcpy(pVertices + (size_t)Remap[v] * InStride, &Source[(size_t)v * InStride], InStride);
+	}
+	return NumUsed;
+}
+
+FVertexCacheStats CMeshOptimizer::AnalyzeVertexCache(const uint32_t* InIndices, size_t InNumIndices, uint32_t InNumVertices,
+	int InCacheSize)
+{
+	FFifoCache Cache(InNumVertices, InCacheSize);
+	vector<bool> Referenced(InNumVertices, false);
+	FVertexCacheStats Stats;
+	for (size_t i = 0; i < InNumIndices; ++i)
+	{
+		uint32_t Index = InIndices[i];
+		assert(Index < InNumVertices);
+		Stats.mNumTransformed += Cache.Access(Index) ? 1 : 0;
+		if (!Referenced[Index])
+		{
+			Referenced[Index] = true;
+			++Stats.mNumVertices;
+		}
+	}
+	Stats.mNumTriangles = InNumIndices / 3;
+	Stats.mACMR = Stats.mNumTriangles > 0 ? (double)Stats.mNumTransformed / Stats.mNumTriangles : 0;
+	Stats.mATVR = Stats.mNumVertices > 0 ? (double)Stats.mNumTransformed / Stats.mNumVertices : 0;
+	return Stats;
+}
+
+bool CMeshOptimizer::OptimizeSdkMesh(vector<uint8_t>& InOutData, FMeshOptimizeReport& OutReport)
+{
+	auto StartTime = chrono::steady_clock::now();
+	OutReport = FMeshOptimizeReport();
+
+	CSdkMeshFile File;
+	if (File.OpenMemory(InOutData.data(), InOutData.size()) != ESdkMeshError::None)
+		return false;
+	uint8_t* pData = InOutData.data();
+
+	// vertices can only be reordered when no other mesh sees the buffers
+	vector<int> VertexBufferUsers(File.GetNumVertexBuffers(), 0);
+	vector<int> IndexBufferUsers(File.GetNumIndexBuffers(), 0);
+	for (uint32_t m = 0; m < File.GetNumMeshes(); ++m)
+	{
+		const FSdkMeshMesh& Mesh = File.GetMesh(m);
+		for (uint32_t Stream = 0; Stream < Mesh.mNumVertexBuffers; ++Stream)
+		{
+			++VertexBufferUsers[Mesh.mVertexBuffers[Stream]];
+		}
+		++IndexBufferUsers[Mesh.mIndexBuffer];
+	}
+
+	vector<uint32_t> Indices;
+	vector<uint32_t> Clusters;
+	vector<uint32_t> MeshIndices;
+	for (uint32_t m = 0; m < File.GetNumMeshes(); ++m)
+	{
+		const FSdkMeshMesh& Mesh = File.GetMesh(m);
+		const FSdkMeshVertexBufferHeader& VertexBuffer = File.GetVertexBufferHeader(Mesh.mVertexBuffers[0]);
+		const FSdkMeshIndexBufferHeader& IndexBuffer = File.GetIndexBufferHeader(Mesh.mIndexBuffer);
+		bool b32Bit = IndexBuffer.mIndexType == 1;
+		uint8_t* pIndices = pData + IndexBuffer.mDataOffset;
+		uint8_t* pVertices = pData + VertexBuffer.mDataOffset;
+		uint32_t Stride = (uint32_t)VertexBuffer.mStrideBytes;
+
+		// overdraw sorting needs float3 positions in the first stream
+		const FSdkMeshVertexElement* pPosition = nullptr;
+		for (const FSdkMeshVertexElement* pElement = VertexBuffer.mDecl; pElement->mStream != 0xff; ++pElement)
+		{
+			if (pElement->mStream == 0 && pElement->mUsage == DeclUsagePosition && pElement->mType == DeclTypeFloat3
+				&& pElement->mOffset + sizeof(float) * 3 <= Stride)
+			{
+				pPosition = pElement;
+				break;
+			}
+		}
+
+		bool bReorderVertices = Mesh.mNumVertexBuffers == 1 && VertexBufferUsers[Mesh.mVertexBuffers[0]] == 1
+			&& IndexBufferUsers[Mesh.mIndexBuffer] == 1;
+		for (uint32_t s = 0; s < Mesh.mNumSubsets; ++s)
+		{
+			const FSdkMeshSubset& Subset = File.GetSubset(m, s);
+			// indices are relative to the base vertex of the subset
+			uint32_t NumVertices = (uint32_t)(VertexBuffer.mNumVertices - Subset.mVertexStart);
+			ReadIndices(pIndices, b32Bit, Subset.mIndexStart, Subset.mIndexCount, Indices);
+			bool bValid = Subset.mPrimitiveType == PrimitiveTriangleList && Indices.size() % 3 == 0
+				&& all_of(Indices.begin(), Indices.end(), [NumVertices](uint32_t Index) { return Index < NumVertices; });
+			if (!bValid)
+			{
+				++OutReport.mNumSkippedSubsets;
+				bReorderVertices = false;
+				continue;
+			}
+			bReorderVertices = bReorderVertices && Subset.mVertexStart == 0;
+
+			OutReport.mBefore.Accumulate(AnalyzeVertexCache(Indices.data(), Indices.size(), NumVertices, DefaultCacheSize));
+			OptimizeVertexCache(Indices, NumVertices, DefaultCacheSize, &Clusters);
+			if (pPosition != nullptr)
+			{
+				const uint8_t* pPositions = pVertices + Subset.mVertexStart * Stride + pPosition->mOffset;
+				OptimizeOverdraw(Indices, Clusters, pPositions, Stride, NumVertices, DefaultOverdrawThreshold, DefaultCacheSize);
+			}
+			OutReport.mAfter.Accumulate(AnalyzeVertexCache(Indices.data(), Indices.size(), NumVertices, DefaultCacheSize));
+			WriteIndices(pIndices, b32Bit, Subset.mIndexStart, Indices);
+			++OutReport.mNumOptimizedSubsets;
+		}
+
+		if (!bReorderVertices || Mesh.mNumSubsets == 0)
+			continue;
+
+		// all subsets share one remapping of the whole buffer, in the order they are drawn
+		MeshIndices.clear();
+		for (uint32_t s = 0; s < Mesh.mNumSubsets; ++s)
+		{
+			const FSdkMeshSubset& Subset = File.GetSubset(m, s);
+			ReadIndices(pIndices, b32Bit, Subset.mIndexStart, Subset.mIndexCount, Indices);
+			MeshIndices.insert(MeshIndices.end(), Indices.begin(), Indices.end());
+		}
+		OptimizeVertexFetch(MeshIndices, pVertices, (uint32_t)VertexBuffer.mNumVertices, Stride);
+		size_t Offset = 0;
+		for (uint32_t s = 0; s < Mesh.mNumSubsets; ++s)
+		{
+			// the subsets belong to InOutData, used vertices may now lie anywhere in the buffer
+			FSdkMeshSubset& Subset = const_cast<FSdkMeshSubset&>(File.GetSubset(m, s));
+			Indices.assign(MeshIndices.begin() + Offset, MeshIndices.begin() + Offset + (size_t)Subset.mIndexCount);
+			WriteIndices(pIndices, b32Bit, Subset.mIndexStart, Indices);
+			Offset += (size_t)Subset.mIndexCount;
+			Subset.mVertexCount = VertexBuffer.mNumVertices;
+		}
+		++OutReport.mNumReorderedVertexBuffers;
+	}
+
+	OutReport.mMilliseconds = MillisecondsSince(StartTime);
+	return true;
+}
+
+bool CMeshOptimizer::OptimizeSdkMeshFile(const string& InFileName, const string& OutFileName, FMeshOptimizeReport& OutReport)
+{
+	vector<uint8_t> Data;
+	{
+		CSdkMeshFile File;
+		if (File.Open(InFileName) != ESdkMeshError::None)
+			return false;
+		uint64_t Size = File.GetHeader().mHeaderSize + File.GetHeader().mNonBufferDataSize + File.GetHeader().mBufferDataSize;
+		const uint8_t* pData = reinterpret_cast<const uint8_t*>(&File.GetHeader());
+		Data.assign(pData, pData + Size);
+	}
+	if (!OptimizeSdkMesh(Data, OutReport))
+		return false;
+
+	FILE* fp = OpenFile(OutFileName.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+	bool bWritten = fwrite(Data.data(), 1, Data.size(), fp) == Data.size();
+	fclose(fp);
+	return bWritten;
+}
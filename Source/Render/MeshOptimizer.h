@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Post-transform vertex cache behaviour of an index buffer, from a FIFO cache simulation.
+struct FVertexCacheStats
+{
+	FVertexCacheStats();
+
+	// Add the counts of another index buffer.
+	void Accumulate(const FVertexCacheStats& InStats);
+
+	// vertex shader invocations
+	uint64_t mNumTransformed;
+	uint64_t mNumTriangles;
+	// distinct vertices referenced
+	uint64_t mNumVertices;
+	// average cache miss ratio, transformed vertices per triangle, 0.5 at best for large regular meshes
+	double mACMR;
+	// average transform to vertex ratio, 1 at best
+	double mATVR;
+};
+
+// Results of optimizing all meshes of a .sdkmesh file.
+struct FMeshOptimizeReport
+{
+	FMeshOptimizeReport();
+
+	// all triangle list subsets before and after
+	FVertexCacheStats mBefore;
+	FVertexCacheStats mAfter;
+	int mNumOptimizedSubsets;
+	// subsets which are not triangle lists
+	int mNumSkippedSubsets;
+	// vertex buffers reordered for fetch, which needs a buffer used by a single mesh
+	int mNumReorderedVertexBuffers;
+	double mMilliseconds;
+};
+
+// Reorders triangle lists for the post-transform vertex cache, then sorts clusters of triangles against overdraw and
+// finally reorders vertices in the order they are first used, so they are fetched linearly. The triangle order
+// follows Tipsify of Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+//
+// Indices are 32 bit and relative to the first vertex of the mesh.
+class CMeshOptimizer
+{
+public:
+	// FIFO size of the simulated cache and of Tipsify, a conservative size for recent hardware
+	static const int DefaultCacheSize = 16;
+	// clusters are split while their own ACMR stays below this factor of the whole mesh's
+	static const float DefaultOverdrawThreshold;
+
+	// Reorder triangles for vertex cache reuse. OutClusters receives the first triangle of each run which starts
+	// over from a cold cache, the clusters of OptimizeOverdraw.
+	static void OptimizeVertexCache(vector<uint32_t>& InOutIndices, uint32_t InNumVertices, int InCacheSize,
+		vector<uint32_t>* OutClusters = nullptr);
+
+	// Split the clusters of OptimizeVertexCache where it costs little cache efficiency and sort them so that
+	// triangles facing away from the mesh center come first, they are likely to occlude the others from any view.
+	// Positions are three floats every InPositionStride bytes.
+	static void OptimizeOverdraw(vector<uint32_t>& InOutIndices, const vector<uint32_t>& InClusters, const void* InPositions,
+		size_t InPositionStride, uint32_t InNumVertices, float InThreshold, int InCacheSize);
+
+	// Reorder vertices in the order the indices first use them and remap the indices, unused vertices move to the
+	// end. Returns the number of used vertices.
+	static uint32_t OptimizeVertexFetch(vector<uint32_t>& InOutIndices, void* InOutVertices, uint32_t InNumVertices,
+		uint32_t InStride);
+
+	// Simulate a FIFO post-transform cache over a triangle list.
+	static FVertexCacheStats AnalyzeVertexCache(const uint32_t* InIndices, size_t InNumIndices, uint32_t InNumVertices,
+		int InCacheSize);
+
+	// Optimize every triangle list subset of a .sdkmesh file in memory, which must be 8 byte aligned. False if the
+	// file is not valid.
+	static bool OptimizeSdkMesh(vector<uint8_t>& InOutData, FMeshOptimizeReport& OutReport);
+	// Write an optimized copy of a .sdkmesh file, for meshes optimized offline.
+	static bool OptimizeSdkMeshFile(const string& InFileName, const string& OutFileName, FMeshOptimizeReport& OutReport);
+};
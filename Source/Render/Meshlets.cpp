@@ -0,0 +1,365 @@
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "SdkMeshFile.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// PT_TRIANGLE_LIST of SDKMESH_PRIMITIVE_TYPE
+	const uint32_t PrimitiveTriangleList = 0;
+	// D3DDECLUSAGE_POSITION and D3DDECLTYPE_FLOAT3 of vertex declarations
+	const uint8_t DeclUsagePosition = 0;
+	const uint8_t DeclTypeFloat3 = 2;
+	// marks vertices not in the meshlet being built
+	const uint8_t NotInMeshlet = 0xff;
+	// cone cutoff of meshlets which are never back facing
+	const float NoConeCutoff = 2.f;
+
+	const float* GetPosition(const void* InPositions, size_t InStride, uint32_t InVertex)
+	{
+		return reinterpret_cast<const float*>(static_cast<const uint8_t*>(InPositions) + InVertex * InStride);
+	}
+
+	float Dot(const float A[3], const float B[3])
+	{
+		return A[0] * B[0] + A[1] * B[1] + A[2] * B[2];
+	}
+
+	float DistanceSq(const float A[3], const float B[3])
+	{
+		float D[3] = { A[0] - B[0], A[1] - B[1], A[2] - B[2] };
+		return Dot(D, D);
+	}
+
+	// Bounding sphere of Ritter, from the two points farthest apart along a first guess, grown over the others.
+	void ComputeBoundingSphere(const FMeshletData& InData, const FMeshlet& InMeshlet, const void* InPositions,
+		size_t InStride, float OutCenter[3], float& OutRadius)
+	{
+		const uint32_t* Vertices = &InData.mVertices[InMeshlet.mVertexOffset];
+		const float* First = GetPosition(InPositions, InStride, Vertices[0]);
+		const float* A = First;
+		for (uint32_t i = 1; i < InMeshlet.mNumVertices; ++i)
+		{
+			const float* P = GetPosition(InPositions, InStride, Vertices[i]);
+			if (DistanceSq(P, First) > DistanceSq(A, First))
+			{
+				A = P;
+			}
+		}
+		const float* B = A;
+		for (uint32_t i = 0; i < InMeshlet.mNumVertices; ++i)
+		{
+			const float* P = GetPosition(InPositions, InStride, Vertices[i]);
+			if (DistanceSq(P, A) > DistanceSq(B, A))
+			{
+				B = P;
+			}
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			OutCenter[k] = (A[k] + B[k]) * .5f;
+		}
+		OutRadius = sqrtf(DistanceSq(A, B)) * .5f;
+		for (uint32_t i = 0; i < InMeshlet.mNumVertices; ++i)
+		{
+			const float* P = GetPosition(InPositions, InStride, Vertices[i]);
+			float Distance = sqrtf(DistanceSq(P, OutCenter));
+			if (Distance > OutRadius)
+			{
+				// move the center towards P so the sphere just touches it and the opposite side of the old one
+				float NewRadius = (OutRadius + Distance) * .5f;
+				float Shift = (NewRadius - OutRadius) / Distance;
+				for (int k = 0; k < 3; ++k)
+				{
+					OutCenter[k] += (P[k] - OutCenter[k]) * Shift;
+				}
+				OutRadius = NewRadius;
+			}
+		}
+	}
+
+	// Cone around the average of the triangle normals containing all of them. Triangles are front facing when
+	// clockwise, as the rasterizer states of CRenderStates cull, so the normals point out of left handed meshes.
+	void ComputeNormalCone(const FMeshletData& InData, const FMeshlet& InMeshlet, const void* InPositions,
+		size_t InStride, float OutAxis[3], float& OutCutoff)
+	{
+		const uint32_t* Vertices = &InData.mVertices[InMeshlet.mVertexOffset];
+		const uint8_t* Triangles = &InData.mTriangles[InMeshlet.mTriangleOffset * 3];
+		float Normals[CMeshletBuilder::MaxTriangles][3];
+		uint32_t NumNormals = 0;
+		float Sum[3] = { 0, 0, 0 };
+		for (uint32_t t = 0; t < InMeshlet.mNumTriangles; ++t)
+		{
+			const float* P0 = GetPosition(InPositions, InStride, Vertices[Triangles[t * 3 + 0]]);
+			const float* P1 = GetPosition(InPositions, InStride, Vertices[Triangles[t * 3 + 1]]);
+			const float* P2 = GetPosition(InPositions, InStride, Vertices[Triangles[t * 3 + 2]]);
+			float E1[3] = { P1[0] - P0[0], P1[1] - P0[1], P1[2] - P0[2] };
+			float E2[3] = { P2[0] - P0[0], P2[1] - P0[1], P2[2] - P0[2] };
+			float* N = Normals[NumNormals];
+			N[0] = E1[1] * E2[2] - E1[2] * E2[1];
+			N[1] = E1[2] * E2[0] - E1[0] * E2[2];
+			N[2] = E1[0] * E2[1] - E1[1] * E2[0];
+			float Length = sqrtf(Dot(N, N));
+			// degenerate triangles are never drawn, any facing will do
+			if (Length <= 0)
+				continue;
+			for (int k = 0; k < 3; ++k)
+			{
+				N[k] /= Length;
+				Sum[k] += N[k];
+			}
+			++NumNormals;
+		}
+
+		float SumLength = sqrtf(Dot(Sum, Sum));
+		OutAxis[0] = OutAxis[1] = OutAxis[2] = 0;
+		OutCutoff = NoConeCutoff;
+		if (NumNormals == 0 || SumLength <= 0)
+			return;
+
+		float MinDot = 1;
+		for (int k = 0; k < 3; ++k)
+		{
+			OutAxis[k] = Sum[k] / SumLength;
+		}
+		for (uint32_t i = 0; i < NumNormals; ++i)
+		{
+			MinDot = min(MinDot, Dot(Normals[i], OutAxis));
+		}
+		// a cone of half angle 90 degrees or more has a front facing triangle from every view
+		if (MinDot > 0)
+		{
+			OutCutoff = sqrtf(max(1 - MinDot * MinDot, 0.f));
+		}
+	}
+
+	void FinishMeshlet(FMeshletData& InOutData, FMeshlet& InOutMeshlet, const void* InPositions, size_t InStride)
+	{
+		ComputeBoundingSphere(InOutData, InOutMeshlet, InPositions, InStride, InOutMeshlet.mCenter, InOutMeshlet.mRadius);
+		ComputeNormalCone(InOutData, InOutMeshlet, InPositions, InStride, InOutMeshlet.mConeAxis, InOutMeshlet.mConeCutoff);
+		InOutData.mMeshlets.push_back(InOutMeshlet);
+	}
+}
+
+void FMeshletData::Clear()
+{
+	mMeshlets.clear();
+	mVertices.clear();
+	mTriangles.clear();
+	mIndices.clear();
+}
+
+FMeshletCullStats::FMeshletCullStats()
+	: mNumMeshlets(0)
+	, mNumFrustumCulled(0)
+	, mNumBackfaceCulled(0)
+	, mNumTriangles(0)
+	, mNumVisibleTriangles(0)
+{
+
+}
+
+void FMeshletCullStats::Accumulate(const FMeshletCullStats& InStats)
+{
+	mNumMeshlets += InStats.mNumMeshlets;
+	mNumFrustumCulled += InStats.mNumFrustumCulled;
+	mNumBackfaceCulled += InStats.mNumBackfaceCulled;
+	mNumTriangles += InStats.mNumTriangles;
+	mNumVisibleTriangles += InStats.mNumVisibleTriangles;
+}
+
+void CMeshletBuilder::Build(const uint32_t* InIndices, size_t InNumIndices, const void* InPositions, size_t InPositionStride,
+	uint32_t InNumVertices, FMeshletData& OutMeshlets)
+{
+	assert(InNumIndices % 3 == 0);
+
+	// position of each mesh vertex in the meshlet being built
+	vector<uint8_t> LocalVertices(InNumVertices, NotInMeshlet);
+	FMeshlet Meshlet = {};
+	Meshlet.mVertexOffset = (uint32_t)OutMeshlets.mVertices.size();
+	Meshlet.mTriangleOffset = (uint32_t)OutMeshlets.GetNumTriangles();
+	for (size_t i = 0; i < InNumIndices; i += 3)
+	{
+		const uint32_t* Triangle = &InIndices[i];
+		assert(Triangle[0] < InNumVertices && Triangle[1] < InNumVertices && Triangle[2] < InNumVertices);
+		uint32_t NumNewVertices = (LocalVertices[Triangle[0]] == NotInMeshlet)
+			+ (LocalVertices[Triangle[1]] == NotInMeshlet && Triangle[1] != Triangle[0])
+			+ (LocalVertices[Triangle[2]] == NotInMeshlet && Triangle[2] != Triangle[0] && Triangle[2] != Triangle[1]);
+
+		// start the next meshlet when the triangle does not fit
+		if (Meshlet.mNumVertices + NumNewVertices > MaxVertices || Meshlet.mNumTriangles == MaxTriangles)
+		{
+			FinishMeshlet(OutMeshlets, Meshlet, InPositions, InPositionStride);
+			for (uint32_t v = 0; v < Meshlet.mNumVertices; ++v)
+			{
+				LocalVertices[OutMeshlets.mVertices[Meshlet.mVertexOffset + v]] = NotInMeshlet;
+			}
+			Meshlet = FMeshlet();
+			Meshlet.mVertexOffset = (uint32_t)OutMeshlets.mVertices.size();
+			Meshlet.mTriangleOffset = (uint32_t)OutMeshlets.GetNumTriangles();
+		}
+
+		for (int k = 0; k < 3; ++k)
+		{
+			uint8_t& Local = LocalVertices[Triangle[k]];
+			if (Local == NotInMeshlet)
+			{
+				Local = (uint8_t)Meshlet.mNumVertices++;
+				OutMeshlets.mVertices.push_back(Triangle[k]);
+			}
+			OutMeshlets.mTriangles.push_back(Local);
+			OutMeshlets.mIndices.push_back(Triangle[k]);
+		}
+		++Meshlet.mNumTriangles;
+	}
+	if (Meshlet.mNumTriangles > 0)
+	{
+		FinishMeshlet(OutMeshlets, Meshlet, InPositions, InPositionStride);
+	}
+}
+
+bool CMeshletBuilder::BuildSdkMesh(const CSdkMeshFile& InFile, uint32_t InMesh, FMeshletData& OutMeshlets)
+{
+	assert(InFile.IsOpen() && InMesh < InFile.GetNumMeshes());
+	OutMeshlets.Clear();
+
+	const FSdkMeshMesh& Mesh = InFile.GetMesh(InMesh);
+	FSdkMeshVertexView Vertices = InFile.GetVertices(Mesh.mVertexBuffers[0]);
+	FSdkMeshIndexView Indices = InFile.GetIndices(Mesh.mIndexBuffer);
+	const FSdkMeshVertexElement* pPosition = nullptr;
+	for (const FSdkMeshVertexElement* pElement = Vertices.mDecl; pElement->mStream != 0xff; ++pElement)
+	{
+		if (pElement->mStream == 0 && pElement->mUsage == DeclUsagePosition && pElement->mType == DeclTypeFloat3
+			&& pElement->mOffset + sizeof(float) * 3 <= Vertices.mStride)
+		{
+			pPosition = pElement;
+			break;
+		}
+	}
+	if (pPosition == nullptr)
+		return false;
+
+	vector<uint32_t> SubsetIndices;
+	for (uint32_t s = 0; s < Mesh.mNumSubsets; ++s)
+	{
+		const FSdkMeshSubset& Subset = InFile.GetSubset(InMesh, s);
+		if (Subset.mPrimitiveType != PrimitiveTriangleList || Subset.mVertexStart != 0 || Subset.mIndexCount % 3 != 0)
+		{
+			OutMeshlets.Clear();
+			return false;
+		}
+		SubsetIndices.resize((size_t)Subset.mIndexCount);
+		for (size_t i = 0; i < SubsetIndices.size(); ++i)
+		{
+			SubsetIndices[i] = Indices[Subset.mIndexStart + i];
+		}
+		Build(SubsetIndices.data(), SubsetIndices.size(), Vertices.mData + pPosition->mOffset, Vertices.mStride,
+			(uint32_t)Vertices.mNumVertices, OutMeshlets);
+	}
+	return true;
+}
+
+void CMeshletCuller::SetupView(const float InWorldViewProj[16], const float InCameraPos[3], FMeshletCullView& OutView)
+{
+	// planes of Gribb and Hartmann from the columns of the matrix, clip = v * M
+	const float* M = InWorldViewProj;
+	for (int k = 0; k < 4; ++k)
+	{
+		float X = M[k * 4 + 0];
+		float Y = M[k * 4 + 1];
+		float Z = M[k * 4 + 2];
+		float W = M[k * 4 + 3];
+		OutView.mPlanes[0][k] = W + X;
+		OutView.mPlanes[1][k] = W - X;
+		OutView.mPlanes[2][k] = W + Y;
+		OutView.mPlanes[3][k] = W - Y;
+		OutView.mPlanes[4][k] = Z;
+		OutView.mPlanes[5][k] = W - Z;
+	}
+	for (float* Plane : OutView.mPlanes)
+	{
+		float Length = sqrtf(Dot(Plane, Plane));
+		float InvLength = Length > 0 ? 1 / Length : 0;
+		for (int k = 0; k < 4; ++k)
+		{
+			Plane[k] *= InvLength;
+		}
+	}
+	memcpy(OutView.mCameraPos, InCameraPos, sizeof(OutView.mCameraPos));
+}
+
+bool CMeshletCuller::IsOutsideFrustum(const FMeshlet& InMeshlet, const FMeshletCullView& InView)
+{
+	for (const float* Plane : InView.mPlanes)
+	{
+		if (Dot(Plane, InMeshlet.mCenter) + Plane[3] < -InMeshlet.mRadius)
+			return true;
+	}
+	return false;
+}
+
+bool CMeshletCuller::IsBackfacing(const FMeshlet& InMeshlet, const FMeshletCullView& InView)
+{
+	// every point P of the sphere must see the cone axis within 90 degrees minus the cone angle, that is
+	// dot(P - Camera, Axis) >= Cutoff * |P - Camera|, which holds if it holds for the center with the radius added
+	// to both sides
+	float ToCenter[3] =
+	{
+		InMeshlet.mCenter[0] - InView.mCameraPos[0],
+		InMeshlet.mCenter[1] - InView.mCameraPos[1],
+		InMeshlet.mCenter[2] - InView.mCameraPos[2],
+	};
+	float Distance = sqrtf(Dot(ToCenter, ToCenter));
+	return Dot(ToCenter, InMeshlet.mConeAxis) >= InMeshlet.mConeCutoff * Distance + InMeshlet.mRadius * (1 + InMeshlet.mConeCutoff);
+}
+
+size_t CMeshletCuller::Cull(const FMeshletData& InMeshlets, const FMeshletCullView& InView, vector<uint32_t>& OutIndices,
+	FMeshletCullStats* OutStats)
+{
+	OutIndices.clear();
+	FMeshletCullStats Stats;
+	Stats.mNumMeshlets = (uint32_t)InMeshlets.mMeshlets.size();
+	Stats.mNumTriangles = InMeshlets.GetNumTriangles();
+	// triangles of the visible meshlets not copied yet
+	auto RunBegin = InMeshlets.mIndices.begin();
+	auto RunEnd = RunBegin;
+	for (const FMeshlet& Meshlet : InMeshlets.mMeshlets)
+	{
+		bool bCulled = true;
+		if (IsOutsideFrustum(Meshlet, InView))
+		{
+			++Stats.mNumFrustumCulled;
+		}
+		else if (IsBackfacing(Meshlet, InView))
+		{
+			++Stats.mNumBackfaceCulled;
+		}
+		else
+		{
+			bCulled = false;
+		}
+
+		auto MeshletBegin = InMeshlets.mIndices.begin() + (size_t)Meshlet.mTriangleOffset * 3;
+		if (bCulled || MeshletBegin != RunEnd)
+		{
+			OutIndices.insert(OutIndices.end(), RunBegin, RunEnd);
+			RunBegin = RunEnd = MeshletBegin;
+		}
+		if (!bCulled)
+		{
+			RunEnd = MeshletBegin + (size_t)Meshlet.mNumTriangles * 3;
+			Stats.mNumVisibleTriangles += Meshlet.mNumTriangles;
+		}
+	}
+	OutIndices.insert(OutIndices.end(), RunBegin, RunEnd);
+
+	if (OutStats != nullptr)
+	{
+		*OutStats = Stats;
+	}
+	return OutIndices.size();
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+class CSdkMeshFile;
+
+// A cluster of a triangle list with the bounds its culling needs.
+struct FMeshlet
+{
+	// first entries of the meshlet in FMeshletData::mVertices and FMeshletData::mTriangles
+	uint32_t mVertexOffset;
+	uint32_t mTriangleOffset;
+	uint32_t mNumVertices;
+	uint32_t mNumTriangles;
+	// bounding sphere
+	float mCenter[3];
+	float mRadius;
+	// normal cone, mConeCutoff is the sine of its half angle, greater than 1 if the triangles face too many
+	// directions for any view to see only their backs
+	float mConeAxis[3];
+	float mConeCutoff;
+};
+
+// Meshlets of a mesh, sharing their vertex and triangle arrays.
+struct FMeshletData
+{
+	// Remove all meshlets, keeping the memory.
+	void Clear();
+	// Triangles of all meshlets.
+	size_t GetNumTriangles() const { return mTriangles.size() / 3; }
+
+	vector<FMeshlet> mMeshlets;
+	// mesh vertex of each meshlet vertex
+	vector<uint32_t> mVertices;
+	// three meshlet vertices per triangle, indices into the meshlet's range of mVertices
+	vector<uint8_t> mTriangles;
+	// the same triangles as mesh indices, meshlet after meshlet in the order of the source triangles, for drawing
+	// visible meshlets without a mesh shader
+	vector<uint32_t> mIndices;
+};
+
+// View of a meshlet culling pass, in the object space of the mesh so meshlet bounds are used as they are.
+struct FMeshletCullView
+{
+	// a x + b y + c z + d >= 0 inside, normalized: left, right, bottom, top, near, far
+	float mPlanes[6][4];
+	float mCameraPos[3];
+};
+
+// Meshlets and triangles a culling pass removed.
+struct FMeshletCullStats
+{
+	FMeshletCullStats();
+
+	// Add the counts of another pass.
+	void Accumulate(const FMeshletCullStats& InStats);
+
+	uint32_t mNumMeshlets;
+	uint32_t mNumFrustumCulled;
+	uint32_t mNumBackfaceCulled;
+	uint64_t mNumTriangles;
+	uint64_t mNumVisibleTriangles;
+};
+
+// Splits triangle lists into meshlets of at most MaxVertices vertices and MaxTriangles triangles, the limits of
+// mesh shader outputs, in the order of the triangles, so an index buffer optimized by CMeshOptimizer yields
+// compact meshlets. Each meshlet gets a bounding sphere and a cone bounding its triangle normals.
+class CMeshletBuilder
+{
+public:
+	static const uint32_t MaxVertices = 64;
+	static const uint32_t MaxTriangles = 124;
+
+	// Append the meshlets of a triangle list. Positions are three floats every InPositionStride bytes.
+	static void Build(const uint32_t* InIndices, size_t InNumIndices, const void* InPositions, size_t InPositionStride,
+		uint32_t InNumVertices, FMeshletData& OutMeshlets);
+
+	// Build the meshlets of a mesh of a .sdkmesh file, all of its subsets. False if a subset is not a triangle
+	// list starting at the first vertex or the vertices have no float3 positions.
+	static bool BuildSdkMesh(const CSdkMeshFile& InFile, uint32_t InMesh, FMeshletData& OutMeshlets);
+};
+
+// Culls meshlets against the view frustum and with their normal cones, and writes the indices of the others.
+class CMeshletCuller
+{
+public:
+	// View of a camera at InCameraPos, both in the object space of the mesh. InWorldViewProj is the row major
+	// object to clip space matrix of row vectors, as DirectXMath stores it, with clip depth in [0, 1].
+	static void SetupView(const float InWorldViewProj[16], const float InCameraPos[3], FMeshletCullView& OutView);
+
+	// A meshlet is outside the frustum.
+	static bool IsOutsideFrustum(const FMeshlet& InMeshlet, const FMeshletCullView& InView);
+	// All triangles of a meshlet face away from the camera.
+	static bool IsBackfacing(const FMeshlet& InMeshlet, const FMeshletCullView& InView);
+
+	// Write the mesh indices of the meshlets which are not culled, copying runs of consecutive visible meshlets at
+	// once. Returns the number of indices.
+	static size_t Cull(const FMeshletData& InMeshlets, const FMeshletCullView& InView, vector<uint32_t>& OutIndices,
+		FMeshletCullStats* OutStats = nullptr);
+};
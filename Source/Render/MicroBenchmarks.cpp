@@ -0,0 +1,181 @@
+#include "MicroBenchmarks.h"
+#include "ModuleBenchmarks.h"
+#include "RenderCommands.h"
+#include "VertexQuantization.h"
+#include "../CpuGI/SGReflectKernel.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// End a result line with its check, clearing bOutPassed when it failed.
+	void EndLine(FILE* OutLog, bool bInValid, bool& bOutPassed)
+	{
+		fprintf(OutLog, ": %s\n", bInValid ? "ok" : "FAILED");
+		bOutPassed = bOutPassed && bInValid;
+	}
+
+	// Draws, binds and uploads of a recorded frame.
+	void PrintStats(FILE* OutLog, const char* InName, const FRenderStats& InStats)
+	{
+		fprintf(OutLog, ", %s %u draws %u binds %u redundant %u skipped %u uploads", InName, InStats.mDraws,
+			InStats.mStateChanges, InStats.mRedundantBinds, InStats.mSkippedBinds, InStats.mUploads);
+	}
+}
+
+FMicroBenchSettings::FMicroBenchSettings()
+	: mScratchDirectory(".")
+	, mMeshFile("mesh/ball.sdkmesh")
+{
+
+}
+
+bool CMicroBenchmarks::Run(const FMicroBenchSettings& InSettings, FILE* OutLog)
+{
+	bool bPassed = true;
+
+	// scene data
+	FRectStoreBenchResult Store = CModuleBenchmarks::RunRectStore(10000);
+	fprintf(OutLog, "RectStore %d rects: add %.1f ns, set %.1f ns, pack %.1f ns, remove %.1f ns", Store.mNumRects,
+		Store.mAddNs, Store.mSetNs, Store.mPackNs, Store.mRemoveNs);
+	EndLine(OutLog, Store.bValid, bPassed);
+
+	// build and refit grow with the scene, queries should not
+	const int BvhSizes[] = { 100, 1000, 10000, 100000 };
+	for (int NumRects : BvhSizes)
+	{
+		// the brute force reference visits every rect per query, fewer queries keep large scenes at about a second
+		int NumQueries = min(10000, 20000000 / NumRects);
+		FRectBvhBenchResult Bvh = CModuleBenchmarks::RunRectBvh(NumRects, NumQueries);
+		fprintf(OutLog, "RectBvh %d rects: %d nodes, build %.3f ms, refit %.3f ms, query %.1f ns, brute force %.1f ns, "
+			"%.1f results", Bvh.mNumRects, Bvh.mNumNodes, Bvh.mBuildMs, Bvh.mRefitMs, Bvh.mQueryNs, Bvh.mBruteForceNs,
+			Bvh.mAvgResults);
+		EndLine(OutLog, Bvh.bMatchesBruteForce, bPassed);
+	}
+
+	FReflectorLinkBenchResult Linker = CModuleBenchmarks::RunReflectorLinker(2000);
+	fprintf(OutLog, "ReflectorLinker %d rects: build %.3f ms, static update %.1f us, moving update %.1f us, "
+		"%d relinked, %.1f links", Linker.mNumRects, Linker.mBuildMs, Linker.mStaticUpdateUs, Linker.mMovingUpdateUs,
+		Linker.mRelinkedReceivers, Linker.mAvgLinks);
+	EndLine(OutLog, Linker.bMatchesRebuild, bPassed);
+
+	FTransformBenchResult Transforms = CModuleBenchmarks::RunTransformHierarchy(10000);
+	fprintf(OutLog, "TransformHierarchy %d nodes: full %.1f ns, partial %.1f ns, static %.1f us, uncached %.1f ns",
+		Transforms.mNumNodes, Transforms.mFullUpdateNs, Transforms.mPartialUpdateNs, Transforms.mStaticUpdateUs,
+		Transforms.mUncachedNs);
+	EndLine(OutLog, Transforms.bMatchesUncached, bPassed);
+
+	// frame update of 50k instances from 1 thread to every core, and to 4 threads at least to check the results
+	int NumCores = max((int)thread::hardware_concurrency(), 1);
+	vector<FJobScalingResult> Scaling = CModuleBenchmarks::RunJobScaling(50000, max(NumCores, 4));
+	for (const FJobScalingResult& Result : Scaling)
+	{
+		fprintf(OutLog, "JobSystem 50000 instances, %d threads on %d cores: %.3f ms, %.2fx", Result.mNumThreads, NumCores,
+			Result.mFrameMs, Result.mSpeedup);
+		EndLine(OutLog, Result.bMatchesSingleThread, bPassed);
+	}
+
+	// command recording and submission
+	FRenderCommandBenchResult Commands = CModuleBenchmarks::RunNullRenderBackend(10000);
+	fprintf(OutLog, "NullRenderBackend %d draws: record %.1f ns, execute %.1f ns", Commands.mNumDraws,
+		Commands.mRecordNs, Commands.mExecuteNs);
+	PrintStats(OutLog, "shared", Commands.mStats);
+	PrintStats(OutLog, "per instance", Commands.mPerInstanceStats);
+	EndLine(OutLog, Commands.mStats.mDraws == (uint32_t)Commands.mNumDraws, bPassed);
+
+	FRectInstancingBenchResult Instancing = CModuleBenchmarks::RunRectInstancing(10000);
+	fprintf(OutLog, "RectInstancePacker %d rects: pack %.1f ns", Instancing.mNumRects, Instancing.mPackNs);
+	PrintStats(OutLog, "per draw", Instancing.mPerDrawStats);
+	PrintStats(OutLog, "instanced", Instancing.mInstancedStats);
+	EndLine(OutLog, Instancing.bSingleDraw && Instancing.bTrianglesMatch, bPassed);
+
+	FDrawListBenchResult Draws = CModuleBenchmarks::RunDrawList(10000);
+	fprintf(OutLog, "DrawList %d draws: radix sort %.1f ns, std::sort %.1f ns", Draws.mNumDraws, Draws.mRadixSortNs,
+		Draws.mStdSortNs);
+	PrintStats(OutLog, "unsorted", Draws.mUnsortedStats);
+	PrintStats(OutLog, "sorted", Draws.mSortedStats);
+	EndLine(OutLog, Draws.bSortsMatch, bPassed);
+
+	FStreamingRingBenchResult Ring = CModuleBenchmarks::RunStreamingRing(1000, 3);
+	fprintf(OutLog, "StreamingRing %d frames: %u allocations, %u discards, %llu of %llu bytes wasted, allocate %.1f ns",
+		Ring.mNumFrames, Ring.mAllocations, Ring.mDiscards, (unsigned long long)Ring.mWastedBytes,
+		(unsigned long long)Ring.mBytesAllocated, Ring.mAllocateNs);
+	EndLine(OutLog, Ring.bNoOverlap, bPassed);
+
+	FShaderCacheBenchResult Shaders = CModuleBenchmarks::RunShaderBytecodeCache(InSettings.mScratchDirectory, 100);
+	fprintf(OutLog, "ShaderBytecodeCache %d lookups: disk %.1f us, memory %.1f ns", Shaders.mNumLookups,
+		Shaders.mDiskLookupUs, Shaders.mMemoryLookupNs);
+	EndLine(OutLog, Shaders.bRoundTrips, bPassed);
+
+	FProfilerBenchResult Profiler = CModuleBenchmarks::RunProfiler(20000);
+	fprintf(OutLog, "Profiler %d zones: enabled %.1f ns, disabled %.1f ns, clock %.1f ns", Profiler.mNumZones,
+		Profiler.mZoneNs, Profiler.mDisabledZoneNs, Profiler.mReadTicksNs);
+	// zones stay enabled in shipping builds, so they have to stay this cheap. Virtual machines may trap rdtsc, when
+	// the two clock reads alone take most of the budget a slow zone is the clock's fault and does not fail the run.
+	const double ProfilerZoneBudgetNs = 50.0;
+	bool bClockBound = 2 * Profiler.mReadTicksNs >= .8 * ProfilerZoneBudgetNs;
+	if (Profiler.mZoneNs >= ProfilerZoneBudgetNs && bClockBound)
+	{
+		fprintf(OutLog, ", over budget by the clock");
+	}
+	EndLine(OutLog, Profiler.mZoneNs < ProfilerZoneBudgetNs || bClockBound, bPassed);
+
+	FRenderThreadBenchResult RenderThread = CModuleBenchmarks::RunRenderThread(100, 1.0);
+	fprintf(OutLog, "RenderThread %d frames: simulate %.3f ms, render %.3f ms, overlapped %.3f ms, frame %.3f ms, "
+		"%u hardware threads", RenderThread.mNumFrames, RenderThread.mSimulateMs, RenderThread.mRenderMs,
+		RenderThread.mOverlapMs, RenderThread.mFrameMs, thread::hardware_concurrency());
+	EndLine(OutLog, RenderThread.bOwnThread, bPassed);
+
+	// meshes
+	FSdkMeshLoadBenchResult MeshFile = CModuleBenchmarks::RunSdkMeshLoad(InSettings.mMeshFile, 20);
+	fprintf(OutLog, "SdkMeshFile %s, %llu bytes: read %.1f us, map %.1f us, read + touch %.1f us, map + touch %.1f us",
+		InSettings.mMeshFile.c_str(), (unsigned long long)MeshFile.mFileBytes, MeshFile.mReadCopyUs, MeshFile.mMapUs,
+		MeshFile.mReadCopyTouchUs, MeshFile.mMapTouchUs);
+	EndLine(OutLog, MeshFile.bMatches, bPassed);
+
+	FMeshOptimizeBenchResult Optimize = CModuleBenchmarks::RunMeshOptimizer(256);
+	fprintf(OutLog, "MeshOptimizer %d triangles: ACMR %.3f shuffled, %.3f vertex cache (%.3f ms), %.3f overdraw "
+		"(%.3f ms), vertex fetch %.3f ms", Optimize.mNumTriangles, Optimize.mShuffled.mACMR, Optimize.mVertexCache.mACMR,
+		Optimize.mVertexCacheMs, Optimize.mOverdraw.mACMR, Optimize.mOverdrawMs, Optimize.mVertexFetchMs);
+	EndLine(OutLog, Optimize.mVertexCache.mACMR < Optimize.mShuffled.mACMR, bPassed);
+
+	// the chosen formats have to meet the default tolerances
+	FVertexQuantizeBenchResult Quantize = CModuleBenchmarks::RunVertexQuantizer(100000);
+	FVertexQuantizeSettings QuantizeSettings;
+	fprintf(OutLog, "VertexQuantizer %d vertices: %u of %u bytes, error position %.3g normal %.3g degrees texcoord %.3g, "
+		"encode %.1f ns, decode %.1f ns scalar %.1f ns simd", Quantize.mNumVertices, Quantize.mFormat.mStride,
+		Quantize.mFloatStride, Quantize.mMaxPositionError, Quantize.mMaxNormalErrorDegrees, Quantize.mMaxTexcoordError,
+		Quantize.mEncodeNs, Quantize.mDecodeScalarNs, Quantize.mDecodeSimdNs);
+	EndLine(OutLog, Quantize.mMaxNormalErrorDegrees <= QuantizeSettings.mMaxNormalErrorDegrees
+		&& Quantize.mMaxTexcoordError <= QuantizeSettings.mMaxTexcoordError, bPassed);
+
+	FMeshletBenchResult Meshlets = CModuleBenchmarks::RunMeshlets(256, 16);
+	fprintf(OutLog, "Meshlets %d triangles: %d meshlets of %.1f vertices %.1f triangles, build %.3f ms, "
+		"%llu of %llu triangles visible, cull %.1f us, copy %.1f us, %.2f ns per culled triangle", Meshlets.mNumTriangles,
+		Meshlets.mNumMeshlets, Meshlets.mAverageVertices, Meshlets.mAverageTriangles, Meshlets.mBuildMs,
+		(unsigned long long)Meshlets.mStats.mNumVisibleTriangles, (unsigned long long)Meshlets.mStats.mNumTriangles,
+		Meshlets.mCullUs, Meshlets.mCopyUs, Meshlets.mNsPerCulledTriangle);
+	EndLine(OutLog, Meshlets.mStats.mNumVisibleTriangles < Meshlets.mStats.mNumTriangles, bPassed);
+
+	// lighting
+	FSGLutBenchResult Lut = CModuleBenchmarks::RunSGLightingLut(100000);
+	fprintf(OutLog, "SGLightingLut: error disk lighting %.3g (analytic %.3g) bandwidth %.3g, analytic %.1f ns, lut %.1f ns",
+		Lut.mDiskLightingMaxError, Lut.mDiskLightingAnalyticError, Lut.mBandwidthMaxError, Lut.mAnalyticNs, Lut.mLutNs);
+	EndLine(OutLog, Lut.bBakedDataValid, bPassed);
+
+	// random points stray further from the scalar port than images do, the Lut policy is held to its tables
+	vector<FSGKernelBenchResult> Kernels = CModuleBenchmarks::RunSGReflectKernel(4096, 8);
+	for (const FSGKernelBenchResult& Kernel : Kernels)
+	{
+		float Budget = Kernel.mMath == ESimdMath::Lut ? Lut.mDiskLightingMaxError
+			: FSGReflectKernel::GetErrorBudget(Kernel.mMath).mImage;
+		fprintf(OutLog, "SGReflectKernel %s %s: %.2f MPoints/s, %.2fx, error %.3g (budget %.3g)",
+			FSGReflectKernel::GetIsaName(Kernel.mIsa), FSGReflectKernel::GetMathName(Kernel.mMath),
+			Kernel.mPointsPerSecond * 1e-6, Kernel.mSpeedup, Kernel.mMaxError, Budget);
+		EndLine(OutLog, Kernel.mMaxError <= Budget, bPassed);
+	}
+
+	fprintf(OutLog, "RectGI micro benchmarks: %s\n", bPassed ? "ok" : "FAILED");
+	return bPassed;
+}
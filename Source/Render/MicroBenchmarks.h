@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdio>
+#include <string>
+
+using namespace std;
+
+// Options of CMicroBenchmarks::Run.
+struct FMicroBenchSettings
+{
+	FMicroBenchSettings();
+
+	// existing directory the shader bytecode cache benchmark writes its files to
+	string mScratchDirectory;
+	// .sdkmesh file of the load benchmark
+	string mMeshFile;
+};
+
+// Runs the benchmarks of CModuleBenchmarks at fixed sizes, one after another on the calling thread.
+// Each result is written as one line, and results which carry a check, like a match against a reference
+// implementation, fail the run. Only portable modules are measured, so the demo and RectGICpu run the same code.
+class CMicroBenchmarks
+{
+public:
+	// Write the results to OutLog, false when a check failed.
+	static bool Run(const FMicroBenchSettings& InSettings, FILE* OutLog);
+};
@@ -5,13 +5,34 @@
 #include "RenderData.h"
 #include "MeshData.h"
 #include <map>
+#include <algorithm>
 #include "DemoUI.h"
 #include "RenderStates.h"
 #include "PostProcess.h"
+#include "RectProxy.h"
+#include "ShaderBuffers.h"
+#include "ShaderCache.h"
+#include "RenderTargetPool.h"
+#include "StreamingGeometry.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <chrono>
+#include "../CpuGI/CpuRenderer.h"
+#include "../CpuGI/SGLightingLut.h"
 
 CMiniEngine::CMiniEngine()
-	: mLightIntensity(1)
-	, mLightInstance(nullptr)
+	: mPipelineStats()
+	, mSimulationTime(0)
+	, mSimulationStep(0)
+	, bMeshletCulling(true)
+	, mLightIntensity(1)
+	, bLightingLut(true)
+	, mSGLightingLut(nullptr)
+	, mSGLightingLutRV(nullptr)
+	, mRectQuad(nullptr)
+	, mRectInstancedVS(nullptr)
+	, mRectInstancedPS(nullptr)
+	, mRectInstancedLayout(nullptr)
 	, mSpecularReflIntensity(0.1f)
 	, mDiffuseReflIntensity(1)
 	, mSpecularSamplingRadius(300)
@@ -52,6 +73,9 @@ void CMiniEngine::SetupDXUT(CreateRenderInstancesCallback InCreateRenderInstance
 void CMiniEngine::InitApp()
 {
 	CDemoUI::GetInstance().InitGUI();
+	// Workers for the frame update, one per remaining hardware thread, and the thread rendering the last frame
+	CJobSystem::GetInstance().Start(-1);
+	mRenderThread.Start();
 	
 	// Parse the command line, show msgboxes on error, no extra command line params
 	DXUTInit(true, true, nullptr); 
@@ -61,6 +85,8 @@ void CMiniEngine::InitApp()
 	DXUTCreateDevice(D3D_FEATURE_LEVEL_11_1, true, 1024, 768);
 	// Enter into the DXUT render loop
 	DXUTMainLoop();
+	mRenderThread.Stop();
+	CJobSystem::GetInstance().Stop();
 }
 
 void CMiniEngine::DestroyEngine()
@@ -72,8 +98,27 @@ void CMiniEngine::DestroyEngine()
 	// Destroy render instances.
 	DestroyRenderInstances();
 
+	SAFE_RELEASE(mSGLightingLutRV);
+	SAFE_RELEASE(mSGLightingLut);
+	mRectRenderer.Release(mBackend);
+
+	IMeshData::DestroyMesh(&mRectQuad);
+	mRectInstancedVS = nullptr;
+	mRectInstancedPS = nullptr;
+	mRectInstancedLayout = nullptr;
+
+	// Destroy post process resources and pooled render targets.
+	CPostProcess::GetInstance().ReleaseDeviceResources();
+	CRenderTargetPool::GetInstance().OnDestroy();
+
+	// Release the frame constants buffers of the backend and the streaming geometry.
+	mBackend.OnDestroy();
+	CStreamingGeometry::GetInstance().OnDestroy();
+
 	// Destroy render states.
 	CRenderStates::GetInstance().OnDestroy();
+	// Release shared shaders, after everything using them.
+	CShaderCache::GetInstance().OnDestroy();
 
 #if _DEBUG
 	ReportLiveDeviceObjects();
@@ -82,9 +127,14 @@ void CMiniEngine::DestroyEngine()
 
 void CMiniEngine::ReportLiveDeviceObjects()
 {
+	// no DXUT device in headless runs
 	ID3D11Device* pd3dDevice = DXUTGetD3D11Device();
+	if (pd3dDevice == nullptr)
+		return;
 	ID3D11Debug* debugDev = nullptr;
 	pd3dDevice->QueryInterface(__uuidof(ID3D11Debug), reinterpret_cast<void**>(&debugDev));
+	if (debugDev == nullptr)
+		return;
 	//debugDev->ReportLiveDeviceObjects(D3D11_RLDO_DETAIL);
 	debugDev->ReportLiveDeviceObjects(D3D11_RLDO_IGNORE_INTERNAL);
 	SAFE_RELEASE(debugDev);
@@ -120,45 +170,136 @@ void CMiniEngine::TakeScreenshot()
 	pContext->Release();
 }
 
+void CMiniEngine::FillPerFrameConstants(CB_PS_PER_FRAME& OutConstants)
+{
+	CDemoUI& DemoUI = CDemoUI::GetInstance();
+
+	float fAmbient = 0.1f;
+	// Get the light direction
+	XMVECTOR vLightDir = mLightControl.GetLightDirection();
+	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&OutConstants.mLightDirAmbient), vLightDir);
+	OutConstants.mLightDirAmbient.w = fAmbient;
+	OutConstants.mLightIntensity.x = mLightIntensity;
+	OutConstants.mLightIntensity.y = mSpecularReflIntensity;
+	OutConstants.mLightIntensity.z = mDiffuseReflIntensity;
+	OutConstants.mToggleOptionsA[0] = DemoUI.mShowIndirectSpecular;
+	OutConstants.mToggleOptionsA[1] = DemoUI.mShowDirectLighting;
+	OutConstants.mToggleOptionsA[2] = 0;
+	OutConstants.mToggleOptionsA[3] = DemoUI.mShowIndirectDiffuse;
+	OutConstants.mSamplingRadius.x = mSpecularSamplingRadius;
+	OutConstants.mSamplingRadius.y = mDiffuseSamplingRadius;
+	XMStoreFloat4(&OutConstants.mEyePos, mCamera.GetEyePt());
+}
+
+void CMiniEngine::CaptureCpuScene(FCpuScene& OutScene)
+{
+	FillPerFrameConstants(OutScene.mPerFrame);
+	const CRectCollections& RectColls = CRectCollections::GetInstance();
+	RectColls.PackRects(OutScene.mRects);
+
+	// every visible rectangle instance is a receiver, indexed by its rect handle like in PlaneMeshPS
+	OutScene.mReceivers.clear();
+	for (CRenderInstance& Inst : mRenderInstances)
+	{
+		CRenderInstance* RenderInst = &Inst;
+		if (!RenderInst->mRender || RenderInst->mMeshData->GetMeshType() != EMeshData::RectMesh)
+			continue;
+
+		FCpuReceiver Receiver;
+		Receiver.mPlaneIndex = RectColls.mRects.GetIndex(RenderInst->mRectHandle);
+		assert(Receiver.mPlaneIndex >= 0);
+		RenderInst->FillPSPerObjectConstants(Receiver.mConstants);
+		OutScene.mReceivers.push_back(Receiver);
+	}
+
+	XMStoreFloat3(&OutScene.mCamera.mEye, mCamera.GetEyePt());
+	XMStoreFloat3(&OutScene.mCamera.mLookAt, mCamera.GetLookAtPt());
+	OutScene.mCamera.mUp = XMFLOAT3(0.f, 1.f, 0.f);
+	OutScene.mCamera.mFovY = XM_PI / 4;
+}
+
+void CMiniEngine::RenderCpuReference(const string& InFileName)
+{
+	FCpuScene Scene;
+	CaptureCpuScene(Scene);
+
+	auto pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+	FHdrImage Image(pBackBufferDesc->Width, pBackBufferDesc->Height);
+	CCpuRenderer Renderer;
+	FCpuRenderStats Stats = Renderer.Render(Scene, Image);
+
+	bool bSaved = Image.Save(InFileName);
+	assert(bSaved);
+
+	WCHAR sz[256];
+	swprintf_s(sz, 256, L"RectGI cpu render: %.3f ms, %.2f MPixels/s, %d threads\n",
+		Stats.mSeconds * 1000, Stats.mPixelsPerSecond * 1e-6, Stats.mNumThreads);
+	OutputDebugStringW(sz);
+}
+
+void CMiniEngine::SaveProfile(const string& InFileName)
+{
+	CProfiler& Profiler = CProfiler::GetInstance();
+	bool bSaved = Profiler.WriteChromeTrace(InFileName);
+	assert(bSaved);
+
+	vector<FProfileZoneStats> Zones;
+	Profiler.GetZoneStats(Zones);
+	for (const FProfileZoneStats& Zone : Zones)
+	{
+		WCHAR sz[256];
+		swprintf_s(sz, 256, L"RectGI zone %S: %d calls, %.3f ms, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+			Zone.mName.c_str(), Zone.mCount, Zone.mTotalMs, Zone.mP50Us, Zone.mP90Us, Zone.mP99Us, Zone.mMaxUs);
+		OutputDebugStringW(sz);
+	}
+}
+
 CRenderInstance* CMiniEngine::CreateRenderInstance(const string& InName, IMeshData* InMeshData, 
-	LPCWSTR InVS, LPCWSTR InPS, ID3D11Device* pd3dDevice)
+	LPCWSTR InVS, LPCWSTR InPS, ID3D11Device* pd3dDevice, const D3D_SHADER_MACRO* pPSDefines)
 {
 	// Create render instance.
-	CRenderInstance* RenderInst = new CRenderInstance(InName);
+	assert(mInstanceNames.count(InName) == 0);
+	FInstanceHandle Handle = mRenderInstances.Add(CRenderInstance(InName));
+	mInstanceNames[InName] = Handle;
+	CRenderInstance* RenderInst = mRenderInstances.Get(Handle);
+	RenderInst->mHandle = Handle;
 	RenderInst->mMeshData = InMeshData;
+	RenderInst->mTransform = mTransforms.Create(Handle.ToKey());
+	RenderInst->MarkDirty();
 
 	UINT NumVertexElement;
 	const D3D11_INPUT_ELEMENT_DESC* layout = InMeshData->GetVertexDesc(NumVertexElement);
 	// Create vertex shader and pixel shader.
-	RenderInst->CreateVertexShader(InVS, "main", layout, NumVertexElement, pd3dDevice);
-	RenderInst->CreatePixelShader(InPS, "main", pd3dDevice);
-
-	// Add render instance to container.
-	assert(mRenderInstances.count(InName) == 0);
-	mRenderInstances[InName] = RenderInst;
+	RenderInst->CreateVertexShader(InVS, "main", layout, NumVertexElement, pd3dDevice, InMeshData->GetShaderDefines());
+	RenderInst->CreatePixelShader(InPS, "main", pd3dDevice, pPSDefines);
 
 	return RenderInst;
 }
 
 CRenderInstance* CMiniEngine::GetRenderInstance(const string& InName)
 {
-	return mRenderInstances[InName];
+	auto it = mInstanceNames.find(InName);
+	return it != mInstanceNames.end() ? mRenderInstances.Get(it->second) : nullptr;
 }
 
 CRenderInstance* CMiniEngine::GetRenderInstance(UINT Index)
 {
-	assert(Index < mRenderInstances.size());
-	auto it = mRenderInstances.begin();
-	std::advance(it, Index);
-	return it->second;
+	assert(Index < (UINT)mRenderInstances.Num());
+	return &mRenderInstances[Index];
+}
+
+CRenderInstance* CMiniEngine::GetRenderInstance(FInstanceHandle InHandle)
+{
+	return mRenderInstances.Get(InHandle);
 }
 
 void CMiniEngine::SetLightPosition(const XMFLOAT3& InLightPos)
 {
-	if (mLightInstance == nullptr)
+	CRenderInstance* LightInst = mRenderInstances.Get(mLightInstance);
+	if (LightInst == nullptr)
 		return;
 
-	mLightInstance->mPosition = InLightPos;
+	LightInst->SetPosition(InLightPos);
 	SetLightDir(InLightPos);
 }
 
@@ -170,68 +311,346 @@ void CMiniEngine::SetLightDir(const XMFLOAT3& InLightDir)
 	mLightControl.SetLightDirection(vLightDir);
 }
 
-void CMiniEngine::RenderScene(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+void CMiniEngine::Simulate(double fTime, float fElapsedTime)
 {
-	CRenderStates& RSMgr = CRenderStates::GetInstance();
+	PROFILE_SCOPE("CMiniEngine::Simulate");
+	// Update the camera's position based on user input
+	mCamera.FrameMove(fElapsedTime);
+	OnFrameUpdate(fTime, fElapsedTime);
+
+	BuildSnapshot(mSnapshots.GetSimulated());
+}
+
+void CMiniEngine::BuildSnapshot(FFrameSnapshot& OutSnapshot)
+{
+	PROFILE_SCOPE("CMiniEngine::BuildSnapshot");
+	OutSnapshot.Reset();
+
+	// per-frame constants, shared by every draw
+	XMStoreFloat4x4(&OutSnapshot.mVSPerFrame.mView, XMMatrixTranspose(mCamera.GetViewMatrix()));
+	XMStoreFloat4x4(&OutSnapshot.mVSPerFrame.mProj, XMMatrixTranspose(mCamera.GetProjMatrix()));
+	FillPerFrameConstants(OutSnapshot.mPSPerFrame);
 
-	map<string, CRenderInstance*>::iterator iter;
-	for (iter = mRenderInstances.begin(); iter != mRenderInstances.end(); ++iter) 
+	const CRectStore& Rects = CRectCollections::GetInstance().mRects;
+	OutSnapshot.mRects.resize(Rects.Num());
+	if (Rects.Num() > 0)
 	{
-		CRenderInstance* RenderInst = iter->second;
+		Rects.PackGpuRects(&OutSnapshot.mRects[0]);
+	}
+
+	// linear scan over the packed instances, collecting the draws
+	const bool bInstancedRects = CDemoUI::GetInstance().mInstancedRects;
+	const XMMATRIX View = mCamera.GetViewMatrix();
+	const float FarClip = mCamera.GetFarClip();
+	mDrawList.Reset();
+	mDrawInstances.clear();
+	// world matrices are read by the jobs below, resolve them while single threaded
+	mTransforms.Update();
+	for (int Index = 0; Index < mRenderInstances.Num(); ++Index)
+	{
+		CRenderInstance* RenderInst = &mRenderInstances[Index];
 		if (!RenderInst->mRender)
 			continue;
 
-		// Set the rasterizer state
-		pd3dImmediateContext->RSSetState(RSMgr.GetRasterizerState(RenderInst->mCull));
+		// rects are packed and drawn together after the other draws
+		if (bInstancedRects && RenderInst->IsInstancedRect())
+		{
+			XMFLOAT4X4 World;
+			XMStoreFloat4x4(&World, RenderInst->GetWorldMatrix());
+			int32_t Reflectors[MAX_RELATED_REFLECTOR_NUM];
+			int NumReflectors = RenderInst->GetLinkedReflectorIndices(Reflectors);
+			OutSnapshot.mRectPacker.Add(World, RenderInst->mRoughness, RenderInst->mDiffuseColor, Reflectors, NumReflectors);
+			continue;
+		}
+
+		mDrawInstances.push_back(Index);
+	}
+
+	// view depths of all draws in parallel
+	int NumDraws = (int)mDrawInstances.size();
+	mDrawDepths.resize(NumDraws);
+	CJobSystem& JobSystem = CJobSystem::GetInstance();
+	JobSystem.ParallelFor(NumDraws, 256, [&](int InBegin, int InEnd)
+	{
+		for (int Draw = InBegin; Draw < InEnd; ++Draw)
+		{
+			XMVECTOR ViewPos = XMVector3TransformCoord(mRenderInstances[mDrawInstances[Draw]].GetWorldMatrix().r[3], View);
+			mDrawDepths[Draw] = XMVectorGetZ(ViewPos) / FarClip;
+		}
+	});
+
+	// by pipeline, mesh and material, front to back within a batch
+	for (int Draw = 0; Draw < NumDraws; ++Draw)
+	{
+		CRenderInstance* RenderInst = &mRenderInstances[mDrawInstances[Draw]];
+		uint64_t SortKey = CDrawList::MakeSortKey(mDrawList.GetPipelineId(RenderInst->GetPipelineState()),
+			mDrawList.GetObjectId(RenderInst->mMeshData), mDrawList.GetObjectId(RenderInst->mMeshData->GetTexture()),
+			mDrawDepths[Draw]);
+		mDrawList.Add(SortKey, (uint32_t)Draw);
+	}
+	mDrawList.Sort();
+
+	// draws and per-object constants in sorted order, packed in parallel
+	PROFILE_SCOPE("CMiniEngine::PackObjectConstants");
+	OutSnapshot.mDraws.resize(NumDraws);
+	OutSnapshot.mObjectConstants.resize(NumDraws);
+	const vector<FDrawItem>& Items = mDrawList.GetItems();
+	JobSystem.ParallelFor(NumDraws, 64, [&](int InBegin, int InEnd)
+	{
+		for (int Draw = InBegin; Draw < InEnd; ++Draw)
+		{
+			const CRenderInstance& RenderInst = mRenderInstances[mDrawInstances[Items[Draw].mPayload]];
+			OutSnapshot.mDraws[Draw].mPipeline = RenderInst.GetPipelineState();
+			OutSnapshot.mDraws[Draw].mMeshData = RenderInst.mMeshData;
+			RenderInst.FillObjectConstants(OutSnapshot.mObjectConstants[Draw]);
+		}
+	});
+}
+
+void CMiniEngine::RenderScene(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
+{
+	PROFILE_SCOPE("CMiniEngine::RenderScene");
+	CRenderStates& RSMgr = CRenderStates::GetInstance();
+	const FFrameSnapshot* Snapshot = mSnapshots.GetRendered();
+	assert(Snapshot != nullptr);
+
+	// shared by all instances using RectGI.hlsl
+	OutCommands.SetSampler(EShaderStage::Pixel, 1, RSMgr.GetSamplerState(true, false));
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 1, mSGLightingLutRV);
+	UploadRects(OutCommands);
+
+	// per-frame constants, written once and shared by every draw
+	uint32_t Offset;
+	void* pVSPerFrame = OutCommands.AllocateFrameConstants(sizeof(CB_VS_PER_FRAME), Offset);
+	memcpy(pVSPerFrame, &Snapshot->mVSPerFrame, sizeof(CB_VS_PER_FRAME));
+	OutCommands.SetFrameConstants(EShaderStage::Vertex, 1, Offset, sizeof(CB_VS_PER_FRAME));
+	void* pPSPerFrame = OutCommands.AllocateFrameConstants(sizeof(CB_PS_PER_FRAME), Offset);
+	memcpy(pPSPerFrame, &Snapshot->mPSPerFrame, sizeof(CB_PS_PER_FRAME));
+	OutCommands.SetFrameConstants(EShaderStage::Pixel, 1, Offset, sizeof(CB_PS_PER_FRAME));
+
+	// per-object constants of all draws in one range of the frame constants
+	int NumDraws = (int)Snapshot->mDraws.size();
+	uint32_t ConstantsOffset = 0;
+	uint32_t ConstantsStride = 0;
+	if (NumDraws > 0)
+	{
+		uint8_t* pConstants = static_cast<uint8_t*>(OutCommands.AllocateFrameConstantsArray(NumDraws,
+			sizeof(CB_PER_OBJECT), ConstantsOffset, ConstantsStride));
+		for (int Draw = 0; Draw < NumDraws; ++Draw)
+		{
+			memcpy(pConstants + (size_t)Draw * ConstantsStride, &Snapshot->mObjectConstants[Draw], sizeof(CB_PER_OBJECT));
+		}
+	}
+
+	// draws are sorted by state, binds matching the previous draw are dropped by the command list
+	CStreamingGeometry& Streaming = CStreamingGeometry::GetInstance();
+	mMeshletStats = FMeshletCullStats();
+	for (int Draw = 0; Draw < NumDraws; ++Draw)
+	{
+		const FSnapshotDraw& SnapshotDraw = Snapshot->mDraws[Draw];
+		IMeshData* MeshData = SnapshotDraw.mMeshData;
+
+		// Get the mesh, streamed meshes append their data here
+		ID3D11Buffer* pVB = MeshData->GetVertexBuffer(pd3dDevice, OutCommands);
+		assert(pVB != nullptr);
+
+		// the indices of the visible meshlets replace the index buffer, draws without any are dropped
+		ID3D11Buffer* pIB = MeshData->GetIndexBuffer();
+		DXGI_FORMAT IndexFormat = MeshData->GetIndexFormat();
+		UINT NumIndices = MeshData->GetIndexNum();
+		UINT StartIndex = MeshData->GetStartIndex();
+		const FMeshletData* Meshlets = bMeshletCulling ? MeshData->GetMeshlets() : nullptr;
+		if (Meshlets != nullptr)
+		{
+			CullMeshlets(*Meshlets, *Snapshot, Draw);
+			if (mCulledIndices.empty())
+				continue;
+			NumIndices = (UINT)mCulledIndices.size();
+			StartIndex = Streaming.AppendIndices(pd3dDevice, OutCommands, &mCulledIndices[0], NumIndices);
+			pIB = Streaming.GetIndexBuffer();
+			IndexFormat = DXGI_FORMAT_R32_UINT;
+		}
+
+		// Set shaders, input layout, rasterizer state and topology
+		OutCommands.SetPipeline(SnapshotDraw.mPipeline);
 
-		//Get the mesh
 		//IA setup
-		pd3dImmediateContext->IASetInputLayout(RenderInst->mVertexLayout11);
-		UINT Strides[1];
-		UINT Offsets[1];
-		ID3D11Buffer* pVB[1];
-		pVB[0] = RenderInst->mMeshData->GetVertexBuffer(pd3dDevice);
-		assert(pVB[0] != nullptr);
-		Strides[0] = (UINT)RenderInst->mMeshData->GetVertexStride();
-		assert(Strides[0] > 0 && Strides[0] < 1024);
-		Offsets[0] = 0;
-		pd3dImmediateContext->IASetVertexBuffers(0, 1, pVB, Strides, Offsets);
-		pd3dImmediateContext->IASetIndexBuffer(RenderInst->mMeshData->GetIndexBuffer(), RenderInst->mMeshData->GetIndexFormat(), 0);
-
-		// Update render instance before rendering.
-		RenderInst->OnFrameRender(pd3dImmediateContext);
-
-		// set topology type.
-		auto PrimType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		pd3dImmediateContext->IASetPrimitiveTopology(PrimType);
+		UINT Stride = (UINT)MeshData->GetVertexStride();
+		assert(Stride > 0 && Stride < 1024);
+		OutCommands.SetVertexBuffer(pVB, Stride, 0);
+		assert(IndexFormat == DXGI_FORMAT_R16_UINT || IndexFormat == DXGI_FORMAT_R32_UINT);
+		OutCommands.SetIndexBuffer(pIB,
+			IndexFormat == DXGI_FORMAT_R32_UINT ? EIndexFormat::UInt32 : EIndexFormat::UInt16);
+
+		// Bind the constants packed above.
+		CRenderInstance::BindObjectConstants(OutCommands, ConstantsOffset + Draw * ConstantsStride);
 
 		// Ignores most of the material information in the mesh to use only a simple shader
-		auto pDiffuseRV = RenderInst->mMeshData->GetTexture();
+		auto pDiffuseRV = MeshData->GetTexture();
 		if (pDiffuseRV != nullptr)
 		{
-			ID3D11SamplerState* SamplerState = RSMgr.GetSamplerState(true, true);
-			pd3dImmediateContext->PSSetSamplers(0, 1, &SamplerState);
-			pd3dImmediateContext->PSSetShaderResources(0, 1, &pDiffuseRV);
+			OutCommands.SetSampler(EShaderStage::Pixel, 0, RSMgr.GetSamplerState(true, true));
+			OutCommands.SetShaderResource(EShaderStage::Pixel, 0, pDiffuseRV);
 		}
 
 		// Drawing.
-		UINT VertexStart = 0;
-		pd3dImmediateContext->DrawIndexed(RenderInst->mMeshData->GetIndexNum(), 0, VertexStart);
+		OutCommands.DrawIndexed(NumIndices, StartIndex, MeshData->GetBaseVertex());
 	}
+
+	RenderInstancedRects(pd3dDevice, OutCommands);
+}
+
+void CMiniEngine::CullMeshlets(const FMeshletData& InMeshlets, const FFrameSnapshot& InSnapshot, int InDraw)
+{
+	// the snapshot holds the matrices transposed for the shaders
+	XMMATRIX World = XMMatrixTranspose(XMLoadFloat4x4(&InSnapshot.mObjectConstants[InDraw].mWorld));
+	XMMATRIX View = XMMatrixTranspose(XMLoadFloat4x4(&InSnapshot.mVSPerFrame.mView));
+	XMMATRIX Proj = XMMatrixTranspose(XMLoadFloat4x4(&InSnapshot.mVSPerFrame.mProj));
+	XMFLOAT4X4 WorldViewProj;
+	XMStoreFloat4x4(&WorldViewProj, World * View * Proj);
+	XMVECTOR Determinant;
+	XMFLOAT3 CameraPos;
+	XMStoreFloat3(&CameraPos, XMVector3TransformCoord(XMLoadFloat4(&InSnapshot.mPSPerFrame.mEyePos),
+		XMMatrixInverse(&Determinant, World)));
+
+	FMeshletCullView CullView;
+	CMeshletCuller::SetupView(&WorldViewProj.m[0][0], &CameraPos.x, CullView);
+	FMeshletCullStats Stats;
+	CMeshletCuller::Cull(InMeshlets, CullView, mCulledIndices, &Stats);
+	mMeshletStats.Accumulate(Stats);
 }
 
 void CMiniEngine::DestroyRenderInstances()
 {
 	// release render instances.
-	map<string, CRenderInstance*>::iterator iter;
-	for (iter = mRenderInstances.begin(); iter != mRenderInstances.end(); ++iter) {
-		CRenderInstance* RenderInst = iter->second;
-		IMeshData::DestroyMesh(&RenderInst->mMeshData);
-		RenderInst->Destroy();
-		SAFE_DELETE(RenderInst);
+	for (CRenderInstance& RenderInst : mRenderInstances)
+	{
+		IMeshData::DestroyMesh(&RenderInst.mMeshData);
+		RenderInst.Destroy();
 	}
 
-	mRenderInstances.clear();
+	mRenderInstances.Clear();
+	mInstanceNames.clear();
+}
+
+void CMiniEngine::CreateLightingLut(ID3D11Device* pd3dDevice)
+{
+	D3D11_TEXTURE2D_DESC Desc;
+	ZeroMemory(&Desc, sizeof(D3D11_TEXTURE2D_DESC));
+	Desc.Width = FSGLightingLut::Width;
+	Desc.Height = FSGLightingLut::Height;
+	Desc.MipLevels = 1;
+	Desc.ArraySize = 1;
+	Desc.Format = DXGI_FORMAT_R16_FLOAT;
+	Desc.SampleDesc.Count = 1;
+	Desc.Usage = D3D11_USAGE_IMMUTABLE;
+	Desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(D3D11_SUBRESOURCE_DATA));
+	InitData.pSysMem = FSGLightingLut::GetHalfTexels();
+	InitData.SysMemPitch = FSGLightingLut::GetRowPitch();
+
+	HRESULT hr;
+	hr = pd3dDevice->CreateTexture2D(&Desc, &InitData, &mSGLightingLut);
+	assert(SUCCEEDED(hr));
+	hr = pd3dDevice->CreateShaderResourceView(mSGLightingLut, nullptr, &mSGLightingLutRV);
+	assert(SUCCEEDED(hr));
+}
+
+const D3D_SHADER_MACRO* CMiniEngine::GetLightingDefines(bool bInRectInstancing) const
+{
+	static const D3D_SHADER_MACRO Defines[4][3] =
+	{
+		{ { "RECTGI_LIGHTING_LUT", "0" }, { nullptr, nullptr } },
+		{ { "RECTGI_LIGHTING_LUT", "0" }, { "RECT_INSTANCING", "1" }, { nullptr, nullptr } },
+		{ { "RECTGI_LIGHTING_LUT", "1" }, { nullptr, nullptr } },
+		{ { "RECTGI_LIGHTING_LUT", "1" }, { "RECT_INSTANCING", "1" }, { nullptr, nullptr } },
+	};
+	return Defines[(bLightingLut ? 2 : 0) + (bInRectInstancing ? 1 : 0)];
+}
+
+void CMiniEngine::SetLightingLut(ID3D11Device* pd3dDevice, bool bInEnable)
+{
+	bLightingLut = bInEnable;
+
+	// rect meshes are drawn with PlaneMeshPS, the programs of both paths stay in the cache
+	CShaderCache& ShaderCache = CShaderCache::GetInstance();
+	for (CRenderInstance& RenderInst : mRenderInstances)
+	{
+		if (RenderInst.mMeshData->GetMeshType() != EMeshData::RectMesh)
+			continue;
+
+		RenderInst.mPixelShader = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PlaneMeshPS.hlsl", "main",
+			GetLightingDefines(false));
+	}
+	if (mRectInstancedPS != nullptr)
+	{
+		mRectInstancedPS = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PlaneMeshPS.hlsl", "main",
+			GetLightingDefines(true));
+	}
+}
+
+void CMiniEngine::UploadRects(CRenderCommandList& OutCommands)
+{
+	PROFILE_SCOPE("CMiniEngine::UploadRects");
+	mRectRenderer.UploadRects(mBackend, mSnapshots.GetRendered()->mRects, OutCommands);
+}
+
+void CMiniEngine::CreateRectInstancing(ID3D11Device* pd3dDevice)
+{
+	assert(mRectQuad == nullptr);
+	mRectQuad = IMeshData::CreateRectMesh(pd3dDevice);
+
+	// the instanced program reads quad positions as they are stored, which needs them to be unscaled
+	assert(mRectQuad->GetVertexFormat().mPosition != EVertexPosition::Unorm16);
+
+	// the rect programs with the world matrix and material read per instance
+	CShaderCache& ShaderCache = CShaderCache::GetInstance();
+	const D3D_SHADER_MACRO Defines[] = { { "RECT_INSTANCING", "1" }, { nullptr, nullptr } };
+	vector<D3D_SHADER_MACRO> VertexDefines(Defines, Defines + 1);
+	for (const D3D_SHADER_MACRO* Define = mRectQuad->GetShaderDefines(); Define != nullptr && Define->Name != nullptr; ++Define)
+	{
+		VertexDefines.push_back(*Define);
+	}
+	VertexDefines.push_back(Defines[1]);
+	mRectInstancedVS = ShaderCache.GetVertexShader(pd3dDevice, L"Shaders\\PlaneMeshVS.hlsl", "main", &VertexDefines[0]);
+	mRectInstancedPS = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PlaneMeshPS.hlsl", "main",
+		GetLightingDefines(true));
+
+	// stream 0: the quad, stream 1: FRectInstanceData
+	UINT NumQuadElements;
+	const D3D11_INPUT_ELEMENT_DESC* QuadLayout = mRectQuad->GetVertexDesc(NumQuadElements);
+	const D3D11_INPUT_ELEMENT_DESC InstanceLayout[] =
+	{
+		{ "INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_MATERIAL", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "INSTANCE_REFLECTORS", 0, DXGI_FORMAT_R32G32_UINT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+	vector<D3D11_INPUT_ELEMENT_DESC> Layout(QuadLayout, QuadLayout + NumQuadElements);
+	Layout.insert(Layout.end(), begin(InstanceLayout), end(InstanceLayout));
+	mRectInstancedLayout = ShaderCache.GetInputLayout(pd3dDevice, mRectInstancedVS, &Layout[0], (UINT)Layout.size());
+}
+
+void CMiniEngine::RenderInstancedRects(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
+{
+	const CRectInstancePacker& RectPacker = mSnapshots.GetRendered()->mRectPacker;
+	if (RectPacker.Num() == 0)
+		return;
+
+	FRectQuadDraw Quad;
+	Quad.mPipeline.mVertexShader = mRectInstancedVS;
+	Quad.mPipeline.mPixelShader = mRectInstancedPS;
+	Quad.mPipeline.mInputLayout = mRectInstancedLayout;
+	Quad.mPipeline.mRasterizerState = CRenderStates::GetInstance().GetRasterizerState(true);
+	Quad.mPipeline.mTopology = EPrimitiveTopology::TriangleList;
+	Quad.mVertexBuffer = mRectQuad->GetVertexBuffer(pd3dDevice, OutCommands);
+	Quad.mVertexStride = mRectQuad->GetVertexStride();
+	Quad.mIndexBuffer = mRectQuad->GetIndexBuffer();
+	Quad.mNumIndices = mRectQuad->GetIndexNum();
+	mRectRenderer.RecordInstancedRects(mBackend, RectPacker, Quad, OutCommands);
 }
 
 //--------------------------------------------------------------------------------------
@@ -243,6 +662,10 @@ HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFAC
 	// Create UI.
 	CDemoUI::GetInstance().CreateGUI(pd3dDevice);
 
+	// Compiled shaders persist in the working directory across runs
+	CShaderCache& ShaderCache = CShaderCache::GetInstance();
+	ShaderCache.SetCacheDirectory(L"ShaderCache");
+
 	// Callbacks
 	CMiniEngine::GetInstance().OnSetupEnvironment();
 	CMiniEngine::GetInstance().OnCreateRenderInstances(pd3dDevice);
@@ -250,44 +673,104 @@ HRESULT CALLBACK OnD3D11CreateDevice(ID3D11Device* pd3dDevice, const DXGI_SURFAC
 	// Initialize render states.
 	CRenderStates::GetInstance().InitRenderStates(pd3dDevice);
 
+	CMiniEngine::GetInstance().CreateLightingLut(pd3dDevice);
+	CMiniEngine::GetInstance().CreateRectInstancing(pd3dDevice);
+
+	// Post process shaders and fixed size targets, the back buffer sized ones follow the swap chain.
+	CPostProcess::GetInstance().CreateDeviceResources(pd3dDevice);
+
 	return S_OK;
 }
 
 void CALLBACK OnFrameMove(double fTime, float fElapsedTime, void* pUserContext)
 {
+	// simulated by OnFrameRender, overlapped with rendering the previous frame
 	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
-	// Update the camera's position based on user input 
-	MiniEngine.mCamera.FrameMove(fElapsedTime);
-	MiniEngine.OnFrameUpdate(fTime, fElapsedTime);
+	MiniEngine.mSimulationTime = fTime;
+	MiniEngine.mSimulationStep = fElapsedTime;
 }
 
-void CMiniEngine::RenderLDR(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+void CMiniEngine::RenderLDR(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
 	// Clear the render target and depth stencil
 	auto pRTV = DXUTGetD3D11RenderTargetView();
-	pd3dImmediateContext->ClearRenderTargetView(pRTV, CRenderStates::GetInstance().GetClearColor());
 	auto pDSV = DXUTGetD3D11DepthStencilView();
-	pd3dImmediateContext->ClearDepthStencilView(pDSV, D3D11_CLEAR_DEPTH, 1.0, 0);
+	OutCommands.SetRenderTargets(pRTV, pDSV);
+	OutCommands.ClearRenderTarget(pRTV, CRenderStates::GetInstance().GetClearColor());
+	OutCommands.ClearDepth(pDSV, 1.0f);
 
 	// render scene
-	RenderScene(pd3dDevice, pd3dImmediateContext);
+	RenderScene(pd3dDevice, OutCommands);
 }
 
 void CMiniEngine::OnFrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, float fElapsedTime)
 {
+	auto FrameStart = chrono::steady_clock::now();
+
+	// the first frame renders the snapshot simulated right before it
+	if (mSnapshots.GetRendered() == nullptr)
+	{
+		Simulate(mSimulationTime, mSimulationStep);
+		mSnapshots.Publish();
+	}
+
+	// render the last snapshot on the render thread while the next one is simulated here, the render stage only
+	// reads the snapshot and resources owned by the renderer
+	struct FRenderStage
+	{
+		CMiniEngine* mEngine;
+		ID3D11Device* mDevice;
+		ID3D11DeviceContext* mContext;
+	};
+	FRenderStage RenderStage = { this, pd3dDevice, pd3dImmediateContext };
+	mRenderThread.Kick([](void* InData)
+	{
+		FRenderStage* Stage = static_cast<FRenderStage*>(InData);
+		Stage->mEngine->RenderSnapshot(Stage->mDevice, Stage->mContext);
+	}, &RenderStage);
+
+	auto SimulateStart = chrono::steady_clock::now();
+	Simulate(mSimulationTime, mSimulationStep);
+	auto SimulateEnd = chrono::steady_clock::now();
+
+	mRenderThread.Wait();
+	mSnapshots.Publish();
+	chrono::duration<double, milli> SimulateTime = SimulateEnd - SimulateStart;
+	chrono::duration<double, milli> RenderTime = mRenderThread.GetStageEnd() - mRenderThread.GetStageBegin();
+	chrono::duration<double, milli> FrameTime = chrono::steady_clock::now() - FrameStart;
+	mPipelineStats.mSimulateMs = SimulateTime.count();
+	mPipelineStats.mRenderMs = RenderTime.count();
+	mPipelineStats.mFrameMs = FrameTime.count();
+	mPipelineStats.mOverlapMs = mRenderThread.GetOverlapMs(SimulateStart, SimulateEnd);
+
+	// render ui to the backbuffer
+	CDemoUI::GetInstance().RenderGUI(fElapsedTime);
+}
+
+void CMiniEngine::RenderSnapshot(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+{
+	PROFILE_SCOPE("CMiniEngine::RenderSnapshot");
+	// the rect buffers are created through the backend while recording
+	mBackend.SetContext(pd3dImmediateContext);
+	CStreamingGeometry& Streaming = CStreamingGeometry::GetInstance();
+	Streaming.BeginFrame(pd3dImmediateContext);
+	mCommands.Reset();
 	if (CDemoUI::GetInstance().mShowHDR)
 	{
 		// render with high dynamic range
-		CPostProcess::GetInstance().RenderHDR(pd3dDevice, pd3dImmediateContext);
+		CPostProcess::GetInstance().RenderHDR(pd3dDevice, mCommands);
 	}
 	else
 	{
 		// render with low dynamic range
-		RenderLDR(pd3dDevice, pd3dImmediateContext);
+		RenderLDR(pd3dDevice, mCommands);
 	}
 
-	// render ui to the backbuffer
-	CDemoUI::GetInstance().RenderGUI(fElapsedTime);
+	// submit the frame and count its work for the HUD
+	mBackend.Execute(mCommands);
+	Streaming.EndFrame(pd3dImmediateContext);
+	mFrameStats.ResetStats();
+	mFrameStats.Execute(mCommands);
 }
 
 void CALLBACK OnD3D11FrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, double fTime,
@@ -332,7 +815,7 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChai
 	CDemoUI& DemoUI = CDemoUI::GetInstance();
 	HRESULT hr;
 
-	CPostProcess::GetInstance().CreateResources(pd3dDevice, pSwapChain, pBackBufferSurfaceDesc);
+	CPostProcess::GetInstance().CreateSizeDependentResources(pd3dDevice, pBackBufferSurfaceDesc);
 
 	hr = (DemoUI.mDialogResourceManager.OnD3D11ResizedSwapChain(pd3dDevice, pBackBufferSurfaceDesc));
 	assert(SUCCEEDED(hr));
@@ -348,6 +831,6 @@ HRESULT CALLBACK OnD3D11ResizedSwapChain(ID3D11Device* pd3dDevice, IDXGISwapChai
 
 void CALLBACK OnD3D11ReleasingSwapChain(void* pUserContext)
 {
-	CPostProcess::GetInstance().ReleaseResources();
+	CPostProcess::GetInstance().ReleaseSizeDependentResources();
 	CDemoUI::GetInstance().mDialogResourceManager.OnD3D11ReleasingSwapChain();
 }
@@ -9,9 +9,21 @@
 #include <string>
 #include <map>
 #include <d3d11.h>
+#include "TransformHierarchy.h"
+#include "SlotMap.h"
+#include "RenderCommands.h"
+#include "D3D11RenderBackend.h"
+#include "RectInstancing.h"
+#include "RectRenderer.h"
+#include "DrawList.h"
+#include "FrameSnapshot.h"
+#include "Meshlets.h"
+#include "RenderThread.h"
 
 class IMeshData;
 class CRenderInstance;
+class FCpuScene;
+struct CB_PS_PER_FRAME;
 
 using namespace std;
 using namespace DirectX;
@@ -38,25 +50,34 @@ public:
 	// Destroy device.
 	void DestroyEngine();
 
-	// Create render instance with given name and mesh data.
+	// Create render instance with given name and mesh data. The pointer is valid until the next instance is
+	// created or destroyed, keep CRenderInstance::mHandle instead.
 	CRenderInstance* CreateRenderInstance(const string& InName, IMeshData* InMeshData,
-		LPCWSTR InVS, LPCWSTR InPS, ID3D11Device* pd3dDevice);
+		LPCWSTR InVS, LPCWSTR InPS, ID3D11Device* pd3dDevice, const D3D_SHADER_MACRO* pPSDefines = nullptr);
 
-	// Find rendering instance by name.
+	// Find rendering instance by name, for setup code.
 	CRenderInstance* GetRenderInstance(const string& InName);
-	// Find rendering instance by index.
+	// Find rendering instance by dense index.
 	CRenderInstance* GetRenderInstance(UINT Index);
+	// Find rendering instance by handle, nullptr if it was destroyed.
+	CRenderInstance* GetRenderInstance(FInstanceHandle InHandle);
 
 	// Set position of light.
 	void SetLightPosition(const XMFLOAT3& InLightPos);
 	// Set direction of distant light.
 	void SetLightDir(const XMFLOAT3& InLightDir);
 
-	// The entry function for rendering the scene.
-	void RenderScene(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext);
+	// Move the camera, run the frame update callback and build the next snapshot.
+	void Simulate(double fTime, float fElapsedTime);
+	// Capture camera, light, rect proxies and sorted draws of the current state.
+	void BuildSnapshot(FFrameSnapshot& OutSnapshot);
+	// The entry function for rendering the scene of the rendered snapshot, recording into the command list.
+	void RenderScene(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
 
-	// Rendering entry function called every frame.
+	// Rendering entry function called every frame, renders the last snapshot while simulating the next.
 	void OnFrameRender(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext, float fElapsedTime);
+	// Record and submit the rendered snapshot, reads nothing the simulation writes.
+	void RenderSnapshot(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext);
 
 	// Report non-zero references.
 	void ReportLiveDeviceObjects();
@@ -64,24 +85,97 @@ public:
 	// Take a screenshot.
 	void TakeScreenshot();
 
+	// Fill constants of 'psPerFrame' shared by all render instances.
+	void FillPerFrameConstants(CB_PS_PER_FRAME& OutConstants);
+	// Capture rect proxies, lighting and camera as a scene for the cpu renderer.
+	void CaptureCpuScene(FCpuScene& OutScene);
+	// Render current view with the cpu reference renderer and save it as an HDR image.
+	void RenderCpuReference(const string& InFileName);
+	// Save the recorded profiler zones as a chrome://tracing file and print their percentiles.
+	void SaveProfile(const string& InFileName);
+
+	// Upload the float16 tables of FSGLightingLut.
+	void CreateLightingLut(ID3D11Device* pd3dDevice);
+	// Defines of the pixel programs including RectGI.hlsl, following bLightingLut.
+	const D3D_SHADER_MACRO* GetLightingDefines(bool bInRectInstancing) const;
+	// Switch RectGI.hlsl between the lookup tables and exp/log, replacing the pixel shaders of all rects.
+	void SetLightingLut(ID3D11Device* pd3dDevice, bool bInEnable);
+	// Upload the rect proxies of the rendered snapshot into the structured buffer psRects.
+	void UploadRects(CRenderCommandList& OutCommands);
+
+	// Create the shared quad and programs of the instanced rect path.
+	void CreateRectInstancing(ID3D11Device* pd3dDevice);
+	// Draw all rects packed into the rendered snapshot with one instanced draw.
+	void RenderInstancedRects(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
+
 private:
 	// Initialize.
 	void InitApp();
+	// Cull the meshlets of a draw of the snapshot into mCulledIndices, in the object space of the draw.
+	void CullMeshlets(const FMeshletData& InMeshlets, const FFrameSnapshot& InSnapshot, int InDraw);
 	// Destroy all render instances.
 	void DestroyRenderInstances();
 
 	// Rendering the scene with low dynamic range.
-	void RenderLDR(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext);
+	void RenderLDR(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
 
 public:
-	// Container for all rendering instances.
-	map<string, CRenderInstance*> mRenderInstances;
+	// All rendering instances, densely packed in creation order until one is destroyed.
+	TSlotMap<CRenderInstance> mRenderInstances;
+	// Instance handles by name, for setup code.
+	map<string, FInstanceHandle> mInstanceNames;
+	// Transforms of all rendering instances, the user data of a node is its instance.
+	CTransformHierarchy mTransforms;
+
+	// Commands of the current frame.
+	CRenderCommandList mCommands;
+	// Executes mCommands on the immediate context.
+	CD3D11RenderBackend mBackend;
+	// Counts the work in mCommands, reset every frame.
+	CNullRenderBackend mFrameStats;
+	// Simulated and rendered state of the last two frames.
+	CFrameSnapshots mSnapshots;
+	// Time of the simulation and render stage of the last frame.
+	FFramePipelineStats mPipelineStats;
+	// Renders the last snapshot while the main thread simulates the next one.
+	CRenderThread mRenderThread;
+	// Time and step of the next simulated frame, from OnFrameMove.
+	double mSimulationTime;
+	float mSimulationStep;
+	// Draws of BuildSnapshot sorted by state, rebuilt every frame.
+	CDrawList mDrawList;
+	// Dense instance index and normalized view depth of each draw of BuildSnapshot.
+	vector<int> mDrawInstances;
+	vector<float> mDrawDepths;
+
+	// Draw only the meshlets in the frustum and facing the camera of meshes which have meshlets.
+	bool bMeshletCulling;
+	// Indices of the visible meshlets of the draw being recorded.
+	vector<uint32_t> mCulledIndices;
+	// Meshlets culled by the last RenderScene.
+	FMeshletCullStats mMeshletStats;
 
 	// Camera class.
 	CModelViewerCamera mCamera;
 
+	// Shade rects with the lookup tables instead of exp/log, see SetLightingLut.
+	bool bLightingLut;
+	// Lookup table for RECTGI_LIGHTING_LUT in RectGI.hlsl, bound to t1 / s1.
+	ID3D11Texture2D* mSGLightingLut;
+	ID3D11ShaderResourceView* mSGLightingLutRV;
+
+	// Buffers of psRects and the instanced rects, created through mBackend.
+	CRectRenderer mRectRenderer;
+
+	// Quad drawn once per rect, shares its buffers with the rect meshes.
+	IMeshData* mRectQuad;
+	// Instanced programs and layout, owned by CShaderCache.
+	ID3D11VertexShader* mRectInstancedVS;
+	ID3D11PixelShader* mRectInstancedPS;
+	ID3D11InputLayout* mRectInstancedLayout;
+
 	// Render instance of light.
-	CRenderInstance* mLightInstance;
+	FInstanceHandle mLightInstance;
 	// Controller for light.
 	CDXUTDirectionWidget mLightControl;
 
@@ -0,0 +1,359 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "RenderCommands.h"
+#include "VertexQuantization.h"
+#include "../CpuGI/SimdIsa.h"
+
+using namespace std;
+
+// Timing of CRectStore operations.
+struct FRectStoreBenchResult
+{
+	// rectangles in the store
+	int mNumRects;
+	// nanoseconds per Add, including growth
+	double mAddNs;
+	// nanoseconds per Set of every rectangle
+	double mSetNs;
+	// nanoseconds per rectangle of a full PackGpuRects
+	double mPackNs;
+	// nanoseconds per Remove of half of the rectangles in random order
+	double mRemoveNs;
+	// the store content matched the reference after the removals
+	bool bValid;
+};
+
+// Timing of CRectBvh at one scene size.
+struct FRectBvhBenchResult
+{
+	// rects in the scene
+	int mNumRects;
+	// nodes of the tree
+	int mNumNodes;
+	// build time in milliseconds
+	double mBuildMs;
+	// refit time in milliseconds after moving every rect
+	double mRefitMs;
+	// nanoseconds per specular query
+	double mQueryNs;
+	// nanoseconds per specular query testing every rect
+	double mBruteForceNs;
+	// average rects returned per query
+	double mAvgResults;
+	// query results matched the brute force results
+	bool bMatchesBruteForce;
+};
+
+// Timing of CReflectorLinker at one scene size.
+struct FReflectorLinkBenchResult
+{
+	// rects in the scene
+	int mNumRects;
+	// full link time in milliseconds
+	double mBuildMs;
+	// microseconds of an update without changes
+	double mStaticUpdateUs;
+	// microseconds of an update after moving 1% of the rects
+	double mMovingUpdateUs;
+	// receivers relinked by that update
+	int mRelinkedReceivers;
+	// average links per receiver
+	double mAvgLinks;
+	// the incremental links matched a full rebuild
+	bool bMatchesRebuild;
+};
+
+// Timing of CTransformHierarchy at one scene size.
+struct FTransformBenchResult
+{
+	// nodes in the hierarchy
+	int mNumNodes;
+	// nanoseconds per node of an update with every node dirty
+	double mFullUpdateNs;
+	// nanoseconds per node of an update after moving 10% of the roots
+	double mPartialUpdateNs;
+	// microseconds of an update without changes
+	double mStaticUpdateUs;
+	// nanoseconds per node of recomputing every world matrix on demand, 4 times like a frame did
+	double mUncachedNs;
+	// cached world matrices matched the recomputed ones
+	bool bMatchesUncached;
+};
+
+// Scaling of the frame update of a synthetic scene with the number of threads.
+struct FJobScalingResult
+{
+	// threads working, the caller included
+	int mNumThreads;
+	// milliseconds per frame of transform update, proxy refresh and constant packing
+	double mFrameMs;
+	// single thread time divided by this one
+	double mSpeedup;
+	// proxies and constants matched the single thread ones
+	bool bMatchesSingleThread;
+};
+
+// Timing of recording and null execution at one draw count.
+struct FRenderCommandBenchResult
+{
+	// draws per frame
+	int mNumDraws;
+	// nanoseconds per draw of recording
+	double mRecordNs;
+	// nanoseconds per draw of CNullRenderBackend::Execute
+	double mExecuteNs;
+	// counters of one frame
+	FRenderStats mStats;
+	// counters of the same frame with per-instance constant buffers and per-frame copies
+	FRenderStats mPerInstanceStats;
+};
+
+// Counters of drawing the same rects one by one and instanced.
+struct FRectInstancingBenchResult
+{
+	// rects drawn
+	int mNumRects;
+	// nanoseconds per rect of packing and recording the instanced draw
+	double mPackNs;
+	// one draw per rect with its own constants
+	FRenderStats mPerDrawStats;
+	// one instanced draw for all rects
+	FRenderStats mInstancedStats;
+	// the instanced path recorded exactly one draw
+	bool bSingleDraw;
+	// both paths drew the same number of triangles
+	bool bTrianglesMatch;
+};
+
+// Timing of sorting and counters of submitting one draw list.
+struct FDrawListBenchResult
+{
+	// draws in the list
+	int mNumDraws;
+	// nanoseconds per draw of CDrawList::Sort
+	double mRadixSortNs;
+	// nanoseconds per draw of std::sort on the same keys
+	double mStdSortNs;
+	// both sorts gave the same order of keys
+	bool bSortsMatch;
+	// submitted in the order draws were added, every bind recorded
+	FRenderStats mUnsortedStats;
+	// submitted in key order, redundant binds dropped by the command list
+	FRenderStats mSortedStats;
+};
+
+// Counters of streaming meshes of random sizes through a ring.
+struct FStreamingRingBenchResult
+{
+	// frames streamed
+	int mNumFrames;
+	// allocations made
+	uint32_t mAllocations;
+	// allocations which restarted the ring with a discard
+	uint32_t mDiscards;
+	// bytes skipped by alignment and at the end of the ring
+	uint64_t mWastedBytes;
+	// bytes allocated
+	uint64_t mBytesAllocated;
+	// nanoseconds per allocation
+	double mAllocateNs;
+	// no allocation overlapped one of a frame which was not retired yet
+	bool bNoOverlap;
+};
+
+// Timing of cache lookups.
+struct FShaderCacheBenchResult
+{
+	// lookups done
+	int mNumLookups;
+	// microseconds of a lookup which loads from disk
+	double mDiskLookupUs;
+	// nanoseconds of a lookup which hits memory
+	double mMemoryLookupNs;
+	// bytecode read back from disk matched what was stored
+	bool bRoundTrips;
+};
+
+// Cost of profiling a zone.
+struct FProfilerBenchResult
+{
+	// zones recorded per run
+	int mNumZones;
+	// nanoseconds per zone while enabled, beginning and ending it
+	double mZoneNs;
+	// nanoseconds per zone while disabled
+	double mDisabledZoneNs;
+	// nanoseconds of one CProfiler::ReadTicks, a zone reads it twice
+	double mReadTicksNs;
+};
+
+// Mean stage times of frames whose render stage runs on CRenderThread.
+struct FRenderThreadBenchResult
+{
+	// frames run
+	int mNumFrames;
+	// milliseconds of the simulation stage on the calling thread
+	double mSimulateMs;
+	// milliseconds of the render stage
+	double mRenderMs;
+	// milliseconds both stages ran at the same time
+	double mOverlapMs;
+	// milliseconds from kicking the render stage to waiting for it
+	double mFrameMs;
+	// every render stage ran on the render thread, never nested in the simulation
+	bool bOwnThread;
+};
+
+// Load times of the same file read and copied like CDXUTSDKMesh, and mapped by CSdkMeshFile.
+struct FSdkMeshLoadBenchResult
+{
+	// bytes of the file
+	uint64_t mFileBytes;
+	// microseconds of reading the whole file into the heap
+	double mReadCopyUs;
+	// microseconds of mapping and validating
+	double mMapUs;
+	// microseconds of summing all vertex and index bytes after each load, page faults included for the mapping
+	double mReadCopyTouchUs;
+	double mMapTouchUs;
+	// both paths saw the same data
+	bool bMatches;
+};
+
+// Cache simulation of a shuffled grid before and after each stage.
+struct FMeshOptimizeBenchResult
+{
+	int mNumTriangles;
+	FVertexCacheStats mShuffled;
+	FVertexCacheStats mVertexCache;
+	FVertexCacheStats mOverdraw;
+	// milliseconds of each stage
+	double mVertexCacheMs;
+	double mOverdrawMs;
+	double mVertexFetchMs;
+};
+
+// Accuracy and speed of a random sphere mesh encoded in the chosen format.
+struct FVertexQuantizeBenchResult
+{
+	int mNumVertices;
+	FVertexFormat mFormat;
+	// bytes per float vertex, mFormat.mStride is the compact size
+	uint32_t mFloatStride;
+	// largest errors, the position one relative to the bounds
+	float mMaxPositionError;
+	float mMaxNormalErrorDegrees;
+	float mMaxTexcoordError;
+	// nanoseconds per vertex
+	double mEncodeNs;
+	double mDecodeScalarNs;
+	double mDecodeSimdNs;
+};
+
+// Culling of a sphere mesh seen from cameras around it.
+struct FMeshletBenchResult
+{
+	int mNumTriangles;
+	int mNumMeshlets;
+	// vertices and triangles per meshlet, on average
+	double mAverageVertices;
+	double mAverageTriangles;
+	// milliseconds of building the meshlets
+	double mBuildMs;
+	// all views
+	FMeshletCullStats mStats;
+	// microseconds per view of culling and writing the visible indices, and of copying all indices
+	double mCullUs;
+	double mCopyUs;
+	// nanoseconds of culling per triangle removed
+	double mNsPerCulledTriangle;
+};
+
+// Accuracy and speed of the lookup table against the analytic functions.
+struct FSGLutBenchResult
+{
+	// max relative error of IntegrateDiskLighting against a double precision evaluation
+	float mDiskLightingMaxError;
+	// same for FRectGI::gIntegrateDiskLighting, which loses precision to cancellation for small k * s
+	float mDiskLightingAnalyticError;
+	// max relative error of CalcBandwidth against FRectGI::asgCalcBandwidth
+	float mBandwidthMaxError;
+	// nanoseconds per call of FRectGI::gIntegrateDiskLighting + FRectGI::asgCalcBandwidth
+	double mAnalyticNs;
+	// nanoseconds per call of IntegrateDiskLighting + CalcBandwidth
+	double mLutNs;
+	// the baked header matches a fresh bake
+	bool bBakedDataValid;
+};
+
+// Result of benchmarking one path of FSGReflectKernel.
+struct FSGKernelBenchResult
+{
+	// instruction set
+	ESimdIsa::Type mIsa;
+	// exp/log policy
+	ESimdMath::Type mMath;
+	// shading points per second on one core
+	double mPointsPerSecond;
+	// throughput relative to the scalar port FRectGI::sgReflectShading
+	double mSpeedup;
+	// max error relative to the scalar port, normalized by the max value of the reference
+	float mMaxError;
+};
+
+// Benchmarks of the single engine modules, run by CMicroBenchmarks. They only go through the public interface
+// of a module, so they live in their own translation units: SceneBenchmarks.cpp for the scene data,
+// RenderBenchmarks.cpp for command recording, submission and the render thread,
+// MeshBenchmarks.cpp for mesh loading and processing,
+// LightingBenchmarks.cpp for the cpu lighting code.
+class CModuleBenchmarks
+{
+public:
+	// Time Add, Set, PackGpuRects and Remove of CRectStore on InNumRects random rectangles.
+	static FRectStoreBenchResult RunRectStore(int InNumRects);
+	// Build, refit and query CRectBvh at InNumRects random rects against a linear scan.
+	static FRectBvhBenchResult RunRectBvh(int InNumRects, int InNumQueries);
+	// Link InNumRects random rects with CReflectorLinker, then update without changes and after moving some of them.
+	static FReflectorLinkBenchResult RunReflectorLinker(int InNumRects);
+	// Update InNumNodes nodes of CTransformHierarchy in chains of 4 levels against recomputing every matrix on demand.
+	static FTransformBenchResult RunTransformHierarchy(int InNumNodes);
+	// Update transforms, refresh proxies and pack constants of InNumInstances instances on CJobSystem with 1 to
+	// InMaxThreads threads, 0 for one per hardware thread. More threads than cores only check the results.
+	static vector<FJobScalingResult> RunJobScaling(int InNumInstances, int InMaxThreads = 0);
+
+	// Record and count on CNullRenderBackend a synthetic frame of InNumDraws draws with the bind pattern of RenderScene.
+	static FRenderCommandBenchResult RunNullRenderBackend(int InNumDraws);
+	// Record InNumRects rects with one draw each against one instanced draw of CRectInstancePacker.
+	static FRectInstancingBenchResult RunRectInstancing(int InNumRects);
+	// Sort InNumDraws draws of random state with CDrawList::Sort and std::sort, and submit them unsorted and
+	// sorted to count the binds.
+	static FDrawListBenchResult RunDrawList(int InNumDraws);
+	// Stream meshes of random sizes through CStreamingRing for InNumFrames frames with the GPU InLatency frames behind.
+	static FStreamingRingBenchResult RunStreamingRing(int InNumFrames, int InLatency);
+	// Store a program with CShaderBytecodeCache in InDirectory and look it up InNumLookups times from disk and
+	// from memory.
+	static FShaderCacheBenchResult RunShaderBytecodeCache(const string& InDirectory, int InNumLookups);
+	// Record InNumZones nested zones of CProfiler enabled and disabled. Clears the recorded events.
+	static FProfilerBenchResult RunProfiler(int InNumZones);
+	// Run InNumFrames frames of two stages of InStageMs busy work each, the render stage on CRenderThread.
+	static FRenderThreadBenchResult RunRenderThread(int InNumFrames, double InStageMs);
+
+	// Load InFileName InIterations times with CSdkMeshFile by reading it into memory, like DXUT, and by mapping it.
+	static FSdkMeshLoadBenchResult RunSdkMeshLoad(const string& InFileName, int InIterations);
+	// Optimize a sphere of InGridSize x InGridSize quads whose triangles are shuffled with CMeshOptimizer.
+	static FMeshOptimizeBenchResult RunMeshOptimizer(int InGridSize);
+	// Encode and decode with CVertexQuantizer InNumVertices vertices of a sphere with random texture coordinates.
+	static FVertexQuantizeBenchResult RunVertexQuantizer(int InNumVertices);
+	// Build the meshlets of a sphere of InGridSize rings and segments optimized by CMeshOptimizer and cull them with
+	// CMeshletCuller for InNumViews cameras circling it, some of them close enough to see only part of it.
+	static FMeshletBenchResult RunMeshlets(int InGridSize, int InNumViews);
+
+	// Compare FSGLightingLut against the analytic functions on InNumSamples random inputs.
+	static FSGLutBenchResult RunSGLightingLut(int InNumSamples);
+	// Measure single core throughput and error of every supported path of FSGReflectKernel on random shading points.
+	static vector<FSGKernelBenchResult> RunSGReflectKernel(int InNumPoints, int InIterations);
+};
@@ -2,6 +2,8 @@
 #include "RenderStates.h"
 #include "MiniEngine.h"
 #include "PostProcess.h"
+#include "ShaderCache.h"
+#include "Profiler.h"
 
 #pragma warning( disable : 4100 )
 
@@ -9,9 +11,7 @@ static const int ToneMappingTexSize = (int)pow(3.0f, NUM_TONEMAP_TEXTURES - 1);
 #define NUM_BLOOM_TEXTURES 2
 
 CPostProcess::CPostProcess()
-	: mTexRender(nullptr)
-	, mTexRenderRTV(nullptr)
-	, mTexRenderRV(nullptr)
+	: mSceneTarget(nullptr)
 	, mDownScale2x2LumPS(nullptr)
 	, mDownScale3x3PS(nullptr)
 	, mFinalPassPS(nullptr)
@@ -22,9 +22,7 @@ CPostProcess::CPostProcess()
 	// Initialize pointers to null
 	for (int i = 0; i < NUM_TONEMAP_TEXTURES; ++i)
 	{
-		mTexToneMap[i] = nullptr;
-		mTexToneMapRV[i] = nullptr;
-		mTexToneMapRTV[i] = nullptr;
+		mToneMapTargets[i] = nullptr;
 	}
 }
 
@@ -34,64 +32,61 @@ CPostProcess& CPostProcess::GetInstance()
 	return GInstance;
 }
 
-void CPostProcess::RenderHDR(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+void CPostProcess::RenderHDR(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
+	PROFILE_SCOPE("CPostProcess::RenderHDR");
 	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
 	CRenderStates& RenderStates = CRenderStates::GetInstance();
 
-	// Store off original render target, this is the back buffer of the swap chain
-	ID3D11RenderTargetView* pOrigRTV = nullptr;
-	ID3D11DepthStencilView* pOrigDSV = nullptr;
-	pd3dImmediateContext->OMGetRenderTargets(1, &pOrigRTV, &pOrigDSV);
+	// Original render target, this is the back buffer of the swap chain
+	ID3D11RenderTargetView* pOrigRTV = DXUTGetD3D11RenderTargetView();
+	ID3D11DepthStencilView* pOrigDSV = DXUTGetD3D11DepthStencilView();
 
 	// Set the render target to our own texture
-	ID3D11RenderTargetView* aRTViews[1] = { mTexRenderRTV };
-	pd3dImmediateContext->OMSetRenderTargets(1, aRTViews, pOrigDSV);
+	OutCommands.SetRenderTargets(mSceneTarget->mRTV, pOrigDSV);
 
-	pd3dImmediateContext->ClearRenderTargetView(mTexRenderRTV, RenderStates.GetClearColor());
+	OutCommands.ClearRenderTarget(mSceneTarget->mRTV, RenderStates.GetClearColor());
 
-	pd3dImmediateContext->ClearRenderTargetView(pOrigRTV, RenderStates.GetClearColor());
-	pd3dImmediateContext->ClearDepthStencilView(pOrigDSV, D3D11_CLEAR_DEPTH, 1.0, 0);
+	OutCommands.ClearRenderTarget(pOrigRTV, RenderStates.GetClearColor());
+	OutCommands.ClearDepth(pOrigDSV, 1.0f);
 
 	// render scene
-	MiniEngine.RenderScene(pd3dDevice, pd3dImmediateContext);
+	MiniEngine.RenderScene(pd3dDevice, OutCommands);
 
 	// measure luminance
-	//MeasureLuminancePS11(pd3dImmediateContext);
+	//MeasureLuminancePS11(OutCommands);
 
 	// Restore original render targets
-	aRTViews[0] = pOrigRTV;
-	pd3dImmediateContext->OMSetRenderTargets(1, aRTViews, pOrigDSV);
+	OutCommands.SetRenderTargets(pOrigRTV, pOrigDSV);
 
 	// Tone-mapping
-	ToneMapping(pd3dDevice, pd3dImmediateContext);
+	ToneMapping(pd3dDevice, OutCommands);
 
-	ID3D11ShaderResourceView* ppSRVNULL[3] = { nullptr, nullptr, nullptr };
-	pd3dImmediateContext->PSSetShaderResources(0, 3, ppSRVNULL);
-
-	// release resources
-	SAFE_RELEASE(pOrigRTV);
-	SAFE_RELEASE(pOrigDSV);
+	for (UINT i = 0; i < 3; ++i)
+	{
+		OutCommands.SetShaderResource(EShaderStage::Pixel, i, nullptr);
+	}
 }
 
-void CPostProcess::ToneMapping(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext)
+void CPostProcess::ToneMapping(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands)
 {
+	PROFILE_SCOPE("CPostProcess::ToneMapping");
 	CRenderStates& RenderStates = CRenderStates::GetInstance();
 
 	auto pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
 
 	// render tone mapping
-	ID3D11ShaderResourceView* aRViews[3] = { mTexRenderRV, mTexToneMapRV[0], nullptr };
-	pd3dImmediateContext->PSSetShaderResources(0, 3, aRViews);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 0, mSceneTarget->mSRV);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 1, mToneMapTargets[0]->mSRV);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 2, nullptr);
 
-	ID3D11SamplerState* aSamplers[] = {
-		RenderStates.GetSamplerState(false, false), RenderStates.GetSamplerState(true, false) };
-	pd3dImmediateContext->PSSetSamplers(0, 2, aSamplers);
+	OutCommands.SetSampler(EShaderStage::Pixel, 0, RenderStates.GetSamplerState(false, false));
+	OutCommands.SetSampler(EShaderStage::Pixel, 1, RenderStates.GetSamplerState(true, false));
 
-	DrawFullScreenQuad11(pd3dImmediateContext, mFinalPassPS, pBackBufferDesc->Width, pBackBufferDesc->Height);
+	DrawFullScreenQuad11(OutCommands, mFinalPassPS, pBackBufferDesc->Width, pBackBufferDesc->Height);
 }
 
-HRESULT CPostProcess::MeasureLuminancePS11(ID3D11DeviceContext* pd3dImmediateContext)
+HRESULT CPostProcess::MeasureLuminancePS11(CRenderCommandList& OutCommands)
 {
 	CRenderStates& RenderStates = CRenderStates::GetInstance();
 
@@ -102,27 +97,20 @@ HRESULT CPostProcess::MeasureLuminancePS11(ID3D11DeviceContext* pd3dImmediateCon
 	//-------------------------------------------------------------------------
 	// Initial sampling pass to convert the image to the log of the grayscale
 	//-------------------------------------------------------------------------
-	pTexSrc = mTexRenderRV;
-	pTexDest = mTexToneMapRV[NUM_TONEMAP_TEXTURES - 1];
-	pSurfDest = mTexToneMapRTV[NUM_TONEMAP_TEXTURES - 1];
+	pTexSrc = mSceneTarget->mSRV;
+	pTexDest = mToneMapTargets[NUM_TONEMAP_TEXTURES - 1]->mSRV;
+	pSurfDest = mToneMapTargets[NUM_TONEMAP_TEXTURES - 1]->mRTV;
 
-	D3D11_TEXTURE2D_DESC descSrc;
-	mTexRender->GetDesc(&descSrc);
-	D3D11_TEXTURE2D_DESC descDest;
-	mTexToneMap[NUM_TONEMAP_TEXTURES - 1]->GetDesc(&descDest);
+	const FRenderTargetDesc& descDest = mToneMapTargets[NUM_TONEMAP_TEXTURES - 1]->mDesc;
 
-	ID3D11RenderTargetView* aRTViews[1] = { pSurfDest };
-	pd3dImmediateContext->OMSetRenderTargets(1, aRTViews, nullptr);
-	ID3D11ShaderResourceView* aRViews[1] = { pTexSrc };
-	pd3dImmediateContext->PSSetShaderResources(0, 1, aRViews);
+	OutCommands.SetRenderTargets(pSurfDest, nullptr);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 0, pTexSrc);
 
-	ID3D11SamplerState* aSamplers[] = { RenderStates.GetSamplerState(false, false) };
-	pd3dImmediateContext->PSSetSamplers(0, 1, aSamplers);
+	OutCommands.SetSampler(EShaderStage::Pixel, 0, RenderStates.GetSamplerState(false, false));
 
-	DrawFullScreenQuad11(pd3dImmediateContext, mDownScale2x2LumPS, descDest.Width, descDest.Height);
+	DrawFullScreenQuad11(OutCommands, mDownScale2x2LumPS, descDest.mWidth, descDest.mHeight);
 
-	ID3D11ShaderResourceView* ppSRVNULL[1] = { nullptr };
-	pd3dImmediateContext->PSSetShaderResources(0, 1, ppSRVNULL);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 0, nullptr);
 
 	//-------------------------------------------------------------------------
 	// Iterate through the remaining tone map textures
@@ -130,139 +118,50 @@ HRESULT CPostProcess::MeasureLuminancePS11(ID3D11DeviceContext* pd3dImmediateCon
 	for (int i = NUM_TONEMAP_TEXTURES - 1; i > 0; i--)
 	{
 		// Cycle the textures
-		pTexSrc = mTexToneMapRV[i];
-		pTexDest = mTexToneMapRV[i - 1];
-		pSurfDest = mTexToneMapRTV[i - 1];
+		pTexSrc = mToneMapTargets[i]->mSRV;
+		pTexDest = mToneMapTargets[i - 1]->mSRV;
+		pSurfDest = mToneMapTargets[i - 1]->mRTV;
 
-		D3D11_TEXTURE2D_DESC desc;
-		mTexToneMap[i]->GetDesc(&desc);
+		const FRenderTargetDesc& desc = mToneMapTargets[i]->mDesc;
 
-		ID3D11RenderTargetView* aRTViews2[1] = { pSurfDest };
-		pd3dImmediateContext->OMSetRenderTargets(1, aRTViews2, nullptr);
+		OutCommands.SetRenderTargets(pSurfDest, nullptr);
 
-		ID3D11ShaderResourceView* aRViews2[1] = { pTexSrc };
-		pd3dImmediateContext->PSSetShaderResources(0, 1, aRViews2);
+		OutCommands.SetShaderResource(EShaderStage::Pixel, 0, pTexSrc);
 
-		DrawFullScreenQuad11(pd3dImmediateContext, mDownScale3x3PS, desc.Width / 3, desc.Height / 3);
+		DrawFullScreenQuad11(OutCommands, mDownScale3x3PS, desc.mWidth / 3, desc.mHeight / 3);
 
-		ID3D11ShaderResourceView* ppSRVNULL2[1] = { nullptr };
-		pd3dImmediateContext->PSSetShaderResources(0, 1, ppSRVNULL2);
+		OutCommands.SetShaderResource(EShaderStage::Pixel, 0, nullptr);
 	}
 
 	return S_OK;
 }
 
-void CPostProcess::CreateResources(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
-	const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
+void CPostProcess::CreateDeviceResources(ID3D11Device* pd3dDevice)
 {
-#ifdef _DEBUG
-	// Disable optimizations to further improve shader debugging
-	DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
-#else
-	DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#endif
-
 	HRESULT hr;
+	CRenderTargetPool& Pool = CRenderTargetPool::GetInstance();
 
-	// Create the render target texture
-	D3D11_TEXTURE2D_DESC Desc = {};
-	Desc.ArraySize = 1;
-	Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-	Desc.Usage = D3D11_USAGE_DEFAULT;
-	Desc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	Desc.Width = pBackBufferSurfaceDesc->Width;
-	Desc.Height = pBackBufferSurfaceDesc->Height;
-	Desc.MipLevels = 1;
-	Desc.SampleDesc.Count = 1;
-	hr = (pd3dDevice->CreateTexture2D(&Desc, nullptr, &mTexRender));
-	assert(SUCCEEDED(hr));
-
-	// Create the render target view
-	D3D11_RENDER_TARGET_VIEW_DESC DescRT;
-	DescRT.Format = Desc.Format;
-	DescRT.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-	DescRT.Texture2D.MipSlice = 0;
-	hr = (pd3dDevice->CreateRenderTargetView(mTexRender, &DescRT, &mTexRenderRTV));
-	assert(SUCCEEDED(hr));
-
-	// Create the resource view
-	D3D11_SHADER_RESOURCE_VIEW_DESC DescRV;
-	DescRV.Format = Desc.Format;
-	DescRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	DescRV.Texture2D.MipLevels = 1;
-	DescRV.Texture2D.MostDetailedMip = 0;
-	hr = (pd3dDevice->CreateShaderResourceView(mTexRender, &DescRV, &mTexRenderRV));
-	assert(SUCCEEDED(hr));
-
-	// Textures for tone mapping for the PS path
-	int nSampleLen = 1;
+	// Textures for tone mapping for the PS path, their size does not depend on the back buffer
+	UINT nSampleLen = 1;
 	for (int i = 0; i < NUM_TONEMAP_TEXTURES; i++)
 	{
-		D3D11_TEXTURE2D_DESC tmdesc = {};
-		tmdesc.ArraySize = 1;
-		tmdesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
-		tmdesc.Usage = D3D11_USAGE_DEFAULT;
-		tmdesc.Format = DXGI_FORMAT_R32_FLOAT;
-		tmdesc.Width = nSampleLen;
-		tmdesc.Height = nSampleLen;
-		tmdesc.MipLevels = 1;
-		tmdesc.SampleDesc.Count = 1;
-		hr = (pd3dDevice->CreateTexture2D(&tmdesc, nullptr, &mTexToneMap[i]));
-		assert(SUCCEEDED(hr));
-
-		// Create the render target view
-		D3D11_RENDER_TARGET_VIEW_DESC DescRT2;
-		DescRT2.Format = tmdesc.Format;
-		DescRT2.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
-		DescRT2.Texture2D.MipSlice = 0;
-		hr = (pd3dDevice->CreateRenderTargetView(mTexToneMap[i], &DescRT2, &mTexToneMapRTV[i]));
-		assert(SUCCEEDED(hr));
-
-		// Create the shader resource view
-		D3D11_SHADER_RESOURCE_VIEW_DESC DescRV2;
-		DescRV2.Format = tmdesc.Format;
-		DescRV2.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		DescRV2.Texture2D.MipLevels = 1;
-		DescRV2.Texture2D.MostDetailedMip = 0;
-		hr = (pd3dDevice->CreateShaderResourceView(mTexToneMap[i], &DescRV2, &mTexToneMapRV[i]));
-		assert(SUCCEEDED(hr));
-
+		assert(mToneMapTargets[i] == nullptr);
+		mToneMapTargets[i] = Pool.Acquire(pd3dDevice, FRenderTargetDesc(nSampleLen, nSampleLen, DXGI_FORMAT_R32_FLOAT));
 		nSampleLen *= 3;
 	}
 
-
-	ID3DBlob* pBlob = nullptr;
-	// Create the shaders
-	hr = (DXUTCompileFromFile(L"Shaders\\PostProcess.hlsl", nullptr, "FinalPass", "ps_5_0", dwShaderFlags, 0, &pBlob));
-	assert(SUCCEEDED(hr));
-	hr = (pd3dDevice->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &mFinalPassPS));
-	assert(SUCCEEDED(hr));
-	SAFE_RELEASE(pBlob);
-
-	hr = (DXUTCompileFromFile(L"Shaders\\PostProcess.hlsl", nullptr, "DownScale2x2_Lum", "ps_5_0", dwShaderFlags, 0, &pBlob));;
-	assert(SUCCEEDED(hr));
-	hr = (pd3dDevice->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &mDownScale2x2LumPS));;
-	assert(SUCCEEDED(hr));
-	SAFE_RELEASE(pBlob);
-
-	hr = (DXUTCompileFromFile(L"Shaders\\PostProcess.hlsl", nullptr, "DownScale3x3", "ps_5_0", dwShaderFlags, 0, &pBlob));;
-	assert(SUCCEEDED(hr));
-	hr = (pd3dDevice->CreatePixelShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &mDownScale3x3PS));;
-	assert(SUCCEEDED(hr));
-	SAFE_RELEASE(pBlob);
-
-	hr = (DXUTCompileFromFile(L"Shaders\\PostProcess.hlsl", nullptr, "QuadVS", "vs_5_0", dwShaderFlags, 0, &pBlob));
-	assert(SUCCEEDED(hr));
-	hr = (pd3dDevice->CreateVertexShader(pBlob->GetBufferPointer(), pBlob->GetBufferSize(), nullptr, &mQuadVS));
-	assert(SUCCEEDED(hr));
+	// Shaders are shared through CShaderCache
+	CShaderCache& ShaderCache = CShaderCache::GetInstance();
+	mFinalPassPS = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PostProcess.hlsl", "FinalPass");
+	mDownScale2x2LumPS = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PostProcess.hlsl", "DownScale2x2_Lum");
+	mDownScale3x3PS = ShaderCache.GetPixelShader(pd3dDevice, L"Shaders\\PostProcess.hlsl", "DownScale3x3");
+	mQuadVS = ShaderCache.GetVertexShader(pd3dDevice, L"Shaders\\PostProcess.hlsl", "QuadVS");
 	const D3D11_INPUT_ELEMENT_DESC quadlayout[] =
 	{
 		{ "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 },
 	};
-	hr = (pd3dDevice->CreateInputLayout(quadlayout, 2, pBlob->GetBufferPointer(), pBlob->GetBufferSize(), &mQuadLayout));
-	assert(SUCCEEDED(hr));
-	SAFE_RELEASE(pBlob);
+	mQuadLayout = ShaderCache.GetInputLayout(pd3dDevice, mQuadVS, quadlayout, 2);
 
 	// Create a screen quad for render to texture operations
 	SCREEN_VERTEX svQuad[4];
@@ -291,58 +190,54 @@ void CPostProcess::CreateResources(ID3D11Device* pd3dDevice, IDXGISwapChain* pSw
 	assert(SUCCEEDED(hr));
 }
 
-void CPostProcess::ReleaseResources()
+void CPostProcess::ReleaseDeviceResources()
 {
-	SAFE_RELEASE(mTexRender);
-	SAFE_RELEASE(mTexRenderRTV);
-	SAFE_RELEASE(mTexRenderRV);
-
-	SAFE_RELEASE(mDownScale2x2LumPS);
-	SAFE_RELEASE(mDownScale3x3PS);
-	SAFE_RELEASE(mFinalPassPS);
-
+	CRenderTargetPool& Pool = CRenderTargetPool::GetInstance();
 	for (int i = 0; i < NUM_TONEMAP_TEXTURES; i++)
 	{
-		SAFE_RELEASE(mTexToneMap[i]); // Tone mapping calculation textures
-		SAFE_RELEASE(mTexToneMapRV[i]);
-		SAFE_RELEASE(mTexToneMapRTV[i]);
+		Pool.Release(mToneMapTargets[i]);
 	}
 
+	// shaders and layout are owned by CShaderCache
+	mDownScale2x2LumPS = nullptr;
+	mDownScale3x3PS = nullptr;
+	mFinalPassPS = nullptr;
+	mQuadVS = nullptr;
+	mQuadLayout = nullptr;
+
 	SAFE_RELEASE(mScreenQuadVB);
-	SAFE_RELEASE(mQuadVS);
-	SAFE_RELEASE(mQuadLayout);
 }
 
-void CPostProcess::DrawFullScreenQuad11(ID3D11DeviceContext* pd3dImmediateContext,
+void CPostProcess::CreateSizeDependentResources(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc)
+{
+	// the render target texture, a pooled one when returning to an earlier size
+	assert(mSceneTarget == nullptr);
+	mSceneTarget = CRenderTargetPool::GetInstance().Acquire(pd3dDevice,
+		FRenderTargetDesc(pBackBufferSurfaceDesc->Width, pBackBufferSurfaceDesc->Height, DXGI_FORMAT_R32G32B32A32_FLOAT));
+}
+
+void CPostProcess::ReleaseSizeDependentResources()
+{
+	CRenderTargetPool::GetInstance().Release(mSceneTarget);
+}
+
+void CPostProcess::DrawFullScreenQuad11(CRenderCommandList& OutCommands,
 	ID3D11PixelShader* pPS, UINT Width, UINT Height)
 {
-	// Save the old viewport
-	D3D11_VIEWPORT vpOld[D3D11_VIEWPORT_AND_SCISSORRECT_MAX_INDEX];
-	UINT nViewPorts = 1;
-	pd3dImmediateContext->RSGetViewports(&nViewPorts, vpOld);
-
-	// Setup the viewport to match the backbuffer
-	D3D11_VIEWPORT vp;
-	vp.Width = (float)Width;
-	vp.Height = (float)Height;
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-	vp.TopLeftX = 0;
-	vp.TopLeftY = 0;
-	pd3dImmediateContext->RSSetViewports(1, &vp);
-
-	UINT strides = sizeof(SCREEN_VERTEX);
-	UINT offsets = 0;
-	ID3D11Buffer* pBuffers[1] = { mScreenQuadVB };
-
-	pd3dImmediateContext->IASetInputLayout(mQuadLayout);
-	pd3dImmediateContext->IASetVertexBuffers(0, 1, pBuffers, &strides, &offsets);
-	pd3dImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-
-	pd3dImmediateContext->VSSetShader(mQuadVS, nullptr, 0);
-	pd3dImmediateContext->PSSetShader(pPS, nullptr, 0);
-	pd3dImmediateContext->Draw(4, 0);
-
-	// Restore the Old viewport
-	pd3dImmediateContext->RSSetViewports(nViewPorts, vpOld);
-}
\ No newline at end of file
+	// Setup the viewport to match the target
+	OutCommands.SetViewport((float)Width, (float)Height);
+
+	FPipelineState Pipeline;
+	Pipeline.mVertexShader = mQuadVS;
+	Pipeline.mPixelShader = pPS;
+	Pipeline.mInputLayout = mQuadLayout;
+	Pipeline.mRasterizerState = CRenderStates::GetInstance().GetRasterizerState(false);
+	Pipeline.mTopology = EPrimitiveTopology::TriangleStrip;
+	OutCommands.SetPipeline(Pipeline);
+	OutCommands.SetVertexBuffer(mScreenQuadVB, sizeof(SCREEN_VERTEX), 0);
+	OutCommands.Draw(4, 0);
+
+	// Restore the back buffer viewport
+	auto pBackBufferDesc = DXUTGetDXGIBackBufferSurfaceDesc();
+	OutCommands.SetViewport((float)pBackBufferDesc->Width, (float)pBackBufferDesc->Height);
+}
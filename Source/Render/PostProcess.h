@@ -9,6 +9,8 @@
 #include <string>
 #include <map>
 #include <d3d11.h>
+#include "RenderCommands.h"
+#include "RenderTargetPool.h"
 
 using namespace std;
 using namespace DirectX;
@@ -32,37 +34,34 @@ private:
 public:
 	static CPostProcess& GetInstance();
 
-	// Render HDR.
-	void RenderHDR(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext);
+	// Render HDR, recording into the command list.
+	void RenderHDR(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
 
-	// Create resources for post process rendering.
-	void CreateResources(ID3D11Device* pd3dDevice, IDXGISwapChain* pSwapChain,
-		const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
-	// Release render resources.
-	void ReleaseResources();
+	// Create resources living as long as the device: shaders, quad geometry and tone mapping targets.
+	void CreateDeviceResources(ID3D11Device* pd3dDevice);
+	// Release resources created by CreateDeviceResources.
+	void ReleaseDeviceResources();
+	// Acquire targets matching the back buffer size from CRenderTargetPool.
+	void CreateSizeDependentResources(ID3D11Device* pd3dDevice, const DXGI_SURFACE_DESC* pBackBufferSurfaceDesc);
+	// Return the size dependent targets to the pool.
+	void ReleaseSizeDependentResources();
 
 private:
 	// Tone mapping.
-	void ToneMapping(ID3D11Device* pd3dDevice, ID3D11DeviceContext* pd3dImmediateContext);
-	// Draw full screen quad for post process.
-	void DrawFullScreenQuad11(ID3D11DeviceContext* pd3dImmediateContext,
+	void ToneMapping(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands);
+	// Draw full screen quad for post process, restoring the back buffer viewport afterwards.
+	void DrawFullScreenQuad11(CRenderCommandList& OutCommands,
 		ID3D11PixelShader* pPS, UINT Width, UINT Height);
 
 	// Measure luminance.
-	HRESULT MeasureLuminancePS11(ID3D11DeviceContext* pd3dImmediateContext);
+	HRESULT MeasureLuminancePS11(CRenderCommandList& OutCommands);
 
 private:
-	// texture
-	ID3D11Texture2D* mTexRender;
-	// render target view
-	ID3D11RenderTargetView* mTexRenderRTV;
-	// shader resource view
-	ID3D11ShaderResourceView* mTexRenderRV;
+	// HDR scene color, back buffer sized
+	FPooledRenderTarget* mSceneTarget;
 
-	// Tone mapping calculation textures used in PS path
-	ID3D11Texture2D* mTexToneMap[NUM_TONEMAP_TEXTURES]; 
-	ID3D11ShaderResourceView* mTexToneMapRV[NUM_TONEMAP_TEXTURES];
-	ID3D11RenderTargetView* mTexToneMapRTV[NUM_TONEMAP_TEXTURES];
+	// Tone mapping calculation textures used in PS path, 3^i texels wide
+	FPooledRenderTarget* mToneMapTargets[NUM_TONEMAP_TEXTURES];
 
 	// Shaders in PS path
 	ID3D11PixelShader* mDownScale2x2LumPS;
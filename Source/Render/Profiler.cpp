@@ -0,0 +1,172 @@
+#include "Profiler.h"
+#include "FileUtil.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <map>
+
+namespace
+{
+	// Write a zone name as a JSON string.
+	void WriteJsonString(FILE* fp, const char* InString)
+	{
+		fputc('"', fp);
+		for (const char* c = InString; *c != 0; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				fputc('\\', fp);
+			}
+			fputc(*c, fp);
+		}
+		fputc('"', fp);
+	}
+}
+
+atomic<bool> CProfiler::bEnabled(true);
+
+CProfiler::CProfiler()
+	: mStartTicks(0)
+	, mTicksPerSecond(1e9)
+{
+#if PROFILER_USE_RDTSC
+	// the time stamp counter runs at a constant rate, measure it against the steady clock
+	auto StartTime = chrono::steady_clock::now();
+	uint64_t StartTicks = ReadTicks();
+	chrono::duration<double> Elapsed;
+	do
+	{
+		Elapsed = chrono::steady_clock::now() - StartTime;
+	} while (Elapsed.count() < .01);
+	mTicksPerSecond = (double)(ReadTicks() - StartTicks) / Elapsed.count();
+#endif
+	mStartTicks = ReadTicks();
+}
+
+CProfiler::~CProfiler()
+{
+	for (FProfileThread* Thread : mThreads)
+	{
+		delete Thread;
+	}
+}
+
+CProfiler& CProfiler::GetInstance()
+{
+	static CProfiler GInstance;
+	return GInstance;
+}
+
+FProfileThread* CProfiler::RegisterThread()
+{
+	FProfileThread* Thread = new FProfileThread;
+	Thread->mEvents.resize(FProfileThread::Capacity);
+	Thread->mNumEvents.store(0);
+	Thread->mDepth = 0;
+
+	lock_guard<mutex> Lock(mThreadsMutex);
+	Thread->mThreadId = (int)mThreads.size();
+	mThreads.push_back(Thread);
+	return Thread;
+}
+
+void CProfiler::Clear()
+{
+	lock_guard<mutex> Lock(mThreadsMutex);
+	for (FProfileThread* Thread : mThreads)
+	{
+		Thread->mNumEvents.store(0, memory_order_relaxed);
+	}
+}
+
+void CProfiler::CollectEvents(vector<pair<int, FProfileEvent>>& OutEvents) const
+{
+	OutEvents.clear();
+	lock_guard<mutex> Lock(mThreadsMutex);
+	for (const FProfileThread* Thread : mThreads)
+	{
+		uint64_t End = Thread->mNumEvents.load(memory_order_acquire);
+		uint64_t Begin = End > FProfileThread::Capacity ? End - FProfileThread::Capacity : 0;
+		for (uint64_t i = Begin; i < End; ++i)
+		{
+			OutEvents.push_back(make_pair(Thread->mThreadId, Thread->mEvents[i & (FProfileThread::Capacity - 1)]));
+		}
+	}
+}
+
+double CProfiler::Percentile(const vector<double>& InSorted, double InFraction)
+{
+	assert(!InSorted.empty());
+	size_t Rank = (size_t)(InFraction * InSorted.size());
+	return InSorted[min(Rank, InSorted.size() - 1)];
+}
+
+void CProfiler::GetZoneStats(vector<FProfileZoneStats>& OutStats) const
+{
+	vector<pair<int, FProfileEvent>> Events;
+	CollectEvents(Events);
+
+	// zones with the same name in different files have different literals
+	map<string, vector<double>> Durations;
+	double UsPerTick = 1e6 / mTicksPerSecond;
+	for (const auto& Event : Events)
+	{
+		Durations[Event.second.mName].push_back((Event.second.mEnd - Event.second.mBegin) * UsPerTick);
+	}
+
+	OutStats.clear();
+	for (auto& Zone : Durations)
+	{
+		vector<double>& Sorted = Zone.second;
+		sort(Sorted.begin(), Sorted.end());
+		double TotalUs = 0;
+		for (double Us : Sorted)
+		{
+			TotalUs += Us;
+		}
+
+		FProfileZoneStats Stats;
+		Stats.mName = Zone.first;
+		Stats.mCount = (int)Sorted.size();
+		Stats.mTotalMs = TotalUs * 1e-3;
+		Stats.mMeanUs = TotalUs / Sorted.size();
+		Stats.mP50Us = Percentile(Sorted, .5);
+		Stats.mP90Us = Percentile(Sorted, .9);
+		Stats.mP99Us = Percentile(Sorted, .99);
+		Stats.mMaxUs = Sorted.back();
+		OutStats.push_back(Stats);
+	}
+	sort(OutStats.begin(), OutStats.end(), [](const FProfileZoneStats& A, const FProfileZoneStats& B)
+	{
+		return A.mTotalMs > B.mTotalMs;
+	});
+}
+
+bool CProfiler::WriteChromeTrace(const string& InFileName) const
+{
+	vector<pair<int, FProfileEvent>> Events;
+	CollectEvents(Events);
+
+	FILE* fp = OpenFile(InFileName.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+
+	// complete events, the viewer nests them by time
+	double UsPerTick = 1e6 / mTicksPerSecond;
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (size_t i = 0; i < Events.size(); ++i)
+	{
+		const FProfileEvent& Event = Events[i].second;
+		fprintf(fp, "%s\n{\"name\":", i > 0 ? "," : "");
+		WriteJsonString(fp, Event.mName);
+		fprintf(fp, ",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"depth\":%u}}",
+			Events[i].first, ((double)Event.mBegin - (double)mStartTicks) * UsPerTick,
+			(Event.mEnd - Event.mBegin) * UsPerTick, Event.mDepth);
+	}
+	fprintf(fp, "\n]}\n");
+
+	bool bWritten = ferror(fp) == 0;
+	fclose(fp);
+	return bWritten;
+}
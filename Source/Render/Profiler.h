@@ -0,0 +1,184 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_USE_RDTSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_USE_RDTSC 1
+#else
+#include <chrono>
+#define PROFILER_USE_RDTSC 0
+#endif
+
+using namespace std;
+
+// A closed zone of one thread, in ticks of CProfiler::ReadTicks.
+struct FProfileEvent
+{
+	// zone name, a string literal
+	const char* mName;
+	uint64_t mBegin;
+	uint64_t mEnd;
+	// zones open on the thread when this one began
+	uint32_t mDepth;
+};
+
+// Ring of the last events of one thread, written by that thread only.
+struct FProfileThread
+{
+	// events kept, a power of two
+	static const uint32_t Capacity = 1 << 16;
+
+	// Append a closed zone, overwriting the oldest one when full.
+	void Write(const char* InName, uint64_t InBegin, uint64_t InEnd, uint32_t InDepth)
+	{
+		uint64_t Index = mNumEvents.load(memory_order_relaxed);
+		FProfileEvent& Event = mEvents[Index & (Capacity - 1)];
+		Event.mName = InName;
+		Event.mBegin = InBegin;
+		Event.mEnd = InEnd;
+		Event.mDepth = InDepth;
+		mNumEvents.store(Index + 1, memory_order_release);
+	}
+
+	// Capacity events
+	vector<FProfileEvent> mEvents;
+	// events written since the last clear, the last Capacity of them are kept
+	atomic<uint64_t> mNumEvents;
+	// zones open on the thread
+	uint32_t mDepth;
+	// order of registration, the thread id of exported events
+	int mThreadId;
+};
+
+// Timing of one zone over the recorded events.
+struct FProfileZoneStats
+{
+	string mName;
+	// recorded events
+	int mCount;
+	// milliseconds of all events
+	double mTotalMs;
+	// microseconds per event
+	double mMeanUs;
+	double mP50Us;
+	double mP90Us;
+	double mP99Us;
+	double mMaxUs;
+};
+
+// Hierarchical CPU profiler. Zones are scopes marked with PROFILE_SCOPE, each thread records its closed zones
+// into its own ring without locks, so profiling can stay enabled in shipping builds. The rings are exported as
+// a chrome://tracing file or summarized per zone.
+//
+// Exporting reads the rings of all threads, events written meanwhile may be torn, so export between frames.
+class CProfiler
+{
+private:
+	CProfiler();
+
+public:
+	~CProfiler();
+
+	static CProfiler& GetInstance();
+
+	// Record zones or not, enabled by default.
+	static void SetEnabled(bool bInEnabled) { bEnabled.store(bInEnabled, memory_order_relaxed); }
+	static bool IsEnabled() { return bEnabled.load(memory_order_relaxed); }
+
+	// Current time in ticks, the time stamp counter where available.
+	static uint64_t ReadTicks()
+	{
+#if PROFILER_USE_RDTSC
+		return __rdtsc();
+#else
+		return (uint64_t)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+	// Ticks of ReadTicks per second, measured at startup.
+	double GetTicksPerSecond() const { return mTicksPerSecond; }
+
+	// Ring of the calling thread, created on first use.
+	FProfileThread& GetThread()
+	{
+		thread_local FProfileThread* GThread = nullptr;
+		if (GThread == nullptr)
+		{
+			GThread = RegisterThread();
+		}
+		return *GThread;
+	}
+
+	// Drop all recorded events.
+	void Clear();
+	// Count, total and percentiles of every zone name, the most expensive first.
+	void GetZoneStats(vector<FProfileZoneStats>& OutStats) const;
+	// Write the recorded events in the JSON trace format of chrome://tracing.
+	bool WriteChromeTrace(const string& InFileName) const;
+	// Nearest rank percentile of sorted values, InFraction in [0, 1].
+	static double Percentile(const vector<double>& InSorted, double InFraction);
+
+private:
+	// Create the ring of the calling thread.
+	FProfileThread* RegisterThread();
+	// Copy the kept events of all threads with their thread id.
+	void CollectEvents(vector<pair<int, FProfileEvent>>& OutEvents) const;
+
+private:
+	// rings of all threads which recorded a zone, kept until exit
+	mutable mutex mThreadsMutex;
+	vector<FProfileThread*> mThreads;
+
+	// static, so a disabled zone costs one load and no call to GetInstance
+	static atomic<bool> bEnabled;
+	// time zero of exported traces
+	uint64_t mStartTicks;
+	double mTicksPerSecond;
+};
+
+// Records its lifetime as a zone of the calling thread.
+class CProfileScope
+{
+public:
+	explicit CProfileScope(const char* InName)
+		: mThread(nullptr)
+	{
+		if (CProfiler::IsEnabled())
+		{
+			mThread = &CProfiler::GetInstance().GetThread();
+			mName = InName;
+			mDepth = mThread->mDepth++;
+			mBegin = CProfiler::ReadTicks();
+		}
+	}
+
+	~CProfileScope()
+	{
+		if (mThread != nullptr)
+		{
+			mThread->Write(mName, mBegin, CProfiler::ReadTicks(), mDepth);
+			--mThread->mDepth;
+		}
+	}
+
+	CProfileScope(const CProfileScope&) = delete;
+	CProfileScope& operator=(const CProfileScope&) = delete;
+
+private:
+	// null when the profiler was disabled
+	FProfileThread* mThread;
+	const char* mName;
+	uint64_t mBegin;
+	uint32_t mDepth;
+};
+
+#define PROFILE_CONCAT_INNER(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_INNER(A, B)
+// Profile the rest of the enclosing scope as a zone named InName, a string literal.
+#define PROFILE_SCOPE(InName) CProfileScope PROFILE_CONCAT(ProfileScope, __LINE__)(InName)
@@ -0,0 +1,510 @@
+#include "RectBvh.h"
+#include "RectProxy.h"
+#include "RectStore.h"
+#include "../CpuGI/GIMath.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace GIMath;
+
+namespace
+{
+	// SG lobe cut, the NDF of sgNDF drops below 1% of its peak outside the reflection cone
+	const float GLobeCutLog = 4.60517f;
+
+	// Axis aligned box.
+	struct FBox
+	{
+		float3 mMin;
+		float3 mMax;
+
+		FBox() : mMin(1e30f), mMax(-1e30f) {}
+
+		void Grow(const float3& InMin, const float3& InMax)
+		{
+			mMin = float3(min(mMin.x, InMin.x), min(mMin.y, InMin.y), min(mMin.z, InMin.z));
+			mMax = float3(max(mMax.x, InMax.x), max(mMax.y, InMax.y), max(mMax.z, InMax.z));
+		}
+		void Grow(const FBox& InBox) { Grow(InBox.mMin, InBox.mMax); }
+		void Grow(const float3& InPoint) { Grow(InPoint, InPoint); }
+
+		float3 Center() const { return (mMin + mMax) * .5f; }
+		float Component(const float3& v, int InAxis) const { return InAxis == 0 ? v.x : (InAxis == 1 ? v.y : v.z); }
+
+		// half surface area, enough for comparing SAH costs
+		float HalfArea() const
+		{
+			float3 d = mMax - mMin;
+			return d.x < 0 ? 0 : d.x * d.y + d.y * d.z + d.z * d.x;
+		}
+	};
+
+	// Rect geometry read from the store streams.
+	struct FRectGeometry
+	{
+		float3 mCenter;
+		float3 mNormal;
+		float3 mMajorAxis;
+		float3 mMinorAxis;
+		float mMajorRadius;
+		float mMinorRadius;
+		float mRoughness;
+
+		FRectGeometry(const CRectStore& InStore, int InIndex)
+		{
+			mCenter = Load(InStore, ERectStream::CenterX, InIndex);
+			mNormal = normalize(Load(InStore, ERectStream::NormalX, InIndex));
+			mMajorAxis = normalize(Load(InStore, ERectStream::MajorAxisX, InIndex));
+			mMinorAxis = normalize(cross(mNormal, mMajorAxis));
+			mMajorRadius = InStore.GetStream(ERectStream::MajorRadius)[InIndex];
+			mMinorRadius = InStore.GetStream(ERectStream::MinorRadius)[InIndex];
+			mRoughness = InStore.GetStream(ERectStream::Roughness)[InIndex];
+		}
+
+		static float3 Load(const CRectStore& InStore, ERectStream::Type InFirst, int InIndex)
+		{
+			return float3(InStore.GetStream(InFirst)[InIndex], InStore.GetStream((ERectStream::Type)(InFirst + 1))[InIndex],
+				InStore.GetStream((ERectStream::Type)(InFirst + 2))[InIndex]);
+		}
+
+		// radius of the circumscribed sphere
+		float Radius() const { return std::sqrt(mMajorRadius * mMajorRadius + mMinorRadius * mMinorRadius); }
+
+		FBox Bounds() const
+		{
+			float3 Extent = float3(std::fabs(mMajorAxis.x), std::fabs(mMajorAxis.y), std::fabs(mMajorAxis.z)) * mMajorRadius +
+				float3(std::fabs(mMinorAxis.x), std::fabs(mMinorAxis.y), std::fabs(mMinorAxis.z)) * mMinorRadius;
+			FBox Box;
+			Box.Grow(mCenter - Extent, mCenter + Extent);
+			return Box;
+		}
+	};
+
+	float AngleBetween(const float3& a, const float3& b)
+	{
+		float d = dot(a, b) / std::sqrt(dot(a, a) * dot(b, b));
+		return std::acos(min(max(d, -1.f), 1.f));
+	}
+
+	// Smallest cone around both cones, angles in radians.
+	void MergeCones(float3& InOutAxis, float& InOutAngle, const float3& InAxis, float InAngle)
+	{
+		if (InOutAngle >= PI || InAngle >= PI)
+		{
+			InOutAngle = PI;
+			return;
+		}
+
+		float Between = AngleBetween(InOutAxis, InAxis);
+		if (Between + InAngle <= InOutAngle)
+			return;
+		if (Between + InOutAngle <= InAngle)
+		{
+			InOutAxis = InAxis;
+			InOutAngle = InAngle;
+			return;
+		}
+
+		float Angle = (InOutAngle + Between + InAngle) * .5f;
+		if (Angle >= PI || std::sin(Between) < 1e-4f)
+		{
+			InOutAngle = PI;
+			return;
+		}
+
+		// rotate the first axis towards the second one
+		float t = (Angle - InOutAngle) / Between;
+		float3 Axis = (InOutAxis * std::sin((1 - t) * Between) + InAxis * std::sin(t * Between)) / std::sin(Between);
+		InOutAxis = normalize(Axis);
+		InOutAngle = Angle;
+	}
+
+	// Angular radius of a sphere seen from distance InDist.
+	float SphereSpread(float InRadius, float InDist)
+	{
+		return InDist > InRadius ? std::asin(InRadius / InDist) : PI;
+	}
+
+	float3 ToFloat3(const XMFLOAT3& v) { return float3(v.x, v.y, v.z); }
+
+	// Build input of one rect.
+	struct FBuildPrim
+	{
+		FBox mBounds;
+		float3 mCentroid;
+		int mIndex;
+	};
+}
+
+FRectQuery::FRectQuery()
+	: mPoint(0.f, 0.f, 0.f)
+	, mPointRadius(0)
+	, mMaxDistance(1e30f)
+	, mExcludeIndex(-1)
+	, bSpecular(false)
+	, mLightDir(0.f, 0.f, 1.f)
+	, mMaxRoughness(.3f)
+{
+
+}
+
+CRectBvh::CRectBvh()
+	: mStore(nullptr)
+	, mLayoutVersion(0)
+{
+
+}
+
+float CRectBvh::ReflectionConeAngle(float InRoughness)
+{
+	// exp(2 / m2 * (cos - 1)) of sgNDF at the cut, doubled from half vector to reflected direction
+	float m2 = InRoughness * InRoughness;
+	float CosHalf = 1 - m2 * GLobeCutLog * .5f;
+	return min(2 * std::acos(max(CosHalf, -1.f)), PI);
+}
+
+void CRectBvh::Build(const CRectStore& InStore)
+{
+	mStore = &InStore;
+	mLayoutVersion = InStore.GetLayoutVersion();
+	mNodes.clear();
+	mRectIndices.clear();
+
+	int NumRects = InStore.Num();
+	if (NumRects == 0)
+		return;
+
+	vector<FBuildPrim> Prims(NumRects);
+	for (int i = 0; i < NumRects; ++i)
+	{
+		Prims[i].mBounds = FRectGeometry(InStore, i).Bounds();
+		Prims[i].mCentroid = Prims[i].mBounds.Center();
+		Prims[i].mIndex = i;
+	}
+
+	// at most 2n - 1 nodes
+	mNodes.reserve(2 * NumRects);
+	mNodes.push_back(FRectBvhNode());
+
+	struct FTask
+	{
+		int mNode;
+		int mBegin;
+		int mEnd;
+		int mDepth;
+	};
+	vector<FTask> Tasks;
+	Tasks.push_back({ 0, 0, NumRects, 0 });
+
+	while (!Tasks.empty())
+	{
+		FTask Task = Tasks.back();
+		Tasks.pop_back();
+		int Count = Task.mEnd - Task.mBegin;
+
+		FBox CentroidBounds;
+		for (int i = Task.mBegin; i < Task.mEnd; ++i)
+		{
+			CentroidBounds.Grow(Prims[i].mCentroid);
+		}
+
+		// binned SAH over the axes with centroid extent
+		int BestAxis = -1;
+		int BestSplit = 0;
+		float BestCost = 1e30f;
+		if (Count > MaxLeafSize && Task.mDepth < MaxDepth)
+		{
+			for (int Axis = 0; Axis < 3; ++Axis)
+			{
+				float AxisMin = CentroidBounds.Component(CentroidBounds.mMin, Axis);
+				float Extent = CentroidBounds.Component(CentroidBounds.mMax, Axis) - AxisMin;
+				if (Extent <= 0)
+					continue;
+
+				FBox BinBounds[NumBins];
+				int BinCounts[NumBins] = { 0 };
+				float Scale = NumBins / Extent;
+				for (int i = Task.mBegin; i < Task.mEnd; ++i)
+				{
+					int Bin = min((int)((CentroidBounds.Component(Prims[i].mCentroid, Axis) - AxisMin) * Scale), NumBins - 1);
+					BinBounds[Bin].Grow(Prims[i].mBounds);
+					++BinCounts[Bin];
+				}
+
+				// sweep from the right, then evaluate every split from the left
+				float RightCosts[NumBins];
+				FBox Right;
+				int RightCount = 0;
+				for (int Bin = NumBins - 1; Bin > 0; --Bin)
+				{
+					Right.Grow(BinBounds[Bin]);
+					RightCount += BinCounts[Bin];
+					RightCosts[Bin] = RightCount * Right.HalfArea();
+				}
+
+				FBox Left;
+				int LeftCount = 0;
+				for (int Bin = 0; Bin < NumBins - 1; ++Bin)
+				{
+					Left.Grow(BinBounds[Bin]);
+					LeftCount += BinCounts[Bin];
+					float Cost = LeftCount * Left.HalfArea() + RightCosts[Bin + 1];
+					if (LeftCount > 0 && LeftCount < Count && Cost < BestCost)
+					{
+						BestCost = Cost;
+						BestAxis = Axis;
+						BestSplit = Bin;
+					}
+				}
+			}
+		}
+
+		// leaf: small enough, too deep, or all centroids coincide
+		if (BestAxis < 0)
+		{
+			FRectBvhNode& Node = mNodes[Task.mNode];
+			Node.mFirst = (int32_t)mRectIndices.size();
+			Node.mCount = Count;
+			for (int i = Task.mBegin; i < Task.mEnd; ++i)
+			{
+				mRectIndices.push_back(Prims[i].mIndex);
+			}
+			continue;
+		}
+
+		float AxisMin = CentroidBounds.Component(CentroidBounds.mMin, BestAxis);
+		float Scale = NumBins / (CentroidBounds.Component(CentroidBounds.mMax, BestAxis) - AxisMin);
+		FBuildPrim* Middle = std::partition(&Prims[Task.mBegin], &Prims[0] + Task.mEnd,
+			[&](const FBuildPrim& Prim) -> bool
+		{
+			int Bin = min((int)((CentroidBounds.Component(Prim.mCentroid, BestAxis) - AxisMin) * Scale), NumBins - 1);
+			return Bin <= BestSplit;
+		});
+		int Split = (int)(Middle - &Prims[0]);
+		assert(Split > Task.mBegin && Split < Task.mEnd);
+
+		int Left = (int)mNodes.size();
+		mNodes.push_back(FRectBvhNode());
+		mNodes.push_back(FRectBvhNode());
+		mNodes[Task.mNode].mFirst = Left;
+		mNodes[Task.mNode].mCount = 0;
+		Tasks.push_back({ Left, Task.mBegin, Split, Task.mDepth + 1 });
+		Tasks.push_back({ Left + 1, Split, Task.mEnd, Task.mDepth + 1 });
+	}
+
+	Refit(InStore);
+}
+
+void CRectBvh::RefitLeaf(const CRectStore& InStore, FRectBvhNode& Node) const
+{
+	FBox Bounds;
+	float3 NormalSum;
+	Node.mMinRoughness = 1e30f;
+	Node.mMaxRoughness = 0;
+	for (int i = 0; i < Node.mCount; ++i)
+	{
+		FRectGeometry Rect(InStore, mRectIndices[Node.mFirst + i]);
+		Bounds.Grow(Rect.Bounds());
+		NormalSum += Rect.mNormal;
+		Node.mMinRoughness = min(Node.mMinRoughness, Rect.mRoughness);
+		Node.mMaxRoughness = max(Node.mMaxRoughness, Rect.mRoughness);
+	}
+
+	float3 Center = Bounds.Center();
+	float3 Axis = length(NormalSum) > 1e-4f ? normalize(NormalSum) : float3(0.f, 0.f, 1.f);
+	float Angle = length(NormalSum) > 1e-4f ? 0 : PI;
+	float Radius = 0;
+	for (int i = 0; i < Node.mCount; ++i)
+	{
+		FRectGeometry Rect(InStore, mRectIndices[Node.mFirst + i]);
+		Radius = max(Radius, length(Rect.mCenter - Center) + Rect.Radius());
+		if (Angle < PI)
+		{
+			Angle = max(Angle, AngleBetween(Axis, Rect.mNormal));
+		}
+	}
+
+	Node.mMin[0] = Bounds.mMin.x; Node.mMin[1] = Bounds.mMin.y; Node.mMin[2] = Bounds.mMin.z;
+	Node.mMax[0] = Bounds.mMax.x; Node.mMax[1] = Bounds.mMax.y; Node.mMax[2] = Bounds.mMax.z;
+	Node.mConeAxis[0] = Axis.x; Node.mConeAxis[1] = Axis.y; Node.mConeAxis[2] = Axis.z;
+	Node.mConeAngle = Angle;
+	Node.mRadius = Radius;
+}
+
+void CRectBvh::RefitInterior(FRectBvhNode& Node) const
+{
+	const FRectBvhNode& Left = mNodes[Node.mFirst];
+	const FRectBvhNode& Right = mNodes[Node.mFirst + 1];
+
+	float3 Center;
+	for (int k = 0; k < 3; ++k)
+	{
+		Node.mMin[k] = min(Left.mMin[k], Right.mMin[k]);
+		Node.mMax[k] = max(Left.mMax[k], Right.mMax[k]);
+	}
+	Center = float3(Node.mMin[0] + Node.mMax[0], Node.mMin[1] + Node.mMax[1], Node.mMin[2] + Node.mMax[2]) * .5f;
+
+	float3 Axis(Left.mConeAxis[0], Left.mConeAxis[1], Left.mConeAxis[2]);
+	float Angle = Left.mConeAngle;
+	MergeCones(Axis, Angle, float3(Right.mConeAxis[0], Right.mConeAxis[1], Right.mConeAxis[2]), Right.mConeAngle);
+	Node.mConeAxis[0] = Axis.x; Node.mConeAxis[1] = Axis.y; Node.mConeAxis[2] = Axis.z;
+	Node.mConeAngle = Angle;
+
+	float3 LeftCenter = float3(Left.mMin[0] + Left.mMax[0], Left.mMin[1] + Left.mMax[1], Left.mMin[2] + Left.mMax[2]) * .5f;
+	float3 RightCenter = float3(Right.mMin[0] + Right.mMax[0], Right.mMin[1] + Right.mMax[1], Right.mMin[2] + Right.mMax[2]) * .5f;
+	Node.mRadius = max(length(LeftCenter - Center) + Left.mRadius, length(RightCenter - Center) + Right.mRadius);
+
+	Node.mMinRoughness = min(Left.mMinRoughness, Right.mMinRoughness);
+	Node.mMaxRoughness = max(Left.mMaxRoughness, Right.mMaxRoughness);
+}
+
+void CRectBvh::Refit(const CRectStore& InStore)
+{
+	assert(IsValidFor(InStore));
+
+	// children always follow their parent
+	for (int i = (int)mNodes.size() - 1; i >= 0; --i)
+	{
+		FRectBvhNode& Node = mNodes[i];
+		if (Node.mCount > 0)
+		{
+			RefitLeaf(InStore, Node);
+		}
+		else
+		{
+			RefitInterior(Node);
+		}
+	}
+}
+
+void CRectBvh::Update(const CRectStore& InStore)
+{
+	if (IsValidFor(InStore))
+	{
+		Refit(InStore);
+	}
+	else
+	{
+		Build(InStore);
+	}
+}
+
+bool CRectBvh::IsValidFor(const CRectStore& InStore) const
+{
+	return mStore == &InStore && mLayoutVersion == InStore.GetLayoutVersion();
+}
+
+bool CRectBvh::TestRect(const CRectStore& InStore, int InIndex, const FRectQuery& InQuery)
+{
+	if (InIndex == InQuery.mExcludeIndex)
+		return false;
+
+	FRectGeometry Rect(InStore, InIndex);
+	if (InQuery.bSpecular && Rect.mRoughness > InQuery.mMaxRoughness)
+		return false;
+
+	// front half-space
+	float3 v = ToFloat3(InQuery.mPoint) - Rect.mCenter;
+	float Height = dot(v, Rect.mNormal);
+	if (Height < -InQuery.mPointRadius)
+		return false;
+
+	// distance to the rect
+	float du = max(std::fabs(dot(v, Rect.mMajorAxis)) - Rect.mMajorRadius, 0.f);
+	float dv = max(std::fabs(dot(v, Rect.mMinorAxis)) - Rect.mMinorRadius, 0.f);
+	float MaxDist = InQuery.mMaxDistance + InQuery.mPointRadius;
+	if (du * du + dv * dv + Height * Height > MaxDist * MaxDist)
+		return false;
+
+	if (!InQuery.bSpecular)
+		return true;
+
+	// reflection cone around the mirror direction of the light
+	float3 LightDir = normalize(ToFloat3(InQuery.mLightDir));
+	float NoL = dot(Rect.mNormal, LightDir);
+	if (NoL < 0)
+		return false;
+
+	float3 MirrorDir = Rect.mNormal * (2 * NoL) - LightDir;
+	float Spread = SphereSpread(Rect.Radius() + InQuery.mPointRadius, length(v));
+	return AngleBetween(v, MirrorDir) <= ReflectionConeAngle(Rect.mRoughness) + Spread;
+}
+
+void CRectBvh::Query(const FRectQuery& InQuery, vector<int>& OutRects) const
+{
+	if (mNodes.empty())
+		return;
+	assert(IsValidFor(*mStore));
+
+	float3 Point = ToFloat3(InQuery.mPoint);
+	float3 LightDir = normalize(ToFloat3(InQuery.mLightDir));
+	float MaxDist2 = (InQuery.mMaxDistance + InQuery.mPointRadius) * (InQuery.mMaxDistance + InQuery.mPointRadius);
+
+	// one pending sibling per level
+	int Stack[MaxDepth + 2];
+	int StackSize = 0;
+	Stack[StackSize++] = 0;
+	while (StackSize > 0)
+	{
+		const FRectBvhNode& Node = mNodes[Stack[--StackSize]];
+
+		// distance to the box
+		float Dist2 = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			float p = k == 0 ? Point.x : (k == 1 ? Point.y : Point.z);
+			float d = max(max(Node.mMin[k] - p, p - Node.mMax[k]), 0.f);
+			Dist2 += d * d;
+		}
+		if (Dist2 > MaxDist2)
+			continue;
+
+		if (InQuery.bSpecular && Node.mMinRoughness > InQuery.mMaxRoughness)
+			continue;
+
+		// some normal of the cone must see the point from some position in the sphere
+		float3 Center = float3(Node.mMin[0] + Node.mMax[0], Node.mMin[1] + Node.mMax[1], Node.mMin[2] + Node.mMax[2]) * .5f;
+		float3 v = Point - Center;
+		float Dist = length(v);
+		float Radius = Node.mRadius + InQuery.mPointRadius;
+		float3 ConeAxis(Node.mConeAxis[0], Node.mConeAxis[1], Node.mConeAxis[2]);
+		if (Node.mConeAngle < PI && Dist > Radius)
+		{
+			float Beyond = AngleBetween(v, ConeAxis) - Node.mConeAngle;
+			if (Beyond > 0 && Dist * std::cos(Beyond) + Radius < 0)
+				continue;
+
+			if (InQuery.bSpecular)
+			{
+				// no normal faces the light
+				if (AngleBetween(LightDir, ConeAxis) - Node.mConeAngle > PI * .5f)
+					continue;
+
+				// mirror directions stay within twice the normal cone
+				float3 MirrorDir = ConeAxis * (2 * dot(ConeAxis, LightDir)) - LightDir;
+				float Lobe = ReflectionConeAngle(min(Node.mMaxRoughness, InQuery.mMaxRoughness));
+				if (dot(MirrorDir, MirrorDir) > 1e-8f &&
+					AngleBetween(v, MirrorDir) > 2 * Node.mConeAngle + Lobe + SphereSpread(Radius, Dist))
+					continue;
+			}
+		}
+
+		if (Node.mCount > 0)
+		{
+			for (int i = 0; i < Node.mCount; ++i)
+			{
+				int Index = mRectIndices[Node.mFirst + i];
+				if (TestRect(*mStore, Index, InQuery))
+				{
+					OutRects.push_back(Index);
+				}
+			}
+		}
+		else
+		{
+			assert(StackSize + 2 <= MaxDepth + 2);
+			Stack[StackSize++] = Node.mFirst + 1;
+			Stack[StackSize++] = Node.mFirst;
+		}
+	}
+}
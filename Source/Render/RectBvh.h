@@ -0,0 +1,111 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+using namespace DirectX;
+using namespace std;
+
+class CRectStore;
+
+// Reflector query against CRectBvh.
+struct FRectQuery
+{
+	FRectQuery();
+
+	// shading point
+	XMFLOAT3 mPoint;
+	// query a sphere around the point instead, all tests pass if they pass for some point of the sphere
+	float mPointRadius;
+	// only rects closer to the point than this
+	float mMaxDistance;
+	// dense index of a rect to skip, usually the receiver itself, or -1
+	int mExcludeIndex;
+	// test the specular reflection cone of each rect, otherwise only its front half-space
+	bool bSpecular;
+	// direction to the light, for specular queries
+	XMFLOAT3 mLightDir;
+	// rects rougher than this are skipped by specular queries, .3 like findSpecularRelatedPlanes
+	float mMaxRoughness;
+};
+
+// Node of CRectBvh, 60 bytes.
+struct FRectBvhNode
+{
+	// bounding box of the rect extents
+	float mMin[3];
+	float mMax[3];
+	// cone bounding all rect normals
+	float mConeAxis[3];
+	// half angle of the normal cone in radians, PI if the normals are unbounded
+	float mConeAngle;
+	// radius around the box center bounding the circumscribed spheres of all rects
+	float mRadius;
+	// roughness range of the rects
+	float mMinRoughness;
+	float mMaxRoughness;
+	// leaf: first entry in the rect index array, interior: left child, right child follows it
+	int32_t mFirst;
+	// rects of a leaf, 0 for interior nodes
+	int32_t mCount;
+};
+
+// Bounding volume hierarchy over the rects of a CRectStore, built with binned SAH.
+//
+// Besides a box, every node bounds the normals of its rects by a cone and keeps their roughness range,
+// so the half-space and reflection cone tests of a query reject whole subtrees:
+//	front half-space: dot(P - center, normal) >= 0, as findDiffuseRelatedPlanes
+//	reflection cone:  the light is in front of the rect and P lies within the lobe around the mirror
+//	                  direction reflect(-L, normal), widened by the angular size of the rect seen from P
+// Leaves refer to dense store indices, so the tree must be rebuilt when the store layout changes
+// (CRectStore::GetLayoutVersion); moving rects only needs a refit.
+class CRectBvh
+{
+public:
+	// most rects in a leaf
+	static const int MaxLeafSize = 4;
+	// SAH bins per axis
+	static const int NumBins = 16;
+	// deeper nodes become leaves regardless of their size, bounds the traversal stack
+	static const int MaxDepth = 60;
+
+	CRectBvh();
+
+	// Build the tree over all rects of the store.
+	void Build(const CRectStore& InStore);
+	// Recompute bounds, cones and roughness ranges bottom up, keeping the topology.
+	void Refit(const CRectStore& InStore);
+	// Build if the store layout changed since the last build, refit otherwise.
+	void Update(const CRectStore& InStore);
+	// Whether Refit is enough for the store.
+	bool IsValidFor(const CRectStore& InStore) const;
+
+	// Append the dense indices of all rects passing the query.
+	void Query(const FRectQuery& InQuery, vector<int>& OutRects) const;
+
+	// Same tests as Query for a single rect.
+	static bool TestRect(const CRectStore& InStore, int InIndex, const FRectQuery& InQuery);
+	// Half angle of the reflection lobe of a rect with given roughness.
+	static float ReflectionConeAngle(float InRoughness);
+
+	// Number of nodes.
+	int NumNodes() const { return (int)mNodes.size(); }
+	// All nodes, the root comes first.
+	const vector<FRectBvhNode>& GetNodes() const { return mNodes; }
+
+private:
+	// Recompute one leaf from the store.
+	void RefitLeaf(const CRectStore& InStore, FRectBvhNode& Node) const;
+	// Recompute one interior node from its children.
+	void RefitInterior(FRectBvhNode& Node) const;
+
+private:
+	// root first, the two children of a node are adjacent and stored after it
+	vector<FRectBvhNode> mNodes;
+	// dense store indices referenced by the leaves
+	vector<int> mRectIndices;
+	// store the tree was built from
+	const CRectStore* mStore;
+	// layout version of the store at build time
+	uint32_t mLayoutVersion;
+};
@@ -0,0 +1,50 @@
+#include "RectInstancing.h"
+#include <cassert>
+
+CRectInstancePacker::CRectInstancePacker()
+{
+}
+
+void CRectInstancePacker::Reset()
+{
+	mInstances.clear();
+	mReflectorLists.clear();
+}
+
+void CRectInstancePacker::Add(const XMFLOAT4X4& InWorld, float InRoughness, const XMFLOAT3& InDiffuseColor,
+	const int32_t* InReflectors, int InNumReflectors)
+{
+	assert(InNumReflectors >= 0 && (InNumReflectors == 0 || InReflectors != nullptr));
+
+	FRectInstanceData Instance;
+	// positions are row vectors, so the world position is the dot product with each column
+	for (int Column = 0; Column < 3; ++Column)
+	{
+		Instance.mWorld[Column] = XMFLOAT4(InWorld.m[0][Column], InWorld.m[1][Column], InWorld.m[2][Column],
+			InWorld.m[3][Column]);
+	}
+	Instance.mDiffuseRoughness = XMFLOAT4(InDiffuseColor.x, InDiffuseColor.y, InDiffuseColor.z, InRoughness);
+	Instance.mReflectorOffset = (uint32_t)mReflectorLists.size();
+	Instance.mNumReflectors = (uint32_t)InNumReflectors;
+	Instance.mPad[0] = Instance.mPad[1] = 0;
+	mInstances.push_back(Instance);
+
+	mReflectorLists.insert(mReflectorLists.end(), InReflectors, InReflectors + InNumReflectors);
+}
+
+void CRectInstancePacker::RecordDraw(CRenderCommandList& OutCommands, void* InInstanceBuffer,
+	void* InReflectorListBuffer, uint32_t InQuadIndexCount) const
+{
+	if (mInstances.empty())
+		return;
+
+	OutCommands.UpdateBuffer(InInstanceBuffer, mInstances.data(), (uint32_t)(mInstances.size() * sizeof(FRectInstanceData)));
+	if (!mReflectorLists.empty())
+	{
+		OutCommands.UpdateBuffer(InReflectorListBuffer, mReflectorLists.data(),
+			(uint32_t)(mReflectorLists.size() * sizeof(int32_t)));
+	}
+
+	OutCommands.SetVertexBuffer(InInstanceBuffer, sizeof(FRectInstanceData), 0, 1);
+	OutCommands.DrawIndexedInstanced(InQuadIndexCount, (uint32_t)mInstances.size(), 0, 0);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "RenderCommands.h"
+
+using namespace DirectX;
+using namespace std;
+
+// Per-instance vertex data of the instanced rect path, vertex stream 1 of PlaneMeshVS.hlsl with
+// RECT_INSTANCING. 80 bytes.
+struct FRectInstanceData
+{
+	// columns of the world matrix, the vertex shader dots the position with each of them
+	XMFLOAT4 mWorld[3];
+	// xyz: diffuse color, w: roughness
+	XMFLOAT4 mDiffuseRoughness;
+	// first element of this rect in the reflector lists
+	uint32_t mReflectorOffset;
+	// linked reflectors of this rect
+	uint32_t mNumReflectors;
+	uint32_t mPad[2];
+};
+
+// Packs all rect receivers into per-instance records and one array of linked reflector indices, so they
+// are drawn by a single DrawIndexedInstanced of the shared quad.
+class CRectInstancePacker
+{
+public:
+	CRectInstancePacker();
+
+	// Remove all rects, keeping the memory.
+	void Reset();
+	// Add a rect with its world matrix, material and the dense indices of its linked reflectors in psRects.
+	void Add(const XMFLOAT4X4& InWorld, float InRoughness, const XMFLOAT3& InDiffuseColor,
+		const int32_t* InReflectors, int InNumReflectors);
+
+	// Rects added since the last reset.
+	int Num() const { return (int)mInstances.size(); }
+	// Per-instance records in the order rects were added.
+	const vector<FRectInstanceData>& GetInstances() const { return mInstances; }
+	// Linked reflectors of all rects, each rect owns a range.
+	const vector<int32_t>& GetReflectorLists() const { return mReflectorLists; }
+
+	// Upload the records and lists into the given buffers and record one instanced draw of the quad.
+	// The pipeline, quad buffers and the view of the lists are bound by the caller.
+	void RecordDraw(CRenderCommandList& OutCommands, void* InInstanceBuffer, void* InReflectorListBuffer,
+		uint32_t InQuadIndexCount) const;
+
+private:
+	// per-instance records
+	vector<FRectInstanceData> mInstances;
+	// reflector indices of all instances
+	vector<int32_t> mReflectorLists;
+};
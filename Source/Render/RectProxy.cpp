@@ -4,18 +4,11 @@
 #include <DirectXMath.h>
 #include "MiniEngine.h"
 #include "RenderData.h"
+#include "ShaderBuffers.h"
+#include "JobSystem.h"
+#include "Profiler.h"
 #include <algorithm>
 
-CRect::CRect()
-	: mID(-2)
-	, mMajorRadius(0)
-	, mMinorRadius(0)
-	, mRoughness(0.1f)
-	, mDiffuseColor(1.f, 1.f, 1.f)
-{
-	
-}
-
 void CRect::GetRenderVerticesWorld(float InScale, vector<Vertex_P3>& OutVertices)
 {
 	XMVECTOR vNorm = XMVector3Normalize(XMLoadFloat3(&mNormal));
@@ -63,7 +56,12 @@ void CRect::GetRenderVerticesWVP(float InScale, vector<Vertex_P3>& OutVertices)
 
 CRectCollections::CRectCollections()
 {
-
+	// no camera matches, the first update refreshes everything
+	XMStoreFloat4x4(&mCameraWorld, XMMatrixSet(0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0));
+	mStats.mRefreshedProxies = 0;
+	mStats.mAddedProxies = 0;
+	mStats.mMovedProxies = 0;
+	mStats.bCameraChanged = false;
 }
 
 CRectCollections& CRectCollections::GetInstance()
@@ -72,28 +70,120 @@ CRectCollections& CRectCollections::GetInstance()
 	return GInstannce;
 }
 
+void CRectCollections::MarkDirty(CRenderInstance* InInstance)
+{
+	assert(InInstance->mProxyDirty);
+	mDirtyInstances.push_back(InInstance->mHandle);
+}
+
+void CRectCollections::UnmarkDirty(CRenderInstance* InInstance)
+{
+	auto it = find(mDirtyInstances.begin(), mDirtyInstances.end(), InInstance->mHandle);
+	if (it != mDirtyInstances.end())
+	{
+		*it = mDirtyInstances.back();
+		mDirtyInstances.pop_back();
+	}
+}
+
 void CRectCollections::UpdateAllProxies()
 {
-	// get render instances
-	const map<string, CRenderInstance*>& AllRenderInst = CMiniEngine::GetInstance().mRenderInstances;
+	PROFILE_SCOPE("CRectCollections::UpdateAllProxies");
+	mStats.mRefreshedProxies = 0;
+	mStats.mAddedProxies = 0;
+	mStats.mMovedProxies = 0;
+	mChangedRects.clear();
+
+	// instances moved directly or through a parent
+	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
+	MiniEngine.mTransforms.Update();
+	mMovedInstances.clear();
+	MiniEngine.mTransforms.ConsumeChanged(mMovedInstances);
+	for (uint64_t Moved : mMovedInstances)
+	{
+		MiniEngine.GetRenderInstance(FInstanceHandle::FromKey(Moved))->MarkDirty();
+	}
+
+	// proxies are transformed by the camera world matrix, so rotating the model refreshes all of them
+	XMFLOAT4X4 CameraWorld;
+	XMStoreFloat4x4(&CameraWorld, MiniEngine.mCamera.GetWorldMatrix());
+	mStats.bCameraChanged = memcmp(&CameraWorld, &mCameraWorld, sizeof(XMFLOAT4X4)) != 0;
+	if (mStats.bCameraChanged)
+	{
+		mCameraWorld = CameraWorld;
+		for (CRenderInstance& RenderInst : MiniEngine.mRenderInstances)
+		{
+			RenderInst.MarkDirty();
+		}
+	}
 
-	INT16 rectIndex = 0;
-	map<string, CRenderInstance*>::const_iterator iter;
-	for (iter = AllRenderInst.begin(); iter != AllRenderInst.end(); ++iter)
+	// proxies are computed in parallel from the updated transforms, then applied to the store in order
+	int NumDirty = (int)mDirtyInstances.size();
+	mRefreshedRects.resize(NumDirty);
+	CJobSystem::GetInstance().ParallelFor(NumDirty, ProxyGrain, [this, &MiniEngine](int InBegin, int InEnd)
 	{
-		const CRenderInstance* RenderInst = iter->second;
+		for (int i = InBegin; i < InEnd; ++i)
+		{
+			CRenderInstance* RenderInst = MiniEngine.GetRenderInstance(mDirtyInstances[i]);
+			RenderInst->mProxyDirty = false;
+			if (RenderInst->mMeshData->GetMeshType() == EMeshData::RectMesh)
+			{
+				RenderInst->GetRectProxy(mRefreshedRects[i]);
+			}
+		}
+	});
+
+	for (int i = 0; i < NumDirty; ++i)
+	{
+		CRenderInstance* RenderInst = MiniEngine.GetRenderInstance(mDirtyInstances[i]);
 		if (RenderInst->mMeshData->GetMeshType() != EMeshData::RectMesh)
 			continue;
 
-		// get rect proxy of this render instance
-		RenderInst->GetRectProxy(mAllRects[rectIndex ++]);
+		// written back in place by handle
+		const CRect& Rect = mRefreshedRects[i];
+		++mStats.mRefreshedProxies;
+		if (mRects.IsValid(RenderInst->mRectHandle))
+		{
+			CRect OldRect;
+			mRects.Get(RenderInst->mRectHandle, OldRect);
+			if (!Rect.HasSameGeometry(OldRect))
+			{
+				mChangedRects.push_back(mRects.GetIndex(RenderInst->mRectHandle));
+				++mStats.mMovedProxies;
+			}
+			mRects.Set(RenderInst->mRectHandle, Rect);
+		}
+		else
+		{
+			RenderInst->mRectHandle = mRects.Add(Rect);
+			++mStats.mAddedProxies;
+		}
 	}
-	assert(rectIndex <= MAX_RECT_NUM);
+	mDirtyInstances.clear();
 
-	// sort rectangles by id
-	std::sort(mAllRects, mAllRects + MAX_RECT_NUM,
-		[](CRect const& a, CRect const& b) -> bool{ return a.mID < b.mID; });
-	assert(rectIndex <= MAX_RECT_NUM);
+	// roughness feeds the hierarchy too, so refit for any refresh; added or removed rects change the layout,
+	// which rebuilds the hierarchy and relinks everything
+	if (mStats.mRefreshedProxies > 0 || !mBvh.IsValidFor(mRects))
+	{
+		mBvh.Update(mRects);
+	}
+	mLinker.Update(mRects, mBvh, mChangedRects);
+}
+
+int CRectCollections::GetLinkedReflectors(FRectHandle InReceiver, const int32_t*& OutLinks) const
+{
+	OutLinks = nullptr;
+	if (!mRects.IsValid(InReceiver) || !mLinker.IsValidFor(mRects))
+		return 0;
+
+	int Index = mRects.GetIndex(InReceiver);
+	OutLinks = mLinker.GetLinks(Index);
+	return mLinker.NumLinks(Index);
+}
+
+void CRectCollections::PackRects(vector<SB_PS_RECT>& OutRects) const
+{
+	mRects.PackGpuRects(OutRects);
 }
 
 void FUtils::CopyFloats(XMFLOAT4& Dst, const XMFLOAT3& Src)
@@ -1,12 +1,16 @@
 #pragma once
-#include <d3d11.h>
+#include <DirectXMath.h>
+#include <cstdint>
 #include <string>
 #include <vector>
+#include "RectStore.h"
+#include "RectBvh.h"
+#include "ReflectorLinker.h"
+#include "SlotMap.h"
 
 using namespace DirectX;
 using namespace std;
 
-#define MAX_RECT_NUM 8
 #define MAX_RELATED_REFLECTOR_NUM 6
 #define INVALID_PLANE_ID -2
 
@@ -14,16 +18,34 @@ using namespace std;
 class CRect
 {
 public:
-	CRect();
+	// defined here so the portable code storing rects links without RectProxy.cpp
+	CRect()
+		: mID(-2)
+		, mDiffuseColor(1.f, 1.f, 1.f)
+		, mMajorRadius(0)
+		, mMinorRadius(0)
+		, mRoughness(0.1f)
+	{
+
+	}
 
 	// Get world position of vertices.
 	void GetRenderVerticesWorld(float InScale, vector<struct Vertex_P3>& OutVertices);
 	// Get perspective projection position of vertices.
 	void GetRenderVerticesWVP(float InScale, vector<struct Vertex_P3>& OutVertices);
 
+	// Whether position, orientation and extents equal another rect, material is ignored.
+	bool HasSameGeometry(const CRect& InOther) const
+	{
+		return mCenter.x == InOther.mCenter.x && mCenter.y == InOther.mCenter.y && mCenter.z == InOther.mCenter.z &&
+			mNormal.x == InOther.mNormal.x && mNormal.y == InOther.mNormal.y && mNormal.z == InOther.mNormal.z &&
+			mMajorAxis.x == InOther.mMajorAxis.x && mMajorAxis.y == InOther.mMajorAxis.y && mMajorAxis.z == InOther.mMajorAxis.z &&
+			mMajorRadius == InOther.mMajorRadius && mMinorRadius == InOther.mMinorRadius;
+	}
+
 public:
 	// id
-	INT16 mID;
+	int32_t mID;
 	// center position
 	XMFLOAT3 mCenter;
 	// normal
@@ -40,6 +62,19 @@ public:
 	float mRoughness;
 };
 
+// Work done by the last CRectCollections::UpdateAllProxies.
+struct FRectProxyStats
+{
+	// proxies recomputed from their render instance
+	int mRefreshedProxies;
+	// proxies added to the store
+	int mAddedProxies;
+	// refreshed proxies whose geometry changed
+	int mMovedProxies;
+	// the camera world matrix changed, which refreshes every proxy
+	bool bCameraChanged;
+};
+
 // Collection of rectangles.
 class CRectCollections
 {
@@ -49,12 +84,45 @@ private:
 public:
 	static CRectCollections& GetInstance();
 
-	// Update relationship for all rectangle proxies.
+	// dirty instances per job of the proxy refresh
+	static const int ProxyGrain = 256;
+
+	// Refresh the proxies of render instances marked dirty since the last call, in place by handle.
 	void UpdateAllProxies();
+	// Queue a render instance for the next UpdateAllProxies, use CRenderInstance::MarkDirty.
+	void MarkDirty(class CRenderInstance* InInstance);
+	// Drop a destroyed render instance from the queue.
+	void UnmarkDirty(class CRenderInstance* InInstance);
+	// Work done by the last UpdateAllProxies.
+	const FRectProxyStats& GetStats() const { return mStats; }
+
+	// Automatically linked reflectors of a rect as dense indices, returns their number.
+	int GetLinkedReflectors(FRectHandle InReceiver, const int32_t*& OutLinks) const;
+
+	// Pack all rectangles into the layout of structured buffer 'psRects'.
+	void PackRects(vector<struct SB_PS_RECT>& OutRects) const;
 
 public:
-	// All rectangles
-	CRect mAllRects[MAX_RECT_NUM];
+	// All rectangles, indexed by the rect handle of their render instance
+	CRectStore mRects;
+	// Hierarchy over mRects for reflector queries, rebuilt when rects are added or removed
+	CRectBvh mBvh;
+	// Reflectors of every rect derived from geometry, relinked when rects move
+	CReflectorLinker mLinker;
+
+private:
+	// dense indices of rects whose geometry changed in this update
+	vector<int> mChangedRects;
+	// render instances waiting for a proxy refresh
+	vector<FInstanceHandle> mDirtyInstances;
+	// proxies of mDirtyInstances computed by this update, rects only
+	vector<CRect> mRefreshedRects;
+	// keys of render instances whose world transform changed, from CTransformHierarchy::ConsumeChanged
+	vector<uint64_t> mMovedInstances;
+	// camera world matrix of the last update, proxies are transformed by it
+	XMFLOAT4X4 mCameraWorld;
+	// work of the last update
+	FRectProxyStats mStats;
 };
 
 // Utility class.
@@ -0,0 +1,66 @@
+#include "RectRenderer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+FRectQuadDraw::FRectQuadDraw()
+	: mVertexBuffer(nullptr)
+	, mVertexStride(0)
+	, mIndexBuffer(nullptr)
+	, mNumIndices(0)
+{
+}
+
+void CRectRenderer::UploadRects(IRenderBackend& InBackend, const vector<SB_PS_RECT>& InRects,
+	CRenderCommandList& OutCommands)
+{
+	uint32_t NumRects = (uint32_t)InRects.size();
+	if (NumRects == 0)
+		return;
+	if (!Reserve(InBackend, EBufferBinding::Structured, sizeof(SB_PS_RECT), NumRects, mRectBuffer))
+		return;
+
+	void* RectData = OutCommands.UpdateBuffer(mRectBuffer.mBuffer, NumRects * sizeof(SB_PS_RECT));
+	memcpy(RectData, &InRects[0], NumRects * sizeof(SB_PS_RECT));
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 2, mRectBuffer.mView);
+}
+
+void CRectRenderer::RecordInstancedRects(IRenderBackend& InBackend, const CRectInstancePacker& InPacker,
+	const FRectQuadDraw& InQuad, CRenderCommandList& OutCommands)
+{
+	if (InPacker.Num() == 0)
+		return;
+
+	// at least one element, the view is bound even when no rect has reflectors
+	uint32_t NumReflectors = max((uint32_t)1, (uint32_t)InPacker.GetReflectorLists().size());
+	if (!Reserve(InBackend, EBufferBinding::Vertex, sizeof(FRectInstanceData), (uint32_t)InPacker.Num(), mInstanceBuffer)
+		|| !Reserve(InBackend, EBufferBinding::Structured, sizeof(int32_t), NumReflectors, mReflectorListBuffer))
+		return;
+
+	OutCommands.SetPipeline(InQuad.mPipeline);
+	OutCommands.SetVertexBuffer(InQuad.mVertexBuffer, InQuad.mVertexStride, 0);
+	OutCommands.SetIndexBuffer(InQuad.mIndexBuffer, EIndexFormat::UInt16);
+	OutCommands.SetShaderResource(EShaderStage::Pixel, 3, mReflectorListBuffer.mView);
+	InPacker.RecordDraw(OutCommands, mInstanceBuffer.mBuffer, mReflectorListBuffer.mBuffer, InQuad.mNumIndices);
+}
+
+void CRectRenderer::Release(IRenderBackend& InBackend)
+{
+	InBackend.ReleaseBuffer(mRectBuffer);
+	InBackend.ReleaseBuffer(mInstanceBuffer);
+	InBackend.ReleaseBuffer(mReflectorListBuffer);
+}
+
+bool CRectRenderer::Reserve(IRenderBackend& InBackend, EBufferBinding::Type InBinding, uint32_t InStride,
+	uint32_t InCapacity, FRenderBuffer& InOutBuffer)
+{
+	if (InOutBuffer.mBuffer != nullptr && InOutBuffer.mCapacity >= InCapacity)
+		return true;
+
+	// the commands of earlier frames were executed, recreating does not touch what they use
+	uint32_t Capacity = max(2 * InOutBuffer.mCapacity, InCapacity);
+	InBackend.ReleaseBuffer(InOutBuffer);
+	bool bCreated = InBackend.CreateBuffer(InBinding, InStride, Capacity, InOutBuffer);
+	assert(bCreated);
+	return bCreated;
+}
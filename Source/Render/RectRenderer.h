@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include "RenderCommands.h"
+#include "RectInstancing.h"
+#include "ShaderBuffers.h"
+
+using namespace std;
+
+// Quad and programs the rect receivers are drawn with by CRectRenderer.
+struct FRectQuadDraw
+{
+	FRectQuadDraw();
+
+	// programs reading FRectInstanceData from vertex stream 1
+	FPipelineState mPipeline;
+	// quad vertices in stream 0
+	void* mVertexBuffer;
+	uint32_t mVertexStride;
+	// 16 bit quad indices
+	void* mIndexBuffer;
+	uint32_t mNumIndices;
+};
+
+// Records the rects of a frame snapshot: the proxies of all rects into psRects and the receivers packed by
+// CRectInstancePacker as one instanced draw. Its buffers are created through the backend and grow by doubling,
+// so adding rects one by one does not recreate them every frame.
+class CRectRenderer
+{
+public:
+	// Upload the proxies into psRects and bind it to t2 of the pixel shader.
+	void UploadRects(IRenderBackend& InBackend, const vector<SB_PS_RECT>& InRects, CRenderCommandList& OutCommands);
+	// Record one instanced draw of the packed receivers, with their reflector lists bound to t3 of the pixel shader.
+	void RecordInstancedRects(IRenderBackend& InBackend, const CRectInstancePacker& InPacker, const FRectQuadDraw& InQuad,
+		CRenderCommandList& OutCommands);
+
+	// Release the buffers, e.g. when the device is destroyed.
+	void Release(IRenderBackend& InBackend);
+
+private:
+	// Make InOutBuffer hold at least InCapacity elements, false if it could not be created.
+	static bool Reserve(IRenderBackend& InBackend, EBufferBinding::Type InBinding, uint32_t InStride,
+		uint32_t InCapacity, FRenderBuffer& InOutBuffer);
+
+private:
+	// psRects
+	FRenderBuffer mRectBuffer;
+	// FRectInstanceData of the receivers
+	FRenderBuffer mInstanceBuffer;
+	// reflector lists of the receivers
+	FRenderBuffer mReflectorListBuffer;
+};
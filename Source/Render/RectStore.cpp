@@ -0,0 +1,193 @@
+#include "RectStore.h"
+#include "RectProxy.h"
+#include "ShaderBuffers.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+CRectStore::CRectStore()
+	: mStreams(nullptr)
+	, mCapacity(0)
+	, mLayoutVersion(0)
+{
+
+}
+
+FRectHandle CRectStore::Add(const CRect& InRect)
+{
+	int Index = Num();
+	if (Index == mCapacity)
+	{
+		Grow(max(2 * mCapacity, (int)StreamAlignment));
+	}
+
+	FRectHandle Handle = mSlots.Add();
+	mIDs.push_back(0);
+	SetAt(Index, InRect);
+	++mLayoutVersion;
+	return Handle;
+}
+
+void CRectStore::Remove(FRectHandle InHandle)
+{
+	// move the last rectangle into the hole
+	int Index = mSlots.Remove(InHandle);
+	int Last = Num();
+	if (Index != Last)
+	{
+		for (int s = 0; s < ERectStream::Num; ++s)
+		{
+			float* Stream = GetStream((ERectStream::Type)s);
+			Stream[Index] = Stream[Last];
+		}
+		mIDs[Index] = mIDs[Last];
+	}
+	mIDs.pop_back();
+	++mLayoutVersion;
+}
+
+void CRectStore::Clear()
+{
+	mSlots.Clear();
+	mIDs.clear();
+	++mLayoutVersion;
+}
+
+void CRectStore::Reserve(int InCapacity)
+{
+	if (InCapacity > mCapacity)
+	{
+		Grow(InCapacity);
+	}
+}
+
+bool CRectStore::IsValid(FRectHandle InHandle) const
+{
+	return mSlots.IsValid(InHandle);
+}
+
+int CRectStore::GetIndex(FRectHandle InHandle) const
+{
+	int Index = mSlots.GetIndex(InHandle);
+	return Index >= 0 ? Index : INVALID_PLANE_ID;
+}
+
+FRectHandle CRectStore::GetHandle(int InIndex) const
+{
+	return mSlots.GetHandle(InIndex);
+}
+
+void CRectStore::Set(FRectHandle InHandle, const CRect& InRect)
+{
+	assert(IsValid(InHandle));
+	SetAt(mSlots.GetIndex(InHandle), InRect);
+}
+
+void CRectStore::Get(FRectHandle InHandle, CRect& OutRect) const
+{
+	assert(IsValid(InHandle));
+	GetAt(mSlots.GetIndex(InHandle), OutRect);
+}
+
+void CRectStore::SetAt(int InIndex, const CRect& InRect)
+{
+	assert(InIndex >= 0 && InIndex < Num());
+	float* s = mStreams + InIndex;
+	size_t c = mCapacity;
+	s[ERectStream::CenterX * c] = InRect.mCenter.x;
+	s[ERectStream::CenterY * c] = InRect.mCenter.y;
+	s[ERectStream::CenterZ * c] = InRect.mCenter.z;
+	s[ERectStream::NormalX * c] = InRect.mNormal.x;
+	s[ERectStream::NormalY * c] = InRect.mNormal.y;
+	s[ERectStream::NormalZ * c] = InRect.mNormal.z;
+	s[ERectStream::MajorAxisX * c] = InRect.mMajorAxis.x;
+	s[ERectStream::MajorAxisY * c] = InRect.mMajorAxis.y;
+	s[ERectStream::MajorAxisZ * c] = InRect.mMajorAxis.z;
+	s[ERectStream::MajorRadius * c] = InRect.mMajorRadius;
+	s[ERectStream::MinorRadius * c] = InRect.mMinorRadius;
+	s[ERectStream::Roughness * c] = InRect.mRoughness;
+	s[ERectStream::DiffuseR * c] = InRect.mDiffuseColor.x;
+	s[ERectStream::DiffuseG * c] = InRect.mDiffuseColor.y;
+	s[ERectStream::DiffuseB * c] = InRect.mDiffuseColor.z;
+	mIDs[InIndex] = InRect.mID;
+}
+
+void CRectStore::GetAt(int InIndex, CRect& OutRect) const
+{
+	assert(InIndex >= 0 && InIndex < Num());
+	const float* s = mStreams + InIndex;
+	size_t c = mCapacity;
+	OutRect.mCenter = XMFLOAT3(s[ERectStream::CenterX * c], s[ERectStream::CenterY * c], s[ERectStream::CenterZ * c]);
+	OutRect.mNormal = XMFLOAT3(s[ERectStream::NormalX * c], s[ERectStream::NormalY * c], s[ERectStream::NormalZ * c]);
+	OutRect.mMajorAxis = XMFLOAT3(s[ERectStream::MajorAxisX * c], s[ERectStream::MajorAxisY * c],
+		s[ERectStream::MajorAxisZ * c]);
+	OutRect.mMajorRadius = s[ERectStream::MajorRadius * c];
+	OutRect.mMinorRadius = s[ERectStream::MinorRadius * c];
+	OutRect.mRoughness = s[ERectStream::Roughness * c];
+	OutRect.mDiffuseColor = XMFLOAT3(s[ERectStream::DiffuseR * c], s[ERectStream::DiffuseG * c],
+		s[ERectStream::DiffuseB * c]);
+	OutRect.mID = mIDs[InIndex];
+}
+
+void CRectStore::PackGpuRects(SB_PS_RECT* OutRects) const
+{
+	const float* CenterX = GetStream(ERectStream::CenterX);
+	const float* CenterY = GetStream(ERectStream::CenterY);
+	const float* CenterZ = GetStream(ERectStream::CenterZ);
+	const float* NormalX = GetStream(ERectStream::NormalX);
+	const float* NormalY = GetStream(ERectStream::NormalY);
+	const float* NormalZ = GetStream(ERectStream::NormalZ);
+	const float* AxisX = GetStream(ERectStream::MajorAxisX);
+	const float* AxisY = GetStream(ERectStream::MajorAxisY);
+	const float* AxisZ = GetStream(ERectStream::MajorAxisZ);
+	const float* MajorRadius = GetStream(ERectStream::MajorRadius);
+	const float* MinorRadius = GetStream(ERectStream::MinorRadius);
+	const float* Roughness = GetStream(ERectStream::Roughness);
+	const float* DiffuseR = GetStream(ERectStream::DiffuseR);
+	const float* DiffuseG = GetStream(ERectStream::DiffuseG);
+	const float* DiffuseB = GetStream(ERectStream::DiffuseB);
+
+	int Count = Num();
+	for (int i = 0; i < Count; ++i)
+	{
+		SB_PS_RECT& Out = OutRects[i];
+		Out.plElement0 = XMFLOAT4((float)mIDs[i], Roughness[i], MajorRadius[i], MinorRadius[i]);
+		Out.plCenter_DiffX = XMFLOAT4(CenterX[i], CenterY[i], CenterZ[i], DiffuseR[i]);
+		Out.plNorm_DifY = XMFLOAT4(NormalX[i], NormalY[i], NormalZ[i], DiffuseG[i]);
+		Out.plAxis_DifZ = XMFLOAT4(AxisX[i], AxisY[i], AxisZ[i], DiffuseB[i]);
+	}
+}
+
+void CRectStore::PackGpuRects(vector<SB_PS_RECT>& OutRects) const
+{
+	OutRects.resize(Num());
+	if (!OutRects.empty())
+	{
+		PackGpuRects(OutRects.data());
+	}
+}
+
+void CRectStore::Grow(int InCapacity)
+{
+	int Capacity = (InCapacity + StreamAlignment - 1) / StreamAlignment * StreamAlignment;
+	assert(Capacity >= Num());
+
+	vector<float> Buffer((size_t)Capacity * ERectStream::Num + StreamAlignment);
+	uintptr_t Address = (uintptr_t)Buffer.data();
+	uintptr_t Alignment = StreamAlignment * sizeof(float);
+	float* Streams = (float*)((Address + Alignment - 1) & ~(Alignment - 1));
+
+	if (Num() > 0)
+	{
+		for (int s = 0; s < ERectStream::Num; ++s)
+		{
+			memcpy(Streams + (size_t)s * Capacity, GetStream((ERectStream::Type)s), Num() * sizeof(float));
+		}
+	}
+
+	mBuffer.swap(Buffer);
+	mStreams = Streams;
+	mCapacity = Capacity;
+	mIDs.reserve(Capacity);
+	mSlots.Reserve(Capacity);
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "SlotMap.h"
+
+using namespace std;
+
+class CRect;
+struct SB_PS_RECT;
+
+// Handle of a rectangle in CRectStore. Stays valid while the rectangle is alive, no matter how
+// other rectangles are added or removed; a removed rectangle invalidates all of its handles.
+typedef FSlotHandle FRectHandle;
+
+// Float streams of CRectStore.
+namespace ERectStream
+{
+	enum Type
+	{
+		CenterX = 0,
+		CenterY,
+		CenterZ,
+		NormalX,
+		NormalY,
+		NormalZ,
+		MajorAxisX,
+		MajorAxisY,
+		MajorAxisZ,
+		MajorRadius,
+		MinorRadius,
+		Roughness,
+		DiffuseR,
+		DiffuseG,
+		DiffuseB,
+		Num
+	};
+};
+
+// Growable rectangle storage in SoA layout, one float stream per rectangle property.
+//
+// Rectangles are kept densely packed in [0, Num()), removing one moves the last rectangle into its place.
+// The dense index is the index of a rectangle in the structured buffer psRects, so it may change on
+// removal; handles go through an indirection table and never do. Every stream starts on a cache line
+// and the capacity is a multiple of StreamAlignment floats, so loops over a stream can use aligned
+// packets without tails beyond the capacity.
+class CRectStore
+{
+public:
+	// floats per cache line
+	static const int StreamAlignment = 16;
+
+	CRectStore();
+
+	// mStreams points into mBuffer, a copy would keep reading the streams of the original
+	CRectStore(const CRectStore&) = delete;
+	CRectStore& operator=(const CRectStore&) = delete;
+
+	// Add a rectangle, returns its handle.
+	FRectHandle Add(const CRect& InRect);
+	// Remove a rectangle, all of its handles become invalid.
+	void Remove(FRectHandle InHandle);
+	// Remove all rectangles and invalidate all handles.
+	void Clear();
+	// Make room for InCapacity rectangles.
+	void Reserve(int InCapacity);
+
+	// Whether the handle refers to a live rectangle.
+	bool IsValid(FRectHandle InHandle) const;
+	// Dense index of a rectangle, or INVALID_PLANE_ID for invalid handles.
+	int GetIndex(FRectHandle InHandle) const;
+	// Handle of the rectangle at a dense index.
+	FRectHandle GetHandle(int InIndex) const;
+
+	// Overwrite the properties of a rectangle.
+	void Set(FRectHandle InHandle, const CRect& InRect);
+	// Read back the properties of a rectangle.
+	void Get(FRectHandle InHandle, CRect& OutRect) const;
+	// Write the properties of the rectangle at a dense index.
+	void SetAt(int InIndex, const CRect& InRect);
+	// Read the properties of the rectangle at a dense index.
+	void GetAt(int InIndex, CRect& OutRect) const;
+
+	// Number of rectangles.
+	int Num() const { return mSlots.Num(); }
+	// Rectangles storable without growing.
+	int Capacity() const { return mCapacity; }
+	// Incremented whenever dense indices change (Add, Remove, Clear), Set keeps it.
+	uint32_t GetLayoutVersion() const { return mLayoutVersion; }
+
+	// Stream of one property, Num() valid elements.
+	const float* GetStream(ERectStream::Type InStream) const { return mStreams + (size_t)InStream * mCapacity; }
+	float* GetStream(ERectStream::Type InStream) { return mStreams + (size_t)InStream * mCapacity; }
+	// Application ids, Num() valid elements.
+	const int32_t* GetIDs() const { return mIDs.data(); }
+
+	// Pack all rectangles in dense order into the element layout of psRects, OutRects holds Num() elements.
+	void PackGpuRects(SB_PS_RECT* OutRects) const;
+	// Same as above into a vector.
+	void PackGpuRects(vector<SB_PS_RECT>& OutRects) const;
+
+private:
+	// Move all streams into a new buffer of InCapacity rectangles.
+	void Grow(int InCapacity);
+
+private:
+	// backing memory of all streams, over-allocated by one cache line
+	vector<float> mBuffer;
+	// first stream, aligned to a cache line
+	float* mStreams;
+	// rectangles per stream
+	int mCapacity;
+	// application ids by dense index
+	vector<int32_t> mIDs;
+
+	// dense index of each handle
+	CSlotIndirection mSlots;
+	// see GetLayoutVersion
+	uint32_t mLayoutVersion;
+};
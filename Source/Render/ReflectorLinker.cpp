@@ -0,0 +1,267 @@
+#include "ReflectorLinker.h"
+#include "RectProxy.h"
+#include "RectStore.h"
+#include "RectBvh.h"
+#include "Profiler.h"
+#include "../CpuGI/GIMath.h"
+#include <algorithm>
+#include <cassert>
+
+using namespace GIMath;
+
+static_assert(CReflectorLinker::MaxLinks == MAX_RELATED_REFLECTOR_NUM, "one link per slot of mLinkedReflectors");
+
+namespace
+{
+	// Rect geometry read from the store streams.
+	struct FLinkGeometry
+	{
+		float3 mCenter;
+		float3 mNormal;
+		float3 mMajorAxis;
+		float3 mMinorAxis;
+		float mMajorRadius;
+		float mMinorRadius;
+
+		FLinkGeometry(const CRectStore& InStore, int InIndex)
+		{
+			mCenter = Load(InStore, ERectStream::CenterX, InIndex);
+			mNormal = normalize(Load(InStore, ERectStream::NormalX, InIndex));
+			mMajorAxis = normalize(Load(InStore, ERectStream::MajorAxisX, InIndex));
+			mMinorAxis = normalize(cross(mNormal, mMajorAxis));
+			mMajorRadius = InStore.GetStream(ERectStream::MajorRadius)[InIndex];
+			mMinorRadius = InStore.GetStream(ERectStream::MinorRadius)[InIndex];
+		}
+
+		static float3 Load(const CRectStore& InStore, ERectStream::Type InFirst, int InIndex)
+		{
+			return float3(InStore.GetStream(InFirst)[InIndex], InStore.GetStream((ERectStream::Type)(InFirst + 1))[InIndex],
+				InStore.GetStream((ERectStream::Type)(InFirst + 2))[InIndex]);
+		}
+
+		// radius of the circumscribed sphere
+		float Radius() const { return std::sqrt(mMajorRadius * mMajorRadius + mMinorRadius * mMinorRadius); }
+
+		// height of the corner farthest in front of a plane
+		float MaxHeightAbove(const float3& InPlanePoint, const float3& InPlaneNormal) const
+		{
+			return dot(mCenter - InPlanePoint, InPlaneNormal) + mMajorRadius * std::fabs(dot(mMajorAxis, InPlaneNormal)) +
+				mMinorRadius * std::fabs(dot(mMinorAxis, InPlaneNormal));
+		}
+
+		// distance from a point to the rect
+		float DistanceTo(const float3& InPoint) const
+		{
+			float3 v = InPoint - mCenter;
+			float du = max(std::fabs(dot(v, mMajorAxis)) - mMajorRadius, 0.f);
+			float dv = max(std::fabs(dot(v, mMinorAxis)) - mMinorRadius, 0.f);
+			float dn = dot(v, mNormal);
+			return std::sqrt(du * du + dv * dv + dn * dn);
+		}
+	};
+
+	// Query of the rects which may link to InRect or be linked by it, see CReflectorLinker::TestLink.
+	FRectQuery MakeLinkQuery(const FLinkGeometry& InRect, int InIndex, float InMaxDistance)
+	{
+		FRectQuery Query;
+		Query.mPoint = XMFLOAT3(InRect.mCenter.x, InRect.mCenter.y, InRect.mCenter.z);
+		Query.mPointRadius = InRect.Radius();
+		Query.mMaxDistance = InMaxDistance;
+		Query.mExcludeIndex = InIndex;
+		return Query;
+	}
+}
+
+FReflectorLinkSettings::FReflectorLinkSettings()
+	: mMaxDistance(10000)
+	, mMinSolidAngle(1e-3f)
+{
+
+}
+
+CReflectorLinker::CReflectorLinker()
+	: mLayoutVersion(0)
+	, mNumRects(0)
+	, bSettingsChanged(true)
+{
+	mStats.mChangedRects = 0;
+	mStats.mRelinkedReceivers = 0;
+	mStats.bRebuilt = false;
+}
+
+void CReflectorLinker::SetSettings(const FReflectorLinkSettings& InSettings)
+{
+	mSettings = InSettings;
+	bSettingsChanged = true;
+}
+
+bool CReflectorLinker::IsValidFor(const CRectStore& InStore) const
+{
+	return !bSettingsChanged && mLayoutVersion == InStore.GetLayoutVersion() && mNumRects == InStore.Num();
+}
+
+bool CReflectorLinker::TestLink(const CRectStore& InStore, int InReceiver, int InReflector,
+	const FReflectorLinkSettings& InSettings, float& OutSolidAngle)
+{
+	if (InReceiver == InReflector)
+		return false;
+
+	FLinkGeometry Recv(InStore, InReceiver);
+	FLinkGeometry Refl(InStore, InReflector);
+
+	// facing each other, coplanar rects do not
+	float Eps = 1e-4f * max(Recv.Radius(), Refl.Radius());
+	if (Recv.MaxHeightAbove(Refl.mCenter, Refl.mNormal) <= Eps || Refl.MaxHeightAbove(Recv.mCenter, Recv.mNormal) <= Eps)
+		return false;
+
+	// lower bound of the distance between the rects, symmetric so CRectBvh queries from either side find the pair
+	float Dist = max(Refl.DistanceTo(Recv.mCenter) - Recv.Radius(), Recv.DistanceTo(Refl.mCenter) - Refl.Radius());
+	if (Dist > InSettings.mMaxDistance)
+		return false;
+
+	float Area = 4 * Refl.mMajorRadius * Refl.mMinorRadius;
+	float Dist2 = max(Dist, 0.f) * max(Dist, 0.f);
+	OutSolidAngle = Dist2 * 2 * PI > Area ? Area / Dist2 : 2 * PI;
+	return OutSolidAngle >= InSettings.mMinSolidAngle;
+}
+
+void CReflectorLinker::LinkReceiver(const CRectStore& InStore, const CRectBvh& InBvh, int InReceiver)
+{
+	mCandidates.clear();
+	InBvh.Query(MakeLinkQuery(FLinkGeometry(InStore, InReceiver), InReceiver, mSettings.mMaxDistance), mCandidates);
+
+	const float* CenterX = InStore.GetStream(ERectStream::CenterX);
+	const float* CenterY = InStore.GetStream(ERectStream::CenterY);
+	const float* CenterZ = InStore.GetStream(ERectStream::CenterZ);
+	mRanked.clear();
+	for (int Refl : mCandidates)
+	{
+		float SolidAngle;
+		if (TestLink(InStore, InReceiver, Refl, mSettings, SolidAngle))
+		{
+			mRanked.push_back(make_pair(SolidAngle, Refl));
+		}
+	}
+
+	// largest solid angle first, then nearest center, then lowest index so results do not depend on query order
+	auto CenterDist2 = [&](int Refl)
+	{
+		float dx = CenterX[Refl] - CenterX[InReceiver];
+		float dy = CenterY[Refl] - CenterY[InReceiver];
+		float dz = CenterZ[Refl] - CenterZ[InReceiver];
+		return dx * dx + dy * dy + dz * dz;
+	};
+	auto Before = [&](const pair<float, int>& a, const pair<float, int>& b)
+	{
+		if (a.first != b.first)
+			return a.first > b.first;
+		float da = CenterDist2(a.second), db = CenterDist2(b.second);
+		return da != db ? da < db : a.second < b.second;
+	};
+	int Num = min((int)mRanked.size(), MaxLinks);
+	partial_sort(mRanked.begin(), mRanked.begin() + Num, mRanked.end(), Before);
+
+	int32_t* Links = &mLinks[(size_t)InReceiver * MaxLinks];
+	for (int i = 0; i < MaxLinks; ++i)
+	{
+		Links[i] = i < Num ? mRanked[i].second : INVALID_PLANE_ID;
+	}
+	mNumLinks[InReceiver] = (uint8_t)Num;
+}
+
+void CReflectorLinker::MarkReceiver(int InReceiver)
+{
+	if (!mMarks[InReceiver])
+	{
+		mMarks[InReceiver] = 1;
+		mMarked.push_back(InReceiver);
+	}
+}
+
+void CReflectorLinker::Build(const CRectStore& InStore, const CRectBvh& InBvh)
+{
+	PROFILE_SCOPE("CReflectorLinker::Build");
+	assert(InBvh.IsValidFor(InStore) || InStore.Num() == 0);
+
+	mNumRects = InStore.Num();
+	mLayoutVersion = InStore.GetLayoutVersion();
+	bSettingsChanged = false;
+	mLinks.assign((size_t)mNumRects * MaxLinks, INVALID_PLANE_ID);
+	mNumLinks.assign(mNumRects, 0);
+	mMarks.assign(mNumRects, 0);
+	mChanged.assign(mNumRects, 0);
+	mMarked.clear();
+
+	for (int i = 0; i < mNumRects; ++i)
+	{
+		LinkReceiver(InStore, InBvh, i);
+	}
+
+	mStats.mChangedRects = mNumRects;
+	mStats.mRelinkedReceivers = mNumRects;
+	mStats.bRebuilt = true;
+}
+
+void CReflectorLinker::Update(const CRectStore& InStore, const CRectBvh& InBvh, const vector<int>& InChangedRects)
+{
+	PROFILE_SCOPE("CReflectorLinker::Update");
+	if (!IsValidFor(InStore))
+	{
+		Build(InStore, InBvh);
+		return;
+	}
+
+	mStats.mChangedRects = (int)InChangedRects.size();
+	mStats.mRelinkedReceivers = 0;
+	mStats.bRebuilt = false;
+	if (InChangedRects.empty())
+		return;
+	assert(InBvh.IsValidFor(InStore));
+
+	// changed rects relink themselves
+	for (int Rect : InChangedRects)
+	{
+		assert(Rect >= 0 && Rect < mNumRects);
+		mChanged[Rect] = 1;
+		MarkReceiver(Rect);
+	}
+
+	// receivers which linked a changed rect may lose it
+	for (int Recv = 0; Recv < mNumRects; ++Recv)
+	{
+		const int32_t* Links = GetLinks(Recv);
+		for (int i = 0; i < mNumLinks[Recv]; ++i)
+		{
+			if (mChanged[Links[i]])
+			{
+				MarkReceiver(Recv);
+				break;
+			}
+		}
+	}
+
+	// receivers a changed rect may be linked to now, the link criteria are symmetric up to the solid angle
+	for (int Rect : InChangedRects)
+	{
+		mCandidates.clear();
+		InBvh.Query(MakeLinkQuery(FLinkGeometry(InStore, Rect), Rect, mSettings.mMaxDistance), mCandidates);
+		for (int Recv : mCandidates)
+		{
+			MarkReceiver(Recv);
+		}
+	}
+
+	// LinkReceiver reuses mCandidates, so relink after gathering
+	for (int Recv : mMarked)
+	{
+		LinkReceiver(InStore, InBvh, Recv);
+		mMarks[Recv] = 0;
+	}
+	mStats.mRelinkedReceivers = (int)mMarked.size();
+	mMarked.clear();
+
+	for (int Rect : InChangedRects)
+	{
+		mChanged[Rect] = 0;
+	}
+}
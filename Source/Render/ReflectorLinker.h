@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class CRectStore;
+class CRectBvh;
+
+// Criteria of CReflectorLinker.
+struct FReflectorLinkSettings
+{
+	FReflectorLinkSettings();
+
+	// only reflectors closer to the receiver than this
+	float mMaxDistance;
+	// only reflectors whose solid angle bound seen from the receiver is at least this, in steradians
+	float mMinSolidAngle;
+};
+
+// Work done by the last CReflectorLinker update.
+struct FReflectorLinkStats
+{
+	// rects reported as changed
+	int mChangedRects;
+	// receivers whose links were recomputed
+	int mRelinkedReceivers;
+	// all links were recomputed because the store layout or the settings changed
+	bool bRebuilt;
+};
+
+// Derives the related reflectors of every rect from geometry, replacing CRenderInstance::LinkReflectors
+// by name.
+//
+// A rect F is linked to a receiver R when
+//	R and F face each other: some corner of R is in front of F and some corner of F is in front of R
+//	they are close:          the distance between them, bounded from below, is at most mMaxDistance
+//	F is large enough:       the bound area(F) / distance^2 of the solid angle of F is at least mMinSolidAngle
+// and among those the MaxLinks reflectors with the largest solid angle bound are kept, largest first,
+// so shaders using fewer slots see the most important ones. Candidates come from CRectBvh queries.
+//
+// Links are dense store indices in fixed size rows per receiver. Update relinks only the changed rects,
+// the receivers currently linking them and the receivers they may now be linked to, so static scenes cost
+// nothing; a store layout change relinks everything.
+class CReflectorLinker
+{
+public:
+	// links per receiver, MAX_RELATED_REFLECTOR_NUM
+	static const int MaxLinks = 6;
+
+	CReflectorLinker();
+
+	// Change the criteria, the next update relinks everything.
+	void SetSettings(const FReflectorLinkSettings& InSettings);
+	const FReflectorLinkSettings& GetSettings() const { return mSettings; }
+
+	// Link all rects of the store, the hierarchy must be up to date.
+	void Build(const CRectStore& InStore, const CRectBvh& InBvh);
+	// Relink rects whose geometry changed since the last update, given by dense index. Rebuilds when
+	// the store layout or the settings changed.
+	void Update(const CRectStore& InStore, const CRectBvh& InBvh, const vector<int>& InChangedRects);
+	// Whether the links refer to the current dense indices of the store.
+	bool IsValidFor(const CRectStore& InStore) const;
+
+	// Number of reflectors linked to a receiver.
+	int NumLinks(int InReceiver) const { return mNumLinks[InReceiver]; }
+	// Dense indices of the reflectors linked to a receiver, NumLinks() valid elements.
+	const int32_t* GetLinks(int InReceiver) const { return &mLinks[(size_t)InReceiver * MaxLinks]; }
+	// Work done by the last update.
+	const FReflectorLinkStats& GetStats() const { return mStats; }
+
+	// Whether a reflector qualifies for a receiver, returns its solid angle bound in OutSolidAngle.
+	static bool TestLink(const CRectStore& InStore, int InReceiver, int InReflector,
+		const FReflectorLinkSettings& InSettings, float& OutSolidAngle);
+
+private:
+	// Recompute the links of one receiver.
+	void LinkReceiver(const CRectStore& InStore, const CRectBvh& InBvh, int InReceiver);
+	// Schedule a receiver for relinking once.
+	void MarkReceiver(int InReceiver);
+
+private:
+	// criteria
+	FReflectorLinkSettings mSettings;
+	// MaxLinks reflector indices per receiver, largest solid angle first
+	vector<int32_t> mLinks;
+	// valid entries of each row of mLinks
+	vector<uint8_t> mNumLinks;
+	// layout version of the store at the last build
+	uint32_t mLayoutVersion;
+	// rects linked since the last build
+	int mNumRects;
+	// settings changed since the last build
+	bool bSettingsChanged;
+	// work of the last update
+	FReflectorLinkStats mStats;
+
+	// receivers scheduled for relinking
+	vector<uint8_t> mMarks;
+	vector<int> mMarked;
+	// rects changed in the current update
+	vector<uint8_t> mChanged;
+	// query results
+	vector<int> mCandidates;
+	// candidates with their solid angle bound
+	vector<pair<float, int>> mRanked;
+};
@@ -0,0 +1,609 @@
+#include "ModuleBenchmarks.h"
+#include "DrawList.h"
+#include "FileUtil.h"
+#include "Profiler.h"
+#include "RectInstancing.h"
+#include "RenderCommands.h"
+#include "RenderThread.h"
+#include "ShaderBytecodeCache.h"
+#include "StreamingRing.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// stand-ins for the D3D objects of recorded frames, CNullRenderBackend tells objects apart by address only
+	uint8_t GObjects[256];
+
+	// Record a synthetic frame with the bind pattern of RenderScene. Constants go either into the frame
+	// constants, per-frame ones once and per-object ones in a single range bound to both stages, or like
+	// before the frame constants into per-instance buffers, each with its own copy of the per-frame data.
+	void RecordBenchmarkFrame(int InNumDraws, bool bInFrameConstants, CRenderCommandList& OutCommands)
+	{
+		const int NumMeshes = 8;
+		const int NumRasterizerStates = 2;
+		const float ClearColor[4] = { 0, 0, 0, 1 };
+
+		// sizes of CB_PER_OBJECT, CB_VS_PER_FRAME and CB_PS_PER_FRAME
+		const uint32_t PerObjectSize = 272;
+		const uint32_t VSPerFrameSize = 128;
+		const uint32_t PSPerFrameSize = 80;
+		// sizes of the per-instance buffers: world, view and projection, and the pixel shader constants
+		const uint32_t VSPerInstanceSize = 3 * 64;
+		const uint32_t PSPerInstanceSize = 176;
+
+		OutCommands.Reset();
+		OutCommands.SetRenderTargets(&GObjects[0], &GObjects[1]);
+		OutCommands.ClearRenderTarget(&GObjects[0], ClearColor);
+		OutCommands.ClearDepth(&GObjects[1], 1.f);
+		OutCommands.SetViewport(1280, 720);
+		OutCommands.SetSampler(EShaderStage::Pixel, 1, &GObjects[2]);
+		OutCommands.SetShaderResource(EShaderStage::Pixel, 1, &GObjects[3]);
+		if (bInFrameConstants)
+		{
+			uint32_t Offset;
+			memset(OutCommands.AllocateFrameConstants(VSPerFrameSize, Offset), 0, VSPerFrameSize);
+			OutCommands.SetFrameConstants(EShaderStage::Vertex, 1, Offset, VSPerFrameSize);
+			memset(OutCommands.AllocateFrameConstants(PSPerFrameSize, Offset), 0, PSPerFrameSize);
+			OutCommands.SetFrameConstants(EShaderStage::Pixel, 1, Offset, PSPerFrameSize);
+		}
+
+		for (int i = 0; i < InNumDraws; ++i)
+		{
+			int Mesh = i % NumMeshes;
+			FPipelineState Pipeline;
+			Pipeline.mVertexShader = &GObjects[4];
+			Pipeline.mPixelShader = &GObjects[5];
+			Pipeline.mInputLayout = &GObjects[6];
+			Pipeline.mRasterizerState = &GObjects[7 + i % NumRasterizerStates];
+			OutCommands.SetPipeline(Pipeline);
+			OutCommands.SetVertexBuffer(&GObjects[16 + Mesh], 32, 0);
+			OutCommands.SetIndexBuffer(&GObjects[32 + Mesh], EIndexFormat::UInt16);
+
+			if (bInFrameConstants)
+			{
+				uint32_t Offset;
+				memset(OutCommands.AllocateFrameConstants(PerObjectSize, Offset), i & 0xff, PerObjectSize);
+				OutCommands.SetFrameConstants(EShaderStage::Vertex, 0, Offset, PerObjectSize);
+				OutCommands.SetFrameConstants(EShaderStage::Pixel, 0, Offset, PerObjectSize);
+			}
+			else
+			{
+				memset(OutCommands.UpdateBuffer(&GObjects[10], VSPerInstanceSize), i & 0xff, VSPerInstanceSize);
+				OutCommands.SetConstantBuffer(EShaderStage::Vertex, 0, &GObjects[10]);
+				memset(OutCommands.UpdateBuffer(&GObjects[11], PSPerFrameSize), 0, PSPerFrameSize);
+				OutCommands.SetConstantBuffer(EShaderStage::Pixel, 1, &GObjects[11]);
+				memset(OutCommands.UpdateBuffer(&GObjects[12], PSPerInstanceSize), i & 0xff, PSPerInstanceSize);
+				OutCommands.SetConstantBuffer(EShaderStage::Pixel, 0, &GObjects[12]);
+			}
+
+			OutCommands.DrawIndexed(36, 0, 0);
+		}
+	}
+
+	// Record the draws of a list in its current order with the bind pattern of RenderScene.
+	void RecordDrawList(const vector<FDrawItem>& InItems, const vector<FPipelineState>& InPipelines,
+		const vector<uint32_t>& InMeshes, const vector<uint32_t>& InMaterials,
+		CRenderCommandList& OutCommands)
+	{
+		const uint32_t PerObjectSize = 272;
+		for (const FDrawItem& Item : InItems)
+		{
+			uint32_t Draw = Item.mPayload;
+			OutCommands.SetPipeline(InPipelines[Draw]);
+			OutCommands.SetVertexBuffer(&GObjects[64 + InMeshes[Draw]], 32, 0);
+			OutCommands.SetIndexBuffer(&GObjects[128 + InMeshes[Draw]], EIndexFormat::UInt16);
+
+			uint32_t Offset;
+			memset(OutCommands.AllocateFrameConstants(PerObjectSize, Offset), Draw & 0xff, PerObjectSize);
+			OutCommands.SetFrameConstants(EShaderStage::Vertex, 0, Offset, PerObjectSize);
+			OutCommands.SetFrameConstants(EShaderStage::Pixel, 0, Offset, PerObjectSize);
+
+			OutCommands.SetSampler(EShaderStage::Pixel, 0, &GObjects[0]);
+			OutCommands.SetShaderResource(EShaderStage::Pixel, 0, &GObjects[192 + InMaterials[Draw]]);
+			OutCommands.DrawIndexed(36, 0, 0);
+		}
+	}
+
+	// Keep the calling thread busy for InMs milliseconds, like a stage of a frame.
+	void BusyWork(double InMs)
+	{
+		auto StartTime = chrono::steady_clock::now();
+		chrono::duration<double, milli> Elapsed(0);
+		while (Elapsed.count() < InMs)
+		{
+			Elapsed = chrono::steady_clock::now() - StartTime;
+		}
+	}
+}
+
+FRenderCommandBenchResult CModuleBenchmarks::RunNullRenderBackend(int InNumDraws)
+{
+	assert(InNumDraws > 0);
+	FRenderCommandBenchResult Result;
+	Result.mNumDraws = InNumDraws;
+
+	CRenderCommandList Commands;
+	CNullRenderBackend Backend;
+	const int NumRepeats = 8;
+	double RecordSeconds = 0;
+	double ExecuteSeconds = 0;
+	for (int Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		auto StartTime = chrono::steady_clock::now();
+		RecordBenchmarkFrame(InNumDraws, true, Commands);
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		RecordSeconds += Elapsed.count();
+
+		StartTime = chrono::steady_clock::now();
+		Backend.ResetStats();
+		Backend.Execute(Commands);
+		Elapsed = chrono::steady_clock::now() - StartTime;
+		ExecuteSeconds += Elapsed.count();
+	}
+
+	Result.mRecordNs = RecordSeconds * 1e9 / NumRepeats / InNumDraws;
+	Result.mExecuteNs = ExecuteSeconds * 1e9 / NumRepeats / InNumDraws;
+	Result.mStats = Backend.GetStats();
+
+	RecordBenchmarkFrame(InNumDraws, false, Commands);
+	Backend.ResetStats();
+	Backend.Execute(Commands);
+	Result.mPerInstanceStats = Backend.GetStats();
+	return Result;
+}
+
+FRectInstancingBenchResult CModuleBenchmarks::RunRectInstancing(int InNumRects)
+{
+	assert(InNumRects > 0);
+	FRectInstancingBenchResult Result;
+	Result.mNumRects = InNumRects;
+
+	const uint32_t QuadIndexCount = 6;
+	// size of CB_PER_OBJECT
+	const uint32_t PerObjectSize = 272;
+	const int MaxReflectors = 6;
+
+	// rects on a grid, each linked to up to 6 of its predecessors
+	vector<XMFLOAT4X4> Worlds(InNumRects);
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		float f = (float)i;
+		XMStoreFloat4x4(&Worlds[i], XMMatrixAffineTransformation(XMVectorReplicate(1.f + (i % 3)), XMVectorZero(),
+			XMQuaternionRotationRollPitchYaw(f * .1f, f * .2f, 0.f), XMVectorSet(f, std::sin(f), std::cos(f), 1.f)));
+	}
+	int32_t Reflectors[MaxReflectors];
+	for (int i = 0; i < MaxReflectors; ++i)
+	{
+		Reflectors[i] = i;
+	}
+
+	CRenderCommandList Commands;
+	CNullRenderBackend Backend;
+
+	// one draw per rect, like RenderScene without instancing
+	Commands.Reset();
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		FPipelineState Pipeline;
+		Pipeline.mVertexShader = &GObjects[0];
+		Pipeline.mPixelShader = &GObjects[1];
+		Pipeline.mInputLayout = &GObjects[2];
+		Pipeline.mRasterizerState = &GObjects[3];
+		Commands.SetPipeline(Pipeline);
+		Commands.SetVertexBuffer(&GObjects[4], 24, 0);
+		Commands.SetIndexBuffer(&GObjects[5], EIndexFormat::UInt16);
+
+		uint32_t Offset;
+		memset(Commands.AllocateFrameConstants(PerObjectSize, Offset), i & 0xff, PerObjectSize);
+		Commands.SetFrameConstants(EShaderStage::Vertex, 0, Offset, PerObjectSize);
+		Commands.SetFrameConstants(EShaderStage::Pixel, 0, Offset, PerObjectSize);
+		Commands.DrawIndexed(QuadIndexCount, 0, 0);
+	}
+	Backend.Execute(Commands);
+	Result.mPerDrawStats = Backend.GetStats();
+
+	// instanced, packing is timed together with recording
+	CRectInstancePacker Packer;
+	const int NumRepeats = 8;
+	double PackSeconds = 0;
+	for (int Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		auto StartTime = chrono::steady_clock::now();
+		Commands.Reset();
+		Packer.Reset();
+		for (int i = 0; i < InNumRects; ++i)
+		{
+			Packer.Add(Worlds[i], (i % 10) * .1f, XMFLOAT3(1.f, .5f, .25f), Reflectors, i % (MaxReflectors + 1));
+		}
+
+		FPipelineState Pipeline;
+		Pipeline.mVertexShader = &GObjects[6];
+		Pipeline.mPixelShader = &GObjects[7];
+		Pipeline.mInputLayout = &GObjects[8];
+		Pipeline.mRasterizerState = &GObjects[3];
+		Commands.SetPipeline(Pipeline);
+		Commands.SetVertexBuffer(&GObjects[4], 24, 0);
+		Commands.SetIndexBuffer(&GObjects[5], EIndexFormat::UInt16);
+		Commands.SetShaderResource(EShaderStage::Pixel, 3, &GObjects[9]);
+		Packer.RecordDraw(Commands, &GObjects[10], &GObjects[11], QuadIndexCount);
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		PackSeconds += Elapsed.count();
+	}
+	Result.mPackNs = PackSeconds * 1e9 / NumRepeats / InNumRects;
+
+	Backend.ResetStats();
+	Backend.Execute(Commands);
+	Result.mInstancedStats = Backend.GetStats();
+
+	// both paths draw the same triangles
+	Result.bSingleDraw = Result.mInstancedStats.mDraws == 1;
+	Result.bTrianglesMatch = Result.mInstancedStats.mTriangles == Result.mPerDrawStats.mTriangles;
+	return Result;
+}
+
+FDrawListBenchResult CModuleBenchmarks::RunDrawList(int InNumDraws)
+{
+	assert(InNumDraws > 0);
+	FDrawListBenchResult Result;
+	Result.mNumDraws = InNumDraws;
+
+	const int NumShaders = 4;
+	const int NumRasterizerStates = 2;
+	const int NumMeshes = 32;
+	const int NumMaterials = 16;
+
+	// draws of random state, in the order a scene would create them
+	mt19937 Random(42);
+	vector<FPipelineState> Pipelines(InNumDraws);
+	vector<uint32_t> Meshes(InNumDraws);
+	vector<uint32_t> Materials(InNumDraws);
+	vector<float> Depths(InNumDraws);
+	for (int i = 0; i < InNumDraws; ++i)
+	{
+		int Shader = Random() % NumShaders;
+		Pipelines[i].mVertexShader = &GObjects[1 + Shader];
+		Pipelines[i].mPixelShader = &GObjects[8 + Shader];
+		Pipelines[i].mInputLayout = &GObjects[16 + Shader];
+		Pipelines[i].mRasterizerState = &GObjects[24 + Random() % NumRasterizerStates];
+		Meshes[i] = Random() % NumMeshes;
+		Materials[i] = Random() % NumMaterials;
+		Depths[i] = (Random() % 10000) / 10000.f;
+	}
+
+	CDrawList DrawList;
+	for (int i = 0; i < InNumDraws; ++i)
+	{
+		uint64_t Key = CDrawList::MakeSortKey(DrawList.GetPipelineId(Pipelines[i]),
+			DrawList.GetObjectId(&GObjects[64 + Meshes[i]]), DrawList.GetObjectId(&GObjects[192 + Materials[i]]), Depths[i]);
+		DrawList.Add(Key, (uint32_t)i);
+	}
+	const vector<FDrawItem> Unsorted = DrawList.GetItems();
+
+	// sorting, repeated on the unsorted draws
+	const int NumRepeats = 8;
+	double RadixSeconds = 0;
+	double StdSeconds = 0;
+	vector<FDrawItem> StdSorted;
+	for (int Repeat = 0; Repeat < NumRepeats; ++Repeat)
+	{
+		DrawList.Reset();
+		for (const FDrawItem& Item : Unsorted)
+		{
+			DrawList.Add(Item.mSortKey, Item.mPayload);
+		}
+		auto StartTime = chrono::steady_clock::now();
+		DrawList.Sort();
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		RadixSeconds += Elapsed.count();
+
+		StdSorted = Unsorted;
+		StartTime = chrono::steady_clock::now();
+		stable_sort(StdSorted.begin(), StdSorted.end(),
+			[](const FDrawItem& A, const FDrawItem& B) { return A.mSortKey < B.mSortKey; });
+		Elapsed = chrono::steady_clock::now() - StartTime;
+		StdSeconds += Elapsed.count();
+	}
+	Result.mRadixSortNs = RadixSeconds * 1e9 / NumRepeats / InNumDraws;
+	Result.mStdSortNs = StdSeconds * 1e9 / NumRepeats / InNumDraws;
+
+	Result.bSortsMatch = true;
+	for (int i = 0; i < InNumDraws; ++i)
+	{
+		Result.bSortsMatch &= StdSorted[i].mPayload == DrawList.GetItems()[i].mPayload;
+	}
+
+	// submission: unsorted with every bind recorded against sorted with redundant binds dropped
+	CRenderCommandList Commands;
+	CNullRenderBackend Backend;
+	Commands.SetSkipRedundantBinds(false);
+	RecordDrawList(Unsorted, Pipelines, Meshes, Materials, Commands);
+	Backend.Execute(Commands);
+	Result.mUnsortedStats = Backend.GetStats();
+
+	Commands.Reset();
+	Commands.SetSkipRedundantBinds(true);
+	RecordDrawList(DrawList.GetItems(), Pipelines, Meshes, Materials, Commands);
+	Backend.ResetStats();
+	Backend.Execute(Commands);
+	Result.mSortedStats = Backend.GetStats();
+	return Result;
+}
+
+FStreamingRingBenchResult CModuleBenchmarks::RunStreamingRing(int InNumFrames, int InLatency)
+{
+	assert(InNumFrames > 0 && InLatency >= 0);
+	FStreamingRingBenchResult Result = {};
+	Result.mNumFrames = InNumFrames;
+	Result.bNoOverlap = true;
+
+	// meshes of 3 to 4096 vertices with mixed strides, about 1 MB per frame in a 4 MB ring
+	const uint32_t Capacity = 4 * 1024 * 1024;
+	CStreamingRing Ring;
+	Ring.Init(Capacity);
+	mt19937 Random(42);
+	const uint32_t Strides[] = { 12, 24, 32 };
+
+	// bytes of frames the GPU may still read, a discard starts a new buffer
+	struct FLiveRange
+	{
+		uint64_t mFrame;
+		uint32_t mBuffer;
+		uint32_t mBegin;
+		uint32_t mEnd;
+	};
+	deque<FLiveRange> LiveRanges;
+	vector<FLiveRange> FrameRanges;
+	uint32_t Buffer = 0;
+
+	double Seconds = 0;
+	for (int Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		// the GPU finished the frame InLatency frames ago
+		if (Frame >= InLatency)
+		{
+			uint64_t Fence = (uint64_t)(Frame - InLatency);
+			Ring.Retire(Fence);
+			while (!LiveRanges.empty() && LiveRanges.front().mFrame <= Fence)
+			{
+				LiveRanges.pop_front();
+			}
+		}
+
+		FrameRanges.clear();
+		auto StartTime = chrono::steady_clock::now();
+		uint32_t FrameBytes = 0;
+		while (FrameBytes < 1024 * 1024)
+		{
+			uint32_t Stride = Strides[Random() % 3];
+			uint32_t Size = (3 + Random() % 4094) * Stride;
+			FStreamingAllocation Allocation;
+			bool bAllocated = Ring.Allocate(Size, Stride, Allocation);
+			assert(bAllocated && Allocation.mOffset % Stride == 0);
+			(void)bAllocated;
+			Result.mDiscards += Allocation.bDiscard ? 1 : 0;
+			++Result.mAllocations;
+			Result.mBytesAllocated += Size;
+			FrameBytes += Size;
+			Buffer += Allocation.bDiscard ? 1 : 0;
+			FrameRanges.push_back({ (uint64_t)Frame, Buffer, Allocation.mOffset, Allocation.mOffset + Size });
+		}
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		Seconds += Elapsed.count();
+
+		// no allocation may overwrite bytes of a frame which is not retired, nor an earlier one of this frame
+		for (const FLiveRange& Range : FrameRanges)
+		{
+			bool bInside = Range.mBegin < Range.mEnd && Range.mEnd <= Capacity;
+			for (const FLiveRange& Live : LiveRanges)
+			{
+				bool bDisjoint = Live.mEnd <= Range.mBegin || Range.mEnd <= Live.mBegin;
+				bInside = bInside && (Live.mBuffer != Range.mBuffer || bDisjoint);
+			}
+			Result.bNoOverlap = Result.bNoOverlap && bInside;
+			LiveRanges.push_back(Range);
+		}
+
+		Ring.EndFrame((uint64_t)Frame);
+	}
+	Result.mWastedBytes = Ring.GetWastedBytes();
+	Result.mAllocateNs = Seconds * 1e9 / Result.mAllocations;
+	return Result;
+}
+
+FShaderCacheBenchResult CModuleBenchmarks::RunShaderBytecodeCache(const string& InDirectory, int InNumLookups)
+{
+	assert(InNumLookups > 0);
+	FShaderCacheBenchResult Result;
+	Result.mNumLookups = InNumLookups;
+
+	// a source including another one, like PlaneMeshPS.hlsl
+	string Directory = InDirectory.empty() || InDirectory.back() == '/' || InDirectory.back() == '\\'
+		? InDirectory : InDirectory + "/";
+	string Include = Directory + "BenchInclude.fxc";
+	string Source = Directory + "BenchShader.hlsl";
+	FILE* fp = OpenFile(Include.c_str(), "wb");
+	assert(fp != nullptr);
+	fprintf(fp, "cbuffer cbBench : register(b0) { float4 gColor; };\n");
+	fclose(fp);
+	fp = OpenFile(Source.c_str(), "wb");
+	assert(fp != nullptr);
+	fprintf(fp, "#include \"BenchInclude.fxc\"\nfloat4 main() : SV_TARGET { return gColor; }\n");
+	fclose(fp);
+
+	FShaderKey Key;
+	Key.mFile = Source;
+	Key.mEntryPoint = "main";
+	Key.mProfile = "ps_5_0";
+	Key.mDefines.push_back(make_pair(string("RECTGI_BENCH"), string("1")));
+	Key.mSourceHash = CShaderBytecodeCache::HashSource(Source);
+
+	// fake bytecode of a typical size
+	vector<uint8_t> Bytecode(16 * 1024);
+	for (size_t i = 0; i < Bytecode.size(); ++i)
+	{
+		Bytecode[i] = (uint8_t)(i * 2654435761u >> 24);
+	}
+	{
+		CShaderBytecodeCache Writer;
+		Writer.SetDirectory(Directory);
+		Writer.Store(Key, Bytecode.data(), Bytecode.size());
+	}
+
+	// a fresh cache per lookup loads from disk, like a warm start
+	Result.bRoundTrips = true;
+	auto StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumLookups; ++i)
+	{
+		CShaderBytecodeCache Reader;
+		Reader.SetDirectory(Directory);
+		const vector<uint8_t>* Found = Reader.Find(Key);
+		Result.bRoundTrips = Result.bRoundTrips && Found != nullptr && *Found == Bytecode;
+	}
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mDiskLookupUs = Elapsed.count() * 1e6 / InNumLookups;
+
+	CShaderBytecodeCache Reader;
+	Reader.SetDirectory(Directory);
+	Reader.Find(Key);
+	StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumLookups; ++i)
+	{
+		Result.bRoundTrips = Result.bRoundTrips && Reader.Find(Key) != nullptr;
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mMemoryLookupNs = Elapsed.count() * 1e9 / InNumLookups;
+
+	// a changed include must miss
+	fp = OpenFile(Include.c_str(), "wb");
+	assert(fp != nullptr);
+	fprintf(fp, "cbuffer cbBench : register(b1) { float4 gColor; };\n");
+	fclose(fp);
+	FShaderKey Changed = Key;
+	Changed.mSourceHash = CShaderBytecodeCache::HashSource(Source);
+	Result.bRoundTrips = Result.bRoundTrips && Changed.mSourceHash != Key.mSourceHash && Reader.Find(Changed) == nullptr;
+
+	remove(Reader.GetFileName(Key.GetHash()).c_str());
+	remove(Source.c_str());
+	remove(Include.c_str());
+	return Result;
+}
+
+FProfilerBenchResult CModuleBenchmarks::RunProfiler(int InNumZones)
+{
+	assert(InNumZones >= 2);
+	CProfiler& Profiler = CProfiler::GetInstance();
+	bool bWasEnabled = Profiler.IsEnabled();
+
+	// pairs of nested zones like a function calling another, the ring wraps many times
+	auto RecordZones = [InNumZones]()
+	{
+		auto StartTime = chrono::steady_clock::now();
+		for (int i = 0; i < InNumZones / 2; ++i)
+		{
+			PROFILE_SCOPE("Benchmark Outer");
+			{
+				PROFILE_SCOPE("Benchmark Inner");
+			}
+		}
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		return Elapsed.count() * 1e9 / (InNumZones / 2 * 2);
+	};
+
+	// cost of one CProfiler::ReadTicks, a zone reads the clock twice
+	auto ReadClock = [InNumZones]()
+	{
+		uint64_t Sum = 0;
+		auto StartTime = chrono::steady_clock::now();
+		for (int i = 0; i < InNumZones; ++i)
+		{
+			Sum += CProfiler::ReadTicks();
+		}
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+		// keep the reads
+		volatile uint64_t Sink = Sum;
+		(void)Sink;
+		return Elapsed.count() * 1e9 / InNumZones;
+	};
+
+	FProfilerBenchResult Result;
+	Result.mNumZones = InNumZones / 2 * 2;
+	// best of a few runs, an interrupt in one run should not fail the budget check
+	const int NumRuns = 10;
+	Result.mZoneNs = DBL_MAX;
+	Result.mDisabledZoneNs = DBL_MAX;
+	Result.mReadTicksNs = DBL_MAX;
+	Profiler.GetThread();
+	for (int Run = 0; Run < NumRuns; ++Run)
+	{
+		Profiler.SetEnabled(true);
+		Result.mZoneNs = min(Result.mZoneNs, RecordZones());
+		Profiler.SetEnabled(false);
+		Result.mDisabledZoneNs = min(Result.mDisabledZoneNs, RecordZones());
+		Result.mReadTicksNs = min(Result.mReadTicksNs, ReadClock());
+	}
+
+	Profiler.SetEnabled(bWasEnabled);
+	Profiler.Clear();
+	return Result;
+}
+
+FRenderThreadBenchResult CModuleBenchmarks::RunRenderThread(int InNumFrames, double InStageMs)
+{
+	assert(InNumFrames > 0 && InStageMs > 0);
+	FRenderThreadBenchResult Result = {};
+	Result.mNumFrames = InNumFrames;
+	Result.bOwnThread = true;
+
+	// the render stage notes the thread it ran on
+	struct FRenderStage
+	{
+		double mMs;
+		thread::id mThread;
+	};
+	FRenderStage RenderStage = { InStageMs, thread::id() };
+
+	CRenderThread RenderThread;
+	RenderThread.Start();
+	for (int Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		auto FrameStart = chrono::steady_clock::now();
+		RenderThread.Kick([](void* InData)
+		{
+			FRenderStage* Stage = static_cast<FRenderStage*>(InData);
+			Stage->mThread = this_thread::get_id();
+			BusyWork(Stage->mMs);
+		}, &RenderStage);
+
+		auto SimulateStart = chrono::steady_clock::now();
+		BusyWork(InStageMs);
+		auto SimulateEnd = chrono::steady_clock::now();
+		RenderThread.Wait();
+
+		chrono::duration<double, milli> Simulate = SimulateEnd - SimulateStart;
+		chrono::duration<double, milli> Render = RenderThread.GetStageEnd() - RenderThread.GetStageBegin();
+		chrono::duration<double, milli> Total = chrono::steady_clock::now() - FrameStart;
+		Result.mSimulateMs += Simulate.count();
+		Result.mRenderMs += Render.count();
+		Result.mOverlapMs += RenderThread.GetOverlapMs(SimulateStart, SimulateEnd);
+		Result.mFrameMs += Total.count();
+		Result.bOwnThread = Result.bOwnThread && RenderStage.mThread != this_thread::get_id();
+	}
+	RenderThread.Stop();
+
+	Result.mSimulateMs /= InNumFrames;
+	Result.mRenderMs /= InNumFrames;
+	Result.mOverlapMs /= InNumFrames;
+	Result.mFrameMs /= InNumFrames;
+	return Result;
+}
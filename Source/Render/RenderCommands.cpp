@@ -0,0 +1,432 @@
+#include "RenderCommands.h"
+#include <cassert>
+#include <cstring>
+
+FPipelineState::FPipelineState()
+	: mVertexShader(nullptr)
+	, mPixelShader(nullptr)
+	, mInputLayout(nullptr)
+	, mRasterizerState(nullptr)
+	, mTopology(EPrimitiveTopology::TriangleList)
+{
+}
+
+FRenderStats::FRenderStats()
+	: mCommands(0)
+	, mDraws(0)
+	, mTriangles(0)
+	, mStateChanges(0)
+	, mRedundantBinds(0)
+	, mSkippedBinds(0)
+	, mUploads(0)
+	, mBytesUploaded(0)
+{
+}
+
+FRenderBuffer::FRenderBuffer()
+	: mBuffer(nullptr)
+	, mView(nullptr)
+	, mCapacity(0)
+{
+}
+
+CRenderCommandList::CRenderCommandList()
+	: bSkipRedundantBinds(true)
+{
+	ResetBoundValues();
+}
+
+void CRenderCommandList::Reset()
+{
+	mCommands.clear();
+	mPipelines.clear();
+	mPayload.clear();
+	mFrameConstants.clear();
+	ResetBoundValues();
+}
+
+void CRenderCommandList::ResetBoundValues()
+{
+	mNumSkippedBinds = 0;
+	memset(&mBoundViewport, 0, sizeof(mBoundViewport));
+	memset(mBoundVertexBuffers, 0, sizeof(mBoundVertexBuffers));
+	memset(&mBoundIndexBuffer, 0, sizeof(mBoundIndexBuffer));
+	memset(mBoundConstants, 0, sizeof(mBoundConstants));
+	memset(mBoundShaderResources, 0, sizeof(mBoundShaderResources));
+	memset(mBoundSamplers, 0, sizeof(mBoundSamplers));
+}
+
+bool CRenderCommandList::SkipBind(FBoundValue& InOutBound, const void* InObject, uint32_t InArg0, uint32_t InArg1)
+{
+	if (bSkipRedundantBinds && InOutBound.bValid && InOutBound.mObject == InObject
+		&& InOutBound.mArgs[0] == InArg0 && InOutBound.mArgs[1] == InArg1)
+	{
+		++mNumSkippedBinds;
+		return true;
+	}
+
+	InOutBound.bValid = true;
+	InOutBound.mObject = InObject;
+	InOutBound.mArgs[0] = InArg0;
+	InOutBound.mArgs[1] = InArg1;
+	return false;
+}
+
+FRenderCommand& CRenderCommandList::Append(ERenderCommand::Type InType)
+{
+	mCommands.emplace_back();
+	FRenderCommand& Command = mCommands.back();
+	memset(&Command, 0, sizeof(Command));
+	Command.mType = (uint8_t)InType;
+	return Command;
+}
+
+void CRenderCommandList::SetRenderTargets(void* InRenderTarget, void* InDepthStencil)
+{
+	FRenderCommand& Command = Append(ERenderCommand::SetRenderTargets);
+	Command.mObject = InRenderTarget;
+	Command.mObject2 = InDepthStencil;
+
+	// D3D11 unbinds views of resources bound as targets, so shader resources are not known any more
+	memset(mBoundShaderResources, 0, sizeof(mBoundShaderResources));
+}
+
+void CRenderCommandList::ClearRenderTarget(void* InRenderTarget, const float InColor[4])
+{
+	FRenderCommand& Command = Append(ERenderCommand::ClearRenderTarget);
+	Command.mObject = InRenderTarget;
+	memcpy(Command.mFloats, InColor, sizeof(Command.mFloats));
+}
+
+void CRenderCommandList::ClearDepth(void* InDepthStencil, float InDepth)
+{
+	FRenderCommand& Command = Append(ERenderCommand::ClearDepth);
+	Command.mObject = InDepthStencil;
+	Command.mFloats[0] = InDepth;
+}
+
+void CRenderCommandList::SetViewport(float InWidth, float InHeight)
+{
+	uint32_t Width, Height;
+	memcpy(&Width, &InWidth, sizeof(Width));
+	memcpy(&Height, &InHeight, sizeof(Height));
+	if (SkipBind(mBoundViewport, nullptr, Width, Height))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetViewport);
+	Command.mFloats[0] = InWidth;
+	Command.mFloats[1] = InHeight;
+}
+
+void CRenderCommandList::SetPipeline(const FPipelineState& InPipeline)
+{
+	// the last pipeline recorded is the one bound
+	if (bSkipRedundantBinds && !mPipelines.empty() && mPipelines.back() == InPipeline)
+	{
+		++mNumSkippedBinds;
+		return;
+	}
+
+	FRenderCommand& Command = Append(ERenderCommand::SetPipeline);
+	Command.mArgs[0] = (uint32_t)mPipelines.size();
+	mPipelines.push_back(InPipeline);
+}
+
+void CRenderCommandList::SetVertexBuffer(void* InBuffer, uint32_t InStride, uint32_t InOffset, uint32_t InStream)
+{
+	assert(InStream < MaxVertexStreams);
+	if (SkipBind(mBoundVertexBuffers[InStream], InBuffer, InStride, InOffset))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetVertexBuffer);
+	Command.mSlot = (uint16_t)InStream;
+	Command.mObject = InBuffer;
+	Command.mArgs[0] = InStride;
+	Command.mArgs[1] = InOffset;
+}
+
+void CRenderCommandList::SetIndexBuffer(void* InBuffer, EIndexFormat::Type InFormat)
+{
+	if (SkipBind(mBoundIndexBuffer, InBuffer, InFormat))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetIndexBuffer);
+	Command.mObject = InBuffer;
+	Command.mArgs[0] = InFormat;
+}
+
+void* CRenderCommandList::UpdateBuffer(void* InBuffer, uint32_t InSize)
+{
+	return UpdateBufferRange(InBuffer, 0, InSize, true);
+}
+
+void CRenderCommandList::UpdateBuffer(void* InBuffer, const void* InData, uint32_t InSize)
+{
+	memcpy(UpdateBuffer(InBuffer, InSize), InData, InSize);
+}
+
+void* CRenderCommandList::UpdateBufferRange(void* InBuffer, uint32_t InOffset, uint32_t InSize, bool bInDiscard)
+{
+	assert(InBuffer && InSize > 0);
+
+	// keep upload data aligned for the packers writing into it
+	uint32_t Offset = ((uint32_t)mPayload.size() + UploadAlignment - 1) & ~(UploadAlignment - 1);
+	mPayload.resize(Offset + InSize);
+
+	FRenderCommand& Command = Append(ERenderCommand::UpdateBuffer);
+	Command.mObject = InBuffer;
+	Command.mArgs[0] = Offset;
+	Command.mArgs[1] = InSize;
+	Command.mArgs[2] = InOffset;
+	Command.mArgs[3] = bInDiscard ? 1 : 0;
+	return &mPayload[Offset];
+}
+
+void CRenderCommandList::SetConstantBuffer(EShaderStage::Type InStage, uint32_t InSlot, void* InBuffer)
+{
+	// updates keep the binding, so a buffer written since it was bound is still bound
+	assert(InSlot < MaxBindSlots);
+	if (SkipBind(mBoundConstants[InStage][InSlot], InBuffer, 0, 0))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetConstantBuffer);
+	Command.mStage = (uint8_t)InStage;
+	Command.mSlot = (uint16_t)InSlot;
+	Command.mObject = InBuffer;
+}
+
+void* CRenderCommandList::AllocateFrameConstants(uint32_t InSize, uint32_t& OutOffset)
+{
+	assert(InSize > 0);
+
+	// whole aligned blocks, so every range can be bound on its own
+	OutOffset = (uint32_t)mFrameConstants.size();
+	uint32_t Size = (InSize + ConstantsAlignment - 1) & ~(ConstantsAlignment - 1);
+	mFrameConstants.resize(OutOffset + Size);
+	return &mFrameConstants[OutOffset];
+}
+
+void* CRenderCommandList::AllocateFrameConstantsArray(uint32_t InCount, uint32_t InSize, uint32_t& OutOffset,
+	uint32_t& OutStride)
+{
+	assert(InCount > 0 && InSize > 0);
+
+	OutStride = (InSize + ConstantsAlignment - 1) & ~(ConstantsAlignment - 1);
+	OutOffset = (uint32_t)mFrameConstants.size();
+	mFrameConstants.resize(OutOffset + (size_t)InCount * OutStride);
+	return &mFrameConstants[OutOffset];
+}
+
+void CRenderCommandList::SetFrameConstants(EShaderStage::Type InStage, uint32_t InSlot, uint32_t InOffset, uint32_t InSize)
+{
+	assert(InOffset % ConstantsAlignment == 0 && InOffset + InSize <= mFrameConstants.size());
+	// a null object with a size tells frame constants apart from constant buffers
+	assert(InSlot < MaxBindSlots && InSize > 0);
+	if (SkipBind(mBoundConstants[InStage][InSlot], nullptr, InOffset, InSize))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetFrameConstants);
+	Command.mStage = (uint8_t)InStage;
+	Command.mSlot = (uint16_t)InSlot;
+	Command.mArgs[0] = InOffset;
+	Command.mArgs[1] = InSize;
+}
+
+void CRenderCommandList::SetShaderResource(EShaderStage::Type InStage, uint32_t InSlot, void* InView)
+{
+	assert(InSlot < MaxBindSlots);
+	if (SkipBind(mBoundShaderResources[InStage][InSlot], InView))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetShaderResource);
+	Command.mStage = (uint8_t)InStage;
+	Command.mSlot = (uint16_t)InSlot;
+	Command.mObject = InView;
+}
+
+void CRenderCommandList::SetSampler(EShaderStage::Type InStage, uint32_t InSlot, void* InSampler)
+{
+	assert(InSlot < MaxBindSlots);
+	if (SkipBind(mBoundSamplers[InStage][InSlot], InSampler))
+		return;
+
+	FRenderCommand& Command = Append(ERenderCommand::SetSampler);
+	Command.mStage = (uint8_t)InStage;
+	Command.mSlot = (uint16_t)InSlot;
+	Command.mObject = InSampler;
+}
+
+void CRenderCommandList::Draw(uint32_t InVertexCount, uint32_t InStartVertex)
+{
+	FRenderCommand& Command = Append(ERenderCommand::Draw);
+	Command.mArgs[0] = InVertexCount;
+	Command.mArgs[1] = InStartVertex;
+}
+
+void CRenderCommandList::DrawIndexed(uint32_t InIndexCount, uint32_t InStartIndex, int32_t InBaseVertex)
+{
+	FRenderCommand& Command = Append(ERenderCommand::DrawIndexed);
+	Command.mArgs[0] = InIndexCount;
+	Command.mArgs[1] = InStartIndex;
+	Command.mArgs[2] = (uint32_t)InBaseVertex;
+}
+
+void CRenderCommandList::DrawIndexedInstanced(uint32_t InIndexCount, uint32_t InInstanceCount, uint32_t InStartIndex,
+	uint32_t InStartInstance)
+{
+	FRenderCommand& Command = Append(ERenderCommand::DrawIndexedInstanced);
+	Command.mArgs[0] = InIndexCount;
+	Command.mArgs[1] = InInstanceCount;
+	Command.mArgs[2] = InStartIndex;
+	Command.mArgs[3] = InStartInstance;
+}
+
+CNullRenderBackend::CNullRenderBackend()
+	: mNumBuffers(0)
+{
+	ResetStats();
+}
+
+bool CNullRenderBackend::CreateBuffer(EBufferBinding::Type InBinding, uint32_t InStride, uint32_t InCapacity,
+	FRenderBuffer& OutBuffer)
+{
+	assert(OutBuffer.mBuffer == nullptr && InStride > 0 && InCapacity > 0);
+	(void)InStride;
+	OutBuffer.mBuffer = new uint8_t;
+	OutBuffer.mView = InBinding == EBufferBinding::Structured ? new uint8_t : nullptr;
+	OutBuffer.mCapacity = InCapacity;
+	++mNumBuffers;
+	return true;
+}
+
+void CNullRenderBackend::ReleaseBuffer(FRenderBuffer& InOutBuffer)
+{
+	if (InOutBuffer.mBuffer == nullptr)
+		return;
+
+	delete static_cast<uint8_t*>(InOutBuffer.mView);
+	delete static_cast<uint8_t*>(InOutBuffer.mBuffer);
+	InOutBuffer = FRenderBuffer();
+	--mNumBuffers;
+}
+
+void CNullRenderBackend::ResetStats()
+{
+	mStats = FRenderStats();
+
+	mRenderTarget = nullptr;
+	mDepthStencil = nullptr;
+	mViewport = nullptr;
+	mVertexShader = nullptr;
+	mPixelShader = nullptr;
+	mInputLayout = nullptr;
+	mRasterizerState = nullptr;
+	mTopology = nullptr;
+	memset(mVertexBuffers, 0, sizeof(mVertexBuffers));
+	mIndexBuffer = nullptr;
+	memset(mConstantBuffers, 0, sizeof(mConstantBuffers));
+	memset(mShaderResources, 0, sizeof(mShaderResources));
+	memset(mSamplers, 0, sizeof(mSamplers));
+}
+
+void CNullRenderBackend::Bind(const void*& InOutBound, const void* InValue)
+{
+	if (InOutBound == InValue)
+	{
+		++mStats.mRedundantBinds;
+	}
+	else
+	{
+		InOutBound = InValue;
+		++mStats.mStateChanges;
+	}
+}
+
+void CNullRenderBackend::Execute(const CRenderCommandList& InCommands)
+{
+	mStats.mSkippedBinds += InCommands.GetNumSkippedBinds();
+
+	// the frame constants stage uploads once before the commands
+	const vector<uint8_t>& FrameConstants = InCommands.GetFrameConstants();
+	if (!FrameConstants.empty())
+	{
+		++mStats.mUploads;
+		mStats.mBytesUploaded += FrameConstants.size();
+	}
+
+	// values which are not objects are tracked as small integers, offset so they are never null
+	for (const FRenderCommand& Command : InCommands.GetCommands())
+	{
+		++mStats.mCommands;
+		switch (Command.mType)
+		{
+		case ERenderCommand::SetRenderTargets:
+			Bind(mRenderTarget, Command.mObject);
+			Bind(mDepthStencil, Command.mObject2);
+			break;
+		case ERenderCommand::ClearRenderTarget:
+		case ERenderCommand::ClearDepth:
+			break;
+		case ERenderCommand::SetViewport:
+		{
+			// viewports are compared by size
+			uintptr_t Size = ((uintptr_t)(uint32_t)Command.mFloats[0] << 16) ^ (uint32_t)Command.mFloats[1];
+			Bind(mViewport, (const void*)(Size + 1));
+			break;
+		}
+		case ERenderCommand::SetPipeline:
+		{
+			const FPipelineState& Pipeline = InCommands.GetPipeline(Command);
+			Bind(mVertexShader, Pipeline.mVertexShader);
+			Bind(mPixelShader, Pipeline.mPixelShader);
+			Bind(mInputLayout, Pipeline.mInputLayout);
+			Bind(mRasterizerState, Pipeline.mRasterizerState);
+			Bind(mTopology, (const void*)((uintptr_t)Pipeline.mTopology + 1));
+			break;
+		}
+		case ERenderCommand::SetVertexBuffer:
+			assert(Command.mSlot < NumStreams);
+			Bind(mVertexBuffers[Command.mSlot], Command.mObject);
+			break;
+		case ERenderCommand::SetIndexBuffer:
+			Bind(mIndexBuffer, Command.mObject);
+			break;
+		case ERenderCommand::UpdateBuffer:
+			++mStats.mUploads;
+			mStats.mBytesUploaded += Command.mArgs[1];
+			break;
+		case ERenderCommand::SetConstantBuffer:
+			assert(Command.mSlot < NumSlots);
+			Bind(mConstantBuffers[Command.mStage][Command.mSlot], Command.mObject);
+			break;
+		case ERenderCommand::SetFrameConstants:
+			// ranges are told apart by their address in the frame constants
+			assert(Command.mSlot < NumSlots);
+			Bind(mConstantBuffers[Command.mStage][Command.mSlot], &FrameConstants[Command.mArgs[0]]);
+			break;
+		case ERenderCommand::SetShaderResource:
+			assert(Command.mSlot < NumSlots);
+			Bind(mShaderResources[Command.mStage][Command.mSlot], Command.mObject);
+			break;
+		case ERenderCommand::SetSampler:
+			assert(Command.mSlot < NumSlots);
+			Bind(mSamplers[Command.mStage][Command.mSlot], Command.mObject);
+			break;
+		case ERenderCommand::Draw:
+			++mStats.mDraws;
+			mStats.mTriangles += mTopology == (const void*)(EPrimitiveTopology::TriangleStrip + 1)
+				? (Command.mArgs[0] >= 2 ? Command.mArgs[0] - 2 : 0) : Command.mArgs[0] / 3;
+			break;
+		case ERenderCommand::DrawIndexed:
+			++mStats.mDraws;
+			mStats.mTriangles += Command.mArgs[0] / 3;
+			break;
+		case ERenderCommand::DrawIndexedInstanced:
+			++mStats.mDraws;
+			mStats.mTriangles += (uint64_t)(Command.mArgs[0] / 3) * Command.mArgs[1];
+			break;
+		default:
+			assert(0);
+		}
+	}
+}
@@ -0,0 +1,349 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Commands recorded into CRenderCommandList.
+namespace ERenderCommand
+{
+	enum Type
+	{
+		// bind a render target view and a depth stencil view
+		SetRenderTargets = 0,
+		// clear a render target view to a color
+		ClearRenderTarget,
+		// clear the depth of a depth stencil view
+		ClearDepth,
+		// set a viewport at the origin
+		SetViewport,
+		// bind shaders, input layout, rasterizer state and topology
+		SetPipeline,
+		// bind a vertex buffer
+		SetVertexBuffer,
+		// bind an index buffer
+		SetIndexBuffer,
+		// write payload data into a dynamic buffer, discarding it or into a range the GPU does not read
+		UpdateBuffer,
+		// bind a constant buffer to a stage
+		SetConstantBuffer,
+		// bind a range of the frame constants to a stage
+		SetFrameConstants,
+		// bind a shader resource view to a stage
+		SetShaderResource,
+		// bind a sampler state to a stage
+		SetSampler,
+		// draw non-indexed primitives
+		Draw,
+		// draw indexed primitives
+		DrawIndexed,
+		// draw instances of indexed primitives
+		DrawIndexedInstanced,
+		Num
+	};
+};
+
+// Shader stages of bind commands.
+namespace EShaderStage
+{
+	enum Type
+	{
+		Vertex = 0,
+		Pixel,
+		Num
+	};
+};
+
+// Primitive topologies of FPipelineState.
+namespace EPrimitiveTopology
+{
+	enum Type
+	{
+		TriangleList = 0,
+		TriangleStrip,
+	};
+};
+
+// Index formats of SetIndexBuffer.
+namespace EIndexFormat
+{
+	enum Type
+	{
+		UInt16 = 0,
+		UInt32,
+	};
+};
+
+// How a buffer of IRenderBackend::CreateBuffer is bound.
+namespace EBufferBinding
+{
+	enum Type
+	{
+		// vertex stream, per vertex or per instance
+		Vertex = 0,
+		// index buffer
+		Index,
+		// structured buffer read by shaders through its view
+		Structured,
+	};
+};
+
+// Dynamic buffer of a backend, written by UpdateBuffer commands.
+struct FRenderBuffer
+{
+	FRenderBuffer();
+
+	// buffer object, null until created
+	void* mBuffer;
+	// shader resource view of structured buffers, null for the others
+	void* mView;
+	// elements the buffer holds
+	uint32_t mCapacity;
+};
+
+// Fixed function and shader state bound by SetPipeline. Objects are opaque to the command list and
+// interpreted by the backend, e.g. ID3D11VertexShader for CD3D11RenderBackend.
+struct FPipelineState
+{
+	FPipelineState();
+
+	bool operator==(const FPipelineState& Other) const
+	{
+		return mVertexShader == Other.mVertexShader && mPixelShader == Other.mPixelShader
+			&& mInputLayout == Other.mInputLayout && mRasterizerState == Other.mRasterizerState
+			&& mTopology == Other.mTopology;
+	}
+
+	// vertex shader
+	void* mVertexShader;
+	// pixel shader
+	void* mPixelShader;
+	// input layout
+	void* mInputLayout;
+	// rasterizer state
+	void* mRasterizerState;
+	// EPrimitiveTopology::Type
+	uint32_t mTopology;
+};
+
+// One recorded command, 32 bytes on 64 bit targets.
+struct FRenderCommand
+{
+	// ERenderCommand::Type
+	uint8_t mType;
+	// EShaderStage::Type of bind commands
+	uint8_t mStage;
+	// register slot or vertex stream
+	uint16_t mSlot;
+	// meaning depends on the type: counts, offsets, formats, colors or a pipeline index
+	union
+	{
+		uint32_t mArgs[4];
+		float mFloats[4];
+	};
+	// object bound, cleared or updated
+	void* mObject;
+	// depth stencil view of SetRenderTargets
+	void* mObject2;
+};
+
+// Counters of submitted work.
+struct FRenderStats
+{
+	FRenderStats();
+
+	// commands executed
+	uint32_t mCommands;
+	// draw calls
+	uint32_t mDraws;
+	// triangles drawn
+	uint64_t mTriangles;
+	// bind commands which changed the bound state, each pipeline part counts
+	uint32_t mStateChanges;
+	// bind commands which bound what was already bound
+	uint32_t mRedundantBinds;
+	// binds the command list dropped because they matched what it had recorded before
+	uint32_t mSkippedBinds;
+	// buffer updates, the frame constants count as one
+	uint32_t mUploads;
+	// bytes written by buffer updates
+	uint64_t mBytesUploaded;
+};
+
+// Frame commands recorded independently of the graphics API. Binding, buffer updates and draws are recorded
+// here and replayed by an IRenderBackend, which also creates the buffers written every frame.
+class CRenderCommandList
+{
+public:
+	// alignment of upload data in the payload
+	static const uint32_t UploadAlignment = 16;
+	// alignment of frame constant ranges, constant buffer offsets are bound in units of 16 constants
+	static const uint32_t ConstantsAlignment = 256;
+	// register slots per stage and vertex streams which can be bound
+	static const uint32_t MaxBindSlots = 16;
+	static const uint32_t MaxVertexStreams = 2;
+
+	CRenderCommandList();
+
+	// Remove all commands, keeping the memory.
+	void Reset();
+	// Drop bind commands matching the value recorded last for the same bind point, on by default.
+	void SetSkipRedundantBinds(bool bInSkip) { bSkipRedundantBinds = bInSkip; }
+
+	// Bind a render target view and a depth stencil view, either may be null.
+	void SetRenderTargets(void* InRenderTarget, void* InDepthStencil);
+	// Clear a render target view.
+	void ClearRenderTarget(void* InRenderTarget, const float InColor[4]);
+	// Clear the depth of a depth stencil view.
+	void ClearDepth(void* InDepthStencil, float InDepth);
+	// Set a viewport of the given size at the origin with depth range [0, 1].
+	void SetViewport(float InWidth, float InHeight);
+	// Bind shaders, input layout, rasterizer state and topology.
+	void SetPipeline(const FPipelineState& InPipeline);
+	// Bind a vertex buffer to a stream.
+	void SetVertexBuffer(void* InBuffer, uint32_t InStride, uint32_t InOffset, uint32_t InStream = 0);
+	// Bind an index buffer.
+	void SetIndexBuffer(void* InBuffer, EIndexFormat::Type InFormat);
+	// Overwrite the first InSize bytes of a dynamic buffer, returns where to write the data. The pointer is
+	// valid until the next command is recorded.
+	void* UpdateBuffer(void* InBuffer, uint32_t InSize);
+	// Same as above, copying the data.
+	void UpdateBuffer(void* InBuffer, const void* InData, uint32_t InSize);
+	// Write InSize bytes at InOffset of a dynamic buffer, returns where to write the data. With bInDiscard the
+	// rest of the buffer is undefined afterwards, otherwise the range must not be in use by the GPU.
+	void* UpdateBufferRange(void* InBuffer, uint32_t InOffset, uint32_t InSize, bool bInDiscard);
+	// Bind a constant buffer.
+	void SetConstantBuffer(EShaderStage::Type InStage, uint32_t InSlot, void* InBuffer);
+	// Allocate constants living for this frame, returns where to write them. All frame constants are uploaded
+	// by one buffer update before the commands run. The pointer is valid until the next allocation.
+	void* AllocateFrameConstants(uint32_t InSize, uint32_t& OutOffset);
+	// Allocate InCount ranges of InSize bytes, OutStride apart, e.g. to fill them from several threads.
+	void* AllocateFrameConstantsArray(uint32_t InCount, uint32_t InSize, uint32_t& OutOffset, uint32_t& OutStride);
+	// Bind frame constants allocated by AllocateFrameConstants.
+	void SetFrameConstants(EShaderStage::Type InStage, uint32_t InSlot, uint32_t InOffset, uint32_t InSize);
+	// Bind a shader resource view, null unbinds.
+	void SetShaderResource(EShaderStage::Type InStage, uint32_t InSlot, void* InView);
+	// Bind a sampler state.
+	void SetSampler(EShaderStage::Type InStage, uint32_t InSlot, void* InSampler);
+	// Draw InVertexCount vertices.
+	void Draw(uint32_t InVertexCount, uint32_t InStartVertex);
+	// Draw InIndexCount indices.
+	void DrawIndexed(uint32_t InIndexCount, uint32_t InStartIndex, int32_t InBaseVertex);
+	// Draw InInstanceCount instances of InIndexCount indices, per-instance streams start at InStartInstance.
+	void DrawIndexedInstanced(uint32_t InIndexCount, uint32_t InInstanceCount, uint32_t InStartIndex,
+		uint32_t InStartInstance);
+
+	// Recorded commands.
+	const vector<FRenderCommand>& GetCommands() const { return mCommands; }
+	// Pipeline of a SetPipeline command.
+	const FPipelineState& GetPipeline(const FRenderCommand& InCommand) const { return mPipelines[InCommand.mArgs[0]]; }
+	// Data of an UpdateBuffer command.
+	const void* GetUploadData(const FRenderCommand& InCommand) const { return &mPayload[InCommand.mArgs[0]]; }
+	// All frame constants, ranges are aligned to ConstantsAlignment.
+	const vector<uint8_t>& GetFrameConstants() const { return mFrameConstants; }
+	// Bind commands dropped since the last reset.
+	uint32_t GetNumSkippedBinds() const { return mNumSkippedBinds; }
+
+private:
+	// A bind point as last recorded.
+	struct FBoundValue
+	{
+		bool bValid;
+		const void* mObject;
+		uint32_t mArgs[2];
+	};
+
+	// Append a command of a type with everything else zero.
+	FRenderCommand& Append(ERenderCommand::Type InType);
+	// True if the value is already bound and the bind can be dropped, otherwise remember it as bound.
+	bool SkipBind(FBoundValue& InOutBound, const void* InObject, uint32_t InArg0 = 0, uint32_t InArg1 = 0);
+	// Forget what was recorded for all bind points.
+	void ResetBoundValues();
+
+private:
+	// commands in recording order
+	vector<FRenderCommand> mCommands;
+	// pipelines of SetPipeline commands
+	vector<FPipelineState> mPipelines;
+	// data of UpdateBuffer commands
+	vector<uint8_t> mPayload;
+	// constants allocated by AllocateFrameConstants
+	vector<uint8_t> mFrameConstants;
+
+	// bind points as recorded so far this frame, the backends replay the commands in the same order
+	bool bSkipRedundantBinds;
+	uint32_t mNumSkippedBinds;
+	FBoundValue mBoundViewport;
+	FBoundValue mBoundVertexBuffers[MaxVertexStreams];
+	FBoundValue mBoundIndexBuffer;
+	FBoundValue mBoundConstants[EShaderStage::Num][MaxBindSlots];
+	FBoundValue mBoundShaderResources[EShaderStage::Num][MaxBindSlots];
+	FBoundValue mBoundSamplers[EShaderStage::Num][MaxBindSlots];
+};
+
+// Executes command lists.
+class IRenderBackend
+{
+public:
+	virtual ~IRenderBackend() {}
+
+	// Replay all commands of the list.
+	virtual void Execute(const CRenderCommandList& InCommands) = 0;
+
+	// Create a dynamic buffer of InCapacity elements of InStride bytes, false if the backend failed to.
+	virtual bool CreateBuffer(EBufferBinding::Type InBinding, uint32_t InStride, uint32_t InCapacity,
+		FRenderBuffer& OutBuffer) = 0;
+	// Release a buffer of CreateBuffer and reset it, commands recorded before must have been executed.
+	virtual void ReleaseBuffer(FRenderBuffer& InOutBuffer) = 0;
+};
+
+// Backend which only tracks the bound state and counts the submitted work, for headless runs.
+class CNullRenderBackend : public IRenderBackend
+{
+public:
+	// bind slots tracked per stage
+	static const int NumSlots = CRenderCommandList::MaxBindSlots;
+	// vertex streams tracked
+	static const int NumStreams = CRenderCommandList::MaxVertexStreams;
+
+	CNullRenderBackend();
+
+	// Count the commands of the list, adding to the stats.
+	virtual void Execute(const CRenderCommandList& InCommands) override;
+	// Buffers are objects of their own, which only their addresses tell apart.
+	virtual bool CreateBuffer(EBufferBinding::Type InBinding, uint32_t InStride, uint32_t InCapacity,
+		FRenderBuffer& OutBuffer) override;
+	virtual void ReleaseBuffer(FRenderBuffer& InOutBuffer) override;
+
+	// Reset the counters and forget the bound state, e.g. at the start of a frame.
+	void ResetStats();
+	// Counters since the last reset.
+	const FRenderStats& GetStats() const { return mStats; }
+	// Buffers created and not released.
+	int GetNumBuffers() const { return mNumBuffers; }
+
+private:
+	// Bind a value to a tracked state, counting changes and redundant binds.
+	void Bind(const void*& InOutBound, const void* InValue);
+
+private:
+	// counters
+	FRenderStats mStats;
+	// buffers alive
+	int mNumBuffers;
+
+	// bound state, null when unknown
+	const void* mRenderTarget;
+	const void* mDepthStencil;
+	const void* mViewport;
+	const void* mVertexShader;
+	const void* mPixelShader;
+	const void* mInputLayout;
+	const void* mRasterizerState;
+	const void* mTopology;
+	const void* mVertexBuffers[NumStreams];
+	const void* mIndexBuffer;
+	const void* mConstantBuffers[EShaderStage::Num][NumSlots];
+	const void* mShaderResources[EShaderStage::Num][NumSlots];
+	const void* mSamplers[EShaderStage::Num][NumSlots];
+};
@@ -9,13 +9,10 @@
 #include "MeshData.h"
 #include "DemoUI.h"
 #include "RectProxy.h"
+#include "ShaderBuffers.h"
+#include "RenderStates.h"
+#include "ShaderCache.h"
 
-#ifdef _DEBUG
-// Disable optimizations to further improve shader debugging
-DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
-#else
-DWORD dwShaderFlags = D3DCOMPILE_ENABLE_STRICTNESS;
-#endif
 
 CRenderInstance::CRenderInstance(const string& InName)
 	: mMeshData(nullptr)
@@ -29,13 +26,10 @@ CRenderInstance::CRenderInstance(const string& InName)
 	, mScale(1.f)
 	, mRoughness(1.f)
 	, mCull(true)
+	, mProxyDirty(false)
 	, mVertexLayout11(nullptr)
 	, mVertexShader(nullptr)
-	, mCbVSPerObject(nullptr)
 	, mPixelShader(nullptr)
-	, mCbPSPerObject(nullptr)
-	, mCbPSRects(nullptr)
-	, mCbPSPerFrame(nullptr)
 {
 	mName = InName;
 }
@@ -48,13 +42,13 @@ CRenderInstance* CRenderInstance::CreateRectInstance(ID3D11Device* pd3dDevice,
 	CRectMesh* MeshData = IMeshData::CreateRectMesh(pd3dDevice);
 
 	// Create render instance with given name and mesh data. 
-	CRenderInstance* RenderInst = CMiniEngine::GetInstance().CreateRenderInstance(InName, MeshData,
-		L"Shaders\\PlaneMeshVS.hlsl", L"Shaders\\PlaneMeshPS.hlsl", pd3dDevice);
+	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
+	CRenderInstance* RenderInst = MiniEngine.CreateRenderInstance(InName, MeshData,
+		L"Shaders\\PlaneMeshVS.hlsl", L"Shaders\\PlaneMeshPS.hlsl", pd3dDevice, MiniEngine.GetLightingDefines(false));
 	RenderInst->SetPosition(InPos);
 	RenderInst->SetRotation(InRot.x, InRot.y, InRot.z);
 	RenderInst->SetScale(InScale);
-	RenderInst->mRoughness = InRoughness;
-	RenderInst->mDiffuseColor = InDiffuseColor;
+	RenderInst->SetMaterial(InRoughness, InDiffuseColor);
 	RenderInst->mID = inID;
 
 	return RenderInst;
@@ -75,6 +69,7 @@ CRenderInstance* CRenderInstance::CreateTestRectInstance(ID3D11Device* pd3dDevic
 void CRenderInstance::SetPosition(const XMFLOAT3& InPosition)
 {
 	mPosition = InPosition;
+	CMiniEngine::GetInstance().mTransforms.SetPosition(mTransform, InPosition);
 }
 
 void CRenderInstance::SetRotation(float InPitch, float InYaw, float InRoll)
@@ -82,34 +77,72 @@ void CRenderInstance::SetRotation(float InPitch, float InYaw, float InRoll)
 	mPitch = InPitch;
 	mYaw = InYaw;
 	mRoll = InRoll;
+	CMiniEngine::GetInstance().mTransforms.SetRotation(mTransform, InPitch, InYaw, InRoll);
 }
 
 void CRenderInstance::SetScale(float InScale)
 {
 	mScale = InScale;
+	CMiniEngine::GetInstance().mTransforms.SetScale(mTransform, InScale);
+}
+
+void CRenderInstance::SetParent(CRenderInstance* InParent)
+{
+	assert(InParent != this);
+	CTransformHierarchy& Transforms = CMiniEngine::GetInstance().mTransforms;
+	Transforms.SetParent(mTransform, InParent != nullptr ? InParent->mTransform : FTransformHandle());
+}
+
+void CRenderInstance::SetMaterial(float InRoughness, const XMFLOAT3& InDiffuseColor)
+{
+	mRoughness = InRoughness;
+	mDiffuseColor = InDiffuseColor;
+	MarkDirty();
+}
+
+void CRenderInstance::MarkDirty()
+{
+	if (mProxyDirty)
+		return;
+
+	mProxyDirty = true;
+	CRectCollections::GetInstance().MarkDirty(this);
 }
 
 void CRenderInstance::Destroy()
 {
-	SAFE_RELEASE(mVertexLayout11);
-	SAFE_RELEASE(mVertexShader);
-	SAFE_RELEASE(mCbVSPerObject);
-
-	SAFE_RELEASE(mPixelShader);    
-	SAFE_RELEASE(mCbPSPerObject);
-	SAFE_RELEASE(mCbPSRects);
-	SAFE_RELEASE(mCbPSPerFrame);
+	// shaders and layout are owned by CShaderCache
+	mVertexLayout11 = nullptr;
+	mVertexShader = nullptr;
+
+	mPixelShader = nullptr;
+
+	// release the rect proxy
+	CRectCollections& RectColls = CRectCollections::GetInstance();
+	if (mProxyDirty)
+	{
+		RectColls.UnmarkDirty(this);
+		mProxyDirty = false;
+	}
+	if (RectColls.mRects.IsValid(mRectHandle))
+	{
+		RectColls.mRects.Remove(mRectHandle);
+	}
+
+	CTransformHierarchy& Transforms = CMiniEngine::GetInstance().mTransforms;
+	if (Transforms.IsValid(mTransform))
+	{
+		Transforms.Destroy(mTransform);
+	}
 }
 
 XMMATRIX CRenderInstance::GetWorldMatrix() const
 {
 	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
 
-	const static FXMVECTOR ZeroOrigin = { .0f, .0f, .0f };
-	XMVECTOR ScaleOrientQuat = XMQuaternionRotationRollPitchYawFromVector(ZeroOrigin);
-	XMVECTOR RotationQuat = XMQuaternionRotationRollPitchYawFromVector({mPitch * XM_PI, mYaw * XM_PI, mRoll * XM_PI });
-	XMMATRIX MeshMat = XMMatrixAffineTransformation(
-		{mScale, mScale, mScale}, ZeroOrigin, RotationQuat, XMLoadFloat3(&mPosition));
+	// a pure read, called from jobs, the transforms are updated while single threaded
+	assert(MiniEngine.mTransforms.IsUpToDate());
+	XMMATRIX MeshMat = XMLoadFloat4x4(&MiniEngine.mTransforms.GetWorld(mTransform));
 
 	return MeshMat * MiniEngine.mCamera.GetWorldMatrix();
 }
@@ -137,11 +170,14 @@ void CRenderInstance::GetRectProxy(CRect& OutRect) const
 
 	XMMATRIX WorldMat = GetWorldMatrix();
 
-	// copy rectangle properties
+	// copy rectangle properties, the center includes parent transforms but not the camera
+	const XMFLOAT4X4& MeshMat = CMiniEngine::GetInstance().mTransforms.GetWorld(mTransform);
 	OutRect.mRoughness = mRoughness;
-	OutRect.mCenter = mPosition;
-	OutRect.mMajorRadius = mScale * 1;
-	OutRect.mMinorRadius = mScale * 1;
+	OutRect.mCenter = XMFLOAT3(MeshMat._41, MeshMat._42, MeshMat._43);
+	// uniform scale including parents, the length of the transformed major axis
+	float WorldScale = std::sqrt(MeshMat._11 * MeshMat._11 + MeshMat._12 * MeshMat._12 + MeshMat._13 * MeshMat._13);
+	OutRect.mMajorRadius = WorldScale * 1;
+	OutRect.mMinorRadius = WorldScale * 1;
 	OutRect.mDiffuseColor = mDiffuseColor;
 	OutRect.mID = mID;
 
@@ -168,7 +204,8 @@ void CRenderInstance::LinkReflectors(const string& RecvName, const vector<string
 	{
 		CRenderInstance* Refl = MiniEngine.GetRenderInstance(*it);
 		assert(Refl != nullptr && Refl != Recv);
-		Recv->mReflectorIndices[plIdx++] = Refl->mID;
+		assert(plIdx < MAX_RELATED_REFLECTOR_NUM);
+		Recv->mReflectors[plIdx++] = Refl->mRectHandle;
 	}
 }
 
@@ -176,248 +213,107 @@ void CRenderInstance::UnlinkReflectors()
 {
 	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; i ++)
 	{
-		mReflectorIndices[i] = INVALID_PLANE_ID;
+		mReflectors[i] = FRectHandle();
 	}
 }
 
-struct CB_VS_PER_OBJECT
-{
-	XMFLOAT4X4 mWorld;
-	XMFLOAT4X4 mView;
-	XMFLOAT4X4 mProj;
-};
-UINT g_iCBVSPerObjectBind = 0;
-void CRenderInstance::UpdateVSConstants(ID3D11DeviceContext* pd3dImmediateContext)
+UINT g_iCBPerObjectBind = 0;
+
+void CRenderInstance::FillPSPerObjectConstants(CB_PS_PER_OBJECT& OutConstants) const
 {
 	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
-	D3D11_MAPPED_SUBRESOURCE MappedResource;
+	XMVECTOR CameraPt = MiniEngine.mCamera.GetEyePt();
 
-	// Get the projection & view matrix from the camera class
-	XMMATRIX mProj = MiniEngine.mCamera.GetProjMatrix();
-	XMMATRIX mView = MiniEngine.mCamera.GetViewMatrix();
+	XMStoreFloat4(&OutConstants.mObjectColor, Colors::White);
+	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&OutConstants.mCameraPos), CameraPt);
+	OutConstants.mRoughness4.x = mRoughness;
+	OutConstants.mCustomData0 = mCustomData0;
+	OutConstants.mDiffuseColor = XMFLOAT4(mDiffuseColor.x, mDiffuseColor.y, mDiffuseColor.z, 1.f);
 
-	// constant buffer: VS Per object
-	XMMATRIX mt;
-	XMMATRIX mWorld = GetWorldMatrix();
-	HRESULT hr = (pd3dImmediateContext->Map(mCbVSPerObject, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
-	assert(SUCCEEDED(hr));
-	auto pVSPerObject = reinterpret_cast<CB_VS_PER_OBJECT*>(MappedResource.pData);
-	//XMMATRIX mt = XMMatrixTranspose(mWorldViewProjection);
-	//XMStoreFloat4x4(&pVSPerObject->m_WorldViewProj, mt);
-	mt = XMMatrixTranspose(mWorld);
-	XMStoreFloat4x4(&pVSPerObject->mWorld, mt);
-	mt = XMMatrixTranspose(mView);
-	XMStoreFloat4x4(&pVSPerObject->mView, mt);
-	mt = XMMatrixTranspose(mProj);
-	XMStoreFloat4x4(&pVSPerObject->mProj, mt);
-	pd3dImmediateContext->Unmap(mCbVSPerObject, 0);
-
-	pd3dImmediateContext->VSSetConstantBuffers(g_iCBVSPerObjectBind, 1, &mCbVSPerObject);
+	int32_t Indices[MAX_RELATED_REFLECTOR_NUM];
+	int NumIndices = GetLinkedReflectorIndices(Indices);
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; i++)
+	{
+		OutConstants.mLinkedReflectors[i * 4] = (uint32_t)(i < NumIndices ? Indices[i] : INVALID_PLANE_ID);
+	}
 }
 
-struct CB_PS_PER_OBJECT
-{
-	XMFLOAT4 mObjectColor;
-	XMFLOAT4 mCameraPos;
-	XMFLOAT4 mRoughness4;
-	XMFLOAT4 mCustomData0;
-	XMFLOAT4 mDiffuseColor;
-	uint32_t mLinkedReflectors[MAX_RELATED_REFLECTOR_NUM*4];
-};
-UINT g_iCBPSPerObjectBind = 0;
-
-struct CB_PS_PER_FRAME
-{
-	XMFLOAT4 mLightDirAmbient;
-	XMFLOAT4 mLightIntensity;
-	uint32_t mToggleOptionsA[4];
-	XMFLOAT4 mSamplingRadius;
-};
-UINT g_iCBPSPerFrameBind = 1;
-
-struct CB_PS_PLANES
+int CRenderInstance::GetLinkedReflectorIndices(int32_t OutIndices[MAX_RELATED_REFLECTOR_NUM]) const
 {
-	// x: id, y: roughness, z: majorRadius, w, minorRadius
-	XMFLOAT4 plElement0[MAX_RECT_NUM];
-	// xyz: center, w: diffuse.x
-	XMFLOAT4 plCenter_DiffX[MAX_RECT_NUM];
-	// xyz: normal, w: diffuse.y
-	XMFLOAT4 plNorm_DifY[MAX_RECT_NUM];
-	// xyz: major axis, w: diffuse.z
-	XMFLOAT4 plAxis_DifZ[MAX_RECT_NUM];
-};
-UINT g_iCBPSPlanesBind = 2;
-
-void CRenderInstance::UpdatePSConstants(ID3D11DeviceContext* pd3dImmediateContext)
-{
-	CMiniEngine& MiniEngine = CMiniEngine::GetInstance();
-	CDemoUI& DemoUI = CDemoUI::GetInstance();
-	CRectCollections& RectColls = CRectCollections::GetInstance();
-	XMVECTOR CameraPt = MiniEngine.mCamera.GetEyePt();
-	D3D11_MAPPED_SUBRESOURCE MappedResource;
-
-	// constant buffer: PS Per frame
-	HRESULT hr = (pd3dImmediateContext->Map(mCbPSPerFrame, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
-	assert(SUCCEEDED(hr));
-	auto pPerFrame = reinterpret_cast<CB_PS_PER_FRAME*>(MappedResource.pData);
-	float fAmbient = 0.1f;
-	// Get the light direction
-	XMVECTOR vLightDir = CMiniEngine::GetInstance().mLightControl.GetLightDirection();
-	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&pPerFrame->mLightDirAmbient), vLightDir);
-	pPerFrame->mLightDirAmbient.w = fAmbient;
-	pPerFrame->mLightIntensity.x = MiniEngine.mLightIntensity;
-	pPerFrame->mLightIntensity.y = MiniEngine.mSpecularReflIntensity;
-	pPerFrame->mLightIntensity.z = MiniEngine.mDiffuseReflIntensity;
-	pPerFrame->mToggleOptionsA[0] = DemoUI.mShowIndirectSpecular;
-	pPerFrame->mToggleOptionsA[1] = DemoUI.mShowDirectLighting;
-	pPerFrame->mToggleOptionsA[2] = 0;
-	pPerFrame->mToggleOptionsA[3] = DemoUI.mShowIndirectDiffuse;
-	pPerFrame->mSamplingRadius.x = MiniEngine.mSpecularSamplingRadius;
-	pPerFrame->mSamplingRadius.y = MiniEngine.mDiffuseSamplingRadius;
-	pd3dImmediateContext->Unmap(mCbPSPerFrame, 0);
-	pd3dImmediateContext->PSSetConstantBuffers(g_iCBPSPerFrameBind, 1, &mCbPSPerFrame);
-
-	// constant buffer: PS Per object
-	hr = (pd3dImmediateContext->Map(mCbPSPerObject, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
-	assert(SUCCEEDED(hr));
-	auto pPSPerObject = reinterpret_cast<CB_PS_PER_OBJECT*>(MappedResource.pData);
-	XMStoreFloat4(&pPSPerObject->mObjectColor, Colors::White);
-	XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&pPSPerObject->mCameraPos), CameraPt);
-	pPSPerObject->mRoughness4.x = mRoughness;
-	pPSPerObject->mCustomData0 = mCustomData0; 
-	pPSPerObject->mDiffuseColor = XMFLOAT4(mDiffuseColor.x, mDiffuseColor.y, mDiffuseColor.z, 1.f);
-	for (uint8_t i = 0; i < MAX_RELATED_REFLECTOR_NUM; i++)
+	const CRectStore& Rects = CRectCollections::GetInstance().mRects;
+
+	// manual links take precedence, rects without them use the links derived by CReflectorLinker
+	const int32_t* AutoLinks = nullptr;
+	int NumAutoLinks = 0;
+	if (!Rects.IsValid(mReflectors[0]))
 	{
-		pPSPerObject->mLinkedReflectors[i * 4] = mReflectorIndices[i];
+		NumAutoLinks = CRectCollections::GetInstance().GetLinkedReflectors(mRectHandle, AutoLinks);
 	}
-	pd3dImmediateContext->Unmap(mCbPSPerObject, 0);
-	pd3dImmediateContext->PSSetConstantBuffers(g_iCBPSPerObjectBind, 1, &mCbPSPerObject);
-
-	// constant buffer: PS Planes
-	hr = (pd3dImmediateContext->Map(mCbPSRects, 0, D3D11_MAP_WRITE_DISCARD, 0, &MappedResource));
-	assert(SUCCEEDED(hr));
-
-	auto pPSPlanes = reinterpret_cast<CB_PS_PLANES*>(MappedResource.pData);
-	for (uint8_t i = 0; i < MAX_RECT_NUM; i ++)
+	int NumIndices = 0;
+	for (int i = 0; i < MAX_RELATED_REFLECTOR_NUM; i++)
 	{
-		CRect& Rect = RectColls.mAllRects[i];		
-		if (Rect.mID == INVALID_PLANE_ID)
-		{
-			pPSPlanes->plElement0[i].x = INVALID_PLANE_ID;
-			continue;
-		}
-
-		// x: id, y: roughness, z: majorRadius, w, minorRadius
-		pPSPlanes->plElement0[i].x = Rect.mID;
-		pPSPlanes->plElement0[i].y = Rect.mRoughness;
-		pPSPlanes->plElement0[i].z = Rect.mMajorRadius;
-		pPSPlanes->plElement0[i].w = Rect.mMinorRadius;
-		// xyz: center, w: diffuse.x
-		pPSPlanes->plCenter_DiffX[i].x = Rect.mCenter.x;
-		pPSPlanes->plCenter_DiffX[i].y = Rect.mCenter.y;
-		pPSPlanes->plCenter_DiffX[i].z = Rect.mCenter.z;
-		pPSPlanes->plCenter_DiffX[i].w = Rect.mDiffuseColor.x;
-		// xyz: center, w: diffuse.x
-		pPSPlanes->plNorm_DifY[i].x = Rect.mNormal.x;
-		pPSPlanes->plNorm_DifY[i].y = Rect.mNormal.y;
-		pPSPlanes->plNorm_DifY[i].z = Rect.mNormal.z;
-		pPSPlanes->plNorm_DifY[i].w = Rect.mDiffuseColor.y;
-		// xyz: major axis, w: diffuse.z
-		pPSPlanes->plAxis_DifZ[i].x = Rect.mMajorAxis.x;
-		pPSPlanes->plAxis_DifZ[i].y = Rect.mMajorAxis.y;
-		pPSPlanes->plAxis_DifZ[i].z = Rect.mMajorAxis.z;
-		pPSPlanes->plAxis_DifZ[i].w = Rect.mDiffuseColor.z;
+		// shaders index psRects by dense index and stop at the first invalid one
+		int32_t Index = AutoLinks != nullptr ? (i < NumAutoLinks ? AutoLinks[i] : INVALID_PLANE_ID) : Rects.GetIndex(mReflectors[i]);
+		if (Index < 0)
+			break;
+		OutIndices[NumIndices++] = Index;
 	}
+	return NumIndices;
+}
 
-	pd3dImmediateContext->Unmap(mCbPSRects, 0);
-	pd3dImmediateContext->PSSetConstantBuffers(g_iCBPSPlanesBind, 1, &mCbPSRects);
+void CRenderInstance::FillObjectConstants(CB_PER_OBJECT& OutConstants) const
+{
+	XMStoreFloat4x4(&OutConstants.mWorld, XMMatrixTranspose(GetWorldMatrix()));
+	const FVertexFormat& Format = mMeshData->GetVertexFormat();
+	OutConstants.mPositionScale = XMFLOAT4(Format.mPositionScale[0], Format.mPositionScale[1], Format.mPositionScale[2], 0);
+	OutConstants.mPositionBias = XMFLOAT4(Format.mPositionBias[0], Format.mPositionBias[1], Format.mPositionBias[2], 0);
+	FillPSPerObjectConstants(OutConstants.mPS);
 }
 
-void CRenderInstance::OnFrameRender(ID3D11DeviceContext* pd3dImmediateContext)
+bool CRenderInstance::IsInstancedRect() const
 {
-	// Set the shaders
-	pd3dImmediateContext->VSSetShader(mVertexShader, nullptr, 0);
-	pd3dImmediateContext->PSSetShader(mPixelShader, nullptr, 0);
+	// one rasterizer state for the whole batch
+	return mMeshData->GetMeshType() == EMeshData::RectMesh && mCull;
+}
 
-	UpdateVSConstants(pd3dImmediateContext);
-	UpdatePSConstants(pd3dImmediateContext);
+FPipelineState CRenderInstance::GetPipelineState() const
+{
+	FPipelineState Pipeline;
+	Pipeline.mVertexShader = mVertexShader;
+	Pipeline.mPixelShader = mPixelShader;
+	Pipeline.mInputLayout = mVertexLayout11;
+	Pipeline.mRasterizerState = CRenderStates::GetInstance().GetRasterizerState(mCull);
+	Pipeline.mTopology = EPrimitiveTopology::TriangleList;
+	return Pipeline;
+}
+
+void CRenderInstance::BindObjectConstants(CRenderCommandList& OutCommands, uint32_t InConstantsOffset)
+{
+	// one range of the frame constants, read by both stages
+	OutCommands.SetFrameConstants(EShaderStage::Vertex, g_iCBPerObjectBind, InConstantsOffset, sizeof(CB_PER_OBJECT));
+	OutCommands.SetFrameConstants(EShaderStage::Pixel, g_iCBPerObjectBind, InConstantsOffset, sizeof(CB_PER_OBJECT));
 }
 
 void CRenderInstance::CreateVertexShader(LPCWSTR pFileName, LPCSTR pEntrypoint,
-	const D3D11_INPUT_ELEMENT_DESC* layout, UINT NumVertexElement, ID3D11Device* pd3dDevice)
+	const D3D11_INPUT_ELEMENT_DESC* layout, UINT NumVertexElement, ID3D11Device* pd3dDevice, const D3D_SHADER_MACRO* pDefines)
 {
-	ID3DBlob* pVertexShaderBuffer = nullptr;
-	HRESULT hr = DXUTCompileFromFile(pFileName, nullptr, pEntrypoint, "vs_5_0", dwShaderFlags, 0, &pVertexShaderBuffer);
-	assert(SUCCEEDED(hr));
+	CShaderCache& ShaderCache = CShaderCache::GetInstance();
 
-	// vertex shader
+	// vertex shader, shared by instances using the same program
 	assert(mVertexShader == nullptr);
-	hr = (pd3dDevice->CreateVertexShader(pVertexShaderBuffer->GetBufferPointer(),
-		pVertexShaderBuffer->GetBufferSize(), nullptr, &mVertexShader));
-	assert(SUCCEEDED(hr));
-	DXUT_SetDebugName(mVertexShader, "VSMain");
+	mVertexShader = ShaderCache.GetVertexShader(pd3dDevice, pFileName, pEntrypoint, pDefines);
 	assert(mVertexShader != nullptr);
 
 	// vertex layout
 	assert(mVertexLayout11 == nullptr);
-	hr = (pd3dDevice->CreateInputLayout(layout, NumVertexElement, pVertexShaderBuffer->GetBufferPointer(),
-		pVertexShaderBuffer->GetBufferSize(), &mVertexLayout11));
-	assert(SUCCEEDED(hr));
+	mVertexLayout11 = ShaderCache.GetInputLayout(pd3dDevice, mVertexShader, layout, NumVertexElement);
 	assert(mVertexLayout11 != nullptr);
-
-	SAFE_RELEASE(pVertexShaderBuffer);
-
-	// constant buffer: per instance
-	D3D11_BUFFER_DESC Desc;
-	Desc.Usage = D3D11_USAGE_DYNAMIC;
-	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	Desc.MiscFlags = 0;
-
-	Desc.ByteWidth = sizeof(CB_VS_PER_OBJECT);
-	assert(mCbVSPerObject == nullptr);
-	hr = (pd3dDevice->CreateBuffer(&Desc, nullptr, &mCbVSPerObject));
-	assert(SUCCEEDED(hr));
-	assert(mCbVSPerObject != nullptr);
 }
 
-void CRenderInstance::CreatePixelShader(LPCWSTR pFileName, LPCSTR pEntrypoint, ID3D11Device* pd3dDevice)
+void CRenderInstance::CreatePixelShader(LPCWSTR pFileName, LPCSTR pEntrypoint, ID3D11Device* pd3dDevice,
+	const D3D_SHADER_MACRO* pDefines)
 {
-	ID3DBlob* pPixelShaderBuffer = nullptr;
-	HRESULT hr = (DXUTCompileFromFile(pFileName, nullptr, pEntrypoint, "ps_5_0", dwShaderFlags, 0, &pPixelShaderBuffer));
-	assert(SUCCEEDED(hr));
-
 	assert(mPixelShader == nullptr);
-	hr = (pd3dDevice->CreatePixelShader(pPixelShaderBuffer->GetBufferPointer(),
-		pPixelShaderBuffer->GetBufferSize(), nullptr, &mPixelShader));
-	assert(SUCCEEDED(hr));
+	mPixelShader = CShaderCache::GetInstance().GetPixelShader(pd3dDevice, pFileName, pEntrypoint, pDefines);
 	assert(mPixelShader != nullptr);
-
-	SAFE_RELEASE(pPixelShaderBuffer);
-
-	D3D11_BUFFER_DESC Desc;
-	Desc.Usage = D3D11_USAGE_DYNAMIC;
-	Desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	Desc.MiscFlags = 0;
-	// constant buffer: per instance
-	Desc.ByteWidth = sizeof(CB_PS_PER_OBJECT);
-	assert(mCbPSPerObject == nullptr);
-	hr = (pd3dDevice->CreateBuffer(&Desc, nullptr, &mCbPSPerObject));
-	assert(SUCCEEDED(hr));
-	assert(mCbPSPerObject != nullptr);
-
-	// constant buffer: planes
-	Desc.ByteWidth = sizeof(CB_PS_PLANES);
-	assert(mCbPSRects == nullptr);
-	hr = (pd3dDevice->CreateBuffer(&Desc, nullptr, &mCbPSRects));
-	assert(SUCCEEDED(hr));
-	assert(mCbPSRects != nullptr);
-
-	// constant buffer: per frame
-	Desc.ByteWidth = sizeof(CB_PS_PER_FRAME);
-	assert(mCbPSPerFrame == nullptr);
-	hr = (pd3dDevice->CreateBuffer(&Desc, nullptr, &mCbPSPerFrame));
-	assert(SUCCEEDED(hr));
-	assert(mCbPSPerFrame != nullptr);
 }
@@ -2,6 +2,8 @@
 #include <d3d11.h>
 #include <string>
 #include "RectProxy.h"
+#include "SlotMap.h"
+#include "RenderCommands.h"
 
 using namespace DirectX;
 using namespace std;
@@ -28,20 +30,32 @@ public:
 	void SetRotation(float InPitch, float InYaw, float InRoll);
 	// Set scale to current render instance.
 	void SetScale(float InScale);
+	// Attach to a parent instance, position, rotation and scale become relative to it. Null detaches.
+	void SetParent(CRenderInstance* InParent);
+	// Set material of the rect proxy.
+	void SetMaterial(float InRoughness, const XMFLOAT3& InDiffuseColor);
+	// Queue the rect proxy of this instance for the next UpdateAllProxies, transform changes are queued by
+	// CRectCollections from the transform hierarchy.
+	void MarkDirty();
 
 	// Destroy current render instance.
 	void Destroy();
 
-	// Create vertex shader for current render instance.
+	// Create vertex shader for current render instance, compiled with the defines of its vertex format.
 	void CreateVertexShader(LPCWSTR pFileName, LPCSTR pEntrypoint,
-		const D3D11_INPUT_ELEMENT_DESC* layout, UINT NumVertexElement, ID3D11Device* pd3dDevice);
+		const D3D11_INPUT_ELEMENT_DESC* layout, UINT NumVertexElement, ID3D11Device* pd3dDevice,
+		const D3D_SHADER_MACRO* pDefines = nullptr);
 	// Create pixel shader for current render instance.
-	void CreatePixelShader(LPCWSTR pFileName, LPCSTR pEntrypoint, ID3D11Device* pd3dDevice);
+	void CreatePixelShader(LPCWSTR pFileName, LPCSTR pEntrypoint, ID3D11Device* pd3dDevice,
+		const D3D_SHADER_MACRO* pDefines = nullptr);
 
-	// Call each frame from renderer.
-	void OnFrameRender(ID3D11DeviceContext* pd3dImmediateContext);
+	// Record the binds of per-object constants written at InConstantsOffset of the frame constants by
+	// FillObjectConstants.
+	static void BindObjectConstants(CRenderCommandList& OutCommands, uint32_t InConstantsOffset);
+	// Shaders, input layout and rasterizer state of this instance.
+	FPipelineState GetPipelineState() const;
 
-	// Get the world transform matrix.
+	// Get the world transform matrix, safe on any thread once transforms are updated.
 	XMMATRIX GetWorldMatrix() const;
 	// Get the world*view*projection matrix.
 	XMMATRIX GetWVPMatrix() const;
@@ -49,18 +63,23 @@ public:
 	// Get rectangle proxy for this render instance.
 	void GetRectProxy(class CRect& OutRect) const;
 
-	// Link possible reflectors to this render instance.
+	// Fill constants of 'psPerObject' for this render instance.
+	void FillPSPerObjectConstants(struct CB_PS_PER_OBJECT& OutConstants) const;
+	// Fill constants of 'cbPerObject' for this render instance, safe on any thread once transforms are updated.
+	void FillObjectConstants(struct CB_PER_OBJECT& OutConstants) const;
+	// Dense indices in psRects of the linked reflectors, returns how many there are.
+	int GetLinkedReflectorIndices(int32_t OutIndices[MAX_RELATED_REFLECTOR_NUM]) const;
+	// Drawn by the instanced rect path of CMiniEngine instead of its own draw.
+	bool IsInstancedRect() const;
+
+	// Link possible reflectors to this render instance, overriding the automatic links of rectangles.
 	static void LinkReflectors(const string& RecvName, const vector<string>& ReflNames);
 	// Unlink all reflectors.
 	void UnlinkReflectors();
 
-private:
-	// Update constants buffer for vertex shader.
-	void UpdateVSConstants(ID3D11DeviceContext* pd3dImmediateContext);
-	// Update constants buffer for pixel shader.
-	void UpdatePSConstants(ID3D11DeviceContext* pd3dImmediateContext);
-
 public:
+	// Handle in CMiniEngine::mRenderInstances.
+	FInstanceHandle mHandle;
 	// Related mesh data.
 	IMeshData* mMeshData;
 	// Instance name.
@@ -75,7 +94,9 @@ public:
 	// is this a receiver
 	bool mReceiver;
 
-	// world position
+	// node in CMiniEngine::mTransforms caching the world matrix
+	FTransformHandle mTransform;
+	// position relative to the parent
 	XMFLOAT3 mPosition;
 	// rotation properties
 	float mPitch;
@@ -93,20 +114,18 @@ public:
 	// the cull mode of render instance
 	bool mCull;
 
-	// related reflector indices
-	INT16 mReflectorIndices[MAX_RELATED_REFLECTOR_NUM];
+	// rect proxy in CRectCollections, only valid for rectangles
+	FRectHandle mRectHandle;
+	// queued in CRectCollections for a proxy refresh
+	bool mProxyDirty;
+	// related reflectors
+	FRectHandle mReflectors[MAX_RELATED_REFLECTOR_NUM];
 
 	// vertex layout
 	ID3D11InputLayout* mVertexLayout11;
 	// vertex shader
 	ID3D11VertexShader* mVertexShader;
-	// constant buffer of vertex shader
-	ID3D11Buffer* mCbVSPerObject;
-	
+
 	// pixel shader
 	ID3D11PixelShader* mPixelShader;
-	// constant buffers of pixel shader
-	ID3D11Buffer* mCbPSPerObject;
-	ID3D11Buffer* mCbPSPerFrame;
-	ID3D11Buffer* mCbPSRects;
 };
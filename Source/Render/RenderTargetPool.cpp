@@ -0,0 +1,137 @@
+#include "DXUT.h"
+#include "RenderTargetPool.h"
+
+FPooledRenderTarget::FPooledRenderTarget()
+	: mTexture(nullptr)
+	, mRTV(nullptr)
+	, mSRV(nullptr)
+	, bInUse(false)
+	, mReleaseStamp(0)
+{
+}
+
+CRenderTargetPool::CRenderTargetPool()
+	: mReleaseCounter(0)
+	, mNumAllocations(0)
+	, mNumReuses(0)
+{
+}
+
+CRenderTargetPool& CRenderTargetPool::GetInstance()
+{
+	static CRenderTargetPool GInstance;
+	return GInstance;
+}
+
+FPooledRenderTarget* CRenderTargetPool::Acquire(ID3D11Device* pd3dDevice, const FRenderTargetDesc& InDesc)
+{
+	assert(InDesc.mWidth > 0 && InDesc.mHeight > 0);
+
+	// reuse the most recently released match, it is the most likely to still be resident
+	FPooledRenderTarget* Best = nullptr;
+	for (FPooledRenderTarget* Target : mTargets)
+	{
+		if (!Target->bInUse && Target->mDesc == InDesc && (Best == nullptr || Target->mReleaseStamp > Best->mReleaseStamp))
+		{
+			Best = Target;
+		}
+	}
+	if (Best != nullptr)
+	{
+		++mNumReuses;
+		Best->bInUse = true;
+		return Best;
+	}
+
+	FPooledRenderTarget* Target = new FPooledRenderTarget();
+	Target->mDesc = InDesc;
+
+	D3D11_TEXTURE2D_DESC Desc = {};
+	Desc.ArraySize = 1;
+	Desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	Desc.Usage = D3D11_USAGE_DEFAULT;
+	Desc.Format = InDesc.mFormat;
+	Desc.Width = InDesc.mWidth;
+	Desc.Height = InDesc.mHeight;
+	Desc.MipLevels = 1;
+	Desc.SampleDesc.Count = 1;
+	HRESULT hr = (pd3dDevice->CreateTexture2D(&Desc, nullptr, &Target->mTexture));
+	assert(SUCCEEDED(hr));
+
+	// Create the render target view
+	D3D11_RENDER_TARGET_VIEW_DESC DescRT;
+	DescRT.Format = Desc.Format;
+	DescRT.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2D;
+	DescRT.Texture2D.MipSlice = 0;
+	hr = (pd3dDevice->CreateRenderTargetView(Target->mTexture, &DescRT, &Target->mRTV));
+	assert(SUCCEEDED(hr));
+
+	// Create the resource view
+	D3D11_SHADER_RESOURCE_VIEW_DESC DescRV;
+	DescRV.Format = Desc.Format;
+	DescRV.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	DescRV.Texture2D.MipLevels = 1;
+	DescRV.Texture2D.MostDetailedMip = 0;
+	hr = (pd3dDevice->CreateShaderResourceView(Target->mTexture, &DescRV, &Target->mSRV));
+	assert(SUCCEEDED(hr));
+
+	++mNumAllocations;
+	Target->bInUse = true;
+	mTargets.push_back(Target);
+	return Target;
+}
+
+void CRenderTargetPool::Release(FPooledRenderTarget*& InOutTarget)
+{
+	if (InOutTarget == nullptr)
+		return;
+
+	assert(InOutTarget->bInUse);
+	InOutTarget->bInUse = false;
+	InOutTarget->mReleaseStamp = ++mReleaseCounter;
+	InOutTarget = nullptr;
+
+	EvictFreeTargets();
+}
+
+void CRenderTargetPool::EvictFreeTargets()
+{
+	int NumFree = 0;
+	for (FPooledRenderTarget* Target : mTargets)
+	{
+		NumFree += Target->bInUse ? 0 : 1;
+	}
+
+	while (NumFree > MaxFreeTargets)
+	{
+		int Oldest = -1;
+		for (int i = 0; i < (int)mTargets.size(); ++i)
+		{
+			if (!mTargets[i]->bInUse && (Oldest < 0 || mTargets[i]->mReleaseStamp < mTargets[Oldest]->mReleaseStamp))
+			{
+				Oldest = i;
+			}
+		}
+		DestroyTarget(mTargets[Oldest]);
+		mTargets.erase(mTargets.begin() + Oldest);
+		--NumFree;
+	}
+}
+
+void CRenderTargetPool::DestroyTarget(FPooledRenderTarget* InTarget)
+{
+	SAFE_RELEASE(InTarget->mSRV);
+	SAFE_RELEASE(InTarget->mRTV);
+	SAFE_RELEASE(InTarget->mTexture);
+	delete InTarget;
+}
+
+void CRenderTargetPool::OnDestroy()
+{
+	for (FPooledRenderTarget* Target : mTargets)
+	{
+		assert(!Target->bInUse);
+		DestroyTarget(Target);
+	}
+	mTargets.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+
+using namespace std;
+
+// Descriptor of a 2D render target which can also be sampled.
+struct FRenderTargetDesc
+{
+	FRenderTargetDesc() : mWidth(0), mHeight(0), mFormat(DXGI_FORMAT_UNKNOWN) {}
+	FRenderTargetDesc(UINT InWidth, UINT InHeight, DXGI_FORMAT InFormat)
+		: mWidth(InWidth), mHeight(InHeight), mFormat(InFormat) {}
+
+	bool operator==(const FRenderTargetDesc& Other) const
+	{
+		return mWidth == Other.mWidth && mHeight == Other.mHeight && mFormat == Other.mFormat;
+	}
+
+	UINT mWidth;
+	UINT mHeight;
+	DXGI_FORMAT mFormat;
+};
+
+// A texture with its render target and shader resource views, owned by CRenderTargetPool.
+struct FPooledRenderTarget
+{
+	FPooledRenderTarget();
+
+	// descriptor it was created with
+	FRenderTargetDesc mDesc;
+	ID3D11Texture2D* mTexture;
+	ID3D11RenderTargetView* mRTV;
+	ID3D11ShaderResourceView* mSRV;
+	// acquired and not released yet
+	bool bInUse;
+	// value of the release counter when it was released, for evicting the oldest
+	UINT mReleaseStamp;
+};
+
+// Render targets reused by descriptor. Released targets stay in the pool, so resizing back to an earlier size
+// or recreating a pass finds its textures without allocating; the oldest free ones are evicted beyond a budget.
+class CRenderTargetPool
+{
+private:
+	CRenderTargetPool();
+
+public:
+	static CRenderTargetPool& GetInstance();
+
+	// free targets kept for reuse
+	static const int MaxFreeTargets = 8;
+
+	// A target matching the descriptor, reusing a free one if possible.
+	FPooledRenderTarget* Acquire(ID3D11Device* pd3dDevice, const FRenderTargetDesc& InDesc);
+	// Return a target to the pool and clear the pointer, null is ignored.
+	void Release(FPooledRenderTarget*& InOutTarget);
+
+	// Destroy all targets, none may be in use.
+	void OnDestroy();
+
+	// Targets created so far.
+	int GetNumAllocations() const { return mNumAllocations; }
+	// Acquires served by a free target.
+	int GetNumReuses() const { return mNumReuses; }
+	// Targets alive, in use or free.
+	int GetNumTargets() const { return (int)mTargets.size(); }
+
+private:
+	// Release the views and texture of a target and delete it.
+	static void DestroyTarget(FPooledRenderTarget* InTarget);
+	// Destroy the oldest free targets beyond MaxFreeTargets.
+	void EvictFreeTargets();
+
+private:
+	// all targets, in use or free
+	vector<FPooledRenderTarget*> mTargets;
+	// incremented by every release
+	UINT mReleaseCounter;
+	// counters
+	int mNumAllocations;
+	int mNumReuses;
+};
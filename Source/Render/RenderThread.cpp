@@ -0,0 +1,99 @@
+#include "RenderThread.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+
+CRenderThread::CRenderThread()
+	: mFunction(nullptr)
+	, mData(nullptr)
+	, bPending(false)
+	, bStopping(false)
+{
+
+}
+
+CRenderThread::~CRenderThread()
+{
+	Stop();
+}
+
+void CRenderThread::Start()
+{
+	Stop();
+	bStopping = false;
+	mThread = thread(&CRenderThread::ThreadMain, this);
+}
+
+void CRenderThread::Stop()
+{
+	if (!mThread.joinable())
+		return;
+
+	{
+		lock_guard<mutex> Lock(mMutex);
+		bStopping = true;
+	}
+	mWakeUp.notify_one();
+	mThread.join();
+}
+
+void CRenderThread::Kick(FRenderStageFunction InFunction, void* InData)
+{
+	assert(InFunction != nullptr && !bPending);
+	mFunction = InFunction;
+	mData = InData;
+	if (!mThread.joinable())
+	{
+		RunStage();
+		return;
+	}
+
+	{
+		lock_guard<mutex> Lock(mMutex);
+		bPending = true;
+	}
+	mWakeUp.notify_one();
+}
+
+void CRenderThread::Wait()
+{
+	unique_lock<mutex> Lock(mMutex);
+	mFinished.wait(Lock, [this]() { return !bPending; });
+}
+
+double CRenderThread::GetOverlapMs(chrono::steady_clock::time_point InBegin,
+	chrono::steady_clock::time_point InEnd) const
+{
+	chrono::steady_clock::time_point Begin = max(InBegin, mStageBegin);
+	chrono::steady_clock::time_point End = min(InEnd, mStageEnd);
+	if (End <= Begin)
+		return 0;
+	chrono::duration<double, milli> Overlap = End - Begin;
+	return Overlap.count();
+}
+
+void CRenderThread::ThreadMain()
+{
+	unique_lock<mutex> Lock(mMutex);
+	for (;;)
+	{
+		// a stage kicked before stopping still runs, Wait would not return otherwise
+		mWakeUp.wait(Lock, [this]() { return bPending || bStopping; });
+		if (!bPending)
+			return;
+
+		Lock.unlock();
+		RunStage();
+		Lock.lock();
+		bPending = false;
+		mFinished.notify_all();
+	}
+}
+
+void CRenderThread::RunStage()
+{
+	PROFILE_SCOPE("CRenderThread::RunStage");
+	mStageBegin = chrono::steady_clock::now();
+	mFunction(mData);
+	mStageEnd = chrono::steady_clock::now();
+}
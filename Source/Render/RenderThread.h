@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+// Function of a render stage, called with the data given to CRenderThread::Kick.
+typedef void (*FRenderStageFunction)(void* InData);
+
+// Dedicated thread running the render stage of a frame while the calling thread simulates the next one. It
+// is not a worker of CJobSystem, so the stage never runs nested in a wait of the simulation, and it runs
+// ParallelFor inline instead of waiting for the simulation's jobs.
+class CRenderThread
+{
+public:
+	CRenderThread();
+	~CRenderThread();
+
+	// Start the thread, stages run inline on the calling thread before.
+	void Start();
+	// Finish the running stage and join the thread.
+	void Stop();
+	// Whether the thread was started.
+	bool IsStarted() const { return mThread.joinable(); }
+
+	// Run InFunction(InData) on the thread and return at once, the last stage must have been waited for.
+	void Kick(FRenderStageFunction InFunction, void* InData);
+	// Return when the stage of the last Kick has finished.
+	void Wait();
+
+	// When the stage of the last Kick began and ended, valid after Wait.
+	chrono::steady_clock::time_point GetStageBegin() const { return mStageBegin; }
+	chrono::steady_clock::time_point GetStageEnd() const { return mStageEnd; }
+	// Milliseconds the last stage ran at the same time as [InBegin, InEnd] of the calling thread.
+	double GetOverlapMs(chrono::steady_clock::time_point InBegin, chrono::steady_clock::time_point InEnd) const;
+
+private:
+	// Loop of the thread.
+	void ThreadMain();
+	// Call the stage and time it.
+	void RunStage();
+
+private:
+	thread mThread;
+	mutex mMutex;
+	// signals a kicked stage or stopping to the thread
+	condition_variable mWakeUp;
+	// signals a finished stage to Wait
+	condition_variable mFinished;
+
+	// stage of the last Kick
+	FRenderStageFunction mFunction;
+	void* mData;
+	// kicked and not finished
+	bool bPending;
+	bool bStopping;
+
+	chrono::steady_clock::time_point mStageBegin;
+	chrono::steady_clock::time_point mStageEnd;
+};
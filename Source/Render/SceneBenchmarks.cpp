@@ -0,0 +1,506 @@
+#include "ModuleBenchmarks.h"
+#include "JobSystem.h"
+#include "RectBvh.h"
+#include "RectProxy.h"
+#include "RectStore.h"
+#include "ReflectorLinker.h"
+#include "RenderCommands.h"
+#include "ShaderBuffers.h"
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// Fill the store with an architectural scene: random axis aligned walls, floors and ceilings of 2 to 20 units
+	// at constant density.
+	void CreateBenchmarkScene(int InNumRects, uint32_t InSeed, CRectStore& OutStore)
+	{
+		mt19937 Rng(InSeed);
+		uniform_real_distribution<float> Unit(0.f, 1.f);
+		float SceneSize = 40.f * std::cbrt((float)InNumRects);
+		const XMFLOAT3 Normals[6] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		const XMFLOAT3 MajorAxes[6] = { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 }, { 1, 0, 0 }, { 1, 0, 0 } };
+
+		OutStore.Clear();
+		OutStore.Reserve(InNumRects);
+		for (int i = 0; i < InNumRects; ++i)
+		{
+			int Dir = (int)(Unit(Rng) * 6) % 6;
+			CRect Rect;
+			Rect.mID = i;
+			Rect.mCenter = XMFLOAT3(Unit(Rng) * SceneSize, Unit(Rng) * SceneSize, Unit(Rng) * SceneSize);
+			Rect.mNormal = Normals[Dir];
+			Rect.mMajorAxis = MajorAxes[Dir];
+			Rect.mMajorRadius = 1 + Unit(Rng) * 9;
+			Rect.mMinorRadius = 1 + Unit(Rng) * 9;
+			Rect.mRoughness = .05f + Unit(Rng) * .45f;
+			OutStore.Add(Rect);
+		}
+	}
+}
+
+FRectStoreBenchResult CModuleBenchmarks::RunRectStore(int InNumRects)
+{
+	assert(InNumRects > 0);
+	FRectStoreBenchResult Result;
+	Result.mNumRects = InNumRects;
+
+	mt19937 Rng(1234);
+	uniform_real_distribution<float> Unit(-1.f, 1.f);
+	vector<CRect> Rects(InNumRects);
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		CRect& Rect = Rects[i];
+		Rect.mID = i;
+		Rect.mCenter = XMFLOAT3(Unit(Rng) * 1000, Unit(Rng) * 1000, Unit(Rng) * 1000);
+		Rect.mNormal = XMFLOAT3(0.f, 0.f, 1.f);
+		Rect.mMajorAxis = XMFLOAT3(1.f, 0.f, 0.f);
+		Rect.mMajorRadius = 10 + Unit(Rng) * 5;
+		Rect.mMinorRadius = 10 + Unit(Rng) * 5;
+		Rect.mRoughness = .2f + Unit(Rng) * .1f;
+		Rect.mDiffuseColor = XMFLOAT3(.5f, .5f, .5f);
+	}
+
+	CRectStore Store;
+	vector<FRectHandle> Handles(InNumRects);
+	auto StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		Handles[i] = Store.Add(Rects[i]);
+	}
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mAddNs = Elapsed.count() * 1e9 / InNumRects;
+
+	StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		Store.Set(Handles[i], Rects[i]);
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mSetNs = Elapsed.count() * 1e9 / InNumRects;
+
+	vector<SB_PS_RECT> GpuRects(InNumRects);
+	StartTime = chrono::steady_clock::now();
+	Store.PackGpuRects(GpuRects.data());
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mPackNs = Elapsed.count() * 1e9 / InNumRects;
+
+	// remove every other rectangle in random order, the survivors must keep their handles
+	vector<int> Removed;
+	for (int i = 0; i < InNumRects; i += 2)
+	{
+		Removed.push_back(i);
+	}
+	shuffle(Removed.begin(), Removed.end(), Rng);
+	StartTime = chrono::steady_clock::now();
+	for (int i : Removed)
+	{
+		Store.Remove(Handles[i]);
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mRemoveNs = Elapsed.count() * 1e9 / max((int)Removed.size(), 1);
+
+	Result.bValid = Store.Num() == InNumRects - (int)Removed.size();
+	for (int i = 0; i < InNumRects && Result.bValid; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			Result.bValid = !Store.IsValid(Handles[i]);
+			continue;
+		}
+
+		CRect Rect;
+		Store.Get(Handles[i], Rect);
+		Result.bValid = Rect.mID == Rects[i].mID && Rect.mCenter.x == Rects[i].mCenter.x &&
+			Rect.mMinorRadius == Rects[i].mMinorRadius && Store.GetHandle(Store.GetIndex(Handles[i])) == Handles[i];
+	}
+
+	return Result;
+}
+
+FRectBvhBenchResult CModuleBenchmarks::RunRectBvh(int InNumRects, int InNumQueries)
+{
+	assert(InNumRects > 0 && InNumQueries > 0);
+	FRectBvhBenchResult Result;
+	Result.mNumRects = InNumRects;
+
+	CRectStore Store;
+	CreateBenchmarkScene(InNumRects, 4321, Store);
+	mt19937 Rng(8765);
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	float SceneSize = 40.f * std::cbrt((float)InNumRects);
+
+	CRectBvh Bvh;
+	auto StartTime = chrono::steady_clock::now();
+	Bvh.Build(Store);
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mBuildMs = Elapsed.count() * 1e3;
+	Result.mNumNodes = Bvh.NumNodes();
+
+	// move every rect a little
+	float* CenterZ = Store.GetStream(ERectStream::CenterZ);
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		CenterZ[i] += Unit(Rng) - .5f;
+	}
+	StartTime = chrono::steady_clock::now();
+	Bvh.Refit(Store);
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mRefitMs = Elapsed.count() * 1e3;
+
+	vector<FRectQuery> Queries(InNumQueries);
+	for (FRectQuery& Query : Queries)
+	{
+		Query.mPoint = XMFLOAT3(Unit(Rng) * SceneSize, Unit(Rng) * SceneSize, Unit(Rng) * SceneSize);
+		Query.mMaxDistance = 100;
+		Query.bSpecular = true;
+		Query.mLightDir = XMFLOAT3(Unit(Rng) - .5f, Unit(Rng) - .5f, 1.f);
+	}
+
+	vector<int> Found;
+	size_t NumFound = 0;
+	StartTime = chrono::steady_clock::now();
+	for (const FRectQuery& Query : Queries)
+	{
+		Found.clear();
+		Bvh.Query(Query, Found);
+		NumFound += Found.size();
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mQueryNs = Elapsed.count() * 1e9 / InNumQueries;
+	Result.mAvgResults = (double)NumFound / InNumQueries;
+
+	size_t NumBruteForce = 0;
+	StartTime = chrono::steady_clock::now();
+	for (const FRectQuery& Query : Queries)
+	{
+		for (int i = 0; i < InNumRects; ++i)
+		{
+			NumBruteForce += CRectBvh::TestRect(Store, i, Query) ? 1 : 0;
+		}
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mBruteForceNs = Elapsed.count() * 1e9 / InNumQueries;
+
+	// compare sets, for half-space queries as well
+	Result.bMatchesBruteForce = NumFound == NumBruteForce;
+	vector<int> Expected;
+	for (int q = 0; q < min(InNumQueries, 64) && Result.bMatchesBruteForce; ++q)
+	{
+		for (int Specular = 0; Specular < 2; ++Specular)
+		{
+			FRectQuery Query = Queries[q];
+			Query.bSpecular = Specular != 0;
+			Found.clear();
+			Expected.clear();
+			Bvh.Query(Query, Found);
+			for (int i = 0; i < InNumRects; ++i)
+			{
+				if (CRectBvh::TestRect(Store, i, Query))
+				{
+					Expected.push_back(i);
+				}
+			}
+			sort(Found.begin(), Found.end());
+			Result.bMatchesBruteForce = Result.bMatchesBruteForce && Found == Expected;
+		}
+	}
+
+	return Result;
+}
+
+FReflectorLinkBenchResult CModuleBenchmarks::RunReflectorLinker(int InNumRects)
+{
+	assert(InNumRects > 0);
+	FReflectorLinkBenchResult Result;
+	Result.mNumRects = InNumRects;
+
+	CRectStore Store;
+	CreateBenchmarkScene(InNumRects, 4321, Store);
+	CRectBvh Bvh;
+	Bvh.Build(Store);
+
+	FReflectorLinkSettings Settings;
+	Settings.mMaxDistance = 30;
+	Settings.mMinSolidAngle = .01f;
+	CReflectorLinker Linker;
+	Linker.SetSettings(Settings);
+
+	auto StartTime = chrono::steady_clock::now();
+	Linker.Build(Store, Bvh);
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mBuildMs = Elapsed.count() * 1e3;
+
+	size_t NumLinks = 0;
+	for (int i = 0; i < InNumRects; ++i)
+	{
+		NumLinks += Linker.NumLinks(i);
+	}
+	Result.mAvgLinks = (double)NumLinks / InNumRects;
+
+	const vector<int> NoChanges;
+	const int NumStaticUpdates = 100;
+	StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < NumStaticUpdates; ++i)
+	{
+		Linker.Update(Store, Bvh, NoChanges);
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mStaticUpdateUs = Elapsed.count() * 1e6 / NumStaticUpdates;
+
+	// move 1% of the rects, the hierarchy is refit outside of the timing like in UpdateAllProxies
+	mt19937 Rng(8765);
+	uniform_real_distribution<float> Unit(0.f, 1.f);
+	vector<int> Changed;
+	float* CenterX = Store.GetStream(ERectStream::CenterX);
+	for (int i = 0; i < max(InNumRects / 100, 1); ++i)
+	{
+		int Rect = (int)(Unit(Rng) * InNumRects) % InNumRects;
+		if (find(Changed.begin(), Changed.end(), Rect) == Changed.end())
+		{
+			CenterX[Rect] += (Unit(Rng) - .5f) * 20;
+			Changed.push_back(Rect);
+		}
+	}
+	Bvh.Update(Store);
+
+	StartTime = chrono::steady_clock::now();
+	Linker.Update(Store, Bvh, Changed);
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mMovingUpdateUs = Elapsed.count() * 1e6;
+	Result.mRelinkedReceivers = Linker.GetStats().mRelinkedReceivers;
+
+	CReflectorLinker Reference;
+	Reference.SetSettings(Settings);
+	Reference.Build(Store, Bvh);
+	Result.bMatchesRebuild = true;
+	for (int i = 0; i < InNumRects && Result.bMatchesRebuild; ++i)
+	{
+		Result.bMatchesRebuild = Reference.NumLinks(i) == Linker.NumLinks(i)
+			&& equal(Linker.GetLinks(i), Linker.GetLinks(i) + Linker.NumLinks(i), Reference.GetLinks(i));
+	}
+
+	return Result;
+}
+
+FTransformBenchResult CModuleBenchmarks::RunTransformHierarchy(int InNumNodes)
+{
+	assert(InNumNodes > 0);
+	FTransformBenchResult Result;
+	Result.mNumNodes = InNumNodes;
+
+	// chains of 4 levels, children created before their parents so the first update has to sort; the local
+	// transforms are kept here as well for the on demand path
+	const int ChainLength = 4;
+	CTransformHierarchy Hierarchy;
+	vector<FTransformHandle> Nodes(InNumNodes);
+	vector<XMFLOAT3> Positions(InNumNodes);
+	vector<XMFLOAT3> Rotations(InNumNodes);
+	vector<float> Scales(InNumNodes);
+	for (int i = InNumNodes - 1; i >= 0; --i)
+	{
+		Nodes[i] = Hierarchy.Create(i);
+	}
+	for (int i = 0; i < InNumNodes; ++i)
+	{
+		if (i % ChainLength != 0)
+		{
+			Hierarchy.SetParent(Nodes[i], Nodes[i - 1]);
+		}
+		float f = (float)i;
+		Positions[i] = XMFLOAT3(std::sin(f) * 10, std::cos(f) * 10, f * .01f);
+		Rotations[i] = XMFLOAT3(f * .1f, f * .2f, f * .3f);
+		Scales[i] = 1.f + (i % 3) * .1f;
+		Hierarchy.SetPosition(Nodes[i], Positions[i]);
+		Hierarchy.SetRotation(Nodes[i], Rotations[i].x, Rotations[i].y, Rotations[i].z);
+		Hierarchy.SetScale(Nodes[i], Scales[i]);
+	}
+	Hierarchy.Update();
+
+	// every node dirty
+	for (int i = 0; i < InNumNodes; ++i)
+	{
+		Scales[i] = 1.f + (i % 5) * .1f;
+		Hierarchy.SetScale(Nodes[i], Scales[i]);
+	}
+	auto StartTime = chrono::steady_clock::now();
+	Hierarchy.Update();
+	chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mFullUpdateNs = Elapsed.count() * 1e9 / InNumNodes;
+
+	// 10% of the roots move, their chains follow
+	for (int i = 0; i < InNumNodes; i += ChainLength * 10)
+	{
+		Positions[i] = XMFLOAT3((float)i, 1.f, 2.f);
+		Hierarchy.SetPosition(Nodes[i], Positions[i]);
+	}
+	StartTime = chrono::steady_clock::now();
+	Hierarchy.Update();
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mPartialUpdateNs = Elapsed.count() * 1e9 / InNumNodes;
+
+	const int NumStaticUpdates = 100;
+	StartTime = chrono::steady_clock::now();
+	for (int i = 0; i < NumStaticUpdates; ++i)
+	{
+		Hierarchy.Update();
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mStaticUpdateUs = Elapsed.count() * 1e6 / NumStaticUpdates;
+
+	// on demand: compose the chain from the node up for every call, owners are the indices of the nodes
+	const int CallsPerFrame = 4;
+	vector<XMFLOAT4X4> Uncached(InNumNodes);
+	StartTime = chrono::steady_clock::now();
+	for (int Call = 0; Call < CallsPerFrame; ++Call)
+	{
+		for (int i = 0; i < InNumNodes; ++i)
+		{
+			XMMATRIX World = CTransformHierarchy::ComposeLocal(Positions[i], Rotations[i], Scales[i]);
+			for (FTransformHandle Parent = Hierarchy.GetParent(Nodes[i]); Hierarchy.IsValid(Parent);
+				Parent = Hierarchy.GetParent(Parent))
+			{
+				int p = (int)Hierarchy.GetOwner(Parent);
+				World = XMMatrixMultiply(World, CTransformHierarchy::ComposeLocal(Positions[p], Rotations[p], Scales[p]));
+			}
+			XMStoreFloat4x4(&Uncached[i], World);
+		}
+	}
+	Elapsed = chrono::steady_clock::now() - StartTime;
+	Result.mUncachedNs = Elapsed.count() * 1e9 / InNumNodes;
+
+	Result.bMatchesUncached = true;
+	for (int i = 0; i < InNumNodes; ++i)
+	{
+		const XMFLOAT4X4& Cached = Hierarchy.GetWorld(Nodes[i]);
+		for (int r = 0; r < 4; ++r)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				float Tolerance = 1e-4f * (1.f + std::fabs(Uncached[i].m[r][c]));
+				Result.bMatchesUncached = Result.bMatchesUncached && std::fabs(Cached.m[r][c] - Uncached[i].m[r][c]) <= Tolerance;
+			}
+		}
+	}
+
+	return Result;
+}
+
+vector<FJobScalingResult> CModuleBenchmarks::RunJobScaling(int InNumInstances, int InMaxThreads)
+{
+	assert(InNumInstances > 0);
+	CJobSystem& Jobs = CJobSystem::GetInstance();
+	bool bWasStarted = Jobs.IsStarted();
+	int PreviousWorkers = Jobs.GetNumThreads() - 1;
+
+	// instances in chains of 4 like RunTransformHierarchy, the roots move every frame
+	const int ChainLength = 4;
+	CTransformHierarchy Hierarchy;
+	vector<FTransformHandle> Nodes(InNumInstances);
+	for (int i = 0; i < InNumInstances; ++i)
+	{
+		Nodes[i] = Hierarchy.Create(i);
+		if (i % ChainLength != 0)
+		{
+			Hierarchy.SetParent(Nodes[i], Nodes[i - 1]);
+		}
+		float f = (float)i;
+		Hierarchy.SetPosition(Nodes[i], XMFLOAT3(std::sin(f) * 10, std::cos(f) * 10, f * .01f));
+		Hierarchy.SetRotation(Nodes[i], f * .1f, f * .2f, f * .3f);
+	}
+
+	// proxies as in CRenderInstance::GetRectProxy, constants as in FillObjectConstants
+	struct FProxy
+	{
+		XMFLOAT3 mCenter;
+		XMFLOAT3 mNormal;
+		XMFLOAT3 mMajorAxis;
+		float mRadius;
+	};
+	vector<FProxy> Proxies(InNumInstances);
+	const uint32_t PerObjectSize = 272;
+	CRenderCommandList Commands;
+
+	auto RunFrame = [&](int InFrame)
+	{
+		for (int i = 0; i < InNumInstances; i += ChainLength)
+		{
+			Hierarchy.SetPosition(Nodes[i], XMFLOAT3((float)InFrame, (float)i, 1.f));
+		}
+		Hierarchy.Update();
+
+		Commands.Reset();
+		uint32_t Offset;
+		uint32_t Stride;
+		uint8_t* Constants = static_cast<uint8_t*>(Commands.AllocateFrameConstantsArray(InNumInstances, PerObjectSize,
+			Offset, Stride));
+		Jobs.ParallelFor(InNumInstances, 256, [&](int InBegin, int InEnd)
+		{
+			for (int i = InBegin; i < InEnd; ++i)
+			{
+				XMMATRIX World = XMLoadFloat4x4(&Hierarchy.GetWorld(Nodes[i]));
+				FProxy& Proxy = Proxies[i];
+				XMStoreFloat3(&Proxy.mCenter, World.r[3]);
+				XMStoreFloat3(&Proxy.mNormal, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(0, 0, 1, 0), World)));
+				XMStoreFloat3(&Proxy.mMajorAxis, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(1, 0, 0, 0), World)));
+				Proxy.mRadius = XMVectorGetX(XMVector3Length(World.r[0]));
+
+				uint8_t* PerObject = Constants + (size_t)i * Stride;
+				XMStoreFloat4x4(reinterpret_cast<XMFLOAT4X4*>(PerObject), XMMatrixTranspose(World));
+				memset(PerObject + sizeof(XMFLOAT4X4), i & 0xff, PerObjectSize - sizeof(XMFLOAT4X4));
+			}
+		});
+	};
+
+	int MaxThreads = InMaxThreads > 0 ? InMaxThreads : max((int)thread::hardware_concurrency(), 1);
+	vector<FJobScalingResult> Results;
+	vector<FProxy> SingleThreadProxies;
+	vector<uint8_t> SingleThreadConstants;
+	for (int NumThreads = 1; ; NumThreads = min(NumThreads * 2, MaxThreads))
+	{
+		Jobs.Start(NumThreads - 1);
+		RunFrame(0);
+
+		const int NumFrames = 20;
+		auto StartTime = chrono::steady_clock::now();
+		for (int Frame = 1; Frame <= NumFrames; ++Frame)
+		{
+			RunFrame(Frame);
+		}
+		chrono::duration<double> Elapsed = chrono::steady_clock::now() - StartTime;
+
+		FJobScalingResult Result;
+		Result.mNumThreads = NumThreads;
+		Result.mFrameMs = Elapsed.count() * 1e3 / NumFrames;
+		Result.mSpeedup = Results.empty() ? 1.0 : Results[0].mFrameMs / Result.mFrameMs;
+
+		// every run ends on the same frame
+		const uint8_t* Constants = Commands.GetFrameConstants().data();
+		if (Results.empty())
+		{
+			SingleThreadProxies = Proxies;
+			SingleThreadConstants.assign(Constants, Constants + Commands.GetFrameConstants().size());
+		}
+		Result.bMatchesSingleThread = memcmp(Proxies.data(), SingleThreadProxies.data(), Proxies.size() * sizeof(FProxy)) == 0
+			&& Commands.GetFrameConstants().size() == SingleThreadConstants.size()
+			&& memcmp(Constants, SingleThreadConstants.data(), SingleThreadConstants.size()) == 0;
+		Results.push_back(Result);
+		if (NumThreads == MaxThreads)
+			break;
+	}
+
+	Jobs.Stop();
+	if (bWasStarted)
+	{
+		Jobs.Start(PreviousWorkers);
+	}
+	return Results;
+}
@@ -0,0 +1,114 @@
+#include "DXUT.h"
+#include "SdkMeshBuffers.h"
+
+namespace
+{
+	// Immutable buffer holding InSize bytes at InData.
+	ID3D11Buffer* CreateImmutableBuffer(ID3D11Device* pd3dDevice, const void* InData, uint64_t InSize, UINT InBindFlags)
+	{
+		// D3D11 buffers are limited to 32 bit sizes, empty buffers cannot be created
+		if (InSize == 0 || InSize > 0xffffffff)
+			return nullptr;
+
+		D3D11_BUFFER_DESC bd = {};
+		bd.Usage = D3D11_USAGE_IMMUTABLE;
+		bd.ByteWidth = (UINT)InSize;
+		bd.BindFlags = InBindFlags;
+		bd.CPUAccessFlags = 0;
+
+		D3D11_SUBRESOURCE_DATA InitData = {};
+		InitData.pSysMem = InData;
+		ID3D11Buffer* pBuffer = nullptr;
+		HRESULT hr = pd3dDevice->CreateBuffer(&bd, &InitData, &pBuffer);
+		return SUCCEEDED(hr) ? pBuffer : nullptr;
+	}
+}
+
+CSdkMeshBuffers::CSdkMeshBuffers()
+{
+
+}
+
+CSdkMeshBuffers::~CSdkMeshBuffers()
+{
+	Release();
+}
+
+bool CSdkMeshBuffers::Create(ID3D11Device* pd3dDevice, const CSdkMeshFile& InFile)
+{
+	assert(InFile.IsOpen());
+	Release();
+
+	for (uint32_t i = 0; i < InFile.GetNumVertexBuffers(); ++i)
+	{
+		FSdkMeshVertexView View = InFile.GetVertices(i);
+		ID3D11Buffer* pBuffer = CreateImmutableBuffer(pd3dDevice, View.mData, View.mNumVertices * View.mStride,
+			D3D11_BIND_VERTEX_BUFFER);
+		mVertexBuffers.push_back(pBuffer);
+		mVertexStrides.push_back(View.mStride);
+		if (pBuffer == nullptr)
+		{
+			Release();
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < InFile.GetNumIndexBuffers(); ++i)
+	{
+		FSdkMeshIndexView View = InFile.GetIndices(i);
+		uint64_t IndexSize = View.b32Bit ? sizeof(uint32_t) : sizeof(uint16_t);
+		ID3D11Buffer* pBuffer = CreateImmutableBuffer(pd3dDevice, View.mData, View.mNumIndices * IndexSize,
+			D3D11_BIND_INDEX_BUFFER);
+		mIndexBuffers.push_back(pBuffer);
+		mIndexFormats.push_back(View.b32Bit ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT);
+		if (pBuffer == nullptr)
+		{
+			Release();
+			return false;
+		}
+	}
+	return true;
+}
+
+void CSdkMeshBuffers::Release()
+{
+	for (ID3D11Buffer*& pBuffer : mVertexBuffers)
+	{
+		SAFE_RELEASE(pBuffer);
+	}
+	for (ID3D11Buffer*& pBuffer : mIndexBuffers)
+	{
+		SAFE_RELEASE(pBuffer);
+	}
+	mVertexBuffers.clear();
+	mVertexStrides.clear();
+	mIndexBuffers.clear();
+	mIndexFormats.clear();
+}
+
+bool CSdkMeshBuffers::ReplaceVertexBuffer(ID3D11Device* pd3dDevice, uint32_t InBuffer, const void* InVertices,
+	uint64_t InNumVertices, UINT InStride)
+{
+	assert(InBuffer < mVertexBuffers.size());
+	ID3D11Buffer* pBuffer = CreateImmutableBuffer(pd3dDevice, InVertices, InNumVertices * InStride, D3D11_BIND_VERTEX_BUFFER);
+	if (pBuffer == nullptr)
+		return false;
+
+	SAFE_RELEASE(mVertexBuffers[InBuffer]);
+	mVertexBuffers[InBuffer] = pBuffer;
+	mVertexStrides[InBuffer] = InStride;
+	return true;
+}
+
+void CSdkMeshBuffers::BindMesh(ID3D11DeviceContext* pd3dContext, const FSdkMeshMesh& InMesh) const
+{
+	ID3D11Buffer* Buffers[FSdkMeshMesh::MaxVertexStreams];
+	UINT Strides[FSdkMeshMesh::MaxVertexStreams];
+	UINT Offsets[FSdkMeshMesh::MaxVertexStreams] = {};
+	for (UINT i = 0; i < InMesh.mNumVertexBuffers; ++i)
+	{
+		Buffers[i] = mVertexBuffers[InMesh.mVertexBuffers[i]];
+		Strides[i] = mVertexStrides[InMesh.mVertexBuffers[i]];
+	}
+	pd3dContext->IASetVertexBuffers(0, InMesh.mNumVertexBuffers, Buffers, Strides, Offsets);
+	pd3dContext->IASetIndexBuffer(mIndexBuffers[InMesh.mIndexBuffer], mIndexFormats[InMesh.mIndexBuffer], 0);
+}
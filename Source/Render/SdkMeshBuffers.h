@@ -0,0 +1,37 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "SdkMeshFile.h"
+
+using namespace std;
+
+// GPU buffers of a CSdkMeshFile, the optional second step after mapping and validating it. The immutable buffers
+// are initialized straight from the views into the mapping, so the file may be closed once they are created.
+class CSdkMeshBuffers
+{
+public:
+	CSdkMeshBuffers();
+	~CSdkMeshBuffers();
+
+	// Create a vertex buffer per vertex buffer header and an index buffer per index buffer header.
+	bool Create(ID3D11Device* pd3dDevice, const CSdkMeshFile& InFile);
+	void Release();
+	bool IsCreated() const { return !mVertexBuffers.empty(); }
+	// Replace a vertex buffer by InNumVertices vertices of InStride bytes, for vertices converted after loading.
+	bool ReplaceVertexBuffer(ID3D11Device* pd3dDevice, uint32_t InBuffer, const void* InVertices, uint64_t InNumVertices,
+		UINT InStride);
+
+	ID3D11Buffer* GetVertexBuffer(uint32_t InBuffer) const { return mVertexBuffers[InBuffer]; }
+	UINT GetVertexStride(uint32_t InBuffer) const { return mVertexStrides[InBuffer]; }
+	ID3D11Buffer* GetIndexBuffer(uint32_t InBuffer) const { return mIndexBuffers[InBuffer]; }
+	DXGI_FORMAT GetIndexFormat(uint32_t InBuffer) const { return mIndexFormats[InBuffer]; }
+
+	// Bind the streams and the index buffer of a mesh of the file the buffers were created from.
+	void BindMesh(ID3D11DeviceContext* pd3dContext, const FSdkMeshMesh& InMesh) const;
+
+private:
+	vector<ID3D11Buffer*> mVertexBuffers;
+	vector<UINT> mVertexStrides;
+	vector<ID3D11Buffer*> mIndexBuffers;
+	vector<DXGI_FORMAT> mIndexFormats;
+};
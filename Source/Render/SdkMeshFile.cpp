@@ -0,0 +1,380 @@
+#include "SdkMeshFile.h"
+#include <cassert>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	// values of SDKMESH_PRIMITIVE_TYPE end with PT_TRIANGLE_PATCH_LIST
+	const uint32_t NumPrimitiveTypes = 11;
+	// stream of the element ending a vertex declaration
+	const uint16_t DeclEndStream = 0xff;
+
+	// A name array holds a terminating nul.
+	template<size_t Size>
+	bool IsTerminated(const char (&InName)[Size])
+	{
+		return memchr(InName, 0, Size) != nullptr;
+	}
+
+	// Frame, mesh or material index which is either valid or unset.
+	bool IsValidOrUnset(uint32_t InIndex, uint32_t InNum)
+	{
+		return InIndex < InNum || InIndex == CSdkMeshFile::InvalidIndex;
+	}
+}
+
+CSdkMeshFile::CSdkMeshFile()
+	: mData(nullptr)
+	, mSize(0)
+	, mFileHandle(nullptr)
+	, mMappingHandle(nullptr)
+	, mHeader(nullptr)
+	, mVertexBuffers(nullptr)
+	, mIndexBuffers(nullptr)
+	, mMeshes(nullptr)
+	, mSubsets(nullptr)
+	, mFrames(nullptr)
+	, mMaterials(nullptr)
+{
+
+}
+
+CSdkMeshFile::~CSdkMeshFile()
+{
+	Close();
+}
+
+ESdkMeshError::Type CSdkMeshFile::Open(const string& InFileName)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE File = CreateFileA(InFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+		return ESdkMeshError::FileNotFound;
+	mFileHandle = File;
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(File, &FileSize) || FileSize.QuadPart < (LONGLONG)sizeof(FSdkMeshHeader))
+	{
+		Close();
+		return ESdkMeshError::Truncated;
+	}
+	// a mapping of an empty file fails, which is caught by the size check
+	mMappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	void* pView = mMappingHandle != nullptr ? MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (pView == nullptr)
+	{
+		Close();
+		return ESdkMeshError::FileNotFound;
+	}
+	mData = static_cast<const uint8_t*>(pView);
+	mSize = (uint64_t)FileSize.QuadPart;
+#else
+	int File = open(InFileName.c_str(), O_RDONLY);
+	if (File < 0)
+		return ESdkMeshError::FileNotFound;
+
+	struct stat Stat;
+	if (fstat(File, &Stat) != 0 || Stat.st_size < (off_t)sizeof(FSdkMeshHeader))
+	{
+		close(File);
+		return ESdkMeshError::Truncated;
+	}
+	// the mapping keeps the file open by itself
+	void* pView = mmap(nullptr, (size_t)Stat.st_size, PROT_READ, MAP_PRIVATE, File, 0);
+	close(File);
+	if (pView == MAP_FAILED)
+		return ESdkMeshError::FileNotFound;
+	mData = static_cast<const uint8_t*>(pView);
+	mSize = (uint64_t)Stat.st_size;
+	mMappingHandle = pView;
+#endif
+
+	ESdkMeshError::Type Error = Validate();
+	if (Error != ESdkMeshError::None)
+	{
+		Close();
+	}
+	return Error;
+}
+
+ESdkMeshError::Type CSdkMeshFile::OpenMemory(const void* InData, size_t InSize)
+{
+	Close();
+	assert(reinterpret_cast<uintptr_t>(InData) % alignof(uint64_t) == 0);
+	mData = static_cast<const uint8_t*>(InData);
+	mSize = InSize;
+
+	ESdkMeshError::Type Error = Validate();
+	if (Error != ESdkMeshError::None)
+	{
+		Close();
+	}
+	return Error;
+}
+
+void CSdkMeshFile::Close()
+{
+#ifdef _WIN32
+	if (mData != nullptr && mMappingHandle != nullptr)
+	{
+		UnmapViewOfFile(mData);
+	}
+	if (mMappingHandle != nullptr)
+	{
+		CloseHandle(mMappingHandle);
+	}
+	if (mFileHandle != nullptr)
+	{
+		CloseHandle(mFileHandle);
+	}
+#else
+	if (mMappingHandle != nullptr)
+	{
+		munmap(mMappingHandle, (size_t)mSize);
+	}
+#endif
+
+	mData = nullptr;
+	mSize = 0;
+	mFileHandle = nullptr;
+	mMappingHandle = nullptr;
+	mHeader = nullptr;
+	mVertexBuffers = nullptr;
+	mIndexBuffers = nullptr;
+	mMeshes = nullptr;
+	mSubsets = nullptr;
+	mFrames = nullptr;
+	mMaterials = nullptr;
+}
+
+const void* CSdkMeshFile::GetTable(uint64_t InOffset, uint64_t InCount, size_t InElementSize, size_t InAlignment,
+	uint64_t InEnd) const
+{
+	// written so that no sum or product can overflow
+	if (InOffset > InEnd || InCount > (InEnd - InOffset) / InElementSize || InOffset % InAlignment != 0)
+		return nullptr;
+	return mData + InOffset;
+}
+
+ESdkMeshError::Type CSdkMeshFile::Validate()
+{
+	if (mSize < sizeof(FSdkMeshHeader))
+		return ESdkMeshError::Truncated;
+
+	const FSdkMeshHeader* pHeader = reinterpret_cast<const FSdkMeshHeader*>(mData);
+	if (pHeader->mVersion != FileVersion || pHeader->mIsBigEndian != 0)
+		return ESdkMeshError::UnsupportedVersion;
+
+	// header and tables, followed by the vertex and index data
+	const FSdkMeshHeader& Header = *pHeader;
+	if (Header.mHeaderSize < sizeof(FSdkMeshHeader) || Header.mHeaderSize > mSize
+		|| Header.mNonBufferDataSize > mSize - Header.mHeaderSize)
+		return ESdkMeshError::Truncated;
+	uint64_t StaticEnd = Header.mHeaderSize + Header.mNonBufferDataSize;
+	if (Header.mBufferDataSize > mSize - StaticEnd)
+		return ESdkMeshError::Truncated;
+	uint64_t BufferEnd = StaticEnd + Header.mBufferDataSize;
+
+	const size_t TableAlignment = alignof(uint64_t);
+	const FSdkMeshVertexBufferHeader* pVertexBuffers = static_cast<const FSdkMeshVertexBufferHeader*>(GetTable(
+		Header.mVertexStreamHeadersOffset, Header.mNumVertexBuffers, sizeof(FSdkMeshVertexBufferHeader), TableAlignment, StaticEnd));
+	const FSdkMeshIndexBufferHeader* pIndexBuffers = static_cast<const FSdkMeshIndexBufferHeader*>(GetTable(
+		Header.mIndexStreamHeadersOffset, Header.mNumIndexBuffers, sizeof(FSdkMeshIndexBufferHeader), TableAlignment, StaticEnd));
+	const FSdkMeshMesh* pMeshes = static_cast<const FSdkMeshMesh*>(GetTable(
+		Header.mMeshDataOffset, Header.mNumMeshes, sizeof(FSdkMeshMesh), TableAlignment, StaticEnd));
+	const FSdkMeshSubset* pSubsets = static_cast<const FSdkMeshSubset*>(GetTable(
+		Header.mSubsetDataOffset, Header.mNumTotalSubsets, sizeof(FSdkMeshSubset), TableAlignment, StaticEnd));
+	const FSdkMeshFrame* pFrames = static_cast<const FSdkMeshFrame*>(GetTable(
+		Header.mFrameDataOffset, Header.mNumFrames, sizeof(FSdkMeshFrame), TableAlignment, StaticEnd));
+	const FSdkMeshMaterial* pMaterials = static_cast<const FSdkMeshMaterial*>(GetTable(
+		Header.mMaterialDataOffset, Header.mNumMaterials, sizeof(FSdkMeshMaterial), TableAlignment, StaticEnd));
+	if (pVertexBuffers == nullptr || pIndexBuffers == nullptr || pMeshes == nullptr || pSubsets == nullptr
+		|| pFrames == nullptr || pMaterials == nullptr)
+		return ESdkMeshError::BadTable;
+
+	// buffer data lies behind the tables, offsets are from the start of the file
+	for (uint32_t i = 0; i < Header.mNumVertexBuffers; ++i)
+	{
+		const FSdkMeshVertexBufferHeader& Buffer = pVertexBuffers[i];
+		if (Buffer.mStrideBytes == 0 || Buffer.mStrideBytes > 0xffff || Buffer.mDataOffset < StaticEnd
+			|| GetTable(Buffer.mDataOffset, Buffer.mSizeBytes, 1, 1, BufferEnd) == nullptr
+			|| Buffer.mNumVertices > Buffer.mSizeBytes / Buffer.mStrideBytes)
+			return ESdkMeshError::BadBuffer;
+
+		// elements lie within the vertex
+		int Element = 0;
+		for (; Element < FSdkMeshVertexBufferHeader::MaxElements && Buffer.mDecl[Element].mStream != DeclEndStream; ++Element)
+		{
+			if (Buffer.mDecl[Element].mOffset >= Buffer.mStrideBytes)
+				return ESdkMeshError::BadBuffer;
+		}
+		if (Element == FSdkMeshVertexBufferHeader::MaxElements)
+			return ESdkMeshError::BadBuffer;
+	}
+	for (uint32_t i = 0; i < Header.mNumIndexBuffers; ++i)
+	{
+		const FSdkMeshIndexBufferHeader& Buffer = pIndexBuffers[i];
+		if (Buffer.mIndexType > 1)
+			return ESdkMeshError::BadBuffer;
+		size_t IndexSize = Buffer.mIndexType == 1 ? sizeof(uint32_t) : sizeof(uint16_t);
+		if (Buffer.mDataOffset < StaticEnd || GetTable(Buffer.mDataOffset, Buffer.mSizeBytes, 1, IndexSize, BufferEnd) == nullptr
+			|| Buffer.mNumIndices > Buffer.mSizeBytes / IndexSize)
+			return ESdkMeshError::BadBuffer;
+	}
+
+	for (uint32_t i = 0; i < Header.mNumMeshes; ++i)
+	{
+		const FSdkMeshMesh& Mesh = pMeshes[i];
+		if (!IsTerminated(Mesh.mName))
+			return ESdkMeshError::BadName;
+		if (Mesh.mNumVertexBuffers == 0 || Mesh.mNumVertexBuffers > FSdkMeshMesh::MaxVertexStreams
+			|| Mesh.mIndexBuffer >= Header.mNumIndexBuffers)
+			return ESdkMeshError::BadMesh;
+		for (uint32_t Stream = 0; Stream < Mesh.mNumVertexBuffers; ++Stream)
+		{
+			if (Mesh.mVertexBuffers[Stream] >= Header.mNumVertexBuffers)
+				return ESdkMeshError::BadMesh;
+		}
+
+		const uint32_t* pSubsetIndices = static_cast<const uint32_t*>(GetTable(
+			Mesh.mSubsetOffset, Mesh.mNumSubsets, sizeof(uint32_t), alignof(uint32_t), StaticEnd));
+		const uint32_t* pFrameIndices = static_cast<const uint32_t*>(GetTable(
+			Mesh.mFrameInfluenceOffset, Mesh.mNumFrameInfluences, sizeof(uint32_t), alignof(uint32_t), StaticEnd));
+		if (pSubsetIndices == nullptr || pFrameIndices == nullptr)
+			return ESdkMeshError::BadMesh;
+		for (uint32_t j = 0; j < Mesh.mNumFrameInfluences; ++j)
+		{
+			if (pFrameIndices[j] >= Header.mNumFrames)
+				return ESdkMeshError::BadMesh;
+		}
+
+		// subsets are drawn with DrawIndexed(IndexCount, IndexStart, VertexStart) from the first stream
+		const FSdkMeshVertexBufferHeader& Vertices = pVertexBuffers[Mesh.mVertexBuffers[0]];
+		const FSdkMeshIndexBufferHeader& Indices = pIndexBuffers[Mesh.mIndexBuffer];
+		for (uint32_t j = 0; j < Mesh.mNumSubsets; ++j)
+		{
+			if (pSubsetIndices[j] >= Header.mNumTotalSubsets)
+				return ESdkMeshError::BadMesh;
+			const FSdkMeshSubset& Subset = pSubsets[pSubsetIndices[j]];
+			if (Subset.mPrimitiveType >= NumPrimitiveTypes || !IsValidOrUnset(Subset.mMaterialID, Header.mNumMaterials)
+				|| Subset.mIndexStart > Indices.mNumIndices || Subset.mIndexCount > Indices.mNumIndices - Subset.mIndexStart
+				|| Subset.mVertexStart > Vertices.mNumVertices || Subset.mVertexCount > Vertices.mNumVertices - Subset.mVertexStart)
+				return ESdkMeshError::BadSubset;
+		}
+	}
+	for (uint32_t i = 0; i < Header.mNumTotalSubsets; ++i)
+	{
+		if (!IsTerminated(pSubsets[i].mName))
+			return ESdkMeshError::BadName;
+	}
+
+	for (uint32_t i = 0; i < Header.mNumFrames; ++i)
+	{
+		const FSdkMeshFrame& Frame = pFrames[i];
+		if (!IsTerminated(Frame.mName))
+			return ESdkMeshError::BadName;
+		if (!IsValidOrUnset(Frame.mMesh, Header.mNumMeshes) || !IsValidOrUnset(Frame.mParentFrame, Header.mNumFrames)
+			|| !IsValidOrUnset(Frame.mChildFrame, Header.mNumFrames) || !IsValidOrUnset(Frame.mSiblingFrame, Header.mNumFrames))
+			return ESdkMeshError::BadFrame;
+	}
+
+	for (uint32_t i = 0; i < Header.mNumMaterials; ++i)
+	{
+		const FSdkMeshMaterial& Material = pMaterials[i];
+		if (!IsTerminated(Material.mName) || !IsTerminated(Material.mMaterialInstancePath) || !IsTerminated(Material.mDiffuseTexture)
+			|| !IsTerminated(Material.mNormalTexture) || !IsTerminated(Material.mSpecularTexture))
+			return ESdkMeshError::BadName;
+	}
+
+	mHeader = pHeader;
+	mVertexBuffers = pVertexBuffers;
+	mIndexBuffers = pIndexBuffers;
+	mMeshes = pMeshes;
+	mSubsets = pSubsets;
+	mFrames = pFrames;
+	mMaterials = pMaterials;
+	return ESdkMeshError::None;
+}
+
+bool CSdkMeshFile::ValidateIndices() const
+{
+	assert(IsOpen());
+	for (uint32_t i = 0; i < mHeader->mNumMeshes; ++i)
+	{
+		const FSdkMeshMesh& Mesh = mMeshes[i];
+		FSdkMeshIndexView Indices = GetIndices(Mesh.mIndexBuffer);
+		uint64_t NumVertices = mVertexBuffers[Mesh.mVertexBuffers[0]].mNumVertices;
+		for (uint32_t j = 0; j < Mesh.mNumSubsets; ++j)
+		{
+			const FSdkMeshSubset& Subset = GetSubset(i, j);
+			// indices are relative to the base vertex of the subset
+			uint64_t MaxIndex = NumVertices - Subset.mVertexStart;
+			for (uint64_t k = Subset.mIndexStart; k < Subset.mIndexStart + Subset.mIndexCount; ++k)
+			{
+				if (Indices[k] >= MaxIndex)
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+const FSdkMeshSubset& CSdkMeshFile::GetSubset(uint32_t InMesh, uint32_t InSubset) const
+{
+	const FSdkMeshMesh& Mesh = mMeshes[InMesh];
+	assert(InSubset < Mesh.mNumSubsets);
+	const uint32_t* pSubsetIndices = reinterpret_cast<const uint32_t*>(mData + Mesh.mSubsetOffset);
+	return mSubsets[pSubsetIndices[InSubset]];
+}
+
+FSdkMeshVertexView CSdkMeshFile::GetVertices(uint32_t InBuffer) const
+{
+	const FSdkMeshVertexBufferHeader& Buffer = mVertexBuffers[InBuffer];
+	FSdkMeshVertexView View;
+	View.mData = mData + Buffer.mDataOffset;
+	View.mNumVertices = Buffer.mNumVertices;
+	View.mStride = (uint32_t)Buffer.mStrideBytes;
+	View.mDecl = Buffer.mDecl;
+	return View;
+}
+
+FSdkMeshIndexView CSdkMeshFile::GetIndices(uint32_t InBuffer) const
+{
+	const FSdkMeshIndexBufferHeader& Buffer = mIndexBuffers[InBuffer];
+	FSdkMeshIndexView View;
+	View.mData = mData + Buffer.mDataOffset;
+	View.mNumIndices = Buffer.mNumIndices;
+	View.b32Bit = Buffer.mIndexType == 1;
+	return View;
+}
+
+const char* CSdkMeshFile::GetErrorName(ESdkMeshError::Type InError)
+{
+	static const char* Names[] =
+	{
+		"None",
+		"FileNotFound",
+		"Truncated",
+		"UnsupportedVersion",
+		"BadTable",
+		"BadBuffer",
+		"BadMesh",
+		"BadSubset",
+		"BadFrame",
+		"BadName",
+	};
+	static_assert(sizeof(Names) / sizeof(Names[0]) == ESdkMeshError::Num, "a name for every error");
+	return InError >= 0 && InError < ESdkMeshError::Num ? Names[InError] : "Unknown";
+}
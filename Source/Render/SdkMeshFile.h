@@ -0,0 +1,258 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Layouts of the .sdkmesh structures of DXUT's SDKmesh.h without D3D types, pointer unions are kept as offsets.
+// All of them are 8 byte aligned in the file.
+#pragma pack(push, 8)
+
+// D3DVERTEXELEMENT9, a stream of 0xff ends the declaration.
+struct FSdkMeshVertexElement
+{
+	uint16_t mStream;
+	uint16_t mOffset;
+	uint8_t mType;
+	uint8_t mMethod;
+	uint8_t mUsage;
+	uint8_t mUsageIndex;
+};
+
+// SDKMESH_HEADER
+struct FSdkMeshHeader
+{
+	uint32_t mVersion;
+	uint8_t mIsBigEndian;
+	uint64_t mHeaderSize;
+	uint64_t mNonBufferDataSize;
+	uint64_t mBufferDataSize;
+	uint32_t mNumVertexBuffers;
+	uint32_t mNumIndexBuffers;
+	uint32_t mNumMeshes;
+	uint32_t mNumTotalSubsets;
+	uint32_t mNumFrames;
+	uint32_t mNumMaterials;
+	uint64_t mVertexStreamHeadersOffset;
+	uint64_t mIndexStreamHeadersOffset;
+	uint64_t mMeshDataOffset;
+	uint64_t mSubsetDataOffset;
+	uint64_t mFrameDataOffset;
+	uint64_t mMaterialDataOffset;
+};
+
+// SDKMESH_VERTEX_BUFFER_HEADER
+struct FSdkMeshVertexBufferHeader
+{
+	static const int MaxElements = 32;
+
+	uint64_t mNumVertices;
+	uint64_t mSizeBytes;
+	uint64_t mStrideBytes;
+	FSdkMeshVertexElement mDecl[MaxElements];
+	uint64_t mDataOffset;
+};
+
+// SDKMESH_INDEX_BUFFER_HEADER
+struct FSdkMeshIndexBufferHeader
+{
+	uint64_t mNumIndices;
+	uint64_t mSizeBytes;
+	// 0: 16 bit, 1: 32 bit
+	uint32_t mIndexType;
+	uint64_t mDataOffset;
+};
+
+// SDKMESH_MESH
+struct FSdkMeshMesh
+{
+	static const int MaxVertexStreams = 16;
+
+	char mName[100];
+	uint8_t mNumVertexBuffers;
+	uint32_t mVertexBuffers[MaxVertexStreams];
+	uint32_t mIndexBuffer;
+	uint32_t mNumSubsets;
+	uint32_t mNumFrameInfluences;
+	float mBoundingBoxCenter[3];
+	float mBoundingBoxExtents[3];
+	// uint32_t subset indices
+	uint64_t mSubsetOffset;
+	// uint32_t frame indices
+	uint64_t mFrameInfluenceOffset;
+};
+
+// SDKMESH_SUBSET
+struct FSdkMeshSubset
+{
+	char mName[100];
+	uint32_t mMaterialID;
+	uint32_t mPrimitiveType;
+	uint64_t mIndexStart;
+	uint64_t mIndexCount;
+	uint64_t mVertexStart;
+	uint64_t mVertexCount;
+};
+
+// SDKMESH_FRAME
+struct FSdkMeshFrame
+{
+	char mName[100];
+	uint32_t mMesh;
+	uint32_t mParentFrame;
+	uint32_t mChildFrame;
+	uint32_t mSiblingFrame;
+	float mMatrix[16];
+	uint32_t mAnimationDataIndex;
+};
+
+// SDKMESH_MATERIAL, the texture pointers are written by the DXUT loader only.
+struct FSdkMeshMaterial
+{
+	char mName[100];
+	char mMaterialInstancePath[260];
+	char mDiffuseTexture[260];
+	char mNormalTexture[260];
+	char mSpecularTexture[260];
+	float mDiffuse[4];
+	float mAmbient[4];
+	float mSpecular[4];
+	float mEmissive[4];
+	float mPower;
+	uint64_t mTextures[6];
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(FSdkMeshHeader) == 104, "SDKMESH_HEADER layout");
+static_assert(sizeof(FSdkMeshVertexBufferHeader) == 288, "SDKMESH_VERTEX_BUFFER_HEADER layout");
+static_assert(sizeof(FSdkMeshIndexBufferHeader) == 32, "SDKMESH_INDEX_BUFFER_HEADER layout");
+static_assert(sizeof(FSdkMeshMesh) == 224, "SDKMESH_MESH layout");
+static_assert(sizeof(FSdkMeshSubset) == 144, "SDKMESH_SUBSET layout");
+static_assert(sizeof(FSdkMeshFrame) == 184, "SDKMESH_FRAME layout");
+static_assert(sizeof(FSdkMeshMaterial) == 1256, "SDKMESH_MATERIAL layout");
+
+// Reasons CSdkMeshFile::Open fails.
+namespace ESdkMeshError
+{
+	enum Type
+	{
+		None = 0,
+		// the file cannot be opened or mapped
+		FileNotFound,
+		// smaller than the header or the sizes it declares
+		Truncated,
+		// not version 101 or big endian
+		UnsupportedVersion,
+		// a header array lies outside the non buffer data or is misaligned
+		BadTable,
+		// a vertex or index buffer lies outside the buffer data or has bad sizes
+		BadBuffer,
+		// a mesh references missing buffers, subsets or frames
+		BadMesh,
+		// a subset exceeds its buffers or has an unknown primitive type
+		BadSubset,
+		// a frame references a missing mesh or frame
+		BadFrame,
+		// a name is not terminated
+		BadName,
+
+		Num
+	};
+};
+
+// Vertices of one vertex buffer, pointing into the mapping.
+struct FSdkMeshVertexView
+{
+	const uint8_t* mData;
+	uint64_t mNumVertices;
+	uint32_t mStride;
+	// ends with an element of stream 0xff
+	const FSdkMeshVertexElement* mDecl;
+};
+
+// Indices of one index buffer, pointing into the mapping.
+struct FSdkMeshIndexView
+{
+	const void* mData;
+	uint64_t mNumIndices;
+	bool b32Bit;
+
+	uint32_t operator[](uint64_t i) const
+	{
+		return b32Bit ? static_cast<const uint32_t*>(mData)[i] : static_cast<const uint16_t*>(mData)[i];
+	}
+};
+
+// A .sdkmesh file mapped read only. Open validates the header, the vertex and index buffer headers, meshes,
+// subsets and frames against the file, so the accessors need no checks; vertex and index data are views into
+// the mapping and nothing is copied. Creating GPU buffers from the views is left to CSdkMeshBuffers.
+class CSdkMeshFile
+{
+public:
+	// version of the format
+	static const uint32_t FileVersion = 101;
+	// value of frame, mesh and material indices which refer to nothing
+	static const uint32_t InvalidIndex = 0xffffffff;
+
+	CSdkMeshFile();
+	~CSdkMeshFile();
+
+	CSdkMeshFile(const CSdkMeshFile&) = delete;
+	CSdkMeshFile& operator=(const CSdkMeshFile&) = delete;
+
+	// Map and validate a file, closing the previous one.
+	ESdkMeshError::Type Open(const string& InFileName);
+	// Validate a file already in memory, which must stay valid and 8 byte aligned until Close.
+	ESdkMeshError::Type OpenMemory(const void* InData, size_t InSize);
+	// Unmap the file.
+	void Close();
+	bool IsOpen() const { return mHeader != nullptr; }
+
+	// Check that every index of every subset lies within the vertices of the subset's mesh, reading all indices.
+	bool ValidateIndices() const;
+
+	const FSdkMeshHeader& GetHeader() const { return *mHeader; }
+	uint32_t GetNumMeshes() const { return mHeader->mNumMeshes; }
+	const FSdkMeshMesh& GetMesh(uint32_t InMesh) const { return mMeshes[InMesh]; }
+	// Subset InSubset of a mesh.
+	const FSdkMeshSubset& GetSubset(uint32_t InMesh, uint32_t InSubset) const;
+	uint32_t GetNumFrames() const { return mHeader->mNumFrames; }
+	const FSdkMeshFrame& GetFrame(uint32_t InFrame) const { return mFrames[InFrame]; }
+	uint32_t GetNumMaterials() const { return mHeader->mNumMaterials; }
+	const FSdkMeshMaterial& GetMaterial(uint32_t InMaterial) const { return mMaterials[InMaterial]; }
+
+	uint32_t GetNumVertexBuffers() const { return mHeader->mNumVertexBuffers; }
+	const FSdkMeshVertexBufferHeader& GetVertexBufferHeader(uint32_t InBuffer) const { return mVertexBuffers[InBuffer]; }
+	FSdkMeshVertexView GetVertices(uint32_t InBuffer) const;
+	uint32_t GetNumIndexBuffers() const { return mHeader->mNumIndexBuffers; }
+	const FSdkMeshIndexBufferHeader& GetIndexBufferHeader(uint32_t InBuffer) const { return mIndexBuffers[InBuffer]; }
+	FSdkMeshIndexView GetIndices(uint32_t InBuffer) const;
+
+	// Name of an error.
+	static const char* GetErrorName(ESdkMeshError::Type InError);
+
+private:
+	// Check all tables of the file at mData.
+	ESdkMeshError::Type Validate();
+	// Table of InCount elements at InOffset, null if it is outside [0, InEnd) or misaligned.
+	const void* GetTable(uint64_t InOffset, uint64_t InCount, size_t InElementSize, size_t InAlignment, uint64_t InEnd) const;
+
+private:
+	// the whole file
+	const uint8_t* mData;
+	uint64_t mSize;
+	// platform handles of the mapping, null for OpenMemory
+	void* mFileHandle;
+	void* mMappingHandle;
+
+	// tables in the file, null until validated
+	const FSdkMeshHeader* mHeader;
+	const FSdkMeshVertexBufferHeader* mVertexBuffers;
+	const FSdkMeshIndexBufferHeader* mIndexBuffers;
+	const FSdkMeshMesh* mMeshes;
+	const FSdkMeshSubset* mSubsets;
+	const FSdkMeshFrame* mFrames;
+	const FSdkMeshMaterial* mMaterials;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include "RectProxy.h"
+
+using namespace DirectX;
+
+// CPU side layouts of the constant and structured buffers declared in Shaders/ShaderBuffers.fxc.
+// Shared by the D3D11 renderer and the cpu reference renderer.
+
+// pixel shader part of cbuffer cbPerObject
+struct CB_PS_PER_OBJECT
+{
+	XMFLOAT4 mObjectColor;
+	XMFLOAT4 mCameraPos;
+	XMFLOAT4 mRoughness4;
+	XMFLOAT4 mCustomData0;
+	XMFLOAT4 mDiffuseColor;
+	uint32_t mLinkedReflectors[MAX_RELATED_REFLECTOR_NUM*4];
+};
+
+// cbuffer cbPerObject, bound to b0 of both the vertex and the pixel shader
+struct CB_PER_OBJECT
+{
+	XMFLOAT4X4 mWorld;
+	// xyz: decoding of quantized positions, see FVertexFormat
+	XMFLOAT4 mPositionScale;
+	XMFLOAT4 mPositionBias;
+	CB_PS_PER_OBJECT mPS;
+};
+
+// cbuffer vsPerFrame
+struct CB_VS_PER_FRAME
+{
+	XMFLOAT4X4 mView;
+	XMFLOAT4X4 mProj;
+};
+
+// cbuffer psPerFrame
+struct CB_PS_PER_FRAME
+{
+	XMFLOAT4 mLightDirAmbient;
+	XMFLOAT4 mLightIntensity;
+	uint32_t mToggleOptionsA[4];
+	XMFLOAT4 mSamplingRadius;
+	// xyz: camera position, for instanced draws without per-object constants
+	XMFLOAT4 mEyePos;
+};
+
+// StructuredBuffer psRects, one element per rectangle indexed by its CRectStore dense index.
+// 64 bytes, a rectangle is a single cache line on both sides.
+struct SB_PS_RECT
+{
+	// x: id, y: roughness, z: majorRadius, w, minorRadius
+	XMFLOAT4 plElement0;
+	// xyz: center, w: diffuse.x
+	XMFLOAT4 plCenter_DiffX;
+	// xyz: normal, w: diffuse.y
+	XMFLOAT4 plNorm_DifY;
+	// xyz: major axis, w: diffuse.z
+	XMFLOAT4 plAxis_DifZ;
+};
\ No newline at end of file
@@ -0,0 +1,228 @@
+#include "ShaderBytecodeCache.h"
+#include "FileUtil.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	// first bytes of cached files
+	const uint32_t CacheFileMagic = 0x43534752; // "RGSC"
+	// bumped when the file layout changes
+	const uint32_t CacheFileVersion = 1;
+	// include nesting deeper than this is assumed to be recursive
+	const int MaxIncludeDepth = 16;
+
+	// Read a whole file, false if it cannot be opened.
+	bool ReadFile(const string& InFileName, vector<uint8_t>& OutData)
+	{
+		FILE* fp = OpenFile(InFileName.c_str(), "rb");
+		if (fp == nullptr)
+			return false;
+
+		OutData.clear();
+		uint8_t Buffer[4096];
+		size_t Read;
+		while ((Read = fread(Buffer, 1, sizeof(Buffer), fp)) > 0)
+		{
+			OutData.insert(OutData.end(), Buffer, Buffer + Read);
+		}
+		fclose(fp);
+		return true;
+	}
+
+	// Directory part of a path including the separator, empty if there is none.
+	string GetDirectoryOf(const string& InFileName)
+	{
+		size_t Separator = InFileName.find_last_of("/\\");
+		return Separator != string::npos ? InFileName.substr(0, Separator + 1) : string();
+	}
+
+	// Hash a file and its includes into InOutHash.
+	void HashSourceRecursive(const string& InFileName, int InDepth, uint64_t& InOutHash)
+	{
+		vector<uint8_t> Source;
+		if (InDepth > MaxIncludeDepth || !ReadFile(InFileName, Source))
+		{
+			// missing includes still change the hash by name
+			InOutHash = CShaderBytecodeCache::HashBytes(InFileName.data(), InFileName.size(), InOutHash);
+			return;
+		}
+		InOutHash = CShaderBytecodeCache::HashBytes(Source.data(), Source.size(), InOutHash);
+
+		// follow #include "name", system includes are not used by the shaders
+		string Directory = GetDirectoryOf(InFileName);
+		const char* Text = (const char*)Source.data();
+		size_t Size = Source.size();
+		for (size_t i = 0; i < Size; ++i)
+		{
+			if (Text[i] != '#' || (i > 0 && Text[i - 1] != '\n' && Text[i - 1] != ' ' && Text[i - 1] != '\t'))
+				continue;
+
+			size_t p = i + 1;
+			while (p < Size && (Text[p] == ' ' || Text[p] == '\t'))
+				++p;
+			if (Size - p < 7 || strncmp(Text + p, "include", 7) != 0)
+				continue;
+			p += 7;
+			while (p < Size && (Text[p] == ' ' || Text[p] == '\t'))
+				++p;
+			if (p >= Size || Text[p] != '"')
+				continue;
+
+			size_t End = p + 1;
+			while (End < Size && Text[End] != '"' && Text[End] != '\n')
+				++End;
+			if (End >= Size || Text[End] != '"')
+				continue;
+
+			HashSourceRecursive(Directory + string(Text + p + 1, End - p - 1), InDepth + 1, InOutHash);
+			i = End;
+		}
+	}
+}
+
+FShaderKey::FShaderKey()
+	: mFlags(0)
+	, mSourceHash(0)
+{
+}
+
+string FShaderKey::ToString() const
+{
+	char Numbers[64];
+	snprintf(Numbers, sizeof(Numbers), "%08x|%016llx", mFlags, (unsigned long long)mSourceHash);
+
+	string Text = mFile + "|" + mEntryPoint + "|" + mProfile + "|" + Numbers;
+	for (const pair<string, string>& Define : mDefines)
+	{
+		Text += "|" + Define.first + "=" + Define.second;
+	}
+	return Text;
+}
+
+uint64_t FShaderKey::GetHash() const
+{
+	string Text = ToString();
+	return CShaderBytecodeCache::HashBytes(Text.data(), Text.size());
+}
+
+CShaderBytecodeCache::CShaderBytecodeCache()
+{
+}
+
+uint64_t CShaderBytecodeCache::HashBytes(const void* InData, size_t InSize, uint64_t InHash)
+{
+	const uint8_t* Bytes = (const uint8_t*)InData;
+	for (size_t i = 0; i < InSize; ++i)
+	{
+		InHash = (InHash ^ Bytes[i]) * 1099511628211ull;
+	}
+	return InHash;
+}
+
+uint64_t CShaderBytecodeCache::HashSource(const string& InFile)
+{
+	FILE* fp = OpenFile(InFile.c_str(), "rb");
+	if (fp == nullptr)
+		return 0;
+	fclose(fp);
+
+	uint64_t Hash = HashBytes(nullptr, 0);
+	HashSourceRecursive(InFile, 0, Hash);
+	return Hash;
+}
+
+string CShaderBytecodeCache::GetFileName(uint64_t InHash) const
+{
+	char Name[32];
+	snprintf(Name, sizeof(Name), "%016llx.cso", (unsigned long long)InHash);
+	string Directory = mDirectory;
+	if (!Directory.empty() && Directory.back() != '/' && Directory.back() != '\\')
+	{
+		Directory += '/';
+	}
+	return Directory + Name;
+}
+
+bool CShaderBytecodeCache::Load(const string& InFileName, const string& InKeyText, vector<uint8_t>& OutBytecode) const
+{
+	vector<uint8_t> Data;
+	if (!ReadFile(InFileName, Data))
+		return false;
+
+	// magic, version, key length, bytecode size
+	uint32_t Header[4];
+	if (Data.size() < sizeof(Header))
+		return false;
+	memcpy(Header, Data.data(), sizeof(Header));
+	if (Header[0] != CacheFileMagic || Header[1] != CacheFileVersion
+		|| Data.size() != sizeof(Header) + (size_t)Header[2] + Header[3])
+		return false;
+
+	const char* KeyText = (const char*)Data.data() + sizeof(Header);
+	if (InKeyText.size() != Header[2] || memcmp(KeyText, InKeyText.data(), Header[2]) != 0)
+		return false;
+
+	const uint8_t* Bytecode = Data.data() + sizeof(Header) + Header[2];
+	OutBytecode.assign(Bytecode, Bytecode + Header[3]);
+	return true;
+}
+
+const vector<uint8_t>* CShaderBytecodeCache::Find(const FShaderKey& InKey)
+{
+	string KeyText = InKey.ToString();
+	uint64_t Hash = HashBytes(KeyText.data(), KeyText.size());
+
+	auto It = mEntries.find(Hash);
+	if (It != mEntries.end() && It->second.mKeyText == KeyText)
+	{
+		++mStats.mMemoryHits;
+		return &It->second.mBytecode;
+	}
+
+	FEntry Entry;
+	if (!mDirectory.empty() && Load(GetFileName(Hash), KeyText, Entry.mBytecode))
+	{
+		++mStats.mDiskHits;
+		Entry.mKeyText = KeyText;
+		FEntry& Cached = mEntries[Hash];
+		Cached = move(Entry);
+		return &Cached.mBytecode;
+	}
+
+	++mStats.mMisses;
+	return nullptr;
+}
+
+const vector<uint8_t>& CShaderBytecodeCache::Store(const FShaderKey& InKey, const void* InBytecode, size_t InSize)
+{
+	assert(InBytecode != nullptr && InSize > 0);
+	++mStats.mStores;
+
+	string KeyText = InKey.ToString();
+	uint64_t Hash = HashBytes(KeyText.data(), KeyText.size());
+	FEntry& Entry = mEntries[Hash];
+	Entry.mKeyText = KeyText;
+	Entry.mBytecode.assign((const uint8_t*)InBytecode, (const uint8_t*)InBytecode + InSize);
+
+	if (!mDirectory.empty())
+	{
+		// a failed write only costs a compile next time
+		FILE* fp = OpenFile(GetFileName(Hash).c_str(), "wb");
+		if (fp != nullptr)
+		{
+			uint32_t Header[4] = { CacheFileMagic, CacheFileVersion, (uint32_t)KeyText.size(), (uint32_t)InSize };
+			fwrite(Header, sizeof(Header), 1, fp);
+			fwrite(KeyText.data(), 1, KeyText.size(), fp);
+			fwrite(InBytecode, 1, InSize, fp);
+			fclose(fp);
+		}
+	}
+	return Entry.mBytecode;
+}
+
+void CShaderBytecodeCache::Clear()
+{
+	mEntries.clear();
+}
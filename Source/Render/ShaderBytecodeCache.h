@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Compile inputs identifying one shader program.
+struct FShaderKey
+{
+	FShaderKey();
+
+	// source file
+	string mFile;
+	// entry point
+	string mEntryPoint;
+	// target profile, e.g. ps_5_0
+	string mProfile;
+	// preprocessor defines as name/value pairs
+	vector<pair<string, string>> mDefines;
+	// compiler flags
+	uint32_t mFlags;
+	// hash of the source file and everything it includes, see CShaderBytecodeCache::HashSource
+	uint64_t mSourceHash;
+
+	// Readable form of all fields, stored with cached bytecode to detect hash collisions.
+	string ToString() const;
+	// Hash of all fields.
+	uint64_t GetHash() const;
+};
+
+// Hits and misses of CShaderBytecodeCache.
+struct FShaderCacheStats
+{
+	FShaderCacheStats() : mMemoryHits(0), mDiskHits(0), mMisses(0), mStores(0) {}
+
+	// found in memory
+	int mMemoryHits;
+	// loaded from the cache directory
+	int mDiskHits;
+	// neither, the caller compiles
+	int mMisses;
+	// programs added
+	int mStores;
+};
+
+// Compiled shader bytecode by FShaderKey, kept in memory and optionally persisted in a directory so a later
+// run finds it without compiling. Files are named by the key hash and hold the full key for verification.
+class CShaderBytecodeCache
+{
+public:
+	CShaderBytecodeCache();
+
+	// Directory of cached files, which must exist. Empty keeps the cache in memory only.
+	void SetDirectory(const string& InDirectory) { mDirectory = InDirectory; }
+	const string& GetDirectory() const { return mDirectory; }
+
+	// Bytecode of a program, from memory or disk, null when it needs to be compiled.
+	const vector<uint8_t>* Find(const FShaderKey& InKey);
+	// Add compiled bytecode, writing it to the directory if there is one.
+	const vector<uint8_t>& Store(const FShaderKey& InKey, const void* InBytecode, size_t InSize);
+	// Forget everything in memory, files stay.
+	void Clear();
+
+	// Lookup counters.
+	const FShaderCacheStats& GetStats() const { return mStats; }
+	// File of a key hash in the directory.
+	string GetFileName(uint64_t InHash) const;
+
+	// Hash a source file with everything it includes by #include "...", resolved relative to the including
+	// file. Returns 0 when the file cannot be read.
+	static uint64_t HashSource(const string& InFile);
+	// 64 bit FNV-1a, continuing from InHash.
+	static uint64_t HashBytes(const void* InData, size_t InSize, uint64_t InHash = 14695981039346656037ull);
+
+private:
+	// Load a cached file, false when it is missing or belongs to another key.
+	bool Load(const string& InFileName, const string& InKeyText, vector<uint8_t>& OutBytecode) const;
+
+private:
+	// cached program of one key
+	struct FEntry
+	{
+		string mKeyText;
+		vector<uint8_t> mBytecode;
+	};
+
+	// programs by key hash
+	unordered_map<uint64_t, FEntry> mEntries;
+	// directory of cached files, empty for none
+	string mDirectory;
+	// counters
+	FShaderCacheStats mStats;
+};
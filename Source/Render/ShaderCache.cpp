@@ -0,0 +1,189 @@
+#include "DXUT.h"
+#include "SDKmisc.h"
+#include "ShaderCache.h"
+
+namespace
+{
+	// UTF-8 form of a wide string.
+	string ToUtf8(LPCWSTR InText)
+	{
+		int Size = WideCharToMultiByte(CP_UTF8, 0, InText, -1, nullptr, 0, nullptr, nullptr);
+		if (Size <= 1)
+			return string();
+
+		string Text(Size - 1, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, InText, -1, &Text[0], Size, nullptr, nullptr);
+		return Text;
+	}
+
+	// Hash of an input layout including the semantic names.
+	uint64_t HashInputLayout(const D3D11_INPUT_ELEMENT_DESC* pLayout, UINT NumElements)
+	{
+		uint64_t Hash = CShaderBytecodeCache::HashBytes(nullptr, 0);
+		for (UINT i = 0; i < NumElements; ++i)
+		{
+			const D3D11_INPUT_ELEMENT_DESC& Element = pLayout[i];
+			Hash = CShaderBytecodeCache::HashBytes(Element.SemanticName, strlen(Element.SemanticName) + 1, Hash);
+			UINT Fields[6] = { Element.SemanticIndex, (UINT)Element.Format, Element.InputSlot,
+				Element.AlignedByteOffset, (UINT)Element.InputSlotClass, Element.InstanceDataStepRate };
+			Hash = CShaderBytecodeCache::HashBytes(Fields, sizeof(Fields), Hash);
+		}
+		return Hash;
+	}
+}
+
+CShaderCache::CShaderCache()
+	: mNumCompiles(0)
+	, mNumSharedRequests(0)
+{
+}
+
+CShaderCache& CShaderCache::GetInstance()
+{
+	static CShaderCache GInstance;
+	return GInstance;
+}
+
+DWORD CShaderCache::GetCompileFlags()
+{
+#ifdef _DEBUG
+	// Disable optimizations to further improve shader debugging
+	return D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_SKIP_OPTIMIZATION | D3DCOMPILE_DEBUG;
+#else
+	return D3DCOMPILE_ENABLE_STRICTNESS;
+#endif
+}
+
+void CShaderCache::SetCacheDirectory(LPCWSTR InDirectory)
+{
+	if (InDirectory == nullptr || InDirectory[0] == 0)
+	{
+		mBytecode.SetDirectory(string());
+		return;
+	}
+
+	// an existing directory fails with ERROR_ALREADY_EXISTS, any other failure disables the disk cache
+	if (!CreateDirectoryW(InDirectory, nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		mBytecode.SetDirectory(string());
+		return;
+	}
+	mBytecode.SetDirectory(ToUtf8(InDirectory));
+}
+
+template <typename TCreate>
+CShaderCache::FProgram& CShaderCache::GetProgram(LPCWSTR pFileName, LPCSTR pEntrypoint, LPCSTR pProfile,
+	const D3D_SHADER_MACRO* pDefines, TCreate InCreate)
+{
+	FShaderKey Key;
+	Key.mFile = ToUtf8(pFileName);
+	Key.mEntryPoint = pEntrypoint;
+	Key.mProfile = pProfile;
+	Key.mFlags = GetCompileFlags();
+	for (const D3D_SHADER_MACRO* Define = pDefines; Define != nullptr && Define->Name != nullptr; ++Define)
+	{
+		Key.mDefines.push_back(make_pair(string(Define->Name), string(Define->Definition != nullptr ? Define->Definition : "")));
+	}
+
+	// the request key leaves out the source hash, sources do not change while running
+	FProgram& Program = mPrograms[Key.ToString()];
+	if (Program.mShader != nullptr)
+	{
+		++mNumSharedRequests;
+		return Program;
+	}
+
+	// hash the source where the compiler will find it
+	WCHAR SourcePath[MAX_PATH];
+	HRESULT hr = DXUTFindDXSDKMediaFileCch(SourcePath, MAX_PATH, pFileName);
+	Key.mSourceHash = SUCCEEDED(hr) ? CShaderBytecodeCache::HashSource(ToUtf8(SourcePath)) : 0;
+
+	// unreadable sources are compiled every run rather than risking stale bytecode
+	const vector<uint8_t>* Cached = Key.mSourceHash != 0 ? mBytecode.Find(Key) : nullptr;
+	if (Cached != nullptr)
+	{
+		Program.mBytecode = *Cached;
+	}
+	else
+	{
+		ID3DBlob* pBlob = nullptr;
+		hr = DXUTCompileFromFile(pFileName, pDefines, pEntrypoint, pProfile, GetCompileFlags(), 0, &pBlob);
+		assert(SUCCEEDED(hr));
+		++mNumCompiles;
+
+		const uint8_t* Bytecode = reinterpret_cast<const uint8_t*>(pBlob->GetBufferPointer());
+		Program.mBytecode.assign(Bytecode, Bytecode + pBlob->GetBufferSize());
+		if (Key.mSourceHash != 0)
+		{
+			mBytecode.Store(Key, Bytecode, pBlob->GetBufferSize());
+		}
+		SAFE_RELEASE(pBlob);
+	}
+
+	Program.mShader = InCreate(Program.mBytecode);
+	assert(Program.mShader != nullptr);
+	return Program;
+}
+
+ID3D11VertexShader* CShaderCache::GetVertexShader(ID3D11Device* pd3dDevice, LPCWSTR pFileName, LPCSTR pEntrypoint,
+	const D3D_SHADER_MACRO* pDefines)
+{
+	FProgram& Program = GetProgram(pFileName, pEntrypoint, "vs_5_0", pDefines,
+		[pd3dDevice](const vector<uint8_t>& InBytecode)
+	{
+		ID3D11VertexShader* pShader = nullptr;
+		HRESULT hr = pd3dDevice->CreateVertexShader(InBytecode.data(), InBytecode.size(), nullptr, &pShader);
+		assert(SUCCEEDED(hr));
+		return static_cast<ID3D11DeviceChild*>(pShader);
+	});
+
+	ID3D11VertexShader* pShader = static_cast<ID3D11VertexShader*>(Program.mShader);
+	mVertexPrograms[pShader] = &Program;
+	return pShader;
+}
+
+ID3D11PixelShader* CShaderCache::GetPixelShader(ID3D11Device* pd3dDevice, LPCWSTR pFileName, LPCSTR pEntrypoint,
+	const D3D_SHADER_MACRO* pDefines)
+{
+	FProgram& Program = GetProgram(pFileName, pEntrypoint, "ps_5_0", pDefines,
+		[pd3dDevice](const vector<uint8_t>& InBytecode)
+	{
+		ID3D11PixelShader* pShader = nullptr;
+		HRESULT hr = pd3dDevice->CreatePixelShader(InBytecode.data(), InBytecode.size(), nullptr, &pShader);
+		assert(SUCCEEDED(hr));
+		return static_cast<ID3D11DeviceChild*>(pShader);
+	});
+
+	return static_cast<ID3D11PixelShader*>(Program.mShader);
+}
+
+ID3D11InputLayout* CShaderCache::GetInputLayout(ID3D11Device* pd3dDevice, ID3D11VertexShader* pVertexShader,
+	const D3D11_INPUT_ELEMENT_DESC* pLayout, UINT NumElements)
+{
+	ID3D11InputLayout*& pInputLayout = mInputLayouts[make_pair(pVertexShader, HashInputLayout(pLayout, NumElements))];
+	if (pInputLayout != nullptr)
+		return pInputLayout;
+
+	auto It = mVertexPrograms.find(pVertexShader);
+	assert(It != mVertexPrograms.end());
+	const vector<uint8_t>& Bytecode = It->second->mBytecode;
+	HRESULT hr = pd3dDevice->CreateInputLayout(pLayout, NumElements, Bytecode.data(), Bytecode.size(), &pInputLayout);
+	assert(SUCCEEDED(hr));
+	return pInputLayout;
+}
+
+void CShaderCache::OnDestroy()
+{
+	for (auto& Entry : mInputLayouts)
+	{
+		SAFE_RELEASE(Entry.second);
+	}
+	mInputLayouts.clear();
+	mVertexPrograms.clear();
+
+	for (auto& Entry : mPrograms)
+	{
+		SAFE_RELEASE(Entry.second.mShader);
+	}
+	mPrograms.clear();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <d3d11.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "ShaderBytecodeCache.h"
+
+using namespace std;
+
+// Compiles and creates shaders once per program and shares them, with their input layouts, across render
+// instances. Bytecode is cached by CShaderBytecodeCache, keyed by file, entry point, profile, defines,
+// compiler flags and the hash of the source with its includes, so a warm start does not compile.
+class CShaderCache
+{
+private:
+	CShaderCache();
+
+public:
+	static CShaderCache& GetInstance();
+
+	// Persist bytecode in a directory, created if missing. An empty name keeps it in memory only.
+	void SetCacheDirectory(LPCWSTR InDirectory);
+
+	// Shared vertex shader, owned by the cache.
+	ID3D11VertexShader* GetVertexShader(ID3D11Device* pd3dDevice, LPCWSTR pFileName, LPCSTR pEntrypoint,
+		const D3D_SHADER_MACRO* pDefines = nullptr);
+	// Shared pixel shader, owned by the cache.
+	ID3D11PixelShader* GetPixelShader(ID3D11Device* pd3dDevice, LPCWSTR pFileName, LPCSTR pEntrypoint,
+		const D3D_SHADER_MACRO* pDefines = nullptr);
+	// Shared input layout of a vertex shader from this cache, owned by the cache.
+	ID3D11InputLayout* GetInputLayout(ID3D11Device* pd3dDevice, ID3D11VertexShader* pVertexShader,
+		const D3D11_INPUT_ELEMENT_DESC* pLayout, UINT NumElements);
+
+	// Release all shaders and layouts, bytecode stays cached for a new device.
+	void OnDestroy();
+
+	// Programs compiled by this run.
+	int GetNumCompiles() const { return mNumCompiles; }
+	// Shader requests served by an existing shader object.
+	int GetNumSharedRequests() const { return mNumSharedRequests; }
+	// Bytecode lookups.
+	const FShaderCacheStats& GetBytecodeStats() const { return mBytecode.GetStats(); }
+
+	// Compiler flags of all shaders.
+	static DWORD GetCompileFlags();
+
+private:
+	// a created shader with its bytecode
+	struct FProgram
+	{
+		FProgram() : mShader(nullptr) {}
+
+		vector<uint8_t> mBytecode;
+		ID3D11DeviceChild* mShader;
+	};
+
+	// Find or create the program of a request, InCreate creates the shader object from bytecode.
+	template <typename TCreate>
+	FProgram& GetProgram(LPCWSTR pFileName, LPCSTR pEntrypoint, LPCSTR pProfile, const D3D_SHADER_MACRO* pDefines,
+		TCreate InCreate);
+
+private:
+	// programs by request key, which has no source hash so it is built without reading files
+	map<string, FProgram> mPrograms;
+	// bytecode of each vertex shader, for creating input layouts
+	map<ID3D11VertexShader*, const FProgram*> mVertexPrograms;
+	// input layouts by vertex shader and layout hash
+	map<pair<ID3D11VertexShader*, uint64_t>, ID3D11InputLayout*> mInputLayouts;
+
+	// compiled bytecode in memory and on disk
+	CShaderBytecodeCache mBytecode;
+	// counters
+	int mNumCompiles;
+	int mNumSharedRequests;
+};
@@ -0,0 +1,222 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Handle of an element in TSlotMap. Stays valid while the element is alive; a removed element invalidates
+// all of its handles, even when its slot is reused.
+struct FSlotHandle
+{
+	// slot in the indirection table
+	uint32_t mSlot;
+	// generation of the slot when the handle was issued
+	uint32_t mGeneration;
+
+	FSlotHandle() : mSlot(InvalidSlot), mGeneration(0) {}
+
+	bool operator==(const FSlotHandle& Other) const { return mSlot == Other.mSlot && mGeneration == Other.mGeneration; }
+	bool operator!=(const FSlotHandle& Other) const { return !(*this == Other); }
+
+	// Pack into a 64 bit key, e.g. for CTransformHierarchy owners.
+	uint64_t ToKey() const { return ((uint64_t)mGeneration << 32) | mSlot; }
+	// Unpack a key made by ToKey.
+	static FSlotHandle FromKey(uint64_t InKey)
+	{
+		FSlotHandle Handle;
+		Handle.mSlot = (uint32_t)InKey;
+		Handle.mGeneration = (uint32_t)(InKey >> 32);
+		return Handle;
+	}
+
+	// slot of default constructed handles
+	static const uint32_t InvalidSlot = 0xffffffff;
+};
+
+// Handle of a render instance in CMiniEngine::mRenderInstances.
+typedef FSlotHandle FInstanceHandle;
+
+// Generational indirection from handles to dense indices, the handle logic of TSlotMap, CRectStore and
+// CTransformHierarchy. The owner keeps its elements in [0, Num()) in the order of the dense slots and mirrors
+// every change of that order: appending on Add, moving the last element into the hole on Remove, and applying
+// its own permutations to GetDenseSlots before calling UpdateIndices.
+class CSlotIndirection
+{
+public:
+	CSlotIndirection() : mFreeSlot(FSlotHandle::InvalidSlot) {}
+
+	// Issue the handle of an element appended at dense index Num().
+	FSlotHandle Add()
+	{
+		FSlotHandle Handle;
+		if (mFreeSlot != FSlotHandle::InvalidSlot)
+		{
+			Handle.mSlot = mFreeSlot;
+			mFreeSlot = mSlotIndices[mFreeSlot];
+		}
+		else
+		{
+			Handle.mSlot = (uint32_t)mSlotIndices.size();
+			mSlotIndices.push_back(0);
+			mSlotGenerations.push_back(0);
+		}
+		Handle.mGeneration = mSlotGenerations[Handle.mSlot];
+
+		mSlotIndices[Handle.mSlot] = (uint32_t)mDenseSlots.size();
+		mDenseSlots.push_back(Handle.mSlot);
+		return Handle;
+	}
+
+	// Invalidate the handles of an element and return its dense index, where the last element moves to.
+	int Remove(FSlotHandle InHandle)
+	{
+		assert(IsValid(InHandle));
+		int Index = (int)mSlotIndices[InHandle.mSlot];
+		mDenseSlots[Index] = mDenseSlots.back();
+		mSlotIndices[mDenseSlots[Index]] = (uint32_t)Index;
+		mDenseSlots.pop_back();
+
+		++mSlotGenerations[InHandle.mSlot];
+		mSlotIndices[InHandle.mSlot] = mFreeSlot;
+		mFreeSlot = InHandle.mSlot;
+		return Index;
+	}
+
+	// Invalidate all handles.
+	void Clear()
+	{
+		for (uint32_t Slot : mDenseSlots)
+		{
+			++mSlotGenerations[Slot];
+			mSlotIndices[Slot] = mFreeSlot;
+			mFreeSlot = Slot;
+		}
+		mDenseSlots.clear();
+	}
+
+	// Make room for InCapacity elements.
+	void Reserve(int InCapacity) { mDenseSlots.reserve(InCapacity); }
+
+	// Whether the handle refers to a live element.
+	bool IsValid(FSlotHandle InHandle) const
+	{
+		return InHandle.mSlot < mSlotGenerations.size() && mSlotGenerations[InHandle.mSlot] == InHandle.mGeneration;
+	}
+	// Dense index of an element, or -1 for invalid handles.
+	int GetIndex(FSlotHandle InHandle) const { return IsValid(InHandle) ? (int)mSlotIndices[InHandle.mSlot] : -1; }
+	// Handle of the element at a dense index.
+	FSlotHandle GetHandle(int InIndex) const
+	{
+		assert(InIndex >= 0 && InIndex < Num());
+		FSlotHandle Handle;
+		Handle.mSlot = mDenseSlots[InIndex];
+		Handle.mGeneration = mSlotGenerations[Handle.mSlot];
+		return Handle;
+	}
+
+	// Number of elements.
+	int Num() const { return (int)mDenseSlots.size(); }
+
+	// Slot of each dense index, for owners which reorder their elements.
+	vector<uint32_t>& GetDenseSlots() { return mDenseSlots; }
+	// Point the slots at their dense indices again after GetDenseSlots was permuted.
+	void UpdateIndices()
+	{
+		for (int i = 0; i < Num(); ++i)
+		{
+			mSlotIndices[mDenseSlots[i]] = (uint32_t)i;
+		}
+	}
+
+private:
+	// slot of each dense index
+	vector<uint32_t> mDenseSlots;
+	// dense index of each live slot, next free slot of each free slot
+	vector<uint32_t> mSlotIndices;
+	// generation of each slot, incremented on removal
+	vector<uint32_t> mSlotGenerations;
+	// head of the free slot list
+	uint32_t mFreeSlot;
+};
+
+// Elements stored by value in one contiguous array, addressed by generational handles.
+//
+// Elements are densely packed in [0, Num()) in insertion order until something is removed; removing an
+// element moves the last one into its place. Iterating is a linear scan, handles go through an indirection
+// table and survive the moves. Pointers and references to elements are invalidated by Add and Remove.
+template <typename T>
+class TSlotMap
+{
+public:
+	// Add an element, returns its handle.
+	FSlotHandle Add(T&& InElement)
+	{
+		mElements.push_back(move(InElement));
+		return mSlots.Add();
+	}
+
+	// Remove an element, all of its handles become invalid.
+	void Remove(FSlotHandle InHandle)
+	{
+		// the last element moves into the hole
+		int Index = mSlots.Remove(InHandle);
+		if (Index != Num() - 1)
+		{
+			mElements[Index] = move(mElements.back());
+		}
+		mElements.pop_back();
+	}
+
+	// Remove all elements and invalidate all handles.
+	void Clear()
+	{
+		mSlots.Clear();
+		mElements.clear();
+	}
+
+	// Make room for InCapacity elements.
+	void Reserve(int InCapacity)
+	{
+		mElements.reserve(InCapacity);
+		mSlots.Reserve(InCapacity);
+	}
+
+	// Whether the handle refers to a live element.
+	bool IsValid(FSlotHandle InHandle) const { return mSlots.IsValid(InHandle); }
+	// Dense index of an element, or -1 for invalid handles.
+	int GetIndex(FSlotHandle InHandle) const { return mSlots.GetIndex(InHandle); }
+	// Handle of the element at a dense index.
+	FSlotHandle GetHandle(int InIndex) const { return mSlots.GetHandle(InIndex); }
+
+	// Element of a handle, nullptr for invalid handles.
+	T* Get(FSlotHandle InHandle)
+	{
+		int Index = mSlots.GetIndex(InHandle);
+		return Index >= 0 ? &mElements[Index] : nullptr;
+	}
+	const T* Get(FSlotHandle InHandle) const
+	{
+		int Index = mSlots.GetIndex(InHandle);
+		return Index >= 0 ? &mElements[Index] : nullptr;
+	}
+
+	// Element at a dense index.
+	T& operator[](int InIndex) { return mElements[InIndex]; }
+	const T& operator[](int InIndex) const { return mElements[InIndex]; }
+
+	// Number of elements.
+	int Num() const { return (int)mElements.size(); }
+
+	// Dense iteration.
+	typename vector<T>::iterator begin() { return mElements.begin(); }
+	typename vector<T>::iterator end() { return mElements.end(); }
+	typename vector<T>::const_iterator begin() const { return mElements.begin(); }
+	typename vector<T>::const_iterator end() const { return mElements.end(); }
+
+private:
+	// elements by dense index
+	vector<T> mElements;
+	CSlotIndirection mSlots;
+};
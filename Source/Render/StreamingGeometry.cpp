@@ -0,0 +1,153 @@
+#include "DXUT.h"
+#include "StreamingGeometry.h"
+
+CStreamingGeometry::CStreamingGeometry()
+	: mFrame(1)
+	, mCompletedFrame(0)
+	, mNumBufferCreations(0)
+{
+	mVertices.mBuffer = nullptr;
+	mVertices.mBindFlags = D3D11_BIND_VERTEX_BUFFER;
+	mVertices.mMinBytes = MinVertexBytes;
+	mIndices.mBuffer = nullptr;
+	mIndices.mBindFlags = D3D11_BIND_INDEX_BUFFER;
+	mIndices.mMinBytes = MinIndexBytes;
+
+	for (int i = 0; i < MaxFramesInFlight; ++i)
+	{
+		mFences[i] = nullptr;
+		mFenceFrames[i] = 0;
+	}
+}
+
+CStreamingGeometry& CStreamingGeometry::GetInstance()
+{
+	static CStreamingGeometry GInstance;
+	return GInstance;
+}
+
+void CStreamingGeometry::BeginFrame(ID3D11DeviceContext* pd3dContext)
+{
+	// frames finish in order, so the newest signaled fence retires everything before it
+	for (int i = 0; i < MaxFramesInFlight; ++i)
+	{
+		if (mFences[i] == nullptr || mFenceFrames[i] <= mCompletedFrame)
+			continue;
+
+		BOOL bDone = FALSE;
+		if (pd3dContext->GetData(mFences[i], &bDone, sizeof(bDone), D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK && bDone)
+		{
+			mCompletedFrame = max(mCompletedFrame, mFenceFrames[i]);
+		}
+	}
+
+	mVertices.mRing.Retire(mCompletedFrame);
+	mIndices.mRing.Retire(mCompletedFrame);
+}
+
+void CStreamingGeometry::EndFrame(ID3D11DeviceContext* pd3dContext)
+{
+	// a fence still pending from MaxFramesInFlight frames ago is overwritten, a later one retires its frame
+	int Slot = (int)(mFrame % MaxFramesInFlight);
+	if (mFences[Slot] == nullptr)
+	{
+		ID3D11Device* pd3dDevice = nullptr;
+		pd3dContext->GetDevice(&pd3dDevice);
+		D3D11_QUERY_DESC Desc = { D3D11_QUERY_EVENT, 0 };
+		HRESULT hr = pd3dDevice->CreateQuery(&Desc, &mFences[Slot]);
+		assert(SUCCEEDED(hr));
+		SAFE_RELEASE(pd3dDevice);
+	}
+	pd3dContext->End(mFences[Slot]);
+	mFenceFrames[Slot] = mFrame;
+
+	mVertices.mRing.EndFrame(mFrame);
+	mIndices.mRing.EndFrame(mFrame);
+	++mFrame;
+
+	// the commands using replaced buffers have been submitted, the runtime keeps them alive for the GPU
+	for (ID3D11Buffer* pBuffer : mRetiredBuffers)
+	{
+		pBuffer->Release();
+	}
+	mRetiredBuffers.clear();
+}
+
+INT CStreamingGeometry::AppendVertices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands,
+	const void* InVertices, UINT InStride, UINT InNumVertices)
+{
+	// aligned to the stride, so all meshes of a stride share one binding and differ by base vertex
+	assert(InStride > 0);
+	UINT Offset = Append(pd3dDevice, OutCommands, mVertices, InVertices, InStride * InNumVertices, InStride);
+	return (INT)(Offset / InStride);
+}
+
+UINT CStreamingGeometry::AppendIndices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands,
+	const WORD* InIndices, UINT InNumIndices)
+{
+	UINT Offset = Append(pd3dDevice, OutCommands, mIndices, InIndices, sizeof(WORD) * InNumIndices, sizeof(WORD));
+	return Offset / sizeof(WORD);
+}
+
+UINT CStreamingGeometry::AppendIndices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands,
+	const uint32_t* InIndices, UINT InNumIndices)
+{
+	UINT Offset = Append(pd3dDevice, OutCommands, mIndices, InIndices, sizeof(uint32_t) * InNumIndices, sizeof(uint32_t));
+	return Offset / sizeof(uint32_t);
+}
+
+UINT CStreamingGeometry::Append(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands, FStream& InOutStream,
+	const void* InData, UINT InSize, UINT InAlignment)
+{
+	assert(InData != nullptr && InSize > 0);
+
+	FStreamingAllocation Allocation;
+	if (!InOutStream.mRing.Allocate(InSize, InAlignment, Allocation))
+	{
+		// grow by doubling, the new buffer starts empty and is written with discard first
+		if (InOutStream.mBuffer != nullptr)
+		{
+			mRetiredBuffers.push_back(InOutStream.mBuffer);
+			InOutStream.mBuffer = nullptr;
+		}
+		UINT Capacity = max(max(InOutStream.mMinBytes, 2 * InOutStream.mRing.GetCapacity()), 2 * InSize);
+
+		D3D11_BUFFER_DESC Desc;
+		ZeroMemory(&Desc, sizeof(D3D11_BUFFER_DESC));
+		Desc.Usage = D3D11_USAGE_DYNAMIC;
+		Desc.BindFlags = InOutStream.mBindFlags;
+		Desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		Desc.ByteWidth = Capacity;
+		HRESULT hr = pd3dDevice->CreateBuffer(&Desc, nullptr, &InOutStream.mBuffer);
+		assert(SUCCEEDED(hr));
+		++mNumBufferCreations;
+
+		InOutStream.mRing.Init(Capacity);
+		bool bAllocated = InOutStream.mRing.Allocate(InSize, InAlignment, Allocation);
+		assert(bAllocated);
+	}
+
+	void* pDst = OutCommands.UpdateBufferRange(InOutStream.mBuffer, Allocation.mOffset, InSize, Allocation.bDiscard);
+	memcpy(pDst, InData, InSize);
+	return Allocation.mOffset;
+}
+
+void CStreamingGeometry::OnDestroy()
+{
+	for (ID3D11Buffer* pBuffer : mRetiredBuffers)
+	{
+		pBuffer->Release();
+	}
+	mRetiredBuffers.clear();
+	SAFE_RELEASE(mVertices.mBuffer);
+	SAFE_RELEASE(mIndices.mBuffer);
+	mVertices.mRing.Init(0);
+	mIndices.mRing.Init(0);
+
+	for (int i = 0; i < MaxFramesInFlight; ++i)
+	{
+		SAFE_RELEASE(mFences[i]);
+		mFenceFrames[i] = 0;
+	}
+	mCompletedFrame = mFrame - 1;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <d3d11.h>
+#include <vector>
+#include "RenderCommands.h"
+#include "StreamingRing.h"
+
+using namespace std;
+
+// Vertex and index rings for geometry generated on the CPU every frame. Data is appended at any size through
+// the command list with no-overwrite maps; each frame is fenced with an event query and its space reused once
+// the GPU has passed it. Buffers are only created when a single frame outgrows them.
+class CStreamingGeometry
+{
+private:
+	CStreamingGeometry();
+
+public:
+	static CStreamingGeometry& GetInstance();
+
+	// initial sizes of the rings
+	static const UINT MinVertexBytes = 1024 * 1024;
+	static const UINT MinIndexBytes = 256 * 1024;
+	// frames which can be fenced at the same time
+	static const int MaxFramesInFlight = 4;
+
+	// Free the space of frames the GPU has finished, before recording a frame.
+	void BeginFrame(ID3D11DeviceContext* pd3dContext);
+	// Fence the data of the frame, after its commands were executed.
+	void EndFrame(ID3D11DeviceContext* pd3dContext);
+
+	// Append InNumVertices vertices of InStride bytes, returns the base vertex of the first one.
+	INT AppendVertices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands, const void* InVertices,
+		UINT InStride, UINT InNumVertices);
+	// Append 16 bit indices, returns the start index of the first one.
+	UINT AppendIndices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands, const WORD* InIndices,
+		UINT InNumIndices);
+	// Append 32 bit indices, returns the start index of the first one in 32 bit units.
+	UINT AppendIndices(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands, const uint32_t* InIndices,
+		UINT InNumIndices);
+
+	// Buffers the data appended last is in, valid until the next append.
+	ID3D11Buffer* GetVertexBuffer() const { return mVertices.mBuffer; }
+	ID3D11Buffer* GetIndexBuffer() const { return mIndices.mBuffer; }
+	// Number of the frame being recorded, starting at 1.
+	UINT64 GetFrame() const { return mFrame; }
+	// Buffers created so far.
+	int GetNumBufferCreations() const { return mNumBufferCreations; }
+
+	// Release the buffers and queries.
+	void OnDestroy();
+
+private:
+	// A dynamic buffer and its sub-allocator.
+	struct FStream
+	{
+		ID3D11Buffer* mBuffer;
+		CStreamingRing mRing;
+		UINT mBindFlags;
+		UINT mMinBytes;
+	};
+
+	// Allocate and record the write of InSize bytes into a stream, returns their offset.
+	UINT Append(ID3D11Device* pd3dDevice, CRenderCommandList& OutCommands, FStream& InOutStream, const void* InData,
+		UINT InSize, UINT InAlignment);
+
+private:
+	FStream mVertices;
+	FStream mIndices;
+
+	// frame being recorded, fences are frame numbers
+	UINT64 mFrame;
+	// the GPU has finished all frames up to this one
+	UINT64 mCompletedFrame;
+	// event queries of the frames in flight, by frame modulo MaxFramesInFlight
+	ID3D11Query* mFences[MaxFramesInFlight];
+	UINT64 mFenceFrames[MaxFramesInFlight];
+
+	// buffers replaced this frame, commands recorded before still use them
+	vector<ID3D11Buffer*> mRetiredBuffers;
+	int mNumBufferCreations;
+};
@@ -0,0 +1,88 @@
+#include "StreamingRing.h"
+#include <cassert>
+
+CStreamingRing::CStreamingRing()
+	: mCapacity(0)
+	, mHead(0)
+	, mUsed(0)
+	, mFrameBytes(0)
+	, bNeedsDiscard(true)
+	, mWastedBytes(0)
+{
+}
+
+void CStreamingRing::Init(uint32_t InCapacity)
+{
+	mCapacity = InCapacity;
+	mHead = 0;
+	mUsed = 0;
+	mFrameBytes = 0;
+	mFrames.clear();
+	bNeedsDiscard = true;
+	mWastedBytes = 0;
+}
+
+bool CStreamingRing::Allocate(uint32_t InSize, uint32_t InAlignment, FStreamingAllocation& OutAllocation)
+{
+	assert(InSize > 0 && InAlignment > 0);
+	if (InSize > mCapacity)
+		return false;
+
+	if (!bNeedsDiscard)
+	{
+		// after the head, or at the beginning when the end of the ring is too small
+		uint32_t Offset = (mHead + InAlignment - 1) / InAlignment * InAlignment;
+		uint32_t Padding = Offset - mHead;
+		if ((uint64_t)Offset + InSize > mCapacity)
+		{
+			Offset = 0;
+			Padding = mCapacity - mHead;
+		}
+
+		// the free space starts at the head, so it fits if padding and data are not more than the free bytes
+		uint64_t Consumed = (uint64_t)Padding + InSize;
+		if (mUsed + Consumed <= mCapacity)
+		{
+			mHead = Offset + InSize;
+			mUsed += (uint32_t)Consumed;
+			mFrameBytes += (uint32_t)Consumed;
+			mWastedBytes += Padding;
+			OutAllocation.mOffset = Offset;
+			OutAllocation.bDiscard = false;
+			return true;
+		}
+	}
+
+	// full: restart the ring, frames in flight keep the memory the driver renames away from us
+	mFrames.clear();
+	mHead = InSize;
+	mUsed = InSize;
+	mFrameBytes = InSize;
+	bNeedsDiscard = false;
+	OutAllocation.mOffset = 0;
+	OutAllocation.bDiscard = true;
+	return true;
+}
+
+void CStreamingRing::EndFrame(uint64_t InFence)
+{
+	assert(mFrames.empty() || mFrames.back().mFence < InFence);
+	if (mFrameBytes == 0)
+		return;
+
+	FFrame Frame;
+	Frame.mFence = InFence;
+	Frame.mBytes = mFrameBytes;
+	mFrames.push_back(Frame);
+	mFrameBytes = 0;
+}
+
+void CStreamingRing::Retire(uint64_t InFence)
+{
+	while (!mFrames.empty() && mFrames.front().mFence <= InFence)
+	{
+		assert(mUsed >= mFrames.front().mBytes);
+		mUsed -= mFrames.front().mBytes;
+		mFrames.pop_front();
+	}
+}
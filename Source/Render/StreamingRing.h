@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+using namespace std;
+
+// Where an allocation of CStreamingRing was placed.
+struct FStreamingAllocation
+{
+	// byte offset in the ring
+	uint32_t mOffset;
+	// the ring was restarted, the buffer has to be mapped with discard so the GPU keeps reading the old memory
+	bool bDiscard;
+};
+
+// Sub-allocator of a dynamic buffer written with no-overwrite maps. Allocations of a frame are fenced when the
+// frame ends and their space is reused once the GPU is known to have finished the frame. When the ring is full
+// it restarts at the beginning with a discard instead of waiting.
+class CStreamingRing
+{
+public:
+	CStreamingRing();
+
+	// Forget all allocations and use a buffer of InCapacity bytes, the next allocation discards.
+	void Init(uint32_t InCapacity);
+	// Allocate InSize bytes aligned to InAlignment, which does not have to be a power of two so vertices can be
+	// aligned to their stride. False if the allocation does not fit into the ring at all.
+	bool Allocate(uint32_t InSize, uint32_t InAlignment, FStreamingAllocation& OutAllocation);
+	// Fence the allocations made since the last call with InFence, fences increase by frame.
+	void EndFrame(uint64_t InFence);
+	// Free the allocations of all frames fenced with InFence or earlier.
+	void Retire(uint64_t InFence);
+
+	// Bytes of the buffer.
+	uint32_t GetCapacity() const { return mCapacity; }
+	// Bytes in use by frames in flight and the current frame, including padding.
+	uint32_t GetUsed() const { return mUsed; }
+	// Bytes skipped by alignment and at the end of the ring since Init.
+	uint64_t GetWastedBytes() const { return mWastedBytes; }
+
+private:
+	// Bytes of one fenced frame.
+	struct FFrame
+	{
+		uint64_t mFence;
+		uint32_t mBytes;
+	};
+
+	// bytes of the buffer
+	uint32_t mCapacity;
+	// where the next allocation starts
+	uint32_t mHead;
+	// bytes from the oldest frame in flight to the head
+	uint32_t mUsed;
+	// bytes of the current frame
+	uint32_t mFrameBytes;
+	// frames in flight, oldest first
+	deque<FFrame> mFrames;
+	// the buffer has not been written since Init or a restart is needed
+	bool bNeedsDiscard;
+	uint64_t mWastedBytes;
+};
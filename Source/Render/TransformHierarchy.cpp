@@ -0,0 +1,317 @@
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+	// flags of a node
+	enum
+	{
+		// position, rotation, scale or parent changed since the last update
+		ELocalDirty = 1,
+		// the world matrix changed in the last update
+		EWorldChanged = 2,
+		// in mChanged
+		EReported = 4,
+	};
+
+	XMFLOAT4X4 GIdentity()
+	{
+		XMFLOAT4X4 Identity;
+		XMStoreFloat4x4(&Identity, XMMatrixIdentity());
+		return Identity;
+	}
+}
+
+CTransformHierarchy::CTransformHierarchy()
+	: bDirty(false)
+	, bOrderDirty(false)
+{
+	mLevelStarts.push_back(0);
+
+}
+
+FTransformHandle CTransformHierarchy::Create(uint64_t InOwner)
+{
+	// roots may go anywhere in depth order
+	FTransformHandle Handle = mSlots.Add();
+	mParents.push_back(-1);
+	mPositions.push_back(XMFLOAT3(0, 0, 0));
+	mRotations.push_back(XMFLOAT3(0, 0, 0));
+	mScales.push_back(1.f);
+	mLocals.push_back(GIdentity());
+	mWorlds.push_back(GIdentity());
+	mOwners.push_back(InOwner);
+	mFlags.push_back(0);
+	MarkLocal(Num() - 1);
+
+	return Handle;
+}
+
+void CTransformHierarchy::Destroy(FTransformHandle InHandle)
+{
+	int Removed = Order(InHandle);
+	int Last = Num() - 1;
+
+	for (int i = 0; i < Num(); ++i)
+	{
+		// orphaned children keep their local transform
+		if (mParents[i] == Removed)
+		{
+			mParents[i] = -1;
+			MarkLocal(i);
+		}
+		// the last node moves into the removed place
+		else if (mParents[i] == Last)
+		{
+			mParents[i] = Removed;
+		}
+	}
+
+	mParents[Removed] = mParents[Last];
+	mPositions[Removed] = mPositions[Last];
+	mRotations[Removed] = mRotations[Last];
+	mScales[Removed] = mScales[Last];
+	mLocals[Removed] = mLocals[Last];
+	mWorlds[Removed] = mWorlds[Last];
+	mOwners[Removed] = mOwners[Last];
+	mFlags[Removed] = mFlags[Last];
+
+	mParents.pop_back();
+	mPositions.pop_back();
+	mRotations.pop_back();
+	mScales.pop_back();
+	mLocals.pop_back();
+	mWorlds.pop_back();
+	mOwners.pop_back();
+	mFlags.pop_back();
+	mSlots.Remove(InHandle);
+
+	// levels shift, and the moved node may now precede its parent
+	bOrderDirty = true;
+}
+
+bool CTransformHierarchy::IsValid(FTransformHandle InHandle) const
+{
+	return mSlots.IsValid(InHandle);
+}
+
+int CTransformHierarchy::Order(FTransformHandle InHandle) const
+{
+	assert(IsValid(InHandle));
+	return mSlots.GetIndex(InHandle);
+}
+
+void CTransformHierarchy::SetParent(FTransformHandle InHandle, FTransformHandle InParent)
+{
+	int Node = Order(InHandle);
+	int Parent = IsValid(InParent) ? Order(InParent) : -1;
+
+	// no cycles
+	for (int Ancestor = Parent; Ancestor >= 0; Ancestor = mParents[Ancestor])
+	{
+		assert(Ancestor != Node);
+	}
+
+	mParents[Node] = Parent;
+	MarkLocal(Node);
+	// the depth of the node and its children changes
+	bOrderDirty = true;
+}
+
+FTransformHandle CTransformHierarchy::GetParent(FTransformHandle InHandle) const
+{
+	int Parent = mParents[Order(InHandle)];
+	return Parent >= 0 ? mSlots.GetHandle(Parent) : FTransformHandle();
+}
+
+void CTransformHierarchy::SetPosition(FTransformHandle InHandle, const XMFLOAT3& InPosition)
+{
+	int Node = Order(InHandle);
+	mPositions[Node] = InPosition;
+	MarkLocal(Node);
+}
+
+void CTransformHierarchy::SetRotation(FTransformHandle InHandle, float InPitch, float InYaw, float InRoll)
+{
+	int Node = Order(InHandle);
+	mRotations[Node] = XMFLOAT3(InPitch, InYaw, InRoll);
+	MarkLocal(Node);
+}
+
+void CTransformHierarchy::SetScale(FTransformHandle InHandle, float InScale)
+{
+	int Node = Order(InHandle);
+	mScales[Node] = InScale;
+	MarkLocal(Node);
+}
+
+void CTransformHierarchy::MarkLocal(int InOrder)
+{
+	mFlags[InOrder] |= ELocalDirty;
+	bDirty = true;
+}
+
+XMMATRIX CTransformHierarchy::ComposeLocal(const XMFLOAT3& InPosition, const XMFLOAT3& InRotation, float InScale)
+{
+	XMVECTOR RotationQuat = XMQuaternionRotationRollPitchYawFromVector(
+		XMVectorSet(InRotation.x * XM_PI, InRotation.y * XM_PI, InRotation.z * XM_PI, 0));
+	return XMMatrixAffineTransformation(XMVectorReplicate(InScale), XMVectorZero(), RotationQuat, XMLoadFloat3(&InPosition));
+}
+
+void CTransformHierarchy::Reorder()
+{
+	int NumNodes = Num();
+
+	// depth of every node, walking up until a known depth
+	vector<int32_t> Depths(NumNodes, -1);
+	vector<int32_t> Chain;
+	int MaxDepth = 0;
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		int Node = i;
+		while (Node >= 0 && Depths[Node] < 0)
+		{
+			Chain.push_back(Node);
+			Node = mParents[Node];
+		}
+		int Depth = Node >= 0 ? Depths[Node] : -1;
+		while (!Chain.empty())
+		{
+			Depths[Chain.back()] = ++Depth;
+			Chain.pop_back();
+		}
+		MaxDepth = max(MaxDepth, Depths[i]);
+	}
+
+	// stable counting sort by depth
+	vector<int32_t> Starts(MaxDepth + 2, 0);
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		++Starts[Depths[i] + 1];
+	}
+	for (int d = 0; d <= MaxDepth; ++d)
+	{
+		Starts[d + 1] += Starts[d];
+	}
+	mLevelStarts = Starts;
+	vector<int32_t> NewOrders(NumNodes);
+	vector<int32_t> OldOrders(NumNodes);
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		NewOrders[i] = Starts[Depths[i]]++;
+		OldOrders[NewOrders[i]] = i;
+	}
+
+	auto Permute = [&](auto& Array)
+	{
+		auto Sorted = Array;
+		for (int i = 0; i < NumNodes; ++i)
+		{
+			Sorted[i] = Array[OldOrders[i]];
+		}
+		Array.swap(Sorted);
+	};
+	Permute(mSlots.GetDenseSlots());
+	mSlots.UpdateIndices();
+	Permute(mParents);
+	Permute(mPositions);
+	Permute(mRotations);
+	Permute(mScales);
+	Permute(mLocals);
+	Permute(mWorlds);
+	Permute(mOwners);
+	Permute(mFlags);
+
+	for (int i = 0; i < NumNodes; ++i)
+	{
+		if (mParents[i] >= 0)
+		{
+			mParents[i] = NewOrders[mParents[i]];
+			assert(mParents[i] < i);
+		}
+	}
+	bOrderDirty = false;
+}
+
+void CTransformHierarchy::Update()
+{
+	PROFILE_SCOPE("CTransformHierarchy::Update");
+	if (bOrderDirty)
+	{
+		Reorder();
+	}
+
+	if (!bDirty)
+		return;
+
+	// a level only reads the flags and world matrices of earlier ones
+	CJobSystem& Jobs = CJobSystem::GetInstance();
+	int NumLevels = (int)mLevelStarts.size() - 1;
+	for (int Level = 0; Level <= NumLevels; ++Level)
+	{
+		int Begin = mLevelStarts[min(Level, NumLevels)];
+		int End = Level < NumLevels ? mLevelStarts[Level + 1] : Num();
+		Jobs.ParallelFor(End - Begin, UpdateGrain, [this, Begin](int InBegin, int InEnd)
+		{
+			UpdateRange(Begin + InBegin, Begin + InEnd);
+		});
+	}
+
+	// report in node order, the same as a serial update
+	for (int i = 0; i < Num(); ++i)
+	{
+		if ((mFlags[i] & (EWorldChanged | EReported)) == EWorldChanged)
+		{
+			mChanged.push_back(mSlots.GetHandle(i));
+			mFlags[i] |= EReported;
+		}
+	}
+	bDirty = false;
+}
+
+void CTransformHierarchy::UpdateRange(int InBegin, int InEnd)
+{
+	for (int i = InBegin; i < InEnd; ++i)
+	{
+		bool bChanged = (mFlags[i] & ELocalDirty) != 0;
+		if (bChanged)
+		{
+			XMStoreFloat4x4(&mLocals[i], ComposeLocal(mPositions[i], mRotations[i], mScales[i]));
+		}
+
+		// parents precede their children, so their flags are already current
+		int Parent = mParents[i];
+		bChanged = bChanged || (Parent >= 0 && (mFlags[Parent] & EWorldChanged) != 0);
+		if (bChanged)
+		{
+			if (Parent >= 0)
+			{
+				XMStoreFloat4x4(&mWorlds[i], XMMatrixMultiply(XMLoadFloat4x4(&mLocals[i]), XMLoadFloat4x4(&mWorlds[Parent])));
+			}
+			else
+			{
+				mWorlds[i] = mLocals[i];
+			}
+		}
+
+		mFlags[i] = (bChanged ? EWorldChanged : 0) | (mFlags[i] & EReported);
+	}
+}
+
+void CTransformHierarchy::ConsumeChanged(vector<uint64_t>& OutOwners)
+{
+	for (FTransformHandle Handle : mChanged)
+	{
+		if (!IsValid(Handle))
+			continue;
+
+		int Node = Order(Handle);
+		mFlags[Node] &= ~EReported;
+		OutOwners.push_back(mOwners[Node]);
+	}
+	mChanged.clear();
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "SlotMap.h"
+
+using namespace DirectX;
+using namespace std;
+
+// Handle of a node in CTransformHierarchy, stays valid until the node is destroyed.
+typedef FSlotHandle FTransformHandle;
+
+// Local and world transforms of render instances with parent/child links.
+//
+// Nodes are stored sorted by depth, so a parent always precedes its children and Update resolves all
+// world matrices level by level, the nodes of a level in parallel on CJobSystem: local matrices are rebuilt
+// only for nodes whose position, rotation or scale changed, world matrices only for those and for nodes whose
+// parent world matrix changed. Changing parents or destroying nodes re-sorts the arrays on the next update,
+// roots created since then are updated after the sorted levels.
+class CTransformHierarchy
+{
+public:
+	CTransformHierarchy();
+
+	// Create a root node with identity transform, InOwner is an opaque key returned by GetOwner.
+	FTransformHandle Create(uint64_t InOwner);
+	// Destroy a node, its children become roots keeping their local transform.
+	void Destroy(FTransformHandle InHandle);
+	// Whether the handle refers to a live node.
+	bool IsValid(FTransformHandle InHandle) const;
+
+	// Attach a node to a parent, or make it a root with an invalid parent handle.
+	void SetParent(FTransformHandle InHandle, FTransformHandle InParent);
+	// Parent of a node, invalid for roots.
+	FTransformHandle GetParent(FTransformHandle InHandle) const;
+
+	// Set local position.
+	void SetPosition(FTransformHandle InHandle, const XMFLOAT3& InPosition);
+	// Set local rotation in units of PI, like CRenderInstance::SetRotation.
+	void SetRotation(FTransformHandle InHandle, float InPitch, float InYaw, float InRoll);
+	// Set local uniform scale.
+	void SetScale(FTransformHandle InHandle, float InScale);
+
+	// Resolve all pending changes, nothing is done when there are none.
+	void Update();
+	// Whether world matrices reflect all changes.
+	bool IsUpToDate() const { return !bDirty && !bOrderDirty; }
+
+	// Local matrix of a node as of the last update.
+	const XMFLOAT4X4& GetLocal(FTransformHandle InHandle) const { return mLocals[Order(InHandle)]; }
+	// World matrix of a node as of the last update.
+	const XMFLOAT4X4& GetWorld(FTransformHandle InHandle) const { return mWorlds[Order(InHandle)]; }
+	// Owner key given to Create.
+	uint64_t GetOwner(FTransformHandle InHandle) const { return mOwners[Order(InHandle)]; }
+	// Append the owners of nodes whose world matrix changed since the last call, each once.
+	void ConsumeChanged(vector<uint64_t>& OutOwners);
+
+	// Number of nodes.
+	int Num() const { return mSlots.Num(); }
+
+	// nodes per job of a parallel level update
+	static const int UpdateGrain = 512;
+
+	// Compose the local matrix the way CRenderInstance::GetWorldMatrix did.
+	static XMMATRIX ComposeLocal(const XMFLOAT3& InPosition, const XMFLOAT3& InRotation, float InScale);
+
+private:
+	// Sorted position of a live node.
+	int Order(FTransformHandle InHandle) const;
+	// Sort nodes by depth, parents first.
+	void Reorder();
+	// Flag a node for a local rebuild.
+	void MarkLocal(int InOrder);
+	// Rebuild the changed matrices of nodes [InBegin, InEnd), whose parents are all updated already.
+	void UpdateRange(int InBegin, int InEnd);
+
+private:
+	// sorted position of each handle, the dense order is the depth order
+	CSlotIndirection mSlots;
+	// per node in depth order
+	vector<int32_t> mParents;
+	vector<XMFLOAT3> mPositions;
+	vector<XMFLOAT3> mRotations;
+	vector<float> mScales;
+	vector<XMFLOAT4X4> mLocals;
+	vector<XMFLOAT4X4> mWorlds;
+	vector<uint64_t> mOwners;
+	// ELocalDirty, EWorldChanged, EReported
+	vector<uint8_t> mFlags;
+	// first node of each depth as of the last sort, followed by the end of the sorted nodes
+	vector<int32_t> mLevelStarts;
+
+	// some local transform changed
+	bool bDirty;
+	// parents changed or nodes were destroyed
+	bool bOrderDirty;
+	// nodes changed since the last ConsumeChanged, may contain destroyed ones
+	vector<FTransformHandle> mChanged;
+};
@@ -0,0 +1,573 @@
+#include "VertexQuantization.h"
+#include "SdkMeshFile.h"
+#include "../CpuGI/HalfFloat.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define VERTEX_DECODE_SSE2 1
+#else
+#define VERTEX_DECODE_SSE2 0
+#endif
+
+namespace
+{
+	// D3DDECLUSAGE and D3DDECLTYPE values of vertex declarations
+	const uint8_t DeclUsagePosition = 0;
+	const uint8_t DeclUsageNormal = 3;
+	const uint8_t DeclUsageTexcoord = 5;
+	const uint8_t DeclTypeFloat2 = 1;
+	const uint8_t DeclTypeFloat3 = 2;
+
+	// largest values of the normalized integer formats
+	const float Snorm8Max = 127.f;
+	const float Snorm16Max = 32767.f;
+	const float Unorm16Max = 65535.f;
+
+	uint32_t GetPositionSize(EVertexPosition::Type InPosition)
+	{
+		return InPosition == EVertexPosition::Float3 ? 12 : 8;
+	}
+
+	uint32_t GetNormalSize(EVertexNormal::Type InNormal)
+	{
+		return InNormal == EVertexNormal::Float3 ? 12 : 4;
+	}
+
+	uint32_t GetTexcoordSize(EVertexTexcoord::Type InTexcoord)
+	{
+		return InTexcoord == EVertexTexcoord::Float2 ? 8 : InTexcoord == EVertexTexcoord::Half2 ? 4 : 0;
+	}
+
+	// Round to the nearest normalized integer, like the GPU conversion of floats.
+	int32_t QuantizeSnorm(float InValue, float InMax)
+	{
+		return (int32_t)lrintf(max(-1.f, min(1.f, InValue)) * InMax);
+	}
+
+	float DequantizeSnorm(int32_t InValue, float InMax)
+	{
+		return max(InValue * (1.f / InMax), -1.f);
+	}
+
+	void Normalize(float InOutVector[3])
+	{
+		float LengthSq = InOutVector[0] * InOutVector[0] + InOutVector[1] * InOutVector[1] + InOutVector[2] * InOutVector[2];
+		if (LengthSq <= 0)
+		{
+			InOutVector[0] = InOutVector[1] = 0;
+			InOutVector[2] = 1;
+			return;
+		}
+		float InvLength = 1.f / sqrtf(LengthSq);
+		InOutVector[0] *= InvLength;
+		InOutVector[1] *= InvLength;
+		InOutVector[2] *= InvLength;
+	}
+
+	// Octahedral coordinates of a unit normal in snorm integers, choosing the rounding closest in angle.
+	void QuantizeOctahedral(const float InNormal[3], float InMax, int32_t OutOct[2])
+	{
+		float Oct[2];
+		CVertexQuantizer::EncodeOctahedral(InNormal, Oct);
+		// a NaN normal matches no corner and keeps the zero code
+		OutOct[0] = 0;
+		OutOct[1] = 0;
+		float BestDot = -2;
+		for (int Corner = 0; Corner < 4; ++Corner)
+		{
+			int32_t Candidate[2] =
+			{
+				(int32_t)((Corner & 1) ? ceilf(Oct[0] * InMax) : floorf(Oct[0] * InMax)),
+				(int32_t)((Corner & 2) ? ceilf(Oct[1] * InMax) : floorf(Oct[1] * InMax)),
+			};
+			float Decoded[3];
+			float CandidateOct[2] = { DequantizeSnorm(Candidate[0], InMax), DequantizeSnorm(Candidate[1], InMax) };
+			CVertexQuantizer::DecodeOctahedral(CandidateOct, Decoded);
+			float Dot = Decoded[0] * InNormal[0] + Decoded[1] * InNormal[1] + Decoded[2] * InNormal[2];
+			if (Dot > BestDot)
+			{
+				BestDot = Dot;
+				OutOct[0] = Candidate[0];
+				OutOct[1] = Candidate[1];
+			}
+		}
+	}
+
+	// Unit normal of a vertex, which need not be normalized.
+	void GetUnitNormal(const FDecodedVertex& InVertex, float OutNormal[3])
+	{
+		memcpy(OutNormal, InVertex.mNormal, sizeof(float) * 3);
+		Normalize(OutNormal);
+	}
+
+#if VERTEX_DECODE_SSE2
+	// Halves in the low 16 bits of each lane to floats, exact for all values including subnormals and infinity.
+	__m128 HalfToFloat(__m128i InHalves)
+	{
+		const __m128i ExpMask = _mm_set1_epi32(0x7c00 << 13);
+		const __m128i Rebias = _mm_set1_epi32((127 - 15) << 23);
+		__m128i Sign = _mm_slli_epi32(_mm_and_si128(InHalves, _mm_set1_epi32(0x8000)), 16);
+		__m128i Bits = _mm_slli_epi32(_mm_and_si128(InHalves, _mm_set1_epi32(0x7fff)), 13);
+		__m128i Exp = _mm_and_si128(Bits, ExpMask);
+		Bits = _mm_add_epi32(Bits, Rebias);
+		// infinity and nan keep the largest exponent
+		Bits = _mm_add_epi32(Bits, _mm_and_si128(_mm_cmpeq_epi32(Exp, ExpMask), Rebias));
+		// subnormals are renormalized by the float unit
+		__m128i bSubnormal = _mm_cmpeq_epi32(Exp, _mm_setzero_si128());
+		__m128 Subnormal = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(Bits, _mm_set1_epi32(1 << 23))),
+			_mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+		__m128 Value = _mm_or_ps(_mm_and_ps(_mm_castsi128_ps(bSubnormal), Subnormal),
+			_mm_andnot_ps(_mm_castsi128_ps(bSubnormal), _mm_castsi128_ps(Bits)));
+		return _mm_or_ps(Value, _mm_castsi128_ps(Sign));
+	}
+
+	// 32 bits at InOffset of four vertices, one per lane.
+	__m128i LoadDwords(const uint8_t* InVertices, uint32_t InStride, uint32_t InOffset)
+	{
+		int32_t Dwords[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			memcpy(&Dwords[k], InVertices + k * InStride + InOffset, 4);
+		}
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(Dwords));
+	}
+
+	// Float at InOffset of four vertices, one per lane.
+	__m128 LoadFloats(const uint8_t* InVertices, uint32_t InStride, uint32_t InOffset)
+	{
+		return _mm_castsi128_ps(LoadDwords(InVertices, InStride, InOffset));
+	}
+
+	// Decode four vertices, positions stay in AoS form while normals and texture coordinates are decoded in SoA.
+	void DecodeFour(const FVertexFormat& InFormat, const uint8_t* InVertices, FDecodedVertex* OutVertices)
+	{
+		uint32_t Stride = InFormat.mStride;
+
+		// positions, the fourth lane spills into the normal which is written afterwards
+		if (InFormat.mPosition == EVertexPosition::Float3)
+		{
+			for (int k = 0; k < 4; ++k)
+			{
+				memcpy(OutVertices[k].mPosition, InVertices + k * Stride, sizeof(float) * 3);
+			}
+		}
+		else
+		{
+			bool bSnorm = InFormat.mPosition == EVertexPosition::Snorm16;
+			__m128 Scale = _mm_setr_ps(InFormat.mPositionScale[0], InFormat.mPositionScale[1], InFormat.mPositionScale[2], 0);
+			__m128 Bias = _mm_setr_ps(InFormat.mPositionBias[0], InFormat.mPositionBias[1], InFormat.mPositionBias[2], 0);
+			__m128 InvMax = _mm_set1_ps(bSnorm ? 1.f / Snorm16Max : 1.f / Unorm16Max);
+			for (int k = 0; k < 4; ++k)
+			{
+				__m128i Packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(InVertices + k * Stride));
+				// widen with sign or zero extension
+				__m128i Wide = bSnorm ? _mm_srai_epi32(_mm_unpacklo_epi16(Packed, Packed), 16)
+					: _mm_unpacklo_epi16(Packed, _mm_setzero_si128());
+				__m128 Stored = _mm_mul_ps(_mm_cvtepi32_ps(Wide), InvMax);
+				if (bSnorm)
+				{
+					Stored = _mm_max_ps(Stored, _mm_set1_ps(-1.f));
+				}
+				_mm_storeu_ps(OutVertices[k].mPosition, _mm_add_ps(_mm_mul_ps(Stored, Scale), Bias));
+			}
+		}
+
+		__m128 NX, NY, NZ;
+		if (InFormat.mNormal == EVertexNormal::Float3)
+		{
+			NX = LoadFloats(InVertices, Stride, InFormat.mNormalOffset);
+			NY = LoadFloats(InVertices, Stride, InFormat.mNormalOffset + 4);
+			NZ = LoadFloats(InVertices, Stride, InFormat.mNormalOffset + 8);
+		}
+		else
+		{
+			__m128i Packed = LoadDwords(InVertices, Stride, InFormat.mNormalOffset);
+			__m128i IntX, IntY;
+			float Max;
+			if (InFormat.mNormal == EVertexNormal::Oct16)
+			{
+				IntX = _mm_srai_epi32(_mm_slli_epi32(Packed, 16), 16);
+				IntY = _mm_srai_epi32(Packed, 16);
+				Max = Snorm16Max;
+			}
+			else
+			{
+				IntX = _mm_srai_epi32(_mm_slli_epi32(Packed, 24), 24);
+				IntY = _mm_srai_epi32(_mm_slli_epi32(Packed, 16), 24);
+				Max = Snorm8Max;
+			}
+			__m128 MinusOne = _mm_set1_ps(-1.f);
+			__m128 InvMax = _mm_set1_ps(1.f / Max);
+			NX = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(IntX), InvMax), MinusOne);
+			NY = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(IntY), InvMax), MinusOne);
+
+			// fold the lower hemisphere back, x -= sign(x) * max(-z, 0)
+			__m128 SignMask = _mm_set1_ps(-0.f);
+			__m128 AbsX = _mm_andnot_ps(SignMask, NX);
+			__m128 AbsY = _mm_andnot_ps(SignMask, NY);
+			NZ = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.f), AbsX), AbsY);
+			__m128 Fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), NZ), _mm_setzero_ps());
+			NX = _mm_sub_ps(NX, _mm_or_ps(Fold, _mm_and_ps(NX, SignMask)));
+			NY = _mm_sub_ps(NY, _mm_or_ps(Fold, _mm_and_ps(NY, SignMask)));
+
+			__m128 LengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(NX, NX), _mm_mul_ps(NY, NY)), _mm_mul_ps(NZ, NZ));
+			__m128 InvLength = _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(LengthSq));
+			NX = _mm_mul_ps(NX, InvLength);
+			NY = _mm_mul_ps(NY, InvLength);
+			NZ = _mm_mul_ps(NZ, InvLength);
+		}
+
+		__m128 U = _mm_setzero_ps();
+		__m128 V = _mm_setzero_ps();
+		if (InFormat.mTexcoord == EVertexTexcoord::Float2)
+		{
+			U = LoadFloats(InVertices, Stride, InFormat.mTexcoordOffset);
+			V = LoadFloats(InVertices, Stride, InFormat.mTexcoordOffset + 4);
+		}
+		else if (InFormat.mTexcoord == EVertexTexcoord::Half2)
+		{
+			__m128i Packed = LoadDwords(InVertices, Stride, InFormat.mTexcoordOffset);
+			U = HalfToFloat(_mm_and_si128(Packed, _mm_set1_epi32(0xffff)));
+			V = HalfToFloat(_mm_srli_epi32(Packed, 16));
+		}
+
+		// normal and texture coordinates are the last five floats of each vertex
+		__m128 Row0 = NY, Row1 = NZ, Row2 = U, Row3 = V;
+		_MM_TRANSPOSE4_PS(Row0, Row1, Row2, Row3);
+		float X[4];
+		_mm_storeu_ps(X, NX);
+		_mm_storeu_ps(&OutVertices[0].mNormal[1], Row0);
+		_mm_storeu_ps(&OutVertices[1].mNormal[1], Row1);
+		_mm_storeu_ps(&OutVertices[2].mNormal[1], Row2);
+		_mm_storeu_ps(&OutVertices[3].mNormal[1], Row3);
+		for (int k = 0; k < 4; ++k)
+		{
+			OutVertices[k].mNormal[0] = X[k];
+		}
+	}
+#endif
+}
+
+FVertexFormat::FVertexFormat(EVertexTexcoord::Type InTexcoord)
+{
+	SetFormats(EVertexPosition::Float3, EVertexNormal::Float3, InTexcoord);
+	for (int i = 0; i < 3; ++i)
+	{
+		mPositionScale[i] = 1;
+		mPositionBias[i] = 0;
+	}
+}
+
+void FVertexFormat::SetFormats(EVertexPosition::Type InPosition, EVertexNormal::Type InNormal, EVertexTexcoord::Type InTexcoord)
+{
+	mPosition = InPosition;
+	mNormal = InNormal;
+	mTexcoord = InTexcoord;
+	mNormalOffset = GetPositionSize(InPosition);
+	mTexcoordOffset = mNormalOffset + GetNormalSize(InNormal);
+	mStride = mTexcoordOffset + GetTexcoordSize(InTexcoord);
+}
+
+FVertexQuantizeSettings::FVertexQuantizeSettings()
+	: mMaxNormalErrorDegrees(.5f)
+	// half a texel of a 2048 texture
+	, mMaxTexcoordError(1.f / 4096)
+	, bQuantizePositions(true)
+{
+
+}
+
+void CVertexQuantizer::EncodeOctahedral(const float InNormal[3], float OutOct[2])
+{
+	float L1 = fabsf(InNormal[0]) + fabsf(InNormal[1]) + fabsf(InNormal[2]);
+	float X = L1 > 0 ? InNormal[0] / L1 : 0;
+	float Y = L1 > 0 ? InNormal[1] / L1 : 0;
+	if (InNormal[2] < 0)
+	{
+		float FoldedX = (1 - fabsf(Y)) * (X >= 0 ? 1 : -1);
+		float FoldedY = (1 - fabsf(X)) * (Y >= 0 ? 1 : -1);
+		X = FoldedX;
+		Y = FoldedY;
+	}
+	OutOct[0] = X;
+	OutOct[1] = Y;
+}
+
+void CVertexQuantizer::DecodeOctahedral(const float InOct[2], float OutNormal[3])
+{
+	float X = InOct[0];
+	float Y = InOct[1];
+	float Z = 1 - fabsf(X) - fabsf(Y);
+	float Fold = max(-Z, 0.f);
+	OutNormal[0] = X >= 0 ? X - Fold : X + Fold;
+	OutNormal[1] = Y >= 0 ? Y - Fold : Y + Fold;
+	OutNormal[2] = Z;
+	Normalize(OutNormal);
+}
+
+FVertexFormat CVertexQuantizer::ChooseFormat(const FDecodedVertex* InVertices, size_t InNumVertices, bool bInHasTexcoord,
+	const FVertexQuantizeSettings& InSettings)
+{
+	FVertexFormat Format;
+
+	// positions against the bounds, unless they fit the snorm range as they are
+	EVertexPosition::Type Position = EVertexPosition::Float3;
+	if (InSettings.bQuantizePositions && InNumVertices > 0)
+	{
+		float Min[3] = { InVertices[0].mPosition[0], InVertices[0].mPosition[1], InVertices[0].mPosition[2] };
+		float Max[3] = { Min[0], Min[1], Min[2] };
+		for (size_t i = 1; i < InNumVertices; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Min[k] = min(Min[k], InVertices[i].mPosition[k]);
+				Max[k] = max(Max[k], InVertices[i].mPosition[k]);
+			}
+		}
+		bool bUnitCube = true;
+		for (int k = 0; k < 3; ++k)
+		{
+			bUnitCube = bUnitCube && Min[k] >= -1 && Max[k] <= 1;
+		}
+		Position = bUnitCube ? EVertexPosition::Snorm16 : EVertexPosition::Unorm16;
+		for (int k = 0; k < 3 && !bUnitCube; ++k)
+		{
+			Format.mPositionBias[k] = Min[k];
+			Format.mPositionScale[k] = Max[k] > Min[k] ? Max[k] - Min[k] : 1.f;
+		}
+	}
+
+	// the smaller normals if they are accurate enough
+	float MinCosine = cosf(InSettings.mMaxNormalErrorDegrees * 3.14159265f / 180);
+	EVertexNormal::Type Normal = EVertexNormal::Oct8;
+	for (size_t i = 0; i < InNumVertices && Normal == EVertexNormal::Oct8; ++i)
+	{
+		float Unit[3];
+		GetUnitNormal(InVertices[i], Unit);
+		int32_t Oct[2];
+		QuantizeOctahedral(Unit, Snorm8Max, Oct);
+		float Decoded[3];
+		float OctFloat[2] = { DequantizeSnorm(Oct[0], Snorm8Max), DequantizeSnorm(Oct[1], Snorm8Max) };
+		DecodeOctahedral(OctFloat, Decoded);
+		if (Decoded[0] * Unit[0] + Decoded[1] * Unit[1] + Decoded[2] * Unit[2] < MinCosine)
+		{
+			Normal = EVertexNormal::Oct16;
+		}
+	}
+
+	EVertexTexcoord::Type Texcoord = bInHasTexcoord ? EVertexTexcoord::Half2 : EVertexTexcoord::None;
+	for (size_t i = 0; i < InNumVertices && Texcoord == EVertexTexcoord::Half2; ++i)
+	{
+		for (int k = 0; k < 2; ++k)
+		{
+			float Value = InVertices[i].mTexcoord[k];
+			if (!(fabsf(HalfFloat::ToFloat(HalfFloat::FromFloat(Value)) - Value) <= InSettings.mMaxTexcoordError))
+			{
+				Texcoord = EVertexTexcoord::Float2;
+			}
+		}
+	}
+
+	Format.SetFormats(Position, Normal, Texcoord);
+	return Format;
+}
+
+void CVertexQuantizer::Encode(const FVertexFormat& InFormat, const FDecodedVertex* InVertices, size_t InNumVertices, void* OutVertices)
+{
+	uint8_t* pVertices = static_cast<uint8_t*>(OutVertices);
+	memset(pVertices, 0, InNumVertices * InFormat.mStride);
+	for (size_t i = 0; i < InNumVertices; ++i)
+	{
+		const FDecodedVertex& Vertex = InVertices[i];
+		uint8_t* pVertex = pVertices + i * InFormat.mStride;
+
+		if (InFormat.mPosition == EVertexPosition::Float3)
+		{
+			memcpy(pVertex, Vertex.mPosition, sizeof(float) * 3);
+		}
+		else
+		{
+			// w is one
+			int16_t Snorm[4];
+			uint16_t Unorm[4];
+			for (int k = 0; k < 3; ++k)
+			{
+				float Stored = (Vertex.mPosition[k] - InFormat.mPositionBias[k]) / InFormat.mPositionScale[k];
+				Snorm[k] = (int16_t)QuantizeSnorm(Stored, Snorm16Max);
+				Unorm[k] = (uint16_t)lrintf(max(0.f, min(1.f, Stored)) * Unorm16Max);
+			}
+			Snorm[3] = (int16_t)Snorm16Max;
+			Unorm[3] = (uint16_t)Unorm16Max;
+			memcpy(pVertex, InFormat.mPosition == EVertexPosition::Snorm16 ? (const void*)Snorm : (const void*)Unorm, 8);
+		}
+
+		uint8_t* pNormal = pVertex + InFormat.mNormalOffset;
+		float Unit[3];
+		GetUnitNormal(Vertex, Unit);
+		if (InFormat.mNormal == EVertexNormal::Float3)
+		{
+			memcpy(pNormal, Vertex.mNormal, sizeof(float) * 3);
+		}
+		else if (InFormat.mNormal == EVertexNormal::Oct16)
+		{
+			int32_t Oct[2];
+			QuantizeOctahedral(Unit, Snorm16Max, Oct);
+			int16_t Packed[2] = { (int16_t)Oct[0], (int16_t)Oct[1] };
+			memcpy(pNormal, Packed, sizeof(Packed));
+		}
+		else
+		{
+			int32_t Oct[2];
+			QuantizeOctahedral(Unit, Snorm8Max, Oct);
+			int8_t Packed[2] = { (int8_t)Oct[0], (int8_t)Oct[1] };
+			memcpy(pNormal, Packed, sizeof(Packed));
+		}
+
+		uint8_t* pTexcoord = pVertex + InFormat.mTexcoordOffset;
+		if (InFormat.mTexcoord == EVertexTexcoord::Float2)
+		{
+			memcpy(pTexcoord, Vertex.mTexcoord, sizeof(float) * 2);
+		}
+		else if (InFormat.mTexcoord == EVertexTexcoord::Half2)
+		{
+			uint16_t Packed[2] = { HalfFloat::FromFloat(Vertex.mTexcoord[0]), HalfFloat::FromFloat(Vertex.mTexcoord[1]) };
+			memcpy(pTexcoord, Packed, sizeof(Packed));
+		}
+	}
+}
+
+void CVertexQuantizer::DecodeScalar(const FVertexFormat& InFormat, const void* InVertices, size_t InNumVertices, FDecodedVertex* OutVertices)
+{
+	const uint8_t* pVertices = static_cast<const uint8_t*>(InVertices);
+	for (size_t i = 0; i < InNumVertices; ++i)
+	{
+		FDecodedVertex& Vertex = OutVertices[i];
+		const uint8_t* pVertex = pVertices + i * InFormat.mStride;
+
+		if (InFormat.mPosition == EVertexPosition::Float3)
+		{
+			memcpy(Vertex.mPosition, pVertex, sizeof(float) * 3);
+		}
+		else
+		{
+			int16_t Snorm[3];
+			uint16_t Unorm[3];
+			memcpy(Snorm, pVertex, sizeof(Snorm));
+			memcpy(Unorm, pVertex, sizeof(Unorm));
+			for (int k = 0; k < 3; ++k)
+			{
+				float Stored = InFormat.mPosition == EVertexPosition::Snorm16 ? DequantizeSnorm(Snorm[k], Snorm16Max)
+					: Unorm[k] * (1.f / Unorm16Max);
+				Vertex.mPosition[k] = Stored * InFormat.mPositionScale[k] + InFormat.mPositionBias[k];
+			}
+		}
+
+		const uint8_t* pNormal = pVertex + InFormat.mNormalOffset;
+		if (InFormat.mNormal == EVertexNormal::Float3)
+		{
+			memcpy(Vertex.mNormal, pNormal, sizeof(float) * 3);
+		}
+		else
+		{
+			float Oct[2];
+			if (InFormat.mNormal == EVertexNormal::Oct16)
+			{
+				int16_t Packed[2];
+				memcpy(Packed, pNormal, sizeof(Packed));
+				Oct[0] = DequantizeSnorm(Packed[0], Snorm16Max);
+				Oct[1] = DequantizeSnorm(Packed[1], Snorm16Max);
+			}
+			else
+			{
+				int8_t Packed[2];
+				memcpy(Packed, pNormal, sizeof(Packed));
+				Oct[0] = DequantizeSnorm(Packed[0], Snorm8Max);
+				Oct[1] = DequantizeSnorm(Packed[1], Snorm8Max);
+			}
+			DecodeOctahedral(Oct, Vertex.mNormal);
+		}
+
+		const uint8_t* pTexcoord = pVertex + InFormat.mTexcoordOffset;
+		if (InFormat.mTexcoord == EVertexTexcoord::Float2)
+		{
+			memcpy(Vertex.mTexcoord, pTexcoord, sizeof(float) * 2);
+		}
+		else if (InFormat.mTexcoord == EVertexTexcoord::Half2)
+		{
+			uint16_t Packed[2];
+			memcpy(Packed, pTexcoord, sizeof(Packed));
+			Vertex.mTexcoord[0] = HalfFloat::ToFloat(Packed[0]);
+			Vertex.mTexcoord[1] = HalfFloat::ToFloat(Packed[1]);
+		}
+		else
+		{
+			Vertex.mTexcoord[0] = Vertex.mTexcoord[1] = 0;
+		}
+	}
+}
+
+void CVertexQuantizer::Decode(const FVertexFormat& InFormat, const void* InVertices, size_t InNumVertices, FDecodedVertex* OutVertices)
+{
+	const uint8_t* pVertices = static_cast<const uint8_t*>(InVertices);
+	size_t i = 0;
+#if VERTEX_DECODE_SSE2
+	for (; i + 4 <= InNumVertices; i += 4)
+	{
+		DecodeFour(InFormat, pVertices + i * InFormat.mStride, OutVertices + i);
+	}
+#endif
+	DecodeScalar(InFormat, pVertices + i * InFormat.mStride, InNumVertices - i, OutVertices + i);
+}
+
+bool CVertexQuantizer::ReadSdkMeshVertices(const FSdkMeshVertexView& InView, vector<FDecodedVertex>& OutVertices,
+	bool& bOutHasTexcoord)
+{
+	// first element of each usage in stream 0
+	const FSdkMeshVertexElement* pPosition = nullptr;
+	const FSdkMeshVertexElement* pNormal = nullptr;
+	const FSdkMeshVertexElement* pTexcoord = nullptr;
+	for (const FSdkMeshVertexElement* pElement = InView.mDecl; pElement->mStream != 0xff; ++pElement)
+	{
+		if (pElement->mStream != 0 || pElement->mUsageIndex != 0)
+			continue;
+		uint32_t Size = pElement->mType == DeclTypeFloat3 ? 12 : pElement->mType == DeclTypeFloat2 ? 8 : 0;
+		if (Size == 0 || pElement->mOffset + Size > InView.mStride)
+			continue;
+		if (pElement->mUsage == DeclUsagePosition && Size == 12 && pPosition == nullptr)
+		{
+			pPosition = pElement;
+		}
+		else if (pElement->mUsage == DeclUsageNormal && Size == 12 && pNormal == nullptr)
+		{
+			pNormal = pElement;
+		}
+		else if (pElement->mUsage == DeclUsageTexcoord && Size == 8 && pTexcoord == nullptr)
+		{
+			pTexcoord = pElement;
+		}
+	}
+	if (pPosition == nullptr || pNormal == nullptr)
+		return false;
+
+	bOutHasTexcoord = pTexcoord != nullptr;
+	OutVertices.resize((size_t)InView.mNumVertices);
+	for (size_t i = 0; i < OutVertices.size(); ++i)
+	{
+		const uint8_t* pVertex = InView.mData + i * InView.mStride;
+		FDecodedVertex& Vertex = OutVertices[i];
+		memcpy(Vertex.mPosition, pVertex + pPosition->mOffset, sizeof(Vertex.mPosition));
+		memcpy(Vertex.mNormal, pVertex + pNormal->mOffset, sizeof(Vertex.mNormal));
+		if (pTexcoord != nullptr)
+		{
+			memcpy(Vertex.mTexcoord, pVertex + pTexcoord->mOffset, sizeof(Vertex.mTexcoord));
+		}
+		else
+		{
+			Vertex.mTexcoord[0] = Vertex.mTexcoord[1] = 0;
+		}
+	}
+	return true;
+}
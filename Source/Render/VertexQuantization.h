@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+struct FSdkMeshVertexView;
+
+// Storage of vertex positions.
+namespace EVertexPosition
+{
+	enum Type
+	{
+		// DXGI_FORMAT_R32G32B32_FLOAT
+		Float3 = 0,
+		// DXGI_FORMAT_R16G16B16A16_SNORM as is, for meshes inside the unit cube
+		Snorm16,
+		// DXGI_FORMAT_R16G16B16A16_UNORM against the mesh bounds
+		Unorm16,
+	};
+};
+
+// Storage of vertex normals.
+namespace EVertexNormal
+{
+	enum Type
+	{
+		// DXGI_FORMAT_R32G32B32_FLOAT
+		Float3 = 0,
+		// octahedral DXGI_FORMAT_R16G16_SNORM
+		Oct16,
+		// octahedral DXGI_FORMAT_R8G8_SNORM, padded to 4 bytes
+		Oct8,
+	};
+};
+
+// Storage of vertex texture coordinates.
+namespace EVertexTexcoord
+{
+	enum Type
+	{
+		None = 0,
+		// DXGI_FORMAT_R32G32_FLOAT
+		Float2,
+		// DXGI_FORMAT_R16G16_FLOAT
+		Half2,
+	};
+};
+
+// Vertex layout of a mesh: position, normal and texture coordinates in this order, each 4 byte aligned.
+struct FVertexFormat
+{
+	// Full precision layout, the one of Vertex_P3N3 and of the sdkmesh files.
+	FVertexFormat(EVertexTexcoord::Type InTexcoord = EVertexTexcoord::None);
+
+	// Set the formats and compute offsets and stride.
+	void SetFormats(EVertexPosition::Type InPosition, EVertexNormal::Type InNormal, EVertexTexcoord::Type InTexcoord);
+	bool IsQuantized() const { return mPosition != EVertexPosition::Float3 || mNormal != EVertexNormal::Float3 || mTexcoord == EVertexTexcoord::Half2; }
+
+	EVertexPosition::Type mPosition;
+	EVertexNormal::Type mNormal;
+	EVertexTexcoord::Type mTexcoord;
+	// positions are Stored * mPositionScale + mPositionBias, Stored in [0, 1] or [-1, 1] like the GPU reads them
+	float mPositionScale[3];
+	float mPositionBias[3];
+
+	// bytes from the vertex start
+	uint32_t mNormalOffset;
+	uint32_t mTexcoordOffset;
+	uint32_t mStride;
+};
+
+// Vertex attributes as floats, the input of the encoder and the output of the decoder.
+struct FDecodedVertex
+{
+	float mPosition[3];
+	float mNormal[3];
+	float mTexcoord[2];
+};
+
+// Tolerances of the format choice.
+struct FVertexQuantizeSettings
+{
+	FVertexQuantizeSettings();
+
+	// Oct8 is used when no normal deviates more than this, Oct16 otherwise
+	float mMaxNormalErrorDegrees;
+	// Half2 is used when no coordinate deviates more than this, Float2 otherwise
+	float mMaxTexcoordError;
+	// keep float positions, for meshes which need exact vertices
+	bool bQuantizePositions;
+};
+
+// Chooses compact vertex formats per mesh and converts vertices to and from them. Positions are stored as 16 bit
+// normalized integers, normals octahedral in 2 x 8 or 2 x 16 bits and texture coordinates as half floats where
+// the tolerances allow, halving the 32 byte float vertex of CDxMesh. Shaders undo the position scale and bias with
+// the per-object constants and decode normals with DecodeOctahedral of ShaderBuffers.fxc.
+class CVertexQuantizer
+{
+public:
+	// Choose the formats and position decoding of a mesh.
+	static FVertexFormat ChooseFormat(const FDecodedVertex* InVertices, size_t InNumVertices, bool bInHasTexcoord,
+		const FVertexQuantizeSettings& InSettings);
+
+	// Write InNumVertices vertices of InFormat, mStride bytes each.
+	static void Encode(const FVertexFormat& InFormat, const FDecodedVertex* InVertices, size_t InNumVertices, void* OutVertices);
+
+	// Read vertices of InFormat, one at a time.
+	static void DecodeScalar(const FVertexFormat& InFormat, const void* InVertices, size_t InNumVertices, FDecodedVertex* OutVertices);
+	// Read vertices of InFormat, four at a time with SSE2 where available. Matches DecodeScalar up to rounding.
+	static void Decode(const FVertexFormat& InFormat, const void* InVertices, size_t InNumVertices, FDecodedVertex* OutVertices);
+
+	// Read the float3 positions and normals and the optional float2 texture coordinates of a .sdkmesh vertex buffer.
+	// False if the declaration lacks float3 positions or normals.
+	static bool ReadSdkMeshVertices(const FSdkMeshVertexView& InView, vector<FDecodedVertex>& OutVertices, bool& bOutHasTexcoord);
+
+	// Octahedral mapping of a unit vector to [-1, 1]^2, and back.
+	static void EncodeOctahedral(const float InNormal[3], float OutOct[2]);
+	static void DecodeOctahedral(const float InOct[2], float OutNormal[3]);
+};
@@ -4,7 +4,7 @@
 struct VS_INPUT
 {
 	float4 vPosition	: POSITION;
-	float3 vNormal		: NORMAL;
+	VERTEX_NORMAL vNormal	: NORMAL;
 	float2 vTexcoord	: TEXCOORD0;
 };
 
@@ -21,10 +21,10 @@ VS_OUTPUT main( VS_INPUT Input )
 {
 	VS_OUTPUT Output;
 	
-	Output.vPosition = mul( Input.vPosition, World);
+	Output.vPosition = mul( DecodePosition(Input.vPosition), World);
 	Output.vPosition = mul(Output.vPosition, View);
 	Output.vPosition = mul(Output.vPosition, Proj);
-	Output.vNormal = mul( Input.vNormal, (float3x3)World);
+	Output.vNormal = mul( DECODE_NORMAL(Input.vNormal), (float3x3)World);
 	Output.vTexcoord = Input.vTexcoord;
 	
 	return Output;
@@ -1,10 +1,28 @@
 #include "ShaderBuffers.fxc"
+
+// all rects in one draw, material and linked reflectors come from the vertex shader
+#ifndef RECT_INSTANCING
+#define RECT_INSTANCING 0
+#endif
+
+#if RECT_INSTANCING
+// linked reflectors of all rects, each instance reads its own range
+StructuredBuffer<int> psReflectorLists : register(t3);
+static uint gReflectorOffset;
+static uint gNumReflectors;
+#define RELATED_PLANE(i) ((uint)(i) < gNumReflectors ? psReflectorLists[gReflectorOffset + (i)] : -1)
+#endif
+
 #include "RectGI.hlsl"
 
 struct PS_INPUT
 {
 	float3 Normal : NORMAL;
 	float4 WorldPos : TEXCOORD0;
+#if RECT_INSTANCING
+	nointerpolation float4 DiffuseRoughness : TEXCOORD1;
+	nointerpolation uint2 Reflectors : TEXCOORD2;
+#endif
 };
 
 float D_GGX(float a2, float NoH)
@@ -41,10 +59,20 @@ float4 main( PS_INPUT Input ) : SV_TARGET
 	bool bOnlyNoL = mToggleOptionsA[2];
 	bool bShowDiffuseGI = mToggleOptionsA[3];
 	
+#if RECT_INSTANCING
+	gReflectorOffset = Input.Reflectors.x;
+	gNumReflectors = Input.Reflectors.y;
+	float Roughness = Input.DiffuseRoughness.w;
+	float3 Diffuse = Input.DiffuseRoughness.xyz;
+	float3 EyePos = mEyePos;
+#else
 	float Roughness = Roughness4.x;
+	float3 Diffuse = DiffuseColor.xyz;
+	float3 EyePos = CameraPos.xyz;
+#endif
 	float a2 = Roughness * Roughness;
 
-	float3 CameraVector = normalize(CameraPos.xyz - WorldPos);
+	float3 CameraVector = normalize(EyePos - WorldPos);
 	float3 DirectionalLightDirection = normalize(mLightDir);
 	float NoV = max(0, dot(WorldNormal, CameraVector));
 	float NoL = max(0, dot(WorldNormal, DirectionalLightDirection));
@@ -61,12 +89,12 @@ float4 main( PS_INPUT Input ) : SV_TARGET
 	float3 OutColor = 0;
 	if (bShowBRDF)
 	{
-		OutColor += DiffuseColor.xyz * D * F * Vis * NoL;
+		OutColor += Diffuse * D * F * Vis * NoL;
 	}
 
 	// indirect lighting
 	OutColor *= LightIntensity;
-	OutColor += GILighting(WorldPos, WorldNormal, Roughness, DirectionalLightDirection, CameraPos.xyz);
+	OutColor += GILighting(WorldPos, WorldNormal, Roughness, DirectionalLightDirection, EyePos);
 
 	return float4(OutColor, 1);
 }
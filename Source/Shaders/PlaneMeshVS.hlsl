@@ -1,29 +1,55 @@
 #include "ShaderBuffers.fxc"
 
+// all rects in one draw, world matrix and material come from vertex stream 1
+#ifndef RECT_INSTANCING
+#define RECT_INSTANCING 0
+#endif
+
 struct VS_INPUT
 {
 	float4 Pos : POSITION;
-	float3 Normal : NORMAL;
+	VERTEX_NORMAL Normal : NORMAL;
+#if RECT_INSTANCING
+	// columns of the world matrix
+	float4 World0 : INSTANCE_WORLD0;
+	float4 World1 : INSTANCE_WORLD1;
+	float4 World2 : INSTANCE_WORLD2;
+	float4 DiffuseRoughness : INSTANCE_MATERIAL;
+	uint2 Reflectors : INSTANCE_REFLECTORS;
+#endif
 };
 
 struct VS_OUTPUT
 {
 	float3 Normal : NORMAL;
 	float4 WorldPos : TEXCOORD0;
+#if RECT_INSTANCING
+	nointerpolation float4 DiffuseRoughness : TEXCOORD1;
+	nointerpolation uint2 Reflectors : TEXCOORD2;
+#endif
 	float4 Pos : SV_POSITION;
 };
 
 VS_OUTPUT main( VS_INPUT Input )
 {
 	VS_OUTPUT Output;
+	float3 Normal = DECODE_NORMAL(Input.Normal);
 	
-	float4 WorldPos = mul(Input.Pos, World);
+#if RECT_INSTANCING
+	// the quad needs no position decoding, see CMiniEngine::CreateRectInstancing
+	float4 WorldPos = float4(dot(Input.Pos, Input.World0), dot(Input.Pos, Input.World1), dot(Input.Pos, Input.World2), 1);
+	float3 WorldNormal = float3(dot(Normal, Input.World0.xyz), dot(Normal, Input.World1.xyz), dot(Normal, Input.World2.xyz));
+	Output.DiffuseRoughness = Input.DiffuseRoughness;
+	Output.Reflectors = Input.Reflectors;
+#else
+	float4 WorldPos = mul(DecodePosition(Input.Pos), World);
+	float3 WorldNormal = mul(Normal, (float3x3)World);
+#endif
 	Output.WorldPos = WorldPos;
 	Output.Pos = mul(WorldPos, View);
 	Output.Pos = mul(Output.Pos, Proj);
 
-	Output.Normal = normalize(mul( Input.Normal, (float3x3)World));
+	Output.Normal = normalize(WorldNormal);
 	
 	return Output;
 }
-
@@ -5,6 +5,42 @@ static const float PI = 3.1415926535897932384626433832795f;
 static const float sgMinLambda = 4.60517f;
 static const int MAX_REFLECTOR_NUM = 3;
 
+// dense index in psRects of the i-th linked reflector of the shaded rect, negative past the last one
+#ifndef RELATED_PLANE
+#define RELATED_PLANE(i) mRelatedPlanes[i].x
+#endif
+
+// read the exp/log terms from the float16 tables of CpuGI/SGLightingLut.h
+#ifndef RECTGI_LIGHTING_LUT
+#define RECTGI_LIGHTING_LUT 0
+#endif
+
+#if RECTGI_LIGHTING_LUT
+Texture2D gSGLightingLut : register(t1);
+SamplerState gSGLightingLutSampler : register(s1);
+
+static const float LUT_WIDTH = 64;
+static const float LUT_HEIGHT = 2;
+static const float LUT_DISK_SCALE = 2;
+static const float LUT_DISK_OFFSET = 0.673f;
+static const float LUT_BANDWIDTH_MAX_X = 2;
+
+// linear lookup of a row at table coordinate x in [0, LUT_WIDTH - 1]
+float lutSampleRow(float row, float x)
+{
+	float2 uv = float2((x + .5f) / LUT_WIDTH, (row + .5f) / LUT_HEIGHT);
+	return gSGLightingLut.SampleLevel(gSGLightingLutSampler, uv, 0).r;
+}
+
+// 1 - exp(-t) for t >= -0.673
+float lutOneMinusExp(float t)
+{
+	float x = t + LUT_DISK_OFFSET;
+	float invScale = 1 / (x + LUT_DISK_SCALE);
+	return t * lutSampleRow(0, x * invScale * (LUT_WIDTH - 1)) * invScale;
+}
+#endif
+
 // Spherical Gaussian
 struct SG
 {
@@ -75,7 +111,12 @@ float sgIntegral(float lambda, float mu)
 float asgCalcBandwidth(float dr)
 {
 	float dr2 = dr * dr;
+#if RECTGI_LIGHTING_LUT
+	float x = min(dr2, LUT_BANDWIDTH_MAX_X) * ((LUT_WIDTH - 1) / LUT_BANDWIDTH_MAX_X);
+	float bw = max(sgMinLambda, lutSampleRow(1, x) / dr2);
+#else
 	float bw = max(sgMinLambda, -(((1 + dr2) * (-5.991f + log(1 + dr2))) / (2 * dr2)));
+#endif
 	return bw;
 }
 
@@ -144,7 +185,11 @@ float gIntegrateDiskLighting(float3 shadingPt, float3 diskPt, float3 diskNormal,
 		float drCos = dr * nol;
 		float drCos2 = drCos * drCos;
 		float approxSinThetaA2 = drCos2 / (1 + drCos2);
+#if RECTGI_LIGHTING_LUT
+		float midTerm = lutOneMinusExp(k * approxSinThetaA2) / (2 * k);
+#else
 		float midTerm = (1 - exp(-k * approxSinThetaA2)) / (2 * k);
+#endif
 
 		float gDGGX0 = 1 / (m2 * PI);
 		float lyr = PI * m2 * gDGGX0 * nol;
@@ -293,8 +338,9 @@ float3 sgGlossyReflection(float3 shadingPt, float3 inShadingNormal, float shadin
 				// shading point
 				shadingPt, inShadingNormal, shadingRoughness, samplingRadius,
 				// reflection plane
-				plCenter_DifX[plId].xyz, plNorm_DifY[plId].xyz, plAxis_DifZ[plId].xyz, defaultSpecularColor,
-				plElement0[plId].z, plElement0[plId].w, plElement0[plId].y,
+				psRects[plId].plCenter_DifX.xyz, psRects[plId].plNorm_DifY.xyz, psRects[plId].plAxis_DifZ.xyz,
+				defaultSpecularColor,
+				psRects[plId].plElement0.z, psRects[plId].plElement0.w, psRects[plId].plElement0.y,
 				// light
 				inLightDir, lightIntensity, viewPoint
 			);
@@ -374,8 +420,9 @@ float3 gDiffuseReflection(float3 shadingPt, float3 inLightDir, float lightIntens
 				// shading point
 				shadingPt, samplingRadius,
 				// reflection plane
-				plCenter_DifX[pid].xyz, plNorm_DifY[pid].xyz, plAxis_DifZ[pid].xyz,
-				plElement0[pid].z, plElement0[pid].w, float3(plCenter_DifX[pid].w, plNorm_DifY[pid].w, plAxis_DifZ[pid].w),
+				psRects[pid].plCenter_DifX.xyz, psRects[pid].plNorm_DifY.xyz, psRects[pid].plAxis_DifZ.xyz,
+				psRects[pid].plElement0.z, psRects[pid].plElement0.w,
+				float3(psRects[pid].plCenter_DifX.w, psRects[pid].plNorm_DifY.w, psRects[pid].plAxis_DifZ.w),
 				// light
 				inLightDir, lightIntensity
 			);
@@ -395,12 +442,12 @@ SGReflectors findDiffuseRelatedPlanes(float3 shadingPt, float3 inShadingNormal)
 	[unroll]
 	for (int i = 0; i < MAX_RELATED_PLANE_NUM; i++)
 	{
-		int plId = int(mRelatedPlanes[i].x + .1f);
+		int plId = int(RELATED_PLANE(i));
 		if (plId < 0)
 			break;
 
-		float3 plCenter = plCenter_DifX[plId].xyz;
-		float3 plNormal = plNorm_DifY[plId].xyz;
+		float3 plCenter = psRects[plId].plCenter_DifX.xyz;
+		float3 plNormal = psRects[plId].plNorm_DifY.xyz;
 
 		float3 projPt = gCalcProjPoint(plNormal, plCenter, shadingPt);
 		float3 viewDir = shadingPt - projPt;
@@ -431,16 +478,16 @@ SGReflectors findSpecularRelatedPlanes(float3 shadingPt, float3 inShadingNormal,
 	[unroll]
 	for (int i = 0; i < MAX_RELATED_PLANE_NUM; i++)
 	{
-		int plId = int(mRelatedPlanes[i].x + .1f);
+		int plId = int(RELATED_PLANE(i));
 		if (plId < 0)
 			break;
 
-		float roughness = plElement0[plId].y;
+		float roughness = psRects[plId].plElement0.y;
 		if (roughness > .3f)
 			continue;
 
-		float3 plCenter = plCenter_DifX[plId].xyz;
-		float3 plNormal = plNorm_DifY[plId].xyz;
+		float3 plCenter = psRects[plId].plCenter_DifX.xyz;
+		float3 plNormal = psRects[plId].plNorm_DifY.xyz;
 
 		float3 projPt = gCalcProjPoint(plNormal, plCenter, shadingPt);
 		float3 viewDir = shadingPt - projPt;